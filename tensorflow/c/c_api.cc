@@ -75,6 +75,8 @@ limitations under the License.
 // brain namespace because we are defining 'extern "C"' functions.
 using tensorflow::AllocationDescription;
 using tensorflow::DataType;
+using tensorflow::DataTypeCanUseMemcpy;
+using tensorflow::DataTypeString;
 using tensorflow::ExtendSessionGraphHelper;
 using tensorflow::Graph;
 using tensorflow::GraphDef;
@@ -2389,6 +2391,144 @@ void TF_SessionPRun(TF_Session* session, const char* handle,
                 output_values, target_names, nullptr, status);
 }
 
+TF_SessionCallable* TF_SessionMakeCallable(
+    TF_Session* session, const TF_Buffer* run_options, const TF_Output* inputs,
+    int ninputs, const TF_Output* outputs, int noutputs,
+    const TF_Operation* const* target_opers, int ntargets,
+    TF_Status* status) {
+  if (session->extend_before_run &&
+      !ExtendSessionGraphHelper(session, status)) {
+    return nullptr;
+  }
+
+  tensorflow::CallableOptions callable_options;
+  if (run_options != nullptr &&
+      !callable_options.mutable_run_options()->ParseFromArray(
+          run_options->data, run_options->length)) {
+    status->status = InvalidArgument("Unparseable RunOptions proto");
+    return nullptr;
+  }
+  for (int i = 0; i < ninputs; ++i) {
+    callable_options.add_feed(OutputName(inputs[i]));
+  }
+  for (int i = 0; i < noutputs; ++i) {
+    callable_options.add_fetch(OutputName(outputs[i]));
+  }
+  for (int i = 0; i < ntargets; ++i) {
+    callable_options.add_target(target_opers[i]->node.name());
+  }
+
+  Session::CallableHandle handle;
+  status->status = session->session->MakeCallable(callable_options, &handle);
+  if (!status->status.ok()) return nullptr;
+  return new TF_SessionCallable{handle, ninputs, noutputs};
+}
+
+void TF_SessionRunCallable(TF_Session* session, TF_SessionCallable* callable,
+                           TF_Tensor* const* input_values, int ninputs,
+                           TF_Tensor** output_values, int noutputs,
+                           TF_Buffer* run_metadata, TF_Status* status) {
+  status->status = Status::OK();
+  if (ninputs != callable->ninputs || noutputs != callable->noutputs) {
+    status->status = InvalidArgument(
+        "Callable expects ", callable->ninputs, " inputs and ",
+        callable->noutputs, " outputs, but was run with ", ninputs,
+        " inputs and ", noutputs, " outputs");
+    return;
+  }
+  if (run_metadata != nullptr && run_metadata->data != nullptr) {
+    status->status =
+        InvalidArgument("Passing non-empty run_metadata is invalid.");
+    return;
+  }
+
+  // TF_TensorToTensor shares the buffers of the input tensors when possible.
+  std::vector<Tensor> feeds(ninputs);
+  for (int i = 0; i < ninputs; ++i) {
+    status->status = TF_TensorToTensor(input_values[i], &feeds[i]);
+    if (!status->status.ok()) return;
+  }
+
+  std::vector<Tensor> fetches;
+  RunMetadata run_metadata_proto;
+  status->status = session->session->RunCallable(
+      callable->handle, feeds, &fetches,
+      run_metadata != nullptr ? &run_metadata_proto : nullptr);
+  if (!status->status.ok()) return;
+  if (run_metadata != nullptr) {
+    status->status = MessageToBuffer(run_metadata_proto, run_metadata);
+    if (!status->status.ok()) return;
+  }
+
+  // Check all the preallocated outputs before allocating any tensor, so
+  // that a mismatch doesn't leave allocated tensors behind.
+  for (int i = 0; i < noutputs; ++i) {
+    const Tensor& src = fetches[i];
+    TF_Tensor* dst = output_values[i];
+    if (dst == nullptr) continue;
+    if (static_cast<DataType>(TF_TensorType(dst)) != src.dtype()) {
+      status->status = InvalidArgument(
+          "Output ", i, " has type ", DataTypeString(src.dtype()),
+          " but the preallocated tensor has type ",
+          DataTypeString(static_cast<DataType>(TF_TensorType(dst))));
+      return;
+    }
+    if (!DataTypeCanUseMemcpy(src.dtype())) {
+      status->status = InvalidArgument(
+          "Output ", i, " has type ", DataTypeString(src.dtype()),
+          " which can't be written into a preallocated tensor");
+      return;
+    }
+    bool same_shape = TF_NumDims(dst) == src.dims();
+    for (int d = 0; same_shape && d < src.dims(); ++d) {
+      same_shape = TF_Dim(dst, d) == src.dim_size(d);
+    }
+    if (!same_shape) {
+      status->status = InvalidArgument(
+          "Output ", i, " has shape ", src.shape().DebugString(),
+          " which doesn't match the shape of the preallocated tensor");
+      return;
+    }
+  }
+
+  std::vector<int> allocated;
+  for (int i = 0; i < noutputs; ++i) {
+    const Tensor& src = fetches[i];
+    TF_Tensor* dst = output_values[i];
+    if (dst != nullptr) {
+      // Write the output into the caller-owned tensor.
+      const tensorflow::StringPiece data = src.tensor_data();
+      if (!data.empty() && TF_TensorData(dst) != data.data()) {
+        memcpy(TF_TensorData(dst), data.data(), data.size());
+      }
+      continue;
+    }
+    if (!src.IsInitialized() || src.NumElements() == 0) {
+      output_values[i] =
+          EmptyTensor(static_cast<TF_DataType>(src.dtype()), src.shape());
+    } else {
+      output_values[i] = TF_TensorFromTensor(src, &status->status);
+    }
+    if (!status->status.ok()) {
+      // The NULL entries of output_values[] must remain NULL on failure.
+      for (int j : allocated) {
+        TF_DeleteTensor(output_values[j]);
+        output_values[j] = nullptr;
+      }
+      output_values[i] = nullptr;
+      return;
+    }
+    allocated.push_back(i);
+  }
+}
+
+void TF_SessionReleaseCallable(TF_Session* session,
+                               TF_SessionCallable* callable,
+                               TF_Status* status) {
+  status->status = session->session->ReleaseCallable(callable->handle);
+  delete callable;
+}
+
 unsigned char TF_TryEvaluateConstant(TF_Graph* graph, TF_Output output,
                                      TF_Tensor** result, TF_Status* status) {
   *result = nullptr;
@@ -1323,6 +1323,60 @@ TF_CAPI_EXPORT extern void TF_SessionPRun(
 // Once called, no more calls to TF_SessionPRun should be made.
 TF_CAPI_EXPORT extern void TF_DeletePRunHandle(const char* handle);
 
+// A subgraph of a session's graph with fixed feeds, fetches and targets,
+// created with TF_SessionMakeCallable. Running a callable skips the per-call
+// lookup of feeds and fetches by name that TF_SessionRun performs.
+typedef struct TF_SessionCallable TF_SessionCallable;
+
+// Prepares the subgraph that feeds `inputs`, fetches `outputs` and runs
+// `target_opers` for repeated execution with TF_SessionRunCallable.
+// `run_options`, if non-NULL, is a serialized RunOptions proto that applies
+// to every run of the callable.
+//
+// On success, returns a callable that must be released with
+// TF_SessionReleaseCallable. On failure, returns NULL.
+TF_CAPI_EXPORT extern TF_SessionCallable* TF_SessionMakeCallable(
+    TF_Session* session,
+    // RunOptions
+    const TF_Buffer* run_options,
+    // Input tensors
+    const TF_Output* inputs, int ninputs,
+    // Output tensors
+    const TF_Output* outputs, int noutputs,
+    // Target operations
+    const TF_Operation* const* target_opers, int ntargets,
+    // Output status
+    TF_Status*);
+
+// Runs `callable` with `input_values[i]` fed to the i-th input the callable
+// was created with. `ninputs` and `noutputs` must match the callable.
+//
+// If `output_values[i]` is non-NULL, it must point to a caller-owned tensor
+// with the type and shape of the i-th output, and the output is written
+// into its buffer; the caller keeps ownership and no new tensor is
+// allocated. Only types that can be copied with memcpy (i.e. not
+// TF_STRING or TF_RESOURCE) may be written into caller-owned tensors.
+// Otherwise `output_values[i]` is set to a newly allocated tensor owned by
+// the caller, which must eventually call TF_DeleteTensor on it.
+//
+// On failure, the NULL entries of output_values[] remain NULL and the
+// contents of caller-owned tensors are unspecified.
+TF_CAPI_EXPORT extern void TF_SessionRunCallable(
+    TF_Session* session, TF_SessionCallable* callable,
+    // Input tensors
+    TF_Tensor* const* input_values, int ninputs,
+    // Output tensors
+    TF_Tensor** output_values, int noutputs,
+    // RunMetadata
+    TF_Buffer* run_metadata,
+    // Output status
+    TF_Status*);
+
+// Releases the resources held by `callable` and deletes it. `callable` must
+// not be used after this call, even if the call fails.
+TF_CAPI_EXPORT extern void TF_SessionReleaseCallable(
+    TF_Session* session, TF_SessionCallable* callable, TF_Status* status);
+
 // --------------------------------------------------------------------------
 // The deprecated session API.  Please switch to the above instead of
 // TF_ExtendGraph(). This deprecated API can be removed at any time without
@@ -997,6 +997,100 @@ TEST(CAPI, Session) {
   TF_DeleteStatus(s);
 }
 
+TEST(CAPI, SessionCallable) {
+  TF_Status* s = TF_NewStatus();
+  TF_Graph* graph = TF_NewGraph();
+
+  TF_Operation* feed = Placeholder(graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Operation* two = ScalarConst(2, graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Operation* add = Add(feed, two, graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  CSession csession(graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Session* session = csession.mutable_session();
+
+  TF_Output input{feed, 0};
+  TF_Output output{add, 0};
+  TF_SessionCallable* callable = TF_SessionMakeCallable(
+      session, nullptr, &input, 1, &output, 1, nullptr, 0, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  ASSERT_TRUE(callable != nullptr);
+
+  // Let the session allocate the output.
+  TF_Tensor* in = Int32Tensor(3);
+  TF_Tensor* out = nullptr;
+  TF_SessionRunCallable(session, callable, &in, 1, &out, 1, nullptr, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  ASSERT_TRUE(out != nullptr);
+  EXPECT_EQ(TF_INT32, TF_TensorType(out));
+  EXPECT_EQ(0, TF_NumDims(out));
+  EXPECT_EQ(3 + 2, *static_cast<int32*>(TF_TensorData(out)));
+  TF_DeleteTensor(out);
+  TF_DeleteTensor(in);
+
+  // Write the output into a caller-owned tensor, repeatedly.
+  TF_Tensor* preallocated =
+      TF_AllocateTensor(TF_INT32, nullptr, 0, sizeof(int32));
+  for (int32 i = 0; i < 3; ++i) {
+    in = Int32Tensor(i);
+    out = preallocated;
+    TF_SessionRunCallable(session, callable, &in, 1, &out, 1, nullptr, s);
+    ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+    EXPECT_EQ(preallocated, out);
+    EXPECT_EQ(i + 2, *static_cast<int32*>(TF_TensorData(preallocated)));
+    TF_DeleteTensor(in);
+  }
+  TF_DeleteTensor(preallocated);
+
+  // Caller-owned tensors must match the type and shape of the output.
+  in = Int32Tensor(3);
+  const int64_t dims[] = {2};
+  TF_Tensor* wrong_shape =
+      TF_AllocateTensor(TF_INT32, dims, 1, 2 * sizeof(int32));
+  out = wrong_shape;
+  TF_SessionRunCallable(session, callable, &in, 1, &out, 1, nullptr, s);
+  EXPECT_EQ(TF_INVALID_ARGUMENT, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteTensor(wrong_shape);
+  TF_Tensor* wrong_type =
+      TF_AllocateTensor(TF_FLOAT, nullptr, 0, sizeof(float));
+  out = wrong_type;
+  TF_SessionRunCallable(session, callable, &in, 1, &out, 1, nullptr, s);
+  EXPECT_EQ(TF_INVALID_ARGUMENT, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteTensor(wrong_type);
+
+  // A mismatched output leaves the other NULL outputs NULL.
+  TF_Output outputs[] = {output, output};
+  TF_SessionCallable* two_outputs = TF_SessionMakeCallable(
+      session, nullptr, &input, 1, outputs, 2, nullptr, 0, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  wrong_type = TF_AllocateTensor(TF_FLOAT, nullptr, 0, sizeof(float));
+  TF_Tensor* outs[] = {nullptr, wrong_type};
+  TF_SessionRunCallable(session, two_outputs, &in, 1, outs, 2, nullptr, s);
+  EXPECT_EQ(TF_INVALID_ARGUMENT, TF_GetCode(s)) << TF_Message(s);
+  EXPECT_TRUE(outs[0] == nullptr);
+  TF_DeleteTensor(wrong_type);
+  TF_SessionReleaseCallable(session, two_outputs, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  // The number of inputs and outputs must match the callable.
+  out = nullptr;
+  TF_SessionRunCallable(session, callable, nullptr, 0, &out, 1, nullptr, s);
+  EXPECT_EQ(TF_INVALID_ARGUMENT, TF_GetCode(s)) << TF_Message(s);
+  EXPECT_TRUE(out == nullptr);
+  TF_DeleteTensor(in);
+
+  TF_SessionReleaseCallable(session, callable, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  csession.CloseAndDelete(s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteGraph(graph);
+  TF_DeleteStatus(s);
+}
+
 // If `device` is non-empty, run Min op on that device.
 // Otherwise run it on the default device (CPU).
 void RunMinTest(const string& device, bool use_XLA) {
@@ -13,6 +13,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "tensorflow/c/eager/c_api.h"
 #include "tensorflow/c/eager/c_api_experimental.h"
 #include "tensorflow/c/eager/c_api_internal.h"
@@ -472,6 +476,110 @@ void TestConnectToCluster(bool keep_localhost_for_first_connect) {
   tensorflow::unsetenv("GRPC_FAIL_FAST");
 }
 
+// Runs a sum all-reduce over the first CPU of each task in `tasks`, issuing
+// the op of every task from its own thread, and checks the result on each.
+void CheckCollectiveReduceOnTasks(TFE_Context* ctx,
+                                  const std::vector<int>& tasks,
+                                  int group_key, int instance_key) {
+  const int group_size = tasks.size();
+  float expected = 0;
+  for (int task : tasks) expected += task + 1;
+  std::vector<std::thread> threads;
+  for (int task : tasks) {
+    threads.emplace_back([ctx, task, group_size, group_key, instance_key,
+                          expected]() {
+      std::unique_ptr<TF_Status, decltype(&TF_DeleteStatus)> status(
+          TF_NewStatus(), TF_DeleteStatus);
+      const string device = tensorflow::strings::StrCat(
+          "/job:localhost/replica:0/task:", task, "/device:CPU:0");
+      float data[6];
+      std::fill(data, data + 6, task + 1.0f);
+      int64_t dims[] = {6};
+      TFE_TensorHandle* input =
+          TestTensorHandleWithDimsFloat(ctx, data, dims, 1);
+      TFE_Op* op = TFE_NewOp(ctx, "CollectiveReduce", status.get());
+      ASSERT_EQ(TF_OK, TF_GetCode(status.get())) << TF_Message(status.get());
+      TFE_OpSetAttrType(op, "T", TF_FLOAT);
+      TFE_OpSetAttrInt(op, "group_size", group_size);
+      TFE_OpSetAttrInt(op, "group_key", group_key);
+      TFE_OpSetAttrInt(op, "instance_key", instance_key);
+      TFE_OpSetAttrString(op, "merge_op", "Add", 3);
+      TFE_OpSetAttrString(op, "final_op", "Id", 2);
+      const int64_t subdiv_offsets[] = {0};
+      TFE_OpSetAttrIntList(op, "subdiv_offsets", subdiv_offsets, 1);
+      // Fail instead of hanging if the group can't be formed.
+      TFE_OpSetAttrFloat(op, "timeout_seconds", 60);
+      TFE_OpAddInput(op, input, status.get());
+      ASSERT_EQ(TF_OK, TF_GetCode(status.get())) << TF_Message(status.get());
+      TFE_OpSetDevice(op, device.c_str(), status.get());
+      ASSERT_EQ(TF_OK, TF_GetCode(status.get())) << TF_Message(status.get());
+      TFE_TensorHandle* retvals[1];
+      int num_retvals = 1;
+      TFE_Execute(op, &retvals[0], &num_retvals, status.get());
+      ASSERT_EQ(TF_OK, TF_GetCode(status.get())) << TF_Message(status.get());
+      TFE_TensorHandle* local = TFE_TensorHandleCopyToDevice(
+          retvals[0], ctx, "/job:localhost/replica:0/task:0/device:CPU:0",
+          status.get());
+      ASSERT_EQ(TF_OK, TF_GetCode(status.get())) << TF_Message(status.get());
+      CheckTFE_TensorHandleHasFloats(local, std::vector<float>(6, expected));
+      TFE_DeleteTensorHandle(local);
+      TFE_DeleteTensorHandle(retvals[0]);
+      TFE_DeleteTensorHandle(input);
+      TFE_DeleteOp(op);
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
+TEST(CAPI, CollectiveGroupReformedAfterRemovingTask) {
+  // Task 0 is the client and leads the collective groups.
+  tensorflow::ServerDef server_def = GetServerDef(3);
+  server_def.mutable_default_session_config()
+      ->mutable_experimental()
+      ->set_collective_group_leader("/job:localhost/replica:0/task:0");
+  string serialized = server_def.SerializeAsString();
+
+  std::vector<std::unique_ptr<tensorflow::GrpcServer>> worker_servers(3);
+  for (int task = 1; task < 3; ++task) {
+    server_def.set_task_index(task);
+    ASSERT_TRUE(tensorflow::GrpcServer::Create(server_def,
+                                               tensorflow::Env::Default(),
+                                               &worker_servers[task])
+                    .ok());
+    ASSERT_TRUE(worker_servers[task]->Start().ok());
+  }
+
+  TF_Status* status = TF_NewStatus();
+  TFE_ContextOptions* opts = TFE_NewContextOptions();
+  TFE_ContextOptionsSetDevicePlacementPolicy(opts, TFE_DEVICE_PLACEMENT_SILENT);
+  TFE_Context* ctx = TFE_NewContext(opts, status);
+  EXPECT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+  TFE_DeleteContextOptions(opts);
+  TFE_ContextSetServerDef(ctx, 0, serialized.data(), serialized.size(), status);
+  ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+
+  CheckCollectiveReduceOnTasks(ctx, {0, 1, 2}, /*group_key=*/1,
+                               /*instance_key=*/1);
+
+  // Remove task 2.  The remaining tasks form a group with the same key but
+  // fewer members, which fails if task 1 still knows the old group.
+  server_def.set_task_index(0);
+  server_def.mutable_cluster()->mutable_job(0)->mutable_tasks()->erase(2);
+  serialized = server_def.SerializeAsString();
+  TFE_ContextUpdateServerDef(ctx, 0, serialized.data(), serialized.size(),
+                             status);
+  ASSERT_EQ(TF_OK, TF_GetCode(status)) << TF_Message(status);
+
+  CheckCollectiveReduceOnTasks(ctx, {0, 1}, /*group_key=*/1,
+                               /*instance_key=*/2);
+
+  TFE_DeleteContext(ctx);
+  TF_DeleteStatus(status);
+
+  // TODO(b/136478427): Figure out how to correctly shut the server down.
+  for (auto& worker_server : worker_servers) worker_server.release();
+}
+
 TEST(CAPI, ConnectToClusterLocalhostFirst) { TestConnectToCluster(false); }
 
 TEST(CAPI, ConnectToClusterRenameFirst) { TestConnectToCluster(true); }
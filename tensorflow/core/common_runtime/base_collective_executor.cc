@@ -217,6 +217,9 @@ void BaseCollectiveExecutor::StartAbort(const Status& s) {
   VLOG(1) << "BaseCollectiveExecutor::StartAbort " << s;
   cem_->GetParamResolver()->StartAbort(s);
   remote_access_->StartAbort(s);
+  if (fusion_buffer_ != nullptr) {
+    fusion_buffer_->StartAbort(s);
+  }
 }
 
 void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
@@ -260,6 +263,20 @@ void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
                           col_params.is_source))
                             ? &ctx->input(0)
                             : nullptr;
+  if (fusion_buffer_ != nullptr && input != nullptr &&
+      fusion_buffer_->CanFuse(col_params, *input)) {
+    fusion_buffer_->Add(ctx, CtxParams(ctx), col_params, exec_key, input,
+                        output, done_safe);
+    return;
+  }
+  RunCollective(ctx, col_params, exec_key, input, output, done_safe);
+}
+
+void BaseCollectiveExecutor::RunCollective(OpKernelContext* ctx,
+                                           const CollectiveParams& col_params,
+                                           const string& exec_key,
+                                           const Tensor* input, Tensor* output,
+                                           const StatusCallback& done_safe) {
   CollectiveImplementationInterface* col_impl = nullptr;
   Status status = CreateCollective(col_params, &col_impl);
   if (!status.ok()) {
@@ -19,6 +19,8 @@ limitations under the License.
 #include <string>
 
 #include "tensorflow/core/common_runtime/buf_rendezvous.h"
+#include "tensorflow/core/common_runtime/collective_compression.h"
+#include "tensorflow/core/common_runtime/collective_fusion.h"
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/platform/unbounded_work_queue.h"
@@ -98,13 +100,30 @@ class BaseCollectiveExecutor : public CollectiveExecutor {
   BaseCollectiveExecutor(CollectiveExecutorMgrInterface* cem,
                          CollectiveRemoteAccess* remote_access, int64 step_id,
                          const DeviceMgr* dev_mgr, const string* gpu_ring_order,
-                         std::shared_ptr<UnboundedWorkQueue> work_queue)
+                         std::shared_ptr<UnboundedWorkQueue> work_queue,
+                         const CollectiveFusionOptions& fusion_options =
+                             CollectiveFusionOptions(),
+                         std::shared_ptr<CompressionResidualStore>
+                             residual_store = nullptr)
       : CollectiveExecutor(cem),
         step_id_(step_id),
         dev_mgr_(dev_mgr),
         remote_access_(remote_access),
         gpu_ring_order_(gpu_ring_order),
-        work_queue_(std::move(work_queue)) {}
+        work_queue_(std::move(work_queue)),
+        residual_store_(residual_store
+                            ? std::move(residual_store)
+                            : std::make_shared<CompressionResidualStore>()) {
+    if (fusion_options.threshold_bytes > 0) {
+      fusion_buffer_ = std::make_shared<CollectiveFusionBuffer>(
+          fusion_options, dev_mgr_, work_queue_, remote_access_.get(),
+          [this](OpKernelContext* ctx, const CollectiveParams& col_params,
+                 const string& exec_key, const Tensor* input, Tensor* output,
+                 const StatusCallback& done) {
+            RunCollective(ctx, col_params, exec_key, input, output, done);
+          });
+    }
+  }
 
   ~BaseCollectiveExecutor() override;
 
@@ -121,6 +140,10 @@ class BaseCollectiveExecutor : public CollectiveExecutor {
     return remote_access_.get();
   }
 
+  CompressionResidualStore* residual_store() override {
+    return residual_store_.get();
+  }
+
   void RunClosure(std::function<void()> closure) override {
     work_queue_->Schedule(std::move(closure));
   }
@@ -148,8 +171,19 @@ class BaseCollectiveExecutor : public CollectiveExecutor {
   // collective instance key -> number of local devices for which NCCL ops have
   // been launched.
   std::unordered_map<int32, int32> launched_ TF_GUARDED_BY(launch_mu_);
+  // Buffers small reductions for fused execution.  Null if fusion is
+  // disabled.
+  std::shared_ptr<CollectiveFusionBuffer> fusion_buffer_;
+  // Ownership of `residual_store_` is shared between `this` and
+  // `CollectiveExecutorMgr`, so residuals persist across steps.
+  std::shared_ptr<CompressionResidualStore> residual_store_;
 
  private:
+  // Runs the collective of `col_params` on `input` and `output`, without
+  // fusion.
+  void RunCollective(OpKernelContext* ctx, const CollectiveParams& col_params,
+                     const string& exec_key, const Tensor* input,
+                     Tensor* output, const StatusCallback& done_safe);
   Status CreateCollective(const CollectiveParams& col_params,
                           CollectiveImplementationInterface** col_impl);
   // Check if all ops on which this collective depends on have launched.
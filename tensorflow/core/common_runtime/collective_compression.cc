@@ -0,0 +1,214 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/core/framework/bfloat16.h"
+#include "tensorflow/core/framework/numeric_types.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+
+Status ParseCollectiveCompression(const string& name,
+                                  CollectiveCompression* compression) {
+  if (name.empty() || name == "none") {
+    *compression = CollectiveCompression::kNone;
+  } else if (name == "bf16") {
+    *compression = CollectiveCompression::kBfloat16;
+  } else if (name == "fp16") {
+    *compression = CollectiveCompression::kFloat16;
+  } else if (name == "topk") {
+    *compression = CollectiveCompression::kTopK;
+  } else {
+    return errors::InvalidArgument(
+        "Unknown collective compression \"", name,
+        "\", expected one of \"none\", \"bf16\", \"fp16\" or \"topk\"");
+  }
+  return Status::OK();
+}
+
+ChunkCompressor::ChunkCompressor(CollectiveCompression compression,
+                                 float topk_ratio)
+    : compression_(compression), topk_ratio_(topk_ratio) {}
+
+DataType ChunkCompressor::WireType() const {
+  switch (compression_) {
+    case CollectiveCompression::kBfloat16:
+      return DT_BFLOAT16;
+    case CollectiveCompression::kFloat16:
+      return DT_HALF;
+    case CollectiveCompression::kTopK:
+      // Indices followed by the bits of the values.
+      return DT_INT32;
+    default:
+      return DT_FLOAT;
+  }
+}
+
+int64 ChunkCompressor::NumKept(int64 num_elements) const {
+  const int64 k = static_cast<int64>(std::ceil(topk_ratio_ * num_elements));
+  return std::min(num_elements, std::max<int64>(1, k));
+}
+
+TensorShape ChunkCompressor::WireShape(int64 num_elements) const {
+  if (compression_ == CollectiveCompression::kTopK) {
+    return TensorShape({2 * NumKept(num_elements)});
+  }
+  return TensorShape({num_elements});
+}
+
+void ChunkCompressor::Compress(const Tensor& chunk, Tensor* residual,
+                               Tensor* wire) const {
+  const int64 n = chunk.NumElements();
+  DCHECK_EQ(wire->dtype(), WireType());
+  DCHECK_EQ(wire->shape(), WireShape(n));
+  const float* src = chunk.flat<float>().data();
+  std::vector<float> sum;
+  float* r = nullptr;
+  if (residual != nullptr) {
+    DCHECK_EQ(residual->NumElements(), n);
+    r = residual->flat<float>().data();
+    sum.resize(n);
+    for (int64 i = 0; i < n; ++i) {
+      sum[i] = src[i] + r[i];
+    }
+    src = sum.data();
+  }
+
+  switch (compression_) {
+    case CollectiveCompression::kNone: {
+      std::memcpy(wire->flat<float>().data(), src, n * sizeof(float));
+      if (r != nullptr) std::fill(r, r + n, 0.0f);
+      break;
+    }
+    case CollectiveCompression::kBfloat16: {
+      bfloat16* dst = wire->flat<bfloat16>().data();
+      RoundFloatToBFloat16(src, dst, n);
+      if (r != nullptr) {
+        for (int64 i = 0; i < n; ++i) {
+          r[i] = src[i] - static_cast<float>(dst[i]);
+        }
+      }
+      break;
+    }
+    case CollectiveCompression::kFloat16: {
+      Eigen::half* dst = wire->flat<Eigen::half>().data();
+      for (int64 i = 0; i < n; ++i) {
+        dst[i] = Eigen::half(src[i]);
+      }
+      if (r != nullptr) {
+        for (int64 i = 0; i < n; ++i) {
+          r[i] = src[i] - static_cast<float>(dst[i]);
+        }
+      }
+      break;
+    }
+    case CollectiveCompression::kTopK: {
+      DCHECK_LE(n, std::numeric_limits<int32>::max());
+      const int64 k = NumKept(n);
+      std::vector<int32> order(n);
+      std::iota(order.begin(), order.end(), 0);
+      if (k < n) {
+        std::nth_element(order.begin(), order.begin() + k, order.end(),
+                         [src](int32 a, int32 b) {
+                           return std::abs(src[a]) > std::abs(src[b]);
+                         });
+      }
+      // Ascending indices make decoding a sequential write.
+      std::sort(order.begin(), order.begin() + k);
+      int32* dst = wire->flat<int32>().data();
+      for (int64 i = 0; i < k; ++i) {
+        dst[i] = order[i];
+        std::memcpy(dst + k + i, src + order[i], sizeof(float));
+      }
+      if (r != nullptr) {
+        std::memcpy(r, src, n * sizeof(float));
+        for (int64 i = 0; i < k; ++i) {
+          r[order[i]] = 0.0f;
+        }
+      }
+      break;
+    }
+  }
+}
+
+Status ChunkCompressor::Decompress(const Tensor& wire, Tensor* chunk) const {
+  const int64 n = chunk->NumElements();
+  if (wire.dtype() != WireType() || wire.shape() != WireShape(n)) {
+    return errors::Internal("Compressed chunk ", wire.DebugString(),
+                            " does not match a chunk of ", n, " elements");
+  }
+  float* dst = chunk->flat<float>().data();
+  switch (compression_) {
+    case CollectiveCompression::kNone:
+      std::memcpy(dst, wire.flat<float>().data(), n * sizeof(float));
+      break;
+    case CollectiveCompression::kBfloat16:
+      BFloat16ToFloat(wire.flat<bfloat16>().data(), dst, n);
+      break;
+    case CollectiveCompression::kFloat16: {
+      const Eigen::half* src = wire.flat<Eigen::half>().data();
+      for (int64 i = 0; i < n; ++i) {
+        dst[i] = static_cast<float>(src[i]);
+      }
+      break;
+    }
+    case CollectiveCompression::kTopK: {
+      const int64 k = wire.NumElements() / 2;
+      const int32* src = wire.flat<int32>().data();
+      std::fill(dst, dst + n, 0.0f);
+      for (int64 i = 0; i < k; ++i) {
+        const int32 index = src[i];
+        if (index < 0 || index >= n) {
+          return errors::Internal("Index ", index,
+                                  " of compressed chunk out of range [0, ", n,
+                                  ")");
+        }
+        std::memcpy(dst + index, src + k + i, sizeof(float));
+      }
+      break;
+    }
+  }
+  return Status::OK();
+}
+
+Tensor CompressionResidualStore::Get(int32 group_key, const string& key,
+                                     int64 num_elements) {
+  mutex_lock l(mu_);
+  Tensor& residual = residuals_[group_key][key];
+  if (!residual.IsInitialized() || residual.NumElements() != num_elements) {
+    residual = Tensor(DT_FLOAT, TensorShape({num_elements}));
+    residual.flat<float>().setZero();
+  }
+  return residual;
+}
+
+void CompressionResidualStore::ClearGroup(int32 group_key) {
+  mutex_lock l(mu_);
+  residuals_.erase(group_key);
+}
+
+void CompressionResidualStore::Clear() {
+  mutex_lock l(mu_);
+  residuals_.clear();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,111 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Lossy encodings applied to the float chunks that an all-reduce exchanges
+// between devices.  Values are always accumulated in float; only the data on
+// the wire is compressed.
+enum class CollectiveCompression {
+  kNone,
+  // Chunks are rounded to bfloat16.
+  kBfloat16,
+  // Chunks are rounded to float16.
+  kFloat16,
+  // Only the largest magnitude elements of a chunk are sent, as pairs of
+  // index and value.  The dropped part is kept as a residual and added to
+  // the next value sent by the same field (error feedback).
+  kTopK,
+};
+
+// Parses the `compression` attr of the CollectiveReduce ops, which is one of
+// "none", "bf16", "fp16" or "topk".  An empty string means "none".
+Status ParseCollectiveCompression(const string& name,
+                                  CollectiveCompression* compression);
+
+// Encodes and decodes chunks of a DT_FLOAT tensor on the host.
+class ChunkCompressor {
+ public:
+  ChunkCompressor(CollectiveCompression compression, float topk_ratio);
+
+  CollectiveCompression compression() const { return compression_; }
+
+  // True if Compress() should be given a residual.
+  bool uses_error_feedback() const {
+    return compression_ == CollectiveCompression::kTopK;
+  }
+
+  // Type and shape of the encoding of a chunk of `num_elements` floats.  Every
+  // replica computes the same shape for the same chunk, so receivers can
+  // allocate the encoding before it arrives.
+  DataType WireType() const;
+  TensorShape WireShape(int64 num_elements) const;
+
+  // Number of elements kept by top-k compression of `num_elements` floats.
+  int64 NumKept(int64 num_elements) const;
+
+  // Encodes `chunk` into `wire`, which must have WireType() and
+  // WireShape(chunk.NumElements()).  If `residual` is not null, it must have
+  // the shape of `chunk`; it is added to `chunk` before encoding and replaced
+  // by the part of the sum that the encoding dropped.
+  void Compress(const Tensor& chunk, Tensor* residual, Tensor* wire) const;
+
+  // Overwrites `chunk` with the value encoded in `wire`.
+  Status Decompress(const Tensor& wire, Tensor* chunk) const;
+
+ private:
+  const CollectiveCompression compression_;
+  const float topk_ratio_;
+};
+
+// Error-feedback residuals of compressed all-reduces.  A residual belongs to
+// one field of one collective instance on one device of a group, so it
+// persists across the steps that reduce the same tensor under the same
+// instance key.  Each CollectiveExecutorMgr owns a store that its step
+// executors share.
+class CompressionResidualStore {
+ public:
+  // Returns the residual of group `group_key` stored under `key`, which
+  // aliases the stored buffer.  The residual is zero-initialized the first
+  // time `key` is seen or when the number of elements changes.
+  Tensor Get(int32 group_key, const string& key, int64 num_elements);
+
+  // Drops the residuals of group `group_key`, e.g. once the group is
+  // re-formed.
+  void ClearGroup(int32 group_key);
+
+  // Drops every residual.
+  void Clear();
+
+ private:
+  mutex mu_;
+  std::unordered_map<int32, std::unordered_map<string, Tensor>> residuals_
+      TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
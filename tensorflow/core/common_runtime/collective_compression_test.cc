@@ -0,0 +1,246 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_compression.h"
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+Tensor Encode(const ChunkCompressor& compressor, const Tensor& chunk,
+              Tensor* residual) {
+  Tensor wire(compressor.WireType(),
+              compressor.WireShape(chunk.NumElements()));
+  compressor.Compress(chunk, residual, &wire);
+  return wire;
+}
+
+Tensor Decode(const ChunkCompressor& compressor, const Tensor& wire,
+              int64 num_elements) {
+  Tensor chunk(DT_FLOAT, TensorShape({num_elements}));
+  TF_CHECK_OK(compressor.Decompress(wire, &chunk));
+  return chunk;
+}
+
+TEST(CollectiveCompressionTest, Parse) {
+  CollectiveCompression compression;
+  TF_EXPECT_OK(ParseCollectiveCompression("", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kNone);
+  TF_EXPECT_OK(ParseCollectiveCompression("none", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kNone);
+  TF_EXPECT_OK(ParseCollectiveCompression("bf16", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kBfloat16);
+  TF_EXPECT_OK(ParseCollectiveCompression("fp16", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kFloat16);
+  TF_EXPECT_OK(ParseCollectiveCompression("topk", &compression));
+  EXPECT_EQ(compression, CollectiveCompression::kTopK);
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      ParseCollectiveCompression("fp8", &compression)));
+}
+
+TEST(CollectiveCompressionTest, Casts) {
+  Tensor chunk = test::AsTensor<float>({0.0f, 1.0f, -2.5f, 1000.125f, 1e-3f});
+  for (auto compression :
+       {CollectiveCompression::kBfloat16, CollectiveCompression::kFloat16}) {
+    ChunkCompressor compressor(compression, 0);
+    Tensor wire = Encode(compressor, chunk, nullptr);
+    EXPECT_EQ(wire.TotalBytes(), chunk.TotalBytes() / 2);
+    Tensor decoded = Decode(compressor, wire, chunk.NumElements());
+    test::ExpectTensorNear<float>(chunk, decoded, 0.5);
+    EXPECT_EQ(decoded.flat<float>()(1), 1.0f);
+    EXPECT_EQ(decoded.flat<float>()(2), -2.5f);
+  }
+}
+
+TEST(CollectiveCompressionTest, CastResidual) {
+  ChunkCompressor compressor(CollectiveCompression::kBfloat16, 0);
+  Tensor chunk = test::AsTensor<float>({1.001f, 3.0f});
+  Tensor residual = test::AsTensor<float>({0.0f, 0.0f});
+  Tensor decoded =
+      Decode(compressor, Encode(compressor, chunk, &residual), 2);
+  EXPECT_EQ(decoded.flat<float>()(0) + residual.flat<float>()(0), 1.001f);
+  EXPECT_EQ(residual.flat<float>()(1), 0.0f);
+}
+
+TEST(CollectiveCompressionTest, TopKKeepsLargest) {
+  ChunkCompressor compressor(CollectiveCompression::kTopK, 0.25);
+  Tensor chunk =
+      test::AsTensor<float>({0.5f, -7.0f, 0.25f, 1.0f, 3.0f, 0.0f, -2.0f, 0});
+  EXPECT_EQ(compressor.NumKept(8), 2);
+  Tensor residual(DT_FLOAT, TensorShape({8}));
+  residual.flat<float>().setZero();
+  Tensor wire = Encode(compressor, chunk, &residual);
+  EXPECT_EQ(wire.NumElements(), 4);
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0, -7.0f, 0, 0, 3.0f, 0, 0, 0}),
+      Decode(compressor, wire, 8));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0.5f, 0, 0.25f, 1.0f, 0, 0.0f, -2.0f, 0}),
+      residual);
+}
+
+TEST(CollectiveCompressionTest, TopKErrorFeedbackSendsEverything) {
+  // With error feedback, every value is eventually sent: the decoded values
+  // plus the residual always add up to the sum of the inputs.
+  ChunkCompressor compressor(CollectiveCompression::kTopK, 0.1);
+  const int64 n = 100;
+  Tensor chunk(DT_FLOAT, TensorShape({n}));
+  for (int64 i = 0; i < n; ++i) {
+    chunk.flat<float>()(i) = (i % 10) - 4.5f;
+  }
+  Tensor residual(DT_FLOAT, TensorShape({n}));
+  residual.flat<float>().setZero();
+  std::vector<double> sent(n, 0.0);
+  const int kRounds = 50;
+  for (int round = 0; round < kRounds; ++round) {
+    Tensor decoded =
+        Decode(compressor, Encode(compressor, chunk, &residual), n);
+    for (int64 i = 0; i < n; ++i) {
+      sent[i] += decoded.flat<float>()(i);
+    }
+  }
+  for (int64 i = 0; i < n; ++i) {
+    EXPECT_NEAR(kRounds * chunk.flat<float>()(i),
+                sent[i] + residual.flat<float>()(i), 1e-3);
+  }
+}
+
+TEST(CollectiveCompressionTest, DecompressRejectsBadInput) {
+  ChunkCompressor compressor(CollectiveCompression::kTopK, 0.5);
+  Tensor chunk(DT_FLOAT, TensorShape({4}));
+  Tensor wire = test::AsTensor<int32>({0, 4, 0, 0});
+  EXPECT_TRUE(errors::IsInternal(compressor.Decompress(wire, &chunk)));
+  Tensor short_wire = test::AsTensor<int32>({0, 0});
+  EXPECT_TRUE(errors::IsInternal(compressor.Decompress(short_wire, &chunk)));
+}
+
+TEST(CollectiveCompressionTest, ResidualStore) {
+  CompressionResidualStore store;
+  Tensor residual = store.Get(1, "a", 3);
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 0, 0}), residual);
+  residual.flat<float>()(1) = 2.0f;
+  // The stored residual persists across lookups.
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 2.0f, 0}),
+                                 store.Get(1, "a", 3));
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 0, 0}),
+                                 store.Get(1, "b", 3));
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 0, 0}),
+                                 store.Get(2, "a", 3));
+  // A new size resets it.
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 0}),
+                                 store.Get(1, "a", 2));
+  store.Get(1, "a", 2).flat<float>()(0) = 1.0f;
+  store.Get(2, "a", 2).flat<float>()(0) = 1.0f;
+  // Clearing a group keeps the residuals of other groups.
+  store.ClearGroup(1);
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 0}),
+                                 store.Get(1, "a", 2));
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({1.0f, 0}),
+                                 store.Get(2, "a", 2));
+  store.Clear();
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 0}),
+                                 store.Get(2, "a", 2));
+}
+
+// Measures sending a compressed chunk between two local devices: encoding,
+// the transfer through CollectiveRemoteAccessLocal and decoding.
+static void BM_CompressedTransfer(int iters, int compression,
+                                  int num_elements) {
+  testing::StopTiming();
+  const string task_name = "/job:localhost/replica:0/task:0";
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_CHECK_OK(DeviceFactory::AddDevices(options, task_name, &devices));
+  StaticDeviceMgr device_mgr(std::move(devices));
+  DeviceResolverLocal device_resolver(&device_mgr);
+  CollectiveRemoteAccessLocal rma(&device_mgr, &device_resolver,
+                                  /*step_id=*/0);
+  Device* cpu0 = nullptr;
+  Device* cpu1 = nullptr;
+  TF_CHECK_OK(device_mgr.LookupDevice(task_name + "/device:CPU:0", &cpu0));
+  TF_CHECK_OK(device_mgr.LookupDevice(task_name + "/device:CPU:1", &cpu1));
+
+  ChunkCompressor compressor(static_cast<CollectiveCompression>(compression),
+                             0.01);
+  Tensor chunk(DT_FLOAT, TensorShape({num_elements}));
+  chunk.flat<float>().setRandom();
+  Tensor received(DT_FLOAT, TensorShape({num_elements}));
+  Tensor residual(DT_FLOAT, TensorShape({num_elements}));
+  residual.flat<float>().setZero();
+  const bool error_feedback = compressor.uses_error_feedback();
+  Tensor sent_wire(compressor.WireType(), compressor.WireShape(num_elements));
+  Tensor received_wire(compressor.WireType(),
+                       compressor.WireShape(num_elements));
+  AllocatorAttributes attr;
+  DeviceLocality locality;
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    const string key = strings::StrCat("key_", i);
+    Notification recv_done;
+    rma.RecvFromPeer(task_name + "/device:CPU:0", task_name,
+                     /*peer_is_local=*/true, key, cpu1,
+                     /*to_device_ctx=*/nullptr, attr, &received_wire,
+                     locality, /*dev_to_dev_stream_index=*/0,
+                     [&recv_done](const Status& s) {
+                       TF_CHECK_OK(s);
+                       recv_done.Notify();
+                     });
+    compressor.Compress(chunk, error_feedback ? &residual : nullptr,
+                        &sent_wire);
+    Notification send_done;
+    rma.PostToPeer(task_name + "/device:CPU:1", task_name, key, cpu0,
+                   /*from_device_ctx=*/nullptr, attr, &sent_wire, locality,
+                   [&send_done](const Status& s) {
+                     TF_CHECK_OK(s);
+                     send_done.Notify();
+                   });
+    recv_done.WaitForNotification();
+    send_done.WaitForNotification();
+    TF_CHECK_OK(compressor.Decompress(received_wire, &received));
+  }
+  testing::StopTiming();
+  testing::BytesProcessed(static_cast<int64>(iters) * chunk.TotalBytes());
+  testing::SetLabel(
+      strings::StrCat("wire bytes ", sent_wire.TotalBytes(), " of ",
+                      chunk.TotalBytes()));
+}
+
+BENCHMARK(BM_CompressedTransfer)
+    ->ArgPair(static_cast<int>(CollectiveCompression::kNone), 1 << 14)
+    ->ArgPair(static_cast<int>(CollectiveCompression::kNone), 1 << 20)
+    ->ArgPair(static_cast<int>(CollectiveCompression::kBfloat16), 1 << 14)
+    ->ArgPair(static_cast<int>(CollectiveCompression::kBfloat16), 1 << 20)
+    ->ArgPair(static_cast<int>(CollectiveCompression::kFloat16), 1 << 14)
+    ->ArgPair(static_cast<int>(CollectiveCompression::kFloat16), 1 << 20)
+    ->ArgPair(static_cast<int>(CollectiveCompression::kTopK), 1 << 14)
+    ->ArgPair(static_cast<int>(CollectiveCompression::kTopK), 1 << 20);
+
+}  // namespace
+}  // namespace tensorflow
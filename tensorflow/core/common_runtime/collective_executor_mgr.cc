@@ -32,8 +32,10 @@ CollectiveExecutorMgr::CollectiveExecutorMgr(
       param_resolver_(std::move(param_resolver)),
       gpu_ring_order_(
           config.gpu_options().experimental().collective_ring_order()),
+      fusion_options_(CollectiveFusionOptions::FromConfig(config)),
       work_queue_(std::make_shared<UnboundedWorkQueue>(Env::Default(),
-                                                       "collective_ops")) {}
+                                                       "collective_ops")),
+      residual_store_(std::make_shared<CompressionResidualStore>()) {}
 
 CollectiveExecutorMgr::~CollectiveExecutorMgr() {
   for (auto iter : executor_table_) {
@@ -61,7 +63,8 @@ CollectiveExecutor* CollectiveExecutorMgr::Create(int64 step_id) {
   CollectiveRemoteAccessLocal* rma =
       new CollectiveRemoteAccessLocal(dev_mgr_, dev_resolver_.get(), step_id);
   return new BaseCollectiveExecutor(this, rma, step_id, dev_mgr_,
-                                    &gpu_ring_order_, work_queue_);
+                                    &gpu_ring_order_, work_queue_,
+                                    fusion_options_, residual_store_);
 }
 
 void CollectiveExecutorMgr::Cleanup(int64 step_id) {
@@ -77,6 +80,11 @@ void CollectiveExecutorMgr::Cleanup(int64 step_id) {
   if (ce) ce->Unref();
 }
 
+void CollectiveExecutorMgr::ResetGroups(const Status& s) {
+  param_resolver_->ResetGroups(s);
+  residual_store_->Clear();
+}
+
 void CollectiveExecutorMgr::GetStepSequenceAsync(
     const GetStepSequenceRequest* request, GetStepSequenceResponse* response,
     const StatusCallback& done) {
@@ -15,6 +15,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_EXECUTOR_MGR_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_EXECUTOR_MGR_H_
 
+#include "tensorflow/core/common_runtime/collective_compression.h"
+#include "tensorflow/core/common_runtime/collective_fusion.h"
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/lib/gtl/flatmap.h"
 #include "tensorflow/core/platform/unbounded_work_queue.h"
@@ -43,6 +45,9 @@ class CollectiveExecutorMgr : public CollectiveExecutorMgrInterface {
     return dev_resolver_.get();
   }
 
+  // Also drops the compression residuals, which belong to the old groups.
+  void ResetGroups(const Status& s) override;
+
   void GetStepSequenceAsync(const GetStepSequenceRequest* request,
                             GetStepSequenceResponse* response,
                             const StatusCallback& done) override;
@@ -64,10 +69,14 @@ class CollectiveExecutorMgr : public CollectiveExecutorMgrInterface {
   std::unique_ptr<DeviceResolverInterface> dev_resolver_;
   std::unique_ptr<ParamResolverInterface> param_resolver_;
   string gpu_ring_order_;
+  const CollectiveFusionOptions fusion_options_;
   // Unbounded work queue for scheduling potentially-blocking work during
   // collective op execution.  Ownership is shared between `this` and
   // `CollectiveRemoteAccessLocal`.
   std::shared_ptr<UnboundedWorkQueue> work_queue_;
+  // Error-feedback residuals of compressed reductions.  Ownership is shared
+  // between `this` and the step executors.
+  std::shared_ptr<CompressionResidualStore> residual_store_;
 
  private:
   mutex exec_mu_;
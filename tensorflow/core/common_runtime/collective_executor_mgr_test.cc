@@ -69,6 +69,29 @@ TEST_F(CollectiveExecutorMgrTest, FindOrCreate) {
   cme_->Cleanup(1);
 }
 
+TEST_F(CollectiveExecutorMgrTest, ResidualsOutliveSteps) {
+  CollectiveExecutor::Handle h1(cme_->FindOrCreate(1), true);
+  CompressionResidualStore* store = h1.get()->residual_store();
+  ASSERT_NE(store, nullptr);
+  store->Get(/*group_key=*/1, "residual", 4).flat<float>()(0) = 1.0f;
+  cme_->Cleanup(1);
+
+  // Executors of later steps see the residuals of earlier ones.
+  CollectiveExecutor::Handle h2(cme_->FindOrCreate(2), true);
+  EXPECT_EQ(store, h2.get()->residual_store());
+  EXPECT_EQ(1.0f, store->Get(/*group_key=*/1, "residual", 4).flat<float>()(0));
+  cme_->Cleanup(2);
+}
+
+TEST_F(CollectiveExecutorMgrTest, ResetGroupsClearsResiduals) {
+  CollectiveExecutor::Handle h(cme_->FindOrCreate(1), true);
+  CompressionResidualStore* store = h.get()->residual_store();
+  store->Get(/*group_key=*/1, "residual", 4).flat<float>()(0) = 1.0f;
+  cme_->ResetGroups(errors::Aborted("Cluster was updated"));
+  EXPECT_EQ(0.0f, store->Get(/*group_key=*/1, "residual", 4).flat<float>()(0));
+  cme_->Cleanup(1);
+}
+
 TEST_F(CollectiveExecutorMgrTest, StepSequenceRelated) {
   EXPECT_EQ(CollectiveExecutor::kInvalidId, cme_->NextStepId(123));
   Notification ss_note;
@@ -0,0 +1,618 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_fusion.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/common_runtime/collective_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace {
+
+bool IsFusibleType(DataType dtype) {
+  switch (dtype) {
+    case DT_HALF:
+    case DT_FLOAT:
+    case DT_DOUBLE:
+    case DT_INT32:
+    case DT_INT64:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns a host scalar of type `dtype` holding `v`, the second operand of
+// final_op.
+Tensor Scalar(DataType dtype, int v) {
+  switch (dtype) {
+    case DT_HALF:
+      return Tensor(static_cast<Eigen::half>(v));
+    case DT_FLOAT:
+      return Tensor(static_cast<float>(v));
+    case DT_DOUBLE:
+      return Tensor(static_cast<double>(v));
+    case DT_INT32:
+      return Tensor(static_cast<int32>(v));
+    default:
+      DCHECK_EQ(dtype, DT_INT64);
+      return Tensor(static_cast<int64>(v));
+  }
+}
+
+char* MutableData(Tensor* t) {
+  return const_cast<char*>(t->tensor_data().data());
+}
+
+// Maximum number of reductions that a group spanning tasks executes as one
+// collective.  Bounds the size of the plan sent to the other tasks.
+constexpr int kMaxPlanSize = 256;
+
+string PlanKey(const string& bucket_key, int64 seq, const string& task) {
+  return strings::StrCat("fusion_plan:", bucket_key, ":", seq, ":", task);
+}
+
+string FusedExecKey(const string& bucket_key, int64 seq) {
+  return strings::StrCat("fused:", bucket_key, ":", seq);
+}
+
+}  // namespace
+
+/*static*/
+CollectiveFusionOptions CollectiveFusionOptions::FromConfig(
+    const ConfigProto& config) {
+  CollectiveFusionOptions options;
+  options.threshold_bytes =
+      config.experimental().collective_fusion_threshold_bytes();
+  options.window_micros =
+      config.experimental().collective_fusion_window_micros();
+  return options;
+}
+
+CollectiveFusionBuffer::CollectiveFusionBuffer(
+    const CollectiveFusionOptions& options, const DeviceMgr* dev_mgr,
+    std::shared_ptr<UnboundedWorkQueue> work_queue,
+    CollectiveRemoteAccess* remote_access, RunCollectiveFn run_collective)
+    : options_(options),
+      dev_mgr_(dev_mgr),
+      work_queue_(std::move(work_queue)),
+      remote_access_(remote_access),
+      run_collective_(std::move(run_collective)) {}
+
+bool CollectiveFusionBuffer::CanFuse(const CollectiveParams& col_params,
+                                     const Tensor& input) const {
+  if (options_.threshold_bytes <= 0 ||
+      input.TotalBytes() > options_.threshold_bytes) {
+    return false;
+  }
+  const CollImplDetails& details = col_params.instance.impl_details;
+  if (col_params.instance.type != REDUCTION_COLLECTIVE ||
+      col_params.group.device_type != DEVICE_CPU ||
+      !IsFusibleType(input.dtype()) || col_params.merge_op == nullptr ||
+      !details.dependencies.empty() || details.timeout_seconds > 0 ||
+      !details.compression.empty()) {
+    return false;
+  }
+  const int group_size = col_params.group.group_size;
+  const std::vector<bool>& is_local = col_params.task.is_local;
+  if (is_local.size() != static_cast<size_t>(group_size) ||
+      col_params.default_rank < 0 || col_params.default_rank >= group_size) {
+    return false;
+  }
+  if (std::find(is_local.begin(), is_local.end(), false) == is_local.end()) {
+    return true;
+  }
+  // The group spans tasks.
+  if (remote_access_ == nullptr || run_collective_ == nullptr) {
+    LOG_FIRST_N(INFO, 1) << "Collective fusion is enabled, but reductions "
+                         << "of groups that span tasks, like "
+                         << col_params.name << ", are not fused";
+    return false;
+  }
+  return col_params.instance.device_names.size() ==
+             static_cast<size_t>(group_size) &&
+         col_params.instance.task_names.size() ==
+             static_cast<size_t>(group_size);
+}
+
+void CollectiveFusionBuffer::Add(OpKernelContext* ctx,
+                                 OpKernelContext::Params* op_params,
+                                 const CollectiveParams& col_params,
+                                 const string& exec_key, const Tensor* input,
+                                 Tensor* output, StatusCallback done) {
+  Member member;
+  Status status = dev_mgr_->LookupDevice(ctx->device()->name(), &member.device);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  member.ctx = ctx;
+  member.op_params = op_params;
+  member.col_params = &col_params;
+  member.merge_op = col_params.merge_op.get();
+  member.final_op = col_params.final_op.get();
+  member.input = input;
+  member.output = output;
+  member.done = std::move(done);
+
+  const string bucket_key = strings::StrCat(
+      col_params.group.group_key, ":", DataTypeString(input->dtype()), ":",
+      member.merge_op->type_string(), ":",
+      member.final_op ? member.final_op->type_string() : "");
+  const int group_size = col_params.group.group_size;
+  const int rank = col_params.default_rank;
+  const std::vector<bool>& is_local = col_params.task.is_local;
+  const int num_local = std::count(is_local.begin(), is_local.end(), true);
+  const bool cross_task = num_local < group_size;
+  std::vector<Batch> batches;
+  PlanRecv recv;
+  bool schedule_flush = false;
+  {
+    mutex_lock l(mu_);
+    if (status_.ok()) {
+      Bucket& bucket = buckets_[bucket_key];
+      bucket.cross_task = cross_task;
+      bucket.is_decider = is_local[0];
+      Instance& instance = bucket.pending[exec_key];
+      if (instance.members.empty()) {
+        instance.exec_key = exec_key;
+        instance.members.resize(group_size);
+      }
+      if (instance.members.size() != static_cast<size_t>(group_size) ||
+          instance.members[rank].done != nullptr) {
+        status = errors::Internal("Inconsistent group or duplicate rank ",
+                                  rank, " in fused collective ", exec_key);
+      } else if (instance.num_members > 0) {
+        for (const Member& other : instance.members) {
+          if (other.done != nullptr &&
+              other.input->NumElements() != input->NumElements()) {
+            status = errors::InvalidArgument(
+                "Shape mismatch in collective ", exec_key, ": ",
+                input->shape().DebugString(), " vs ",
+                other.input->shape().DebugString());
+            break;
+          }
+        }
+      }
+      if (status.ok()) {
+        instance.members[rank] = std::move(member);
+        if (++instance.num_members == num_local) {
+          Instance ready = std::move(instance);
+          bucket.pending.erase(exec_key);
+          if (cross_task && !bucket.is_decider) {
+            bucket.unplanned.emplace(Fingerprint64(exec_key),
+                                     std::move(ready));
+            batches = TakeExecutablePlans(bucket_key, &bucket);
+            recv = NextPlanRecv(&bucket);
+          } else {
+            bucket.ready.push_back(std::move(ready));
+            bucket.ready_bytes += input->TotalBytes();
+            if (bucket.ready_bytes >= options_.threshold_bytes ||
+                (cross_task && bucket.ready.size() >= kMaxPlanSize)) {
+              batches.push_back(TakeReady(bucket_key, &bucket));
+            } else if (!bucket.flush_scheduled) {
+              bucket.flush_scheduled = true;
+              schedule_flush = true;
+            }
+          }
+        }
+      }
+    } else {
+      status = status_;
+    }
+  }
+  if (!status.ok()) {
+    // Other members of the reduction would never complete.
+    StartAbort(status);
+    member.done(status);
+    return;
+  }
+  for (Batch& batch : batches) {
+    ScheduleExecute(std::move(batch));
+  }
+  if (recv.seq >= 0) {
+    RecvPlan(bucket_key, recv);
+  }
+  if (schedule_flush) {
+    std::shared_ptr<CollectiveFusionBuffer> self = shared_from_this();
+    SchedNonBlockingClosureAfter(options_.window_micros,
+                                 [self, bucket_key]() {
+                                   self->Flush(bucket_key);
+                                 });
+  }
+}
+
+/*static*/
+CollectiveFusionBuffer::Batch CollectiveFusionBuffer::TakeReady(
+    const string& bucket_key, Bucket* bucket) {
+  Batch batch;
+  batch.bucket_key = bucket_key;
+  batch.instances.swap(bucket->ready);
+  bucket->ready_bytes = 0;
+  if (bucket->cross_task) {
+    batch.seq = bucket->next_seq++;
+  }
+  return batch;
+}
+
+/*static*/
+std::vector<CollectiveFusionBuffer::Batch>
+CollectiveFusionBuffer::TakeExecutablePlans(const string& bucket_key,
+                                            Bucket* bucket) {
+  std::vector<Batch> batches;
+  for (auto plan = bucket->plans.begin(); plan != bucket->plans.end();) {
+    const bool complete = std::all_of(
+        plan->fingerprints.begin(), plan->fingerprints.end(),
+        [bucket](uint64 fp) { return bucket->unplanned.count(fp) > 0; });
+    if (!complete) {
+      ++plan;
+      continue;
+    }
+    Batch batch;
+    batch.bucket_key = bucket_key;
+    batch.seq = plan->seq;
+    for (uint64 fp : plan->fingerprints) {
+      auto it = bucket->unplanned.find(fp);
+      batch.instances.push_back(std::move(it->second));
+      bucket->unplanned.erase(it);
+      bucket->planned.erase(fp);
+    }
+    batches.push_back(std::move(batch));
+    plan = bucket->plans.erase(plan);
+  }
+  return batches;
+}
+
+/*static*/
+CollectiveFusionBuffer::PlanRecv CollectiveFusionBuffer::NextPlanRecv(
+    Bucket* bucket) {
+  PlanRecv recv;
+  if (bucket->recv_pending) return recv;
+  for (const auto& it : bucket->unplanned) {
+    // Every ready reduction is part of a plan the deciding task sends sooner
+    // or later, but only the plans that cover one are sure to be sent.
+    if (bucket->planned.count(it.first) > 0) continue;
+    for (const Member& member : it.second.members) {
+      // The plan is received by the first member on this task.
+      if (member.done != nullptr) {
+        recv.seq = bucket->next_seq;
+        recv.device = member.device;
+        recv.device_ctx = member.ctx->op_device_context();
+        recv.col_params = member.col_params;
+        bucket->recv_pending = true;
+        return recv;
+      }
+    }
+  }
+  return recv;
+}
+
+void CollectiveFusionBuffer::Flush(const string& bucket_key) {
+  Batch batch;
+  {
+    mutex_lock l(mu_);
+    auto it = buckets_.find(bucket_key);
+    if (it == buckets_.end()) return;
+    Bucket& bucket = it->second;
+    bucket.flush_scheduled = false;
+    if (!bucket.ready.empty()) {
+      batch = TakeReady(bucket_key, &bucket);
+    }
+    // The buckets of groups that span tasks keep counting plans.
+    if (bucket.pending.empty() && !bucket.cross_task) {
+      buckets_.erase(it);
+    }
+  }
+  if (!batch.instances.empty()) {
+    ScheduleExecute(std::move(batch));
+  }
+}
+
+void CollectiveFusionBuffer::RecvPlan(const string& bucket_key,
+                                      const PlanRecv& recv) {
+  const CollectiveParams& cp = *recv.col_params;
+  const string& task = cp.instance.task_names[std::distance(
+      cp.task.is_local.begin(),
+      std::find(cp.task.is_local.begin(), cp.task.is_local.end(), true))];
+  auto plan =
+      std::make_shared<Tensor>(DT_INT64, TensorShape({kMaxPlanSize + 1}));
+  std::shared_ptr<CollectiveFusionBuffer> self = shared_from_this();
+  const int64 seq = recv.seq;
+  remote_access_->RecvFromPeer(
+      cp.instance.device_names[0], cp.instance.task_names[0],
+      /*peer_is_local=*/false, PlanKey(bucket_key, seq, task), recv.device,
+      recv.device_ctx, AllocatorAttributes(), plan.get(),
+      recv.device->attributes().locality(), /*dev_to_dev_stream_index=*/0,
+      [self, bucket_key, seq, plan](const Status& s) {
+        self->PlanReceived(bucket_key, seq, *plan, s);
+      });
+}
+
+void CollectiveFusionBuffer::PlanReceived(const string& bucket_key, int64 seq,
+                                          const Tensor& plan,
+                                          const Status& s) {
+  Status status = s;
+  Plan received;
+  received.seq = seq;
+  if (status.ok()) {
+    auto flat = plan.flat<int64>();
+    const int64 size = flat(0);
+    if (size <= 0 || size > kMaxPlanSize) {
+      status = errors::Internal("Invalid size ", size,
+                                " of collective fusion plan ", seq, " for ",
+                                bucket_key);
+    }
+    for (int64 i = 0; status.ok() && i < size; ++i) {
+      received.fingerprints.push_back(static_cast<uint64>(flat(i + 1)));
+    }
+  }
+  std::vector<Batch> batches;
+  PlanRecv recv;
+  if (status.ok()) {
+    mutex_lock l(mu_);
+    if (!status_.ok()) return;
+    Bucket& bucket = buckets_[bucket_key];
+    bucket.recv_pending = false;
+    ++bucket.next_seq;
+    for (uint64 fp : received.fingerprints) {
+      if (!bucket.planned.insert(fp).second) {
+        status = errors::Internal("Collective fusion plan ", seq, " for ",
+                                  bucket_key, " repeats a reduction");
+        break;
+      }
+    }
+    if (status.ok()) {
+      bucket.plans.push_back(std::move(received));
+      batches = TakeExecutablePlans(bucket_key, &bucket);
+      recv = NextPlanRecv(&bucket);
+    }
+  }
+  if (!status.ok()) {
+    StartAbort(status);
+    return;
+  }
+  for (Batch& batch : batches) {
+    ScheduleExecute(std::move(batch));
+  }
+  if (recv.seq >= 0) {
+    RecvPlan(bucket_key, recv);
+  }
+}
+
+void CollectiveFusionBuffer::StartAbort(const Status& s) {
+  std::vector<StatusCallback> dones;
+  {
+    mutex_lock l(mu_);
+    if (!status_.ok()) return;
+    status_ = s;
+    auto take_dones = [&dones](Instance* instance) {
+      for (Member& member : instance->members) {
+        if (member.done != nullptr) dones.push_back(std::move(member.done));
+      }
+    };
+    for (auto& it : buckets_) {
+      for (auto& pending : it.second.pending) {
+        take_dones(&pending.second);
+      }
+      for (Instance& instance : it.second.ready) {
+        take_dones(&instance);
+      }
+      for (auto& unplanned : it.second.unplanned) {
+        take_dones(&unplanned.second);
+      }
+    }
+    buckets_.clear();
+  }
+  for (const StatusCallback& done : dones) {
+    done(s);
+  }
+}
+
+void CollectiveFusionBuffer::ScheduleExecute(Batch batch) {
+  // The reduction may block, so don't run it on the timer or executor thread.
+  auto shared = std::make_shared<Batch>(std::move(batch));
+  std::shared_ptr<CollectiveFusionBuffer> self = shared_from_this();
+  work_queue_->Schedule([self, shared]() {
+    if (shared->seq < 0) {
+      self->Execute(shared->instances);
+    } else {
+      self->ExecuteAcrossTasks(std::move(*shared));
+    }
+  });
+}
+
+void CollectiveFusionBuffer::Execute(const std::vector<Instance>& instances) {
+  VLOG(1) << "CollectiveFusionBuffer executing " << instances.size()
+          << " fused reductions";
+  const Status s = Reduce(instances);
+  for (const Instance& instance : instances) {
+    for (const Member& member : instance.members) {
+      member.done(s);
+    }
+  }
+}
+
+/*static*/
+void CollectiveFusionBuffer::Pack(const std::vector<Instance>& instances,
+                                  int rank, Tensor* t) {
+  char* dst = MutableData(t);
+  for (const Instance& instance : instances) {
+    const StringPiece src = instance.members[rank].input->tensor_data();
+    if (!src.empty()) memcpy(dst, src.data(), src.size());
+    dst += src.size();
+  }
+}
+
+Status CollectiveFusionBuffer::Reduce(const std::vector<Instance>& instances) {
+  const Member& lead = instances[0].members[0];
+  const int group_size = instances[0].members.size();
+  const DataType dtype = lead.input->dtype();
+  int64 num_elements = 0;
+  for (const Instance& instance : instances) {
+    num_elements += instance.members[0].input->NumElements();
+  }
+
+  // Pack the inputs of each rank in turn and accumulate them into the inputs
+  // of rank 0.
+  Allocator* allocator = lead.device->GetAllocator(AllocatorAttributes());
+  Tensor accum(allocator, dtype, TensorShape({num_elements}));
+  Tensor packed(allocator, dtype, TensorShape({num_elements}));
+  Pack(instances, 0, &accum);
+  for (int rank = 1; rank < group_size; ++rank) {
+    Pack(instances, rank, &packed);
+    TF_RETURN_IF_ERROR(collective_util::ComputeBinOp(
+        lead.ctx, lead.op_params, lead.device, lead.merge_op, &accum,
+        &packed));
+  }
+  if (lead.final_op != nullptr) {
+    Tensor group_size_val = Scalar(dtype, group_size);
+    TF_RETURN_IF_ERROR(collective_util::ComputeBinOp(
+        lead.ctx, lead.op_params, lead.device, lead.final_op, &accum,
+        &group_size_val));
+  }
+
+  // Scatter the result.  Outputs may alias their inputs, which have already
+  // been consumed.
+  const char* src = accum.tensor_data().data();
+  for (const Instance& instance : instances) {
+    const size_t bytes = instance.members[0].input->TotalBytes();
+    for (const Member& member : instance.members) {
+      if (bytes > 0) memcpy(MutableData(member.output), src, bytes);
+    }
+    src += bytes;
+  }
+  return Status::OK();
+}
+
+void CollectiveFusionBuffer::ExecuteAcrossTasks(Batch batch) {
+  VLOG(1) << "CollectiveFusionBuffer executing " << batch.instances.size()
+          << " fused reductions as " << FusedExecKey(batch.bucket_key,
+                                                     batch.seq);
+  // The state of the collectives run by the members on this task.
+  struct Run {
+    std::vector<Instance> instances;
+    std::vector<int> ranks;
+    std::vector<Tensor> packed;
+    mutex mu;
+    Status status TF_GUARDED_BY(mu);
+    int pending TF_GUARDED_BY(mu) = 0;
+  };
+  auto run = std::make_shared<Run>();
+  const std::vector<Member>& first = batch.instances[0].members;
+  const int group_size = first.size();
+  for (int rank = 0; rank < group_size; ++rank) {
+    if (first[rank].done != nullptr) run->ranks.push_back(rank);
+  }
+  if (run->ranks[0] == 0) {
+    PostPlan(batch);
+  }
+  const int lead_rank = run->ranks[0];
+  const DataType dtype = first[lead_rank].input->dtype();
+  int64 num_elements = 0;
+  for (const Instance& instance : batch.instances) {
+    num_elements += instance.members[lead_rank].input->NumElements();
+  }
+  run->packed.resize(group_size);
+  for (int rank : run->ranks) {
+    const Member& member = first[rank];
+    run->packed[rank] =
+        Tensor(member.device->GetAllocator(AllocatorAttributes()), dtype,
+               TensorShape({num_elements}));
+    Pack(batch.instances, rank, &run->packed[rank]);
+  }
+  run->instances = std::move(batch.instances);
+  {
+    mutex_lock l(run->mu);
+    run->pending = run->ranks.size();
+  }
+
+  auto done = [run](const Status& s) {
+    Status status;
+    {
+      mutex_lock l(run->mu);
+      run->status.Update(s);
+      if (--run->pending > 0) return;
+      status = run->status;
+    }
+    if (status.ok()) {
+      // Scatter the result of each rank.
+      for (int rank : run->ranks) {
+        const char* src = run->packed[rank].tensor_data().data();
+        for (const Instance& instance : run->instances) {
+          const Member& member = instance.members[rank];
+          const size_t bytes = member.input->TotalBytes();
+          if (bytes > 0) memcpy(MutableData(member.output), src, bytes);
+          src += bytes;
+        }
+      }
+    }
+    for (const Instance& instance : run->instances) {
+      for (const Member& member : instance.members) {
+        if (member.done != nullptr) member.done(status);
+      }
+    }
+  };
+  const string exec_key = FusedExecKey(batch.bucket_key, batch.seq);
+  for (int rank : run->ranks) {
+    const Member& member = run->instances[0].members[rank];
+    run_collective_(member.ctx, *member.col_params, exec_key,
+                    &run->packed[rank], &run->packed[rank], done);
+  }
+}
+
+void CollectiveFusionBuffer::PostPlan(const Batch& batch) {
+  auto plan =
+      std::make_shared<Tensor>(DT_INT64, TensorShape({kMaxPlanSize + 1}));
+  auto flat = plan->flat<int64>();
+  flat.setZero();
+  flat(0) = batch.instances.size();
+  for (size_t i = 0; i < batch.instances.size(); ++i) {
+    flat(i + 1) =
+        static_cast<int64>(Fingerprint64(batch.instances[i].exec_key));
+  }
+  // Rank 0 sends the plan to the first member of each other task.
+  const Member& lead = batch.instances[0].members[0];
+  const CollectiveParams& cp = *lead.col_params;
+  std::shared_ptr<CollectiveFusionBuffer> self = shared_from_this();
+  std::unordered_set<string> tasks;
+  for (int rank = 0; rank < cp.group.group_size; ++rank) {
+    const string& task = cp.instance.task_names[rank];
+    if (cp.task.is_local[rank] || !tasks.insert(task).second) continue;
+    remote_access_->PostToPeer(
+        cp.instance.device_names[rank], task,
+        PlanKey(batch.bucket_key, batch.seq, task), lead.device,
+        lead.ctx->op_device_context(), AllocatorAttributes(), plan.get(),
+        lead.device->attributes().locality(),
+        [self, plan](const Status& s) {
+          if (!s.ok()) self->StartAbort(s);
+        });
+  }
+}
+
+}  // namespace tensorflow
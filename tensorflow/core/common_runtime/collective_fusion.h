@@ -0,0 +1,202 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/unbounded_work_queue.h"
+
+namespace tensorflow {
+class ConfigProto;
+class Device;
+class DeviceMgr;
+
+// Configures the runtime fusion of small reductions, see
+// ConfigProto.Experimental.collective_fusion_threshold_bytes.
+struct CollectiveFusionOptions {
+  // Reductions with inputs of at most this many bytes are fused, and a bucket
+  // is executed as soon as it holds this many bytes of ready reductions.  Zero
+  // disables fusion.
+  int64 threshold_bytes = 0;
+  // Maximum time a ready reduction waits for others before it is executed.
+  int64 window_micros = 0;
+
+  static CollectiveFusionOptions FromConfig(const ConfigProto& config);
+};
+
+// Buffers small reductions issued to one CollectiveExecutor and executes the
+// ready ones together.  A reduction is ready once every member of its group
+// on this task has called Add() with the same exec_key.  Ready reductions of
+// the same group, data type and ops are packed into one flat tensor per rank.
+//
+// If every member of the group is a CPU device of this process, the packed
+// tensors are reduced in-process with a single pass of merge_op and final_op.
+// Otherwise the task that holds rank 0 decides which reductions form each
+// bucket and posts that plan to the other tasks, which pack the same
+// reductions in the same order.  Every task then runs one collective over its
+// packed tensors, so the whole bucket pays the latency of a single reduction.
+// In both cases the result is scattered back to the outputs.
+class CollectiveFusionBuffer
+    : public std::enable_shared_from_this<CollectiveFusionBuffer> {
+ public:
+  // Runs the collective of `col_params` on `input` and `output` under
+  // `exec_key`, like CollectiveExecutor::ExecuteAsync() does for the op of
+  // `ctx`.
+  typedef std::function<void(OpKernelContext* ctx,
+                             const CollectiveParams& col_params,
+                             const string& exec_key, const Tensor* input,
+                             Tensor* output, const StatusCallback& done)>
+      RunCollectiveFn;
+
+  // Reductions of groups that span tasks are only fused if `remote_access`
+  // and `run_collective` are set.
+  CollectiveFusionBuffer(const CollectiveFusionOptions& options,
+                         const DeviceMgr* dev_mgr,
+                         std::shared_ptr<UnboundedWorkQueue> work_queue,
+                         CollectiveRemoteAccess* remote_access = nullptr,
+                         RunCollectiveFn run_collective = nullptr);
+
+  // Returns true if the collective described by `col_params` with the given
+  // input may be handed to Add() instead of being executed on its own.
+  bool CanFuse(const CollectiveParams& col_params, const Tensor& input) const;
+
+  // Adds the contribution of one group member to the reduction identified by
+  // `exec_key`.  `ctx`, `op_params`, `col_params`, `input` and `output` must
+  // stay valid until `done` is called.
+  void Add(OpKernelContext* ctx, OpKernelContext::Params* op_params,
+           const CollectiveParams& col_params, const string& exec_key,
+           const Tensor* input, Tensor* output, StatusCallback done);
+
+  // Fails every buffered reduction, and every later call to Add(), with `s`.
+  void StartAbort(const Status& s);
+
+ private:
+  struct Member {
+    OpKernelContext* ctx = nullptr;
+    OpKernelContext::Params* op_params = nullptr;
+    const CollectiveParams* col_params = nullptr;
+    Device* device = nullptr;
+    OpKernel* merge_op = nullptr;
+    OpKernel* final_op = nullptr;
+    const Tensor* input = nullptr;
+    Tensor* output = nullptr;
+    StatusCallback done;
+  };
+
+  // One reduction, with its members indexed by rank.  Only the members on
+  // this task are set.
+  struct Instance {
+    string exec_key;
+    std::vector<Member> members;
+    int num_members = 0;
+  };
+
+  // Reductions of a group that spans tasks, which the task of rank 0 decided
+  // to execute together as the `seq`-th fused collective of their bucket.
+  struct Plan {
+    int64 seq = 0;
+    std::vector<uint64> fingerprints;
+  };
+
+  // Reductions that may be fused together.
+  struct Bucket {
+    std::unordered_map<string, Instance> pending;
+    std::vector<Instance> ready;
+    int64 ready_bytes = 0;
+    bool flush_scheduled = false;
+    // Whether the group spans tasks, and whether this task decides the plans.
+    bool cross_task = false;
+    bool is_decider = false;
+    // Number of plans sent (on the deciding task) or received (on the others).
+    int64 next_seq = 0;
+    // On the other tasks: ready reductions by the fingerprint of their
+    // exec_key, received plans that still wait for some of them, the
+    // fingerprints of those plans, and whether the next plan is being
+    // received.
+    std::unordered_map<uint64, Instance> unplanned;
+    std::vector<Plan> plans;
+    std::unordered_set<uint64> planned;
+    bool recv_pending = false;
+  };
+
+  // Ready reductions to execute together.  `seq` is -1 for groups on this
+  // process.
+  struct Batch {
+    string bucket_key;
+    int64 seq = -1;
+    std::vector<Instance> instances;
+  };
+
+  // Where a task that does not decide the plans receives the next one.
+  struct PlanRecv {
+    int64 seq = -1;
+    Device* device = nullptr;
+    DeviceContext* device_ctx = nullptr;
+    const CollectiveParams* col_params = nullptr;
+  };
+
+  // Takes the ready reductions of the bucket, as the next plan if the group
+  // spans tasks.
+  static Batch TakeReady(const string& bucket_key, Bucket* bucket);
+  // Takes the received plans of the bucket whose reductions are all ready.
+  static std::vector<Batch> TakeExecutablePlans(const string& bucket_key,
+                                                Bucket* bucket);
+  // Returns the plan to receive next if some ready reduction is not covered
+  // by a received plan, or a PlanRecv with seq -1.
+  static PlanRecv NextPlanRecv(Bucket* bucket);
+
+  // Takes the ready reductions of the bucket and schedules their execution.
+  void Flush(const string& bucket_key);
+  void ScheduleExecute(Batch batch);
+  void RecvPlan(const string& bucket_key, const PlanRecv& recv);
+  void PlanReceived(const string& bucket_key, int64 seq, const Tensor& plan,
+                    const Status& s);
+  // Reduces `instances` and calls the done callbacks of their members.
+  void Execute(const std::vector<Instance>& instances);
+  Status Reduce(const std::vector<Instance>& instances);
+  // Packs the inputs of `rank` in `instances` into `t`.
+  static void Pack(const std::vector<Instance>& instances, int rank,
+                   Tensor* t);
+  // Runs one collective over the packed inputs of each rank on this task and
+  // calls the done callbacks of the members.
+  void ExecuteAcrossTasks(Batch batch);
+  // Sends the plan of `batch` to the other tasks of the group.
+  void PostPlan(const Batch& batch);
+
+  const CollectiveFusionOptions options_;
+  const DeviceMgr* dev_mgr_;  // Not owned.
+  std::shared_ptr<UnboundedWorkQueue> work_queue_;
+  CollectiveRemoteAccess* remote_access_;  // Not owned.
+  const RunCollectiveFn run_collective_;
+  mutex mu_;
+  Status status_ TF_GUARDED_BY(mu_);
+  std::unordered_map<string, Bucket> buckets_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_H_
@@ -0,0 +1,439 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_fusion.h"
+
+#include <unordered_map>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/unbounded_work_queue.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+static const int64 kStepId = 123;
+static const int kGroupKey = 5;
+
+std::unique_ptr<OpKernel> GetKernel(const NodeDef& node, Device* device) {
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()), node,
+      TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, Device* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder(strings::StrCat(op, "_node"), op)
+                  .Attr("T", DT_FLOAT)
+                  .Input(FakeInput(DT_FLOAT))
+                  .Input(FakeInput(DT_FLOAT))
+                  .Finalize(&node_def));
+  return GetKernel(node_def, device);
+}
+
+// Routes receives from peers of other tasks to the CollectiveRemoteAccessLocal
+// of that task, so that the tasks of a group can share one process.  Counts the
+// buffers posted under each kind of key.
+class FakeTaskRemoteAccess : public CollectiveRemoteAccessLocal {
+ public:
+  FakeTaskRemoteAccess(
+      const DeviceMgr* dev_mgr, DeviceResolverInterface* dev_resolver,
+      const std::unordered_map<string, FakeTaskRemoteAccess*>* tasks)
+      : CollectiveRemoteAccessLocal(dev_mgr, dev_resolver, kStepId),
+        tasks_(tasks) {}
+
+  void RecvFromPeer(const string& peer_device, const string& peer_task,
+                    bool peer_is_local, const string& key, Device* to_device,
+                    DeviceContext* to_device_ctx,
+                    const AllocatorAttributes& to_alloc_attr, Tensor* to_tensor,
+                    const DeviceLocality& client_locality,
+                    int dev_to_dev_stream_index,
+                    const StatusCallback& done) override {
+    CollectiveRemoteAccessLocal* peer = this;
+    if (!peer_is_local) {
+      auto it = tasks_->find(peer_task);
+      if (it == tasks_->end()) {
+        done(errors::NotFound("Unknown task ", peer_task));
+        return;
+      }
+      peer = it->second;
+    }
+    peer->CollectiveRemoteAccessLocal::RecvFromPeer(
+        peer_device, peer_task, /*peer_is_local=*/true, key, to_device,
+        to_device_ctx, to_alloc_attr, to_tensor, client_locality,
+        dev_to_dev_stream_index, done);
+  }
+
+  void PostToPeer(const string& peer_device, const string& peer_task,
+                  const string& key, Device* from_device,
+                  DeviceContext* from_device_ctx,
+                  const AllocatorAttributes& from_alloc_attr,
+                  const Tensor* from_tensor,
+                  const DeviceLocality& client_locality,
+                  const StatusCallback& done) override {
+    {
+      mutex_lock l(mu_);
+      if (absl::StartsWith(key, "fusion_plan:")) {
+        ++num_plans_;
+      } else if (!absl::StrContains(key, "fused:")) {
+        ++num_unfused_;
+      }
+    }
+    CollectiveRemoteAccessLocal::PostToPeer(
+        peer_device, peer_task, key, from_device, from_device_ctx,
+        from_alloc_attr, from_tensor, client_locality, done);
+  }
+
+  int num_plans() {
+    mutex_lock l(mu_);
+    return num_plans_;
+  }
+
+  int num_unfused() {
+    mutex_lock l(mu_);
+    return num_unfused_;
+  }
+
+ private:
+  const std::unordered_map<string, FakeTaskRemoteAccess*>* tasks_;
+  mutex mu_;
+  int num_plans_ TF_GUARDED_BY(mu_) = 0;
+  int num_unfused_ TF_GUARDED_BY(mu_) = 0;
+};
+
+class CollectiveFusionTest : public ::testing::Test {
+ protected:
+  // The state of one CollectiveReduce op, which must outlive its execution.
+  struct Op {
+    Tensor tensor;
+    CollectiveParams col_params;
+    std::unique_ptr<OpKernel> kernel;
+    gtl::InlinedVector<TensorValue, 4> inputs;
+    gtl::InlinedVector<AllocatorAttributes, 4> input_alloc_attrs;
+    AllocatorAttributes output_alloc_attr;
+    int forward_from = 0;
+    OpKernelContext::Params op_params;
+    std::unique_ptr<OpKernelContext> ctx;
+    Status status;
+  };
+
+  ~CollectiveFusionTest() override {
+    for (CollectiveExecutor* col_exec : col_execs_) col_exec->Unref();
+    for (DeviceContext* dev_ctx : dev_ctxs_) dev_ctx->Unref();
+  }
+
+  void Init(int num_devices, const CollectiveFusionOptions& options) {
+    InitTasks(/*num_tasks=*/1, num_devices, options);
+  }
+
+  // Creates `devices_per_task` devices for each of `num_tasks` tasks, which
+  // share the process but each have their own CollectiveExecutor.
+  void InitTasks(int num_tasks, int devices_per_task,
+                 const CollectiveFusionOptions& options) {
+    num_tasks_ = num_tasks;
+    devices_per_task_ = devices_per_task;
+    std::vector<std::unique_ptr<Device>> devices;
+    SessionOptions sess_opts;
+    sess_opts.env = Env::Default();
+    for (int ti = 0; ti < num_tasks; ++ti) {
+      for (int di = 0; di < devices_per_task; ++di) {
+        devices.push_back(absl::make_unique<ThreadPoolDevice>(
+            sess_opts, strings::StrCat(TaskName(ti), "/cpu:", di),
+            Bytes(4 << 20), DeviceLocality(), cpu_allocator()));
+        dev_ctxs_.push_back(new DeviceContext);
+      }
+    }
+    dev_mgr_ = absl::make_unique<StaticDeviceMgr>(std::move(devices));
+    dev_resolver_ = absl::make_unique<DeviceResolverLocal>(dev_mgr_.get());
+    work_queue_ = std::make_shared<UnboundedWorkQueue>(Env::Default(), "test");
+    for (int ti = 0; ti < num_tasks; ++ti) {
+      FakeTaskRemoteAccess* remote_access =
+          new FakeTaskRemoteAccess(dev_mgr_.get(), dev_resolver_.get(), &tasks_);
+      tasks_[TaskName(ti)] = remote_access;
+      remote_accesses_.push_back(remote_access);
+      col_execs_.push_back(new BaseCollectiveExecutor(
+          &col_exec_mgr_, remote_access, kStepId, dev_mgr_.get(),
+          &gpu_ring_order_, work_queue_, options));
+    }
+  }
+
+  static string TaskName(int task) {
+    return strings::StrCat("/job:worker/replica:0/task:", task);
+  }
+
+  // Prepares the CollectiveReduce op of `rank` for instance `instance_key`,
+  // computing the mean of `input` over the group.
+  Op* AddOp(int rank, int instance_key, const Tensor& input) {
+    const int group_size = dev_mgr_->ListDevices().size();
+    const int task = rank / devices_per_task_;
+    Device* device = dev_mgr_->ListDevices()[rank];
+    ops_.push_back(absl::make_unique<Op>());
+    Op* op = ops_.back().get();
+    op->tensor = tensor::DeepCopy(input);
+
+    CollectiveParams& cp = op->col_params;
+    cp.name = "test_collective";
+    cp.group.group_key = kGroupKey;
+    cp.group.group_size = group_size;
+    cp.group.device_type = DEVICE_CPU;
+    cp.group.num_tasks = num_tasks_;
+    cp.instance.instance_key = instance_key;
+    cp.instance.type = REDUCTION_COLLECTIVE;
+    cp.instance.data_type = DT_FLOAT;
+    cp.instance.shape = input.shape();
+    cp.instance.impl_details.collective_name = "RingReduce";
+    cp.instance.impl_details.subdiv_offsets.push_back(0);
+    for (int di = 0; di < group_size; ++di) {
+      cp.instance.device_names.push_back(dev_mgr_->ListDevices()[di]->name());
+      cp.instance.task_names.push_back(TaskName(di / devices_per_task_));
+      cp.task.is_local.push_back(di / devices_per_task_ == task);
+    }
+    cp.default_rank = rank;
+    if (num_tasks_ > 1) {
+      CollectiveImplementationInterface* ring = nullptr;
+      TF_CHECK_OK(
+          CollectiveRegistry::LookupParamResolverInstance("RingReduce", &ring));
+      TF_CHECK_OK(ring->InitializeCollectiveParams(&cp));
+    }
+    cp.merge_op = GetBinOp("Add", device);
+    cp.final_op = GetBinOp("Div", device);
+
+    NodeDef node_def;
+    TF_CHECK_OK(NodeDefBuilder(strings::StrCat("reduce_", ops_.size()),
+                               "CollectiveReduce")
+                    .Attr("T", DT_FLOAT)
+                    .Attr("merge_op", "Add")
+                    .Attr("final_op", "Div")
+                    .Attr("group_size", group_size)
+                    .Attr("group_key", kGroupKey)
+                    .Attr("instance_key", instance_key)
+                    .Attr("subdiv_offsets", std::vector<int>{0})
+                    .Input(FakeInput(DT_FLOAT))
+                    .Finalize(&node_def));
+    op->kernel = GetKernel(node_def, device);
+
+    op->inputs.push_back(TensorValue(&op->tensor));
+    op->input_alloc_attrs.push_back(AllocatorAttributes());
+    op->op_params.step_id = kStepId;
+    op->op_params.device = device;
+    op->op_params.inputs = &op->inputs;
+    op->op_params.input_alloc_attrs = &op->input_alloc_attrs;
+    op->op_params.op_device_context = dev_ctxs_[rank];
+    op->op_params.forward_from_array = &op->forward_from;
+    op->op_params.output_attr_array = &op->output_alloc_attr;
+    op->op_params.op_kernel = op->kernel.get();
+    op->ctx = absl::make_unique<OpKernelContext>(&op->op_params, 1);
+    Tensor* output = nullptr;
+    TF_CHECK_OK(op->ctx->forward_input_or_allocate_output(
+        {0}, 0, op->tensor.shape(), &output));
+    return op;
+  }
+
+  void Execute(Op* op, BlockingCounter* counter) {
+    const int task = op->col_params.default_rank / devices_per_task_;
+    col_execs_[task]->ExecuteAsync(
+        op->ctx.get(), op->col_params,
+        strings::StrCat(op->col_params.instance.instance_key, ":0:0"),
+        [op, counter](const Status& s) {
+          op->status = s;
+          counter->DecrementCount();
+        });
+  }
+
+  // Runs `num_tensors` reductions over `num_devices` devices, where tensor i
+  // has 1 + i * len_step elements, and checks that every device computes the
+  // mean of each input.
+  void RunTest(int num_devices, int num_tensors, int len_step,
+               const CollectiveFusionOptions& options) {
+    Init(num_devices, options);
+    RunReductions(num_tensors, len_step);
+  }
+
+  void RunReductions(int num_tensors, int len_step) {
+    const int num_devices = dev_mgr_->ListDevices().size();
+    std::vector<std::vector<Op*>> ops(num_tensors);
+    std::vector<Tensor> expected;
+    for (int ti = 0; ti < num_tensors; ++ti) {
+      const int len = 1 + len_step * ti;
+      Tensor sum(DT_FLOAT, TensorShape({len}));
+      sum.flat<float>().setZero();
+      for (int di = 0; di < num_devices; ++di) {
+        Tensor input(DT_FLOAT, TensorShape({len}));
+        for (int i = 0; i < len; ++i) {
+          input.flat<float>()(i) = (di + 1) * (i + ti);
+        }
+        sum.flat<float>() += input.flat<float>();
+        ops[ti].push_back(AddOp(di, /*instance_key=*/ti, input));
+      }
+      sum.flat<float>() = sum.flat<float>() / static_cast<float>(num_devices);
+      expected.push_back(sum);
+    }
+
+    // Issue the ops of each device in a different order.
+    BlockingCounter counter(num_devices * num_tensors);
+    for (int di = 0; di < num_devices; ++di) {
+      for (int i = 0; i < num_tensors; ++i) {
+        const int ti = (di % 2 == 0) ? i : num_tensors - 1 - i;
+        Execute(ops[ti][di], &counter);
+      }
+    }
+    counter.Wait();
+
+    for (int ti = 0; ti < num_tensors; ++ti) {
+      for (int di = 0; di < num_devices; ++di) {
+        TF_ASSERT_OK(ops[ti][di]->status);
+        test::ExpectTensorNear<float>(
+            expected[ti], *ops[ti][di]->ctx->mutable_output(0), 1e-5);
+      }
+    }
+  }
+
+  TestCollectiveExecutorMgr col_exec_mgr_;
+  std::unique_ptr<DeviceMgr> dev_mgr_;
+  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
+  std::shared_ptr<UnboundedWorkQueue> work_queue_;
+  string gpu_ring_order_;
+  std::vector<DeviceContext*> dev_ctxs_;
+  int num_tasks_ = 1;
+  int devices_per_task_ = 0;
+  std::unordered_map<string, FakeTaskRemoteAccess*> tasks_;
+  std::vector<FakeTaskRemoteAccess*> remote_accesses_;
+  std::vector<CollectiveExecutor*> col_execs_;
+  std::vector<std::unique_ptr<Op>> ops_;
+};
+
+TEST_F(CollectiveFusionTest, FusesReadyReductionsAfterWindow) {
+  CollectiveFusionOptions options;
+  options.threshold_bytes = 1 << 20;
+  options.window_micros = 1000;
+  RunTest(/*num_devices=*/3, /*num_tensors=*/20, /*len_step=*/7, options);
+}
+
+TEST_F(CollectiveFusionTest, FlushesFullBucketWithoutWaiting) {
+  // Every pair of ready single-element reductions fills the bucket.  With a
+  // window this long the test only finishes quickly if full buckets are
+  // executed right away.
+  CollectiveFusionOptions options;
+  options.threshold_bytes = 2 * sizeof(float);
+  options.window_micros = 60 * 1000 * 1000;
+  const uint64 start_us = Env::Default()->NowMicros();
+  RunTest(/*num_devices=*/2, /*num_tensors=*/4, /*len_step=*/0, options);
+  EXPECT_LT(Env::Default()->NowMicros() - start_us, 30 * 1000 * 1000);
+}
+
+TEST_F(CollectiveFusionTest, FusesReductionsAcrossTasks) {
+  CollectiveFusionOptions options;
+  options.threshold_bytes = 1 << 20;
+  options.window_micros = 1000;
+  InitTasks(/*num_tasks=*/2, /*devices_per_task=*/2, options);
+  RunReductions(/*num_tensors=*/20, /*len_step=*/7);
+  // Rank 0 told the other task which reductions to fuse, and the chunks of
+  // every ring were exchanged under the key of a fused collective.
+  EXPECT_GT(remote_accesses_[0]->num_plans(), 0);
+  EXPECT_EQ(remote_accesses_[1]->num_plans(), 0);
+  for (FakeTaskRemoteAccess* remote_access : remote_accesses_) {
+    EXPECT_EQ(remote_access->num_unfused(), 0);
+  }
+}
+
+TEST_F(CollectiveFusionTest, FlushesFullPlansAcrossTasks) {
+  CollectiveFusionOptions options;
+  options.threshold_bytes = 2 * sizeof(float);
+  options.window_micros = 60 * 1000 * 1000;
+  InitTasks(/*num_tasks=*/2, /*devices_per_task=*/1, options);
+  const uint64 start_us = Env::Default()->NowMicros();
+  RunReductions(/*num_tensors=*/4, /*len_step=*/0);
+  EXPECT_LT(Env::Default()->NowMicros() - start_us, 30 * 1000 * 1000);
+}
+
+TEST_F(CollectiveFusionTest, CanFuse) {
+  CollectiveFusionOptions options;
+  options.threshold_bytes = 64;
+  Init(/*num_devices=*/2, options);
+  CollectiveFusionBuffer buffer(options, dev_mgr_.get(), work_queue_);
+  Op* op = AddOp(/*rank=*/0, /*instance_key=*/1,
+                 test::AsTensor<float>({1, 2, 3, 4}));
+  CollectiveParams& cp = op->col_params;
+  EXPECT_TRUE(buffer.CanFuse(cp, op->tensor));
+  EXPECT_FALSE(buffer.CanFuse(cp, Tensor(DT_FLOAT, TensorShape({17}))));
+  // Groups that span tasks need a way to exchange plans and run collectives.
+  cp.task.is_local[1] = false;
+  EXPECT_FALSE(buffer.CanFuse(cp, op->tensor));
+  CollectiveFusionBuffer cross_task_buffer(
+      options, dev_mgr_.get(), work_queue_, remote_accesses_[0],
+      [](OpKernelContext*, const CollectiveParams&, const string&,
+         const Tensor*, Tensor*, const StatusCallback& done) {
+        done(errors::Unimplemented("Not run by this test"));
+      });
+  EXPECT_TRUE(cross_task_buffer.CanFuse(cp, op->tensor));
+  cp.task.is_local[1] = true;
+  cp.instance.impl_details.compression = "bf16";
+  EXPECT_FALSE(buffer.CanFuse(cp, op->tensor));
+  cp.instance.impl_details.compression = "";
+  cp.instance.impl_details.dependencies.push_back(0);
+  EXPECT_FALSE(buffer.CanFuse(cp, op->tensor));
+  cp.instance.impl_details.dependencies.clear();
+  cp.instance.type = GATHER_COLLECTIVE;
+  EXPECT_FALSE(buffer.CanFuse(cp, op->tensor));
+}
+
+TEST_F(CollectiveFusionTest, AbortFailsBufferedReductions) {
+  CollectiveFusionOptions options;
+  options.threshold_bytes = 1 << 20;
+  options.window_micros = 1000;
+  Init(/*num_devices=*/2, options);
+  // Only one of the two members arrives, so the reduction stays buffered.
+  Op* op = AddOp(/*rank=*/0, /*instance_key=*/1,
+                 test::AsTensor<float>({1, 2}));
+  BlockingCounter counter(1);
+  Execute(op, &counter);
+  col_execs_[0]->StartAbort(errors::Aborted("test abort"));
+  counter.Wait();
+  EXPECT_TRUE(errors::IsAborted(op->status)) << op->status;
+
+  // Later reductions fail right away.
+  Op* late = AddOp(/*rank=*/1, /*instance_key=*/2,
+                   test::AsTensor<float>({1, 2}));
+  BlockingCounter late_counter(1);
+  Execute(late, &late_counter);
+  late_counter.Wait();
+  EXPECT_TRUE(errors::IsAborted(late->status)) << late->status;
+}
+
+}  // namespace
+}  // namespace tensorflow
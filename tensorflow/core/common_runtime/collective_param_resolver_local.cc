@@ -65,7 +65,14 @@ const char* GetCollectiveName(const CollectiveParams* cp, bool nccl) {
       return "HierarchicalTreeBroadcast";
 
     case REDUCTION_COLLECTIVE:
-      return nccl ? "NcclReduce" : "RingReduce";
+      // Only the ring implementation compresses values in flight.
+      if (!cp->instance.impl_details.compression.empty()) return "RingReduce";
+      if (nccl) return "NcclReduce";
+      if (cp->instance.impl_details.communication_hint == "hierarchical" &&
+          cp->group.device_type == DEVICE_CPU) {
+        return "HierarchicalReduce";
+      }
+      return "RingReduce";
 
     case GATHER_COLLECTIVE:
       return "RingGather";
@@ -88,6 +95,7 @@ void CollectiveParamResolverLocal::CompleteGroupLocal(
     auto it = group_table_.find(cp->group.group_key);
     if (it == group_table_.end()) {
       gr = new GroupRec;
+      gr->generation = group_generation_;
       gr->group.group_key = cp->group.group_key;
       gr->group.group_size = cp->group.group_size;
       gr->group.device_type = cp->group.device_type;
@@ -463,6 +471,19 @@ void CollectiveParamResolverLocal::CompleteTaskIsLocal(const string& task_name,
   }
 }
 
+void CollectiveParamResolverLocal::CompleteHostNames(CollectiveParams* cp) {
+  cp->instance.host_names.clear();
+  cp->instance.host_names.reserve(cp->instance.task_names.size());
+  std::unordered_map<string, string> task_hosts;
+  for (const string& task_name : cp->instance.task_names) {
+    auto it = task_hosts.find(task_name);
+    if (it == task_hosts.end()) {
+      it = task_hosts.emplace(task_name, TaskHost(task_name)).first;
+    }
+    cp->instance.host_names.push_back(it->second);
+  }
+}
+
 void CollectiveParamResolverLocal::SetDefaultRank(const string& device,
                                                   CollectiveParams* cp) {
   CHECK_EQ(cp->group.group_size, cp->instance.device_names.size()) << cp;
@@ -777,6 +798,7 @@ void CollectiveParamResolverLocal::CompleteInstanceFromInitializedIRec(
   AssignCollectiveType(cp);
   SetDefaultRank(device, cp);
   CompleteTaskIsLocal(task_name_, cp);
+  CompleteHostNames(cp);
 
   CollectiveImplementationInterface* col_impl;
   Status status = CollectiveRegistry::LookupParamResolverInstance(
@@ -878,6 +900,36 @@ void CollectiveParamResolverLocal::StartAbort(const Status& s) {
   StartAbortLocal(s);
 }
 
+void CollectiveParamResolverLocal::ResetGroups(const Status& s) {
+  CHECK(!s.ok());
+  VLOG(1) << "Resetting collective groups: " << s;
+  // Resolutions that start while the groups are being reset fail with `s`.
+  {
+    mutex_lock l(status_mu_);
+    status_ = s;
+  }
+  StartAbortLocal(s);
+  {
+    mutex_lock l(group_mu_);
+    for (auto& item : group_table_) {
+      retired_groups_.push_back(std::move(item.second));
+    }
+    group_table_.clear();
+    ++group_generation_;
+  }
+  {
+    mutex_lock l(instance_mu_);
+    for (auto& group_entry : instance_table_) {
+      for (auto& item : group_entry.second) {
+        retired_instances_.push_back(std::move(item.second));
+      }
+    }
+    instance_table_.clear();
+  }
+  mutex_lock l(status_mu_);
+  status_ = Status::OK();
+}
+
 void CollectiveParamResolverLocal::StartAbortLocal(const Status& s) {
   {
     mutex_lock l(group_mu_);
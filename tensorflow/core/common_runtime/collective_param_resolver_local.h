@@ -61,6 +61,8 @@ class CollectiveParamResolverLocal : public ParamResolverInterface {
 
   void StartAbort(const Status& s) override;
 
+  void ResetGroups(const Status& s) override;
+
  protected:
   // For access to InstanceRec and CompleteDefaultRanking.
   friend class CollectiveParamResolverLocalTest;
@@ -68,6 +70,9 @@ class CollectiveParamResolverLocal : public ParamResolverInterface {
   // Used to complete/verify CollGroup.
   struct GroupRec {
     CollGroupParams group;
+    // Value of group_generation_ when the record was created. Set before the
+    // record is inserted in group_table_ and not modified afterwards.
+    int64 generation = 0;
     mutable mutex mu;
     Status status TF_GUARDED_BY(mu);
     std::set<string> device_set TF_GUARDED_BY(mu);
@@ -218,6 +223,13 @@ class CollectiveParamResolverLocal : public ParamResolverInterface {
   // Precondition: cp->device_names is fully populated and in final order.
   void CompleteTaskIsLocal(const string& task_name, CollectiveParams* cp);
 
+  // Returns the name of the host running `task_name`.  The default assumes
+  // that every task runs on a host of its own.
+  virtual string TaskHost(const string& task_name) { return task_name; }
+
+  // Sets cp->instance.host_names from cp->instance.task_names.
+  void CompleteHostNames(CollectiveParams* cp);
+
   // Sets cp->instance_default_rank according to location of device in
   // current ordering of cp->instance.device_names.
   void SetDefaultRank(const string& device, CollectiveParams* cp);
@@ -243,6 +255,15 @@ class CollectiveParamResolverLocal : public ParamResolverInterface {
   mutex instance_mu_;
   gtl::FlatMap<int32, gtl::FlatMap<int32, std::unique_ptr<InstanceRec>>>
       instance_table_ TF_GUARDED_BY(instance_mu_);
+  // Records removed by ResetGroups(). Callbacks of in-flight resolutions may
+  // still point to them, so they are kept until the resolver is destroyed.
+  std::vector<std::unique_ptr<GroupRec>> retired_groups_
+      TF_GUARDED_BY(group_mu_);
+  // Incremented by every ResetGroups(), so that group resolutions started
+  // before a reset can tell that their result is stale.
+  int64 group_generation_ TF_GUARDED_BY(group_mu_) = 0;
+  std::vector<std::unique_ptr<InstanceRec>> retired_instances_
+      TF_GUARDED_BY(instance_mu_);
   mutex status_mu_;
   Status status_ TF_GUARDED_BY(status_mu_);
 };
@@ -64,12 +64,22 @@ bool ReadBoolFromEnvVar(StringPiece env_var_name, bool default_val) {
   return default_val;
 }
 
+int64 ReadInt64FromEnvVar(StringPiece env_var_name, int64 default_val) {
+  int64 val;
+  if (tensorflow::ReadInt64FromEnvVar(env_var_name, default_val, &val).ok()) {
+    return val;
+  }
+  return default_val;
+}
+
 auto* eager_context_created =
     monitoring::Gauge<bool, 0>::New("/tensorflow/core/eager_context_created",
                                     "True if an eager context was created.");
 
 }  // namespace
 
+constexpr int64 EagerContext::kDefaultKernelCacheCapacity;
+
 EagerContext::EagerContext(
     const SessionOptions& opts,
     ContextDevicePlacementPolicy default_device_placement_policy, bool async,
@@ -86,6 +96,8 @@ EagerContext::EagerContext(
       thread_pool_(NewThreadPoolFromSessionOptions(opts)),
       custom_kernel_creator_(custom_kernel_creator),
       cluster_flr_(cluster_flr),
+      kernel_cache_(ReadInt64FromEnvVar("TF_EAGER_KERNEL_CACHE_CAPACITY",
+                                        kDefaultKernelCacheCapacity)),
       log_device_placement_(opts.config.log_device_placement()),
       allow_soft_placement_(opts.config.allow_soft_placement()),
       num_active_steps_(0),
@@ -109,6 +121,12 @@ EagerContext::EagerContext(
   };
 
 #if !defined(IS_MOBILE_PLATFORM)
+  if (ReadBoolFromEnvVar("TF_EAGER_ENABLE_OP_BATCHING", false)) {
+    Status s = EnableOpBatching(EagerOpBatcher::Options());
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to enable eager op batching: " << s;
+    }
+  }
   context_id_ = kInvalidContextId;
   context_view_id_ = 0;
 #endif  // IS_MOBILE_PLATFORM
@@ -379,7 +397,7 @@ void EagerContext::ClearCachesAndDefaultExecutor() {
   // as well.
   mutex_lock ml(cache_mu_);
   default_executor_.WaitForAllPendingNodes().IgnoreError();
-  kernel_cache_.clear();
+  kernel_cache_.Clear();
   for (auto& entry : registered_functions_) {
     entry.second->cached_kernel_keys->clear();
   }
@@ -716,7 +734,7 @@ Status EagerContext::AddFunctionDef(const FunctionDef& fdef,
     if (registered_function == nullptr) {
       registered_function = new RegisteredFunction;
       registered_function->cached_kernel_keys =
-          absl::make_unique<std::vector<Fprint128>>();
+          absl::make_unique<std::unordered_set<Fprint128, Fprint128Hasher>>();
       gtl::InsertOrUpdate(&registered_functions_, fdef.signature().name(),
                           registered_function);
     } else {
@@ -750,7 +768,7 @@ Status EagerContext::RemoveFunction(const string& func) {
     is_last_ref = registered_function->RefCountIsOne();
     if (is_last_ref) {
       for (auto& key : *registered_function->cached_kernel_keys) {
-        kernel_cache_.erase(key);
+        kernel_cache_.Erase(key);
       }
       registered_functions_.erase(func);
     }
@@ -813,30 +831,40 @@ Status EagerContext::SyncExecutors() {
 
 core::RefCountPtr<KernelAndDevice> EagerContext::GetCachedKernel(
     Fprint128 cache_key) {
-  tf_shared_lock l(cache_mu_);
-  auto iter = kernel_cache_.find(cache_key);
-  if (iter == kernel_cache_.end()) {
-    return nullptr;
-  }
-  core::RefCountPtr<KernelAndDevice> new_ref(iter->second.get());
-  new_ref->Ref();
-  return new_ref;
+  return kernel_cache_.Lookup(cache_key);
 }
 
 void EagerContext::AddKernelToCache(Fprint128 cache_key,
                                     KernelAndDevice* kernel) {
   mutex_lock ml(cache_mu_);
-  core::RefCountPtr<KernelAndDevice> new_ref(kernel);
-  new_ref->Ref();
-  kernel_cache_[cache_key] = std::move(new_ref);
+  std::vector<KernelCache::EvictedKernel> evicted;
+  kernel_cache_.Insert(cache_key, kernel, &evicted);
+  // Forget the keys of evicted function kernels, so that the keys of a
+  // function only grow with its live kernels.
+  for (const KernelCache::EvictedKernel& evicted_kernel : evicted) {
+    auto* evicted_function =
+        gtl::FindPtrOrNull(registered_functions_, evicted_kernel.kernel_name);
+    if (evicted_function != nullptr) {
+      evicted_function->cached_kernel_keys->erase(evicted_kernel.key);
+    }
+  }
   auto* registered_function =
       gtl::FindPtrOrNull(registered_functions_, kernel->name());
   // The kernel name can be either a primitive op or a function.
   if (registered_function != nullptr) {
-    registered_function->cached_kernel_keys->emplace_back(cache_key);
+    registered_function->cached_kernel_keys->insert(cache_key);
   }
 }
 
+#if !defined(IS_MOBILE_PLATFORM)
+Status EagerContext::EnableOpBatching(const EagerOpBatcher::Options& options) {
+  if (op_batcher_ != nullptr) {
+    return errors::FailedPrecondition("Op batching is already enabled");
+  }
+  return EagerOpBatcher::Create(options, &op_batcher_);
+}
+#endif  // !IS_MOBILE_PLATFORM
+
 bool EagerContext::ShouldStoreGraphs() { return should_store_graphs_.load(); }
 
 void EagerContext::SetShouldStoreGraphs(bool value) {
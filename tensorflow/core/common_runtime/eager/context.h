@@ -39,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/eager/eager_executor.h"
 #include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
+#include "tensorflow/core/common_runtime/eager/kernel_cache.h"
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/example/example.pb.h"
@@ -46,6 +47,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/util/device_name_utils.h"
 #if !defined(IS_MOBILE_PLATFORM)
+#include "tensorflow/core/common_runtime/eager/eager_op_batcher.h"
 #include "tensorflow/core/distributed_runtime/eager/eager_client.h"
 #include "tensorflow/core/distributed_runtime/rendezvous_mgr_interface.h"
 #include "tensorflow/core/distributed_runtime/server_lib.h"
@@ -263,10 +265,15 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
 
   Status AsyncWait() override { return SyncExecutors(); }
 
+  // The kernel cache holds at most TF_EAGER_KERNEL_CACHE_CAPACITY kernels
+  // (kDefaultKernelCacheCapacity by default, unbounded if <= 0), evicting the
+  // ones that were not used recently. Lookups don't contend with each other.
   core::RefCountPtr<KernelAndDevice> GetCachedKernel(Fprint128 cache_key);
 
   void AddKernelToCache(Fprint128 cache_key, KernelAndDevice* kernel);
 
+  static constexpr int64 kDefaultKernelCacheCapacity = 10000;
+
   bool LogDevicePlacement() const { return log_device_placement_; }
   void SetLogDevicePlacement(bool enable) { log_device_placement_ = enable; }
   bool AllowSoftPlacement() const { return allow_soft_placement_; }
@@ -457,6 +464,17 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
 
   bool PinSmallOpsToCPU() const { return pin_small_ops_to_cpu_; }
 
+#if !defined(IS_MOBILE_PLATFORM)
+  // Enables batching of identical ops executed at the same time, e.g. by the
+  // async executors of different threads. See EagerOpBatcher. Must be called
+  // before any op is executed. TF_EAGER_ENABLE_OP_BATCHING=true enables
+  // batching with the default options.
+  Status EnableOpBatching(const EagerOpBatcher::Options& options);
+
+  // Returns nullptr if op batching is disabled.
+  EagerOpBatcher* GetOpBatcher() const { return op_batcher_.get(); }
+#endif  // !IS_MOBILE_PLATFORM
+
   tensorflow::Env* TFEnv() const { return env_; }
 
   Status FindDeviceFromName(const char* device_name, Device** device) const;
@@ -587,11 +605,12 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
   struct RegisteredFunction : public core::RefCounted {
     ~RegisteredFunction() override {}
 
-    std::unique_ptr<std::vector<Fprint128>> cached_kernel_keys;
+    std::unique_ptr<std::unordered_set<Fprint128, Fprint128Hasher>>
+        cached_kernel_keys;
   };
-  std::unordered_map<Fprint128, core::RefCountPtr<KernelAndDevice>,
-                     Fprint128Hasher>
-      kernel_cache_ TF_GUARDED_BY(cache_mu_);
+  // Not guarded by cache_mu_, which only serializes updates of
+  // registered_functions_ with the kernel cache.
+  KernelCache kernel_cache_;
   std::unordered_map<string, RegisteredFunction*> registered_functions_
       TF_GUARDED_BY(cache_mu_);
 
@@ -685,6 +704,10 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
   bool use_send_tensor_rpc_;
   const bool pin_small_ops_to_cpu_;
 
+#if !defined(IS_MOBILE_PLATFORM)
+  std::unique_ptr<EagerOpBatcher> op_batcher_;
+#endif  // !IS_MOBILE_PLATFORM
+
   // Function that will be invoked in destructor to deallocate resources related
   // to this context.
   std::function<void()> resource_deallocator_ = nullptr;
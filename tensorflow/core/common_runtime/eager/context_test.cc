@@ -15,9 +15,14 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/eager/context.h"
 
+#include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -143,5 +148,72 @@ TEST_F(EagerContextTest, CompositeDeviceWithGivenName) {
   EXPECT_EQ(composite_device_1, composite_device_0);
 }
 
+KernelAndDevice* CreateTestKernel(const string& name) {
+  return new KernelAndDeviceFunc(
+      /*flr=*/nullptr, /*pflr=*/nullptr, /*input_devices=*/{},
+      /*composite_devices=*/{}, /*input_resource_dtypes_and_shapes=*/{},
+      /*runner=*/nullptr, /*collective_executor=*/nullptr,
+      /*host_cpu_device=*/nullptr, name,
+      /*rendezvous_creator=*/nullptr, /*get_op_id=*/nullptr);
+}
+
+TEST_F(EagerContextTest, KernelCache) {
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  const Fprint128 key = Fingerprint128("kernel");
+  EXPECT_EQ(context()->GetCachedKernel(key), nullptr);
+
+  core::RefCountPtr<KernelAndDevice> kernel(CreateTestKernel("kernel"));
+  context()->AddKernelToCache(key, kernel.get());
+  EXPECT_EQ(context()->GetCachedKernel(key).get(), kernel.get());
+
+  context()->ClearCachesAndThreadExecutors();
+  EXPECT_EQ(context()->GetCachedKernel(key), nullptr);
+  EXPECT_TRUE(kernel->RefCountIsOne());
+}
+
+// Looks up kernels from `num_threads` threads concurrently, like a server
+// executing eager ops from many request threads.
+void BM_GetCachedKernel(int iters, int num_threads) {
+  testing::StopTiming();
+  std::unique_ptr<Device> device(CreateDevice(DEVICE_CPU, 0));
+  StaticDeviceMgr device_mgr(std::move(device));
+  EagerContext* ctx = new EagerContext(
+      SessionOptions(), DEVICE_PLACEMENT_SILENT,
+      /* async */ false,
+      /* lazy_copy_function_remote_inputs */ false, &device_mgr,
+      /* device_mgr_owned */ false, /* rendezvous */ nullptr,
+      /* custom_kernel_creator */ nullptr,
+      /* cluster_flr */ nullptr);
+
+  const int kNumKernels = 64;
+  std::vector<Fprint128> keys;
+  for (int i = 0; i < kNumKernels; ++i) {
+    keys.push_back(Fingerprint128(strings::StrCat("kernel", i)));
+    core::RefCountPtr<KernelAndDevice> kernel(
+        CreateTestKernel(strings::StrCat("kernel", i)));
+    ctx->AddKernelToCache(keys.back(), kernel.get());
+  }
+
+  thread::ThreadPool pool(Env::Default(), "lookup", num_threads);
+  const int iters_per_thread = iters / num_threads;
+  BlockingCounter counter(num_threads);
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int t = 0; t < num_threads; ++t) {
+    pool.Schedule([ctx, &keys, &counter, iters_per_thread, t]() {
+      for (int i = 0; i < iters_per_thread; ++i) {
+        core::RefCountPtr<KernelAndDevice> kernel =
+            ctx->GetCachedKernel(keys[(i + t) % kNumKernels]);
+        CHECK(kernel != nullptr);
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  testing::StopTiming();
+  ctx->Unref();
+}
+BENCHMARK(BM_GetCachedKernel)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
 }  // namespace
 }  // namespace tensorflow
@@ -0,0 +1,351 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/eager/eager_op_batcher.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+struct BatchableOp {
+  // Inputs [0, num_batched_inputs) are batched, the other inputs must be
+  // shared by all the ops of a batch.
+  int num_batched_inputs;
+  // Minimum rank of the batched inputs. For lower ranks, the first dimension
+  // is not independent across rows.
+  int min_rank;
+};
+
+const std::unordered_map<string, BatchableOp>& BatchableOps() {
+  static const auto* batchable_ops =
+      new std::unordered_map<string, BatchableOp>({
+          // Element-wise unary ops.
+          {"Abs", {1, 1}},
+          {"Cast", {1, 1}},
+          {"Elu", {1, 1}},
+          {"Exp", {1, 1}},
+          {"Log", {1, 1}},
+          {"Neg", {1, 1}},
+          {"Relu", {1, 1}},
+          {"Relu6", {1, 1}},
+          {"Rsqrt", {1, 1}},
+          {"Selu", {1, 1}},
+          {"Sigmoid", {1, 1}},
+          {"Softplus", {1, 1}},
+          {"Sqrt", {1, 1}},
+          {"Square", {1, 1}},
+          {"Tanh", {1, 1}},
+          // Element-wise binary ops. Both inputs are batched, so they must
+          // have the same rank and number of rows, but may broadcast along
+          // the other dimensions.
+          {"Add", {2, 1}},
+          {"AddV2", {2, 1}},
+          {"Maximum", {2, 1}},
+          {"Minimum", {2, 1}},
+          {"Mul", {2, 1}},
+          {"RealDiv", {2, 1}},
+          {"SquaredDifference", {2, 1}},
+          {"Sub", {2, 1}},
+          // Row-wise ops, with shared weights.
+          {"BiasAdd", {1, 2}},
+          {"Conv2D", {1, 4}},
+          {"LogSoftmax", {1, 2}},
+          {"MatMul", {1, 2}},
+          {"Softmax", {1, 2}},
+      });
+  return *batchable_ops;
+}
+
+// Returns a key that is equal for ops that can run in the same batch: the
+// same op with the same attributes and device, and inputs of the same types
+// and shapes, except for the first dimension of the batched inputs.
+string BatchKey(const KernelAndDevice& kernel,
+                const std::vector<Tensor>& inputs, int num_batched_inputs) {
+  const OpKernel* op_kernel = kernel.kernel();
+  string key = strings::StrCat(
+      op_kernel->type_string(), "{",
+      SummarizeAttrsHelper(AttrSlice(op_kernel->def()),
+                           kernel.device()->name()),
+      "}");
+  const int num_inputs = inputs.size();
+  for (int i = 0; i < num_inputs; ++i) {
+    const Tensor& input = inputs[i];
+    strings::StrAppend(&key, ";", input.dtype(), ":");
+    for (int d = i < num_batched_inputs ? 1 : 0; d < input.dims(); ++d) {
+      strings::StrAppend(&key, input.dim_size(d), ",");
+    }
+  }
+  return key;
+}
+
+}  // namespace
+
+Status EagerOpBatcher::Create(const Options& options,
+                              std::unique_ptr<EagerOpBatcher>* batcher) {
+  if (options.max_batch_size <= 0) {
+    return errors::InvalidArgument("max_batch_size must be positive, got ",
+                                   options.max_batch_size);
+  }
+  std::unique_ptr<EagerOpBatcher> new_batcher(new EagerOpBatcher(options));
+  serving::SharedBatchScheduler<Task>::Options scheduler_options;
+  scheduler_options.thread_pool_name = "eager_op_batcher";
+  scheduler_options.num_batch_threads = options.num_batch_threads;
+  TF_RETURN_IF_ERROR(serving::SharedBatchScheduler<Task>::Create(
+      scheduler_options, &new_batcher->scheduler_));
+  *batcher = std::move(new_batcher);
+  return Status::OK();
+}
+
+bool EagerOpBatcher::IsBatchable(const KernelAndDevice& kernel,
+                                 const EagerKernelArgs& inputs) const {
+  const OpKernel* op_kernel = kernel.kernel();
+  // Batched inputs are concatenated on the host.
+  if (op_kernel == nullptr || kernel.device() == nullptr ||
+      kernel.device()->device_type() != DEVICE_CPU) {
+    return false;
+  }
+  auto it = BatchableOps().find(op_kernel->type_string());
+  if (it == BatchableOps().end()) {
+    return false;
+  }
+  const BatchableOp& op = it->second;
+  if (op_kernel->type_string() == "MatMul") {
+    bool transpose_a;
+    if (!GetNodeAttr(op_kernel->def(), "transpose_a", &transpose_a).ok() ||
+        transpose_a) {
+      return false;
+    }
+  }
+
+  const gtl::InlinedVector<TensorValue, 4>& values = *inputs.GetTensorValues();
+  if (static_cast<int>(values.size()) < op.num_batched_inputs) {
+    return false;
+  }
+  for (const TensorValue& value : values) {
+    if (value.tensor == nullptr || value.is_ref() ||
+        !DataTypeCanUseMemcpy(value.tensor->dtype())) {
+      return false;
+    }
+  }
+  const Tensor& first = *values[0].tensor;
+  if (first.dims() < op.min_rank || first.dim_size(0) <= 0 ||
+      first.dim_size(0) > options_.max_batch_size) {
+    return false;
+  }
+  for (int i = 1; i < op.num_batched_inputs; ++i) {
+    const Tensor& input = *values[i].tensor;
+    if (input.dims() != first.dims() ||
+        input.dim_size(0) != first.dim_size(0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status EagerOpBatcher::Run(ScopedStepContainer* step_container,
+                           const core::RefCountPtr<KernelAndDevice>& kernel,
+                           const EagerKernelArgs& inputs,
+                           std::vector<EagerKernelRet>* outputs) {
+  auto task = absl::make_unique<Task>();
+  kernel->Ref();
+  task->kernel.reset(kernel.get());
+  task->step_container = step_container;
+  for (const TensorValue& value : *inputs.GetTensorValues()) {
+    task->inputs.push_back(*value.tensor);
+  }
+  task->num_rows = task->inputs[0].dim_size(0);
+  task->num_batched_inputs =
+      BatchableOps().at(kernel->kernel()->type_string()).num_batched_inputs;
+
+  std::vector<Tensor> results;
+  Status status;
+  Notification done;
+  task->outputs = &results;
+  task->status = &status;
+  task->done = &done;
+
+  std::shared_ptr<Queue> queue = GetOrCreateQueue(*task);
+  if (queue == nullptr || !queue->Schedule(&task).ok()) {
+    // Too many batch keys or a full queue: don't wait for a batch.
+    return kernel->Run(step_container, inputs, outputs,
+                       /*cancellation_manager=*/nullptr,
+                       /*remote_func_params=*/absl::nullopt);
+  }
+  done.WaitForNotification();
+  TF_RETURN_IF_ERROR(status);
+  outputs->clear();
+  outputs->reserve(results.size());
+  for (Tensor& result : results) {
+    outputs->push_back(std::move(result));
+  }
+  return Status::OK();
+}
+
+std::shared_ptr<EagerOpBatcher::Queue> EagerOpBatcher::GetOrCreateQueue(
+    const Task& task) {
+  const string key =
+      BatchKey(*task.kernel, task.inputs, task.num_batched_inputs);
+  const uint64 now_micros = Env::Default()->NowMicros();
+  // Evicted queues are destroyed outside of `mu_`, since destroying a queue
+  // waits for its pending batches.
+  std::vector<std::shared_ptr<Queue>> evicted;
+  mutex_lock l(mu_);
+  auto it = queues_.find(key);
+  if (it != queues_.end()) {
+    it->second.last_use_micros = now_micros;
+    return it->second.queue;
+  }
+  for (auto entry = queues_.begin(); entry != queues_.end();) {
+    if (now_micros - entry->second.last_use_micros >=
+        static_cast<uint64>(options_.idle_queue_timeout_micros)) {
+      evicted.push_back(std::move(entry->second.queue));
+      entry = queues_.erase(entry);
+    } else {
+      ++entry;
+    }
+  }
+  if (static_cast<int>(queues_.size()) >= options_.max_batch_keys) {
+    return nullptr;
+  }
+  serving::SharedBatchScheduler<Task>::QueueOptions queue_options;
+  queue_options.input_batch_size_limit = options_.max_batch_size;
+  queue_options.max_execution_batch_size = options_.max_batch_size;
+  queue_options.batch_timeout_micros = options_.batch_timeout_micros;
+  queue_options.max_enqueued_batches = options_.max_enqueued_batches;
+  std::unique_ptr<Queue> queue;
+  const Status s = scheduler_->AddQueue(
+      queue_options, &EagerOpBatcher::ProcessBatch, &queue);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to create an eager op batching queue: " << s;
+    return nullptr;
+  }
+  QueueEntry& entry = queues_[key];
+  entry.queue = std::move(queue);
+  entry.last_use_micros = now_micros;
+  return entry.queue;
+}
+
+void EagerOpBatcher::ProcessBatch(
+    std::unique_ptr<serving::Batch<Task>> batch) {
+  // Ops with the same batch key may have different unbatched inputs, e.g. the
+  // weights of different models, or run in different steps, which need
+  // separate kernel calls. The tasks hold references to their inputs, so
+  // equal addresses mean equal tensors.
+  std::vector<std::vector<Task*>> groups;
+  for (int i = 0; i < batch->num_tasks(); ++i) {
+    Task* task = batch->mutable_task(i);
+    auto same_step_and_shared_inputs = [task](const std::vector<Task*>& group) {
+      const Task& other = *group[0];
+      if (task->step_container != other.step_container) {
+        return false;
+      }
+      const int num_inputs = task->inputs.size();
+      for (int j = task->num_batched_inputs; j < num_inputs; ++j) {
+        if (task->inputs[j].tensor_data().data() !=
+            other.inputs[j].tensor_data().data()) {
+          return false;
+        }
+      }
+      return true;
+    };
+    auto group = std::find_if(groups.begin(), groups.end(),
+                              same_step_and_shared_inputs);
+    if (group == groups.end()) {
+      groups.push_back({task});
+    } else {
+      group->push_back(task);
+    }
+  }
+  for (const std::vector<Task*>& tasks : groups) {
+    const Status status = RunBatch(tasks);
+    for (Task* task : tasks) {
+      *task->status = status;
+      task->done->Notify();
+    }
+  }
+}
+
+Status EagerOpBatcher::RunBatch(const std::vector<Task*>& tasks) {
+  const int num_tasks = tasks.size();
+  const Task& first = *tasks[0];
+  const int num_inputs = first.inputs.size();
+  std::vector<Tensor> batched_inputs(num_inputs);
+  for (int i = 0; i < num_inputs; ++i) {
+    if (num_tasks == 1 || i >= first.num_batched_inputs) {
+      batched_inputs[i] = first.inputs[i];
+      continue;
+    }
+    std::vector<Tensor> rows;
+    rows.reserve(num_tasks);
+    for (int t = 0; t < num_tasks; ++t) {
+      rows.push_back(tasks[t]->inputs[i]);
+    }
+    TF_RETURN_IF_ERROR(tensor::Concat(rows, &batched_inputs[i]));
+  }
+
+  gtl::InlinedVector<TensorValue, 4> values;
+  for (Tensor& input : batched_inputs) {
+    values.emplace_back(&input);
+  }
+  EagerKernelArgs args(std::move(values));
+  std::vector<EagerKernelRet> rets;
+  TF_RETURN_IF_ERROR(first.kernel->Run(first.step_container, args, &rets,
+                                       /*cancellation_manager=*/nullptr,
+                                       /*remote_func_params=*/absl::nullopt));
+
+  int64 num_rows = 0;
+  for (const Task* task : tasks) {
+    num_rows += task->num_rows;
+  }
+  for (EagerKernelRet& ret : rets) {
+    if (ret.index() != 0) {
+      return errors::Internal("Batched kernel ", first.kernel->name(),
+                              " returned a remote output");
+    }
+    const Tensor& output = absl::get<Tensor>(ret);
+    if (output.dims() == 0 || output.dim_size(0) != num_rows) {
+      return errors::Internal("Batched kernel ", first.kernel->name(),
+                              " returned an output of shape ",
+                              output.shape().DebugString(), " for ", num_rows,
+                              " rows");
+    }
+    // Slices share the buffer of the batched output. Kernels may require
+    // aligned inputs, so copy the slices that aren't.
+    int64 start = 0;
+    for (int t = 0; t < num_tasks; ++t) {
+      Task* task = tasks[t];
+      Tensor slice = output.Slice(start, start + task->num_rows);
+      if (!slice.IsAligned()) {
+        slice = tensor::DeepCopy(slice);
+      }
+      task->outputs->push_back(std::move(slice));
+      start += task->num_rows;
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,128 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_EAGER_OP_BATCHER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_EAGER_OP_BATCHER_H_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Coalesces identical ops that are executed at the same time, e.g. by the
+// async executors of many request threads, into a single kernel call.
+//
+// Two ops are batched together if they run the same op with the same
+// attributes on the same device and step container, their inputs have the
+// same types and shapes, and their unbatched inputs are the same tensors (e.g.
+// the weights of a MatMul). The batched inputs of the ops are concatenated
+// along their first dimension, and the outputs of the batched kernel call are
+// split along theirs. This is only valid for ops whose output rows are
+// computed from the same rows of the batched inputs, so batching is limited to
+// a list of such ops on CPU.
+//
+// Callers of Run() block until their batch has been processed, which adds up
+// to `batch_timeout_micros` of latency to every batchable op.
+class EagerOpBatcher {
+ public:
+  struct Options {
+    // Number of threads that run batched kernels.
+    int num_batch_threads = port::MaxParallelism();
+    // Maximum number of rows of a batch. Ops with more rows are not batched.
+    int max_batch_size = 64;
+    // Maximum time an op waits for other ops to join its batch.
+    int64 batch_timeout_micros = 100;
+    // Maximum number of batches waiting for a thread, per batch key. Ops that
+    // don't fit run without batching.
+    int max_enqueued_batches = 16;
+    // Maximum number of distinct batch keys. Ops with new keys beyond that
+    // run without batching.
+    int max_batch_keys = 1000;
+    // Batch keys that haven't been used for that long are dropped when a new
+    // batch key is added.
+    int64 idle_queue_timeout_micros = 60 * 1000 * 1000;
+  };
+
+  static Status Create(const Options& options,
+                       std::unique_ptr<EagerOpBatcher>* batcher);
+
+  // Returns true if `kernel` can be batched with these inputs.
+  bool IsBatchable(const KernelAndDevice& kernel,
+                   const EagerKernelArgs& inputs) const;
+
+  // Runs `kernel` on `inputs`, batched with concurrent calls for the same
+  // kernel, step container and compatible inputs. Requires
+  // IsBatchable(*kernel, inputs).
+  Status Run(ScopedStepContainer* step_container,
+             const core::RefCountPtr<KernelAndDevice>& kernel,
+             const EagerKernelArgs& inputs,
+             std::vector<EagerKernelRet>* outputs);
+
+ private:
+  struct Task : public serving::BatchTask {
+    size_t size() const override { return num_rows; }
+
+    core::RefCountPtr<KernelAndDevice> kernel;
+    ScopedStepContainer* step_container;
+    std::vector<Tensor> inputs;
+    int64 num_rows;
+    int num_batched_inputs;
+
+    // Results, owned by the caller of Run().
+    std::vector<Tensor>* outputs;
+    Status* status;
+    Notification* done;
+  };
+  using Queue = serving::BatchScheduler<Task>;
+
+  explicit EagerOpBatcher(const Options& options) : options_(options) {}
+
+  struct QueueEntry {
+    // Shared with the callers of Run() that are scheduling tasks, so that
+    // the queue outlives its eviction.
+    std::shared_ptr<Queue> queue;
+    uint64 last_use_micros;
+  };
+
+  // Returns the queue of the batch key of `task`, creating it if needed, or
+  // nullptr if there are too many batch keys.
+  std::shared_ptr<Queue> GetOrCreateQueue(const Task& task);
+
+  // Runs the tasks of a batch, with a single kernel call per step container
+  // and set of shared inputs.
+  static void ProcessBatch(std::unique_ptr<serving::Batch<Task>> batch);
+  static Status RunBatch(const std::vector<Task*>& tasks);
+
+  const Options options_;
+  std::shared_ptr<serving::SharedBatchScheduler<Task>> scheduler_;
+
+  mutex mu_;
+  std::unordered_map<string, QueueEntry> queues_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_EAGER_OP_BATCHER_H_
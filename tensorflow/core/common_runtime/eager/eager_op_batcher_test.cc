@@ -0,0 +1,236 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/eager/eager_op_batcher.h"
+
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/optional.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/eager/attr_builder.h"
+#include "tensorflow/core/common_runtime/process_function_library_runtime.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+class EagerOpBatcherTest : public ::testing::Test {
+ protected:
+  EagerOpBatcherTest() : flib_def_(OpRegistry::Global(), {}) {
+    std::vector<std::unique_ptr<Device>> devices;
+    devices.push_back(
+        DeviceFactory::NewDevice("CPU", {}, "/job:a/replica:0/task:0"));
+    device_mgr_ = absl::make_unique<StaticDeviceMgr>(std::move(devices));
+    pflr_ = absl::make_unique<ProcessFunctionLibraryRuntime>(
+        device_mgr_.get(), Env::Default(), /*config=*/nullptr,
+        TF_GRAPH_DEF_VERSION, &flib_def_, OptimizerOptions(),
+        /*default_thread_pool=*/nullptr);
+  }
+
+  core::RefCountPtr<KernelAndDevice> CreateKernel(const NodeDef& ndef) {
+    FunctionLibraryRuntime* flr =
+        pflr_->GetFLR("/job:a/replica:0/task:0/device:CPU:0");
+    core::RefCountPtr<KernelAndDevice> kernel(new KernelAndDeviceOp(
+        nullptr, false, flr, nullptr, nullptr, device_mgr_->HostCPU()));
+    TF_CHECK_OK(kernel->Init({}, ndef, nullptr));
+    return kernel;
+  }
+
+  core::RefCountPtr<KernelAndDevice> CreateMatMul(bool transpose_a) {
+    return CreateKernel(AttrBuilder("MatMul")
+                            .Set("T", DT_FLOAT)
+                            .Set("transpose_a", transpose_a)
+                            .Set("transpose_b", false)
+                            .NumInputs(2)
+                            .BuildNodeDef());
+  }
+
+  std::unique_ptr<EagerOpBatcher> CreateBatcher(
+      int max_batch_size, int max_batch_keys = 1000,
+      int64 idle_queue_timeout_micros = 60 * 1000 * 1000) {
+    EagerOpBatcher::Options options;
+    options.num_batch_threads = 2;
+    options.max_batch_size = max_batch_size;
+    options.batch_timeout_micros = 10 * 1000;
+    options.max_batch_keys = max_batch_keys;
+    options.idle_queue_timeout_micros = idle_queue_timeout_micros;
+    std::unique_ptr<EagerOpBatcher> batcher;
+    TF_CHECK_OK(EagerOpBatcher::Create(options, &batcher));
+    return batcher;
+  }
+
+  FunctionLibraryDefinition flib_def_;
+  std::unique_ptr<DeviceMgr> device_mgr_;
+  std::unique_ptr<ProcessFunctionLibraryRuntime> pflr_;
+};
+
+EagerKernelArgs MakeArgs(std::vector<Tensor>* tensors) {
+  gtl::InlinedVector<TensorValue, 4> values;
+  for (Tensor& tensor : *tensors) {
+    values.emplace_back(&tensor);
+  }
+  return EagerKernelArgs(std::move(values));
+}
+
+TEST_F(EagerOpBatcherTest, IsBatchable) {
+  std::unique_ptr<EagerOpBatcher> batcher = CreateBatcher(4);
+  std::vector<Tensor> inputs = {test::AsTensor<float>({1, 2}, {1, 2}),
+                                test::AsTensor<float>({1, 0, 0, 1}, {2, 2})};
+  EXPECT_TRUE(batcher->IsBatchable(*CreateMatMul(false), MakeArgs(&inputs)));
+  EXPECT_FALSE(batcher->IsBatchable(*CreateMatMul(true), MakeArgs(&inputs)));
+
+  // Too many rows.
+  std::vector<Tensor> large_inputs = {
+      Tensor(DT_FLOAT, TensorShape({5, 2})),
+      test::AsTensor<float>({1, 0, 0, 1}, {2, 2})};
+  EXPECT_FALSE(
+      batcher->IsBatchable(*CreateMatMul(false), MakeArgs(&large_inputs)));
+
+  // The first dimension of a vector is not independent across rows.
+  core::RefCountPtr<KernelAndDevice> softmax =
+      CreateKernel(AttrBuilder("Softmax")
+                       .Set("T", DT_FLOAT)
+                       .NumInputs(1)
+                       .BuildNodeDef());
+  std::vector<Tensor> vector = {test::AsTensor<float>({1, 2})};
+  EXPECT_FALSE(batcher->IsBatchable(*softmax, MakeArgs(&vector)));
+  std::vector<Tensor> matrix = {test::AsTensor<float>({1, 2}, {1, 2})};
+  EXPECT_TRUE(batcher->IsBatchable(*softmax, MakeArgs(&matrix)));
+
+  // Both inputs of element-wise binary ops are batched.
+  core::RefCountPtr<KernelAndDevice> add = CreateKernel(
+      AttrBuilder("AddV2").Set("T", DT_FLOAT).NumInputs(2).BuildNodeDef());
+  std::vector<Tensor> same_rows = {test::AsTensor<float>({1, 2}, {2, 1}),
+                                   test::AsTensor<float>({1, 2}, {2, 1})};
+  EXPECT_TRUE(batcher->IsBatchable(*add, MakeArgs(&same_rows)));
+  std::vector<Tensor> broadcast_rows = {test::AsTensor<float>({1, 2}, {2, 1}),
+                                        test::AsTensor<float>({1}, {1, 1})};
+  EXPECT_FALSE(batcher->IsBatchable(*add, MakeArgs(&broadcast_rows)));
+}
+
+TEST_F(EagerOpBatcherTest, ConcurrentMatMuls) {
+  const int kNumThreads = 8;
+  std::unique_ptr<EagerOpBatcher> batcher = CreateBatcher(kNumThreads);
+  // Kernels for the same op signature share a batch key. Half of the ops
+  // share their weights, the others need their own kernel calls.
+  std::vector<core::RefCountPtr<KernelAndDevice>> kernels;
+  for (int i = 0; i < kNumThreads; ++i) {
+    kernels.push_back(CreateMatMul(false));
+  }
+  const Tensor shared_weights = test::AsTensor<float>({1, 2, 3, 4}, {2, 2});
+
+  std::vector<Status> statuses(kNumThreads);
+  std::vector<std::vector<EagerKernelRet>> outputs(kNumThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+    BlockingCounter counter(kNumThreads);
+    for (int i = 0; i < kNumThreads; ++i) {
+      pool.Schedule([&, i]() {
+        std::vector<Tensor> inputs = {
+            test::AsTensor<float>({1.0f * i, 1}, {1, 2}),
+            i % 2 == 0 ? shared_weights
+                       : test::AsTensor<float>({1, 2, 3, 4}, {2, 2})};
+        EagerKernelArgs args = MakeArgs(&inputs);
+        EXPECT_TRUE(batcher->IsBatchable(*kernels[i], args));
+        statuses[i] = batcher->Run(/*step_container=*/nullptr, kernels[i],
+                                   args, &outputs[i]);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+
+  for (int i = 0; i < kNumThreads; ++i) {
+    TF_ASSERT_OK(statuses[i]);
+    ASSERT_EQ(outputs[i].size(), 1);
+    test::ExpectTensorEqual<float>(
+        absl::get<Tensor>(outputs[i][0]),
+        test::AsTensor<float>({1.0f * i + 3, 2.0f * i + 4}, {1, 2}));
+  }
+}
+
+TEST_F(EagerOpBatcherTest, ConcurrentMatMulsInDifferentSteps) {
+  const int kNumThreads = 8;
+  std::unique_ptr<EagerOpBatcher> batcher = CreateBatcher(kNumThreads);
+  core::RefCountPtr<KernelAndDevice> kernel = CreateMatMul(false);
+  const Tensor weights = test::AsTensor<float>({1, 2, 3, 4}, {2, 2});
+  // Ops in different steps share a batch key, but run in separate kernel
+  // calls with their own step container.
+  ScopedStepContainer step_0(0, [](const string&) {});
+  ScopedStepContainer step_1(1, [](const string&) {});
+
+  std::vector<Status> statuses(kNumThreads);
+  std::vector<std::vector<EagerKernelRet>> outputs(kNumThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+    BlockingCounter counter(kNumThreads);
+    for (int i = 0; i < kNumThreads; ++i) {
+      pool.Schedule([&, i]() {
+        std::vector<Tensor> inputs = {
+            test::AsTensor<float>({1.0f * i, 1}, {1, 2}), weights};
+        EagerKernelArgs args = MakeArgs(&inputs);
+        EXPECT_TRUE(batcher->IsBatchable(*kernel, args));
+        statuses[i] = batcher->Run(i % 2 == 0 ? &step_0 : &step_1, kernel,
+                                   args, &outputs[i]);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+
+  for (int i = 0; i < kNumThreads; ++i) {
+    TF_ASSERT_OK(statuses[i]);
+    ASSERT_EQ(outputs[i].size(), 1);
+    test::ExpectTensorEqual<float>(
+        absl::get<Tensor>(outputs[i][0]),
+        test::AsTensor<float>({1.0f * i + 3, 2.0f * i + 4}, {1, 2}));
+  }
+}
+
+TEST_F(EagerOpBatcherTest, EvictsIdleBatchKeys) {
+  // A single batch key, dropped as soon as another one is needed.
+  std::unique_ptr<EagerOpBatcher> batcher =
+      CreateBatcher(/*max_batch_size=*/4, /*max_batch_keys=*/1,
+                    /*idle_queue_timeout_micros=*/0);
+  core::RefCountPtr<KernelAndDevice> kernel = CreateMatMul(false);
+  for (int num_columns = 1; num_columns <= 3; ++num_columns) {
+    std::vector<Tensor> inputs = {
+        test::AsTensor<float>({1, 2}, {1, 2}),
+        Tensor(DT_FLOAT, TensorShape({2, num_columns}))};
+    inputs[1].flat<float>().setConstant(1);
+    EagerKernelArgs args = MakeArgs(&inputs);
+    ASSERT_TRUE(batcher->IsBatchable(*kernel, args));
+    std::vector<EagerKernelRet> outputs;
+    TF_ASSERT_OK(batcher->Run(/*step_container=*/nullptr, kernel, args,
+                              &outputs));
+    ASSERT_EQ(outputs.size(), 1);
+    Tensor expected(DT_FLOAT, TensorShape({1, num_columns}));
+    expected.flat<float>().setConstant(3);
+    test::ExpectTensorEqual<float>(absl::get<Tensor>(outputs[0]), expected);
+  }
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/eager/execute.h"
 
 #include <cstddef>
+#include <limits>
 #include <vector>
 
 // clang-format off
@@ -1119,8 +1120,21 @@ Status EagerKernelExecute(
   // device. We don't call it now because it is an unneeded overhead (it
   // acquires a lock) and we can't recover from errors anyway.
   ScopedStepContainer* container = ctx->StepContainer();
+#if !defined(IS_MOBILE_PLATFORM)
+  // Batched kernels can't be cancelled on behalf of a single op.
+  EagerOpBatcher* batcher = ctx->GetOpBatcher();
+  if (batcher != nullptr && cancellation_manager == nullptr &&
+      !remote_func_params.has_value() && !inputs.HasRemoteOrPackedInputs() &&
+      batcher->IsBatchable(*kernel, inputs)) {
+    TF_RETURN_IF_ERROR(batcher->Run(container, kernel, inputs, &outputs));
+  } else {
+    TF_RETURN_IF_ERROR(kernel->Run(container, inputs, &outputs,
+                                   cancellation_manager, remote_func_params));
+  }
+#else   // IS_MOBILE_PLATFORM
   TF_RETURN_IF_ERROR(kernel->Run(container, inputs, &outputs,
                                  cancellation_manager, remote_func_params));
+#endif  // IS_MOBILE_PLATFORM
   if (graph_collector != nullptr) {
     CollectGraphs(ctx);
   }
@@ -1136,6 +1150,103 @@ Status EagerKernelExecute(
                           kernel.get(), remote_func_params);
 }
 
+Status EagerCompileOp(EagerOperation* op,
+                      core::RefCountPtr<KernelAndDevice>* kernel) {
+  profiler::TraceMe activity(
+      [&] { return absl::StrCat("EagerCompileOp: ", op->Name()); },
+      profiler::TraceMeLevel::kInfo);
+
+  std::unique_ptr<tensorflow::EagerOperation> out_op;
+  TF_RETURN_IF_ERROR(EagerOpRewriteRegistry::Global()->RunRewrite(
+      EagerOpRewriteRegistry::PRE_EXECUTION, op, &out_op));
+  if (out_op) {
+    op = out_op.get();
+  }
+  if (!op->IsLocal()) {
+    return errors::Unimplemented("Unable to compile ", op->Name(),
+                                 ": compiled ops must run on a local device, "
+                                 "but the op is placed on ",
+                                 op->DeviceName());
+  }
+
+  // The kernel is resolved exactly like EagerLocalExecute does, so a compiled
+  // op shares its KernelAndDevice with the kernel cache.
+  int num_retvals = std::numeric_limits<int>::max();
+  core::RefCountPtr<KernelAndDevice> compiled;
+  TF_RETURN_IF_ERROR(GetOrCreateKernelAndDevice(op, /*retvals=*/nullptr,
+                                                &num_retvals, &compiled));
+  if (compiled->IsCrossProcess()) {
+    return errors::Unimplemented("Unable to compile ", op->Name(),
+                                 ": cross-process functions are not supported");
+  }
+  *kernel = std::move(compiled);
+  return Status::OK();
+}
+
+Status EagerExecuteCompiledOp(EagerContext* ctx,
+                              const core::RefCountPtr<KernelAndDevice>& kernel,
+                              absl::Span<TensorHandle* const> inputs,
+                              absl::Span<TensorHandle*> retvals) {
+  profiler::TraceMe activity("EagerExecuteCompiledOp",
+                             profiler::TraceMeLevel::kInfo);
+  const int num_inputs = inputs.size();
+  if (TF_PREDICT_FALSE(kernel->num_inputs() != num_inputs)) {
+    return errors::InvalidArgument("Compiled op ", kernel->name(), " expects ",
+                                   kernel->num_inputs(), " inputs, got ",
+                                   num_inputs);
+  }
+  const int num_retvals = retvals.size();
+  if (TF_PREDICT_FALSE(kernel->num_outputs() != num_retvals)) {
+    return errors::InvalidArgument("Compiled op ", kernel->name(), " has ",
+                                   kernel->num_outputs(), " outputs, got ",
+                                   num_retvals, " retvals");
+  }
+  // Unlike ValidateInputTypeAndPlacement, never copy inputs: a copy would
+  // dominate the cost of the small ops this path is meant for.
+  const DataTypeVector& input_dtypes = kernel->input_dtypes();
+  for (int i = 0; i < num_inputs; ++i) {
+    TensorHandle* handle = inputs[i];
+    if (TF_PREDICT_FALSE(handle->dtype != input_dtypes[i])) {
+      return errors::InvalidArgument(
+          "cannot compute ", kernel->name(), " as input #", i, "(zero-based)",
+          " was expected to be a ", DataTypeString(input_dtypes[i]),
+          " tensor but is a ", DataTypeString(handle->dtype), " tensor");
+    }
+    const VariantDevice handle_device = handle->DeviceOrHostCPU(*ctx);
+    Device* expected_device = kernel->InputDevice(i);
+    if (TF_PREDICT_FALSE(VariantDeviceIsCustom(handle_device) ||
+                         absl::get<Device*>(handle_device) !=
+                             expected_device)) {
+      return errors::InvalidArgument(
+          "cannot compute ", kernel->name(), " as input #", i, "(zero-based)",
+          " was expected to be on ", DeviceNameOrUnspecified(expected_device),
+          " but is on ", VariantDeviceName(handle_device),
+          ". Inputs of compiled ops are not copied across devices.");
+    }
+  }
+
+  GraphCollector* graph_collector = nullptr;
+  if (ctx->ShouldStoreGraphs()) {
+    graph_collector = ctx->GetGraphCollector();
+  }
+  for (TensorHandle*& retval : retvals) {
+    retval = nullptr;
+  }
+  Status s = EagerKernelExecute(
+      ctx, absl::InlinedVector<TensorHandle*, 4>(inputs.begin(), inputs.end()),
+      /*remote_func_params=*/absl::nullopt, kernel, graph_collector,
+      /*cancellation_manager=*/nullptr, retvals);
+  if (!s.ok()) {
+    for (TensorHandle*& retval : retvals) {
+      if (retval != nullptr) {
+        retval->Unref();
+        retval = nullptr;
+      }
+    }
+  }
+  return s;
+}
+
 namespace {
 
 Status LocalEagerCopyToDevice(TensorHandle* h, EagerContext* ctx,
@@ -54,6 +54,29 @@ Status EagerKernelExecute(
     GraphCollector* graph_collector, CancellationManager* cancellation_manager,
     absl::Span<TensorHandle*> retvals);
 
+// Resolves `op`, together with its attributes and requested device, into a
+// kernel that can be run any number of times with EagerExecuteCompiledOp.
+// `op` must have its inputs added, since they determine attribute values and,
+// for functions, input devices; later executions must use inputs of the same
+// types on the same devices. Only ops that run on the local task are
+// supported.
+Status EagerCompileOp(EagerOperation* op,
+                      core::RefCountPtr<KernelAndDevice>* kernel);
+
+// Fast path to execute a kernel returned by EagerCompileOp. Unlike
+// EagerExecute, this skips attribute building, kernel cache lookup and device
+// placement, and runs the kernel synchronously on the calling thread without
+// going through the eager executor. Inputs produced by pending asynchronous
+// ops are waited on. It is an error if an input doesn't have the expected type
+// or isn't already on kernel->InputDevice(i): inputs are never copied.
+//
+// `retvals` must have exactly kernel->num_outputs() elements. On success, each
+// element is set to a new reference owned by the caller.
+Status EagerExecuteCompiledOp(EagerContext* ctx,
+                              const core::RefCountPtr<KernelAndDevice>& kernel,
+                              absl::Span<TensorHandle* const> inputs,
+                              absl::Span<TensorHandle*> retvals);
+
 // Low-level utility to copy a tensor handle from one device to another. If
 // successful, result TensorHandle will be populated. If the caller requests for
 // the mirror flag, EagerCopyToDevice will attempt to add a mirror to the
@@ -0,0 +1,181 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/eager/execute.h"
+
+#include <memory>
+
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/eager/context.h"
+#include "tensorflow/core/common_runtime/eager/eager_operation.h"
+#include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
+#include "tensorflow/core/common_runtime/eager/tensor_handle.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+EagerContext* CreateTestContext(DeviceMgr* device_mgr) {
+  return new EagerContext(
+      SessionOptions(),
+      tensorflow::ContextDevicePlacementPolicy::DEVICE_PLACEMENT_SILENT, false,
+      false, device_mgr, false, nullptr, nullptr, nullptr);
+}
+
+TensorHandle* CreateScalar(EagerContext* ctx, float value) {
+  Tensor t(DT_FLOAT, TensorShape({}));
+  t.scalar<float>()() = value;
+  return TensorHandle::CreateLocalHandle(std::move(t), ctx->HostCPU(),
+                                         /*op_device=*/nullptr, ctx);
+}
+
+Status CompileAdd(EagerContext* ctx, TensorHandle* x, TensorHandle* y,
+                  core::RefCountPtr<KernelAndDevice>* kernel) {
+  EagerOperation op(ctx);
+  TF_RETURN_IF_ERROR(op.Reset("AddV2", /*device_name=*/nullptr,
+                              /*remote=*/false, /*executor=*/nullptr));
+  TF_RETURN_IF_ERROR(op.AddInput(x));
+  TF_RETURN_IF_ERROR(op.AddInput(y));
+  return EagerCompileOp(&op, kernel);
+}
+
+class ExecuteTest : public ::testing::Test {
+ protected:
+  ExecuteTest()
+      : device_mgr_(DeviceFactory::NewDevice(
+            "CPU", {}, "/job:localhost/replica:0/task:0/device:CPU:0")),
+        ctx_(CreateTestContext(&device_mgr_)) {}
+
+  ~ExecuteTest() override { ctx_->Unref(); }
+
+  StaticDeviceMgr device_mgr_;
+  EagerContext* ctx_;
+};
+
+TEST_F(ExecuteTest, CompiledOpRunsWithNewInputs) {
+  TensorHandle* x = CreateScalar(ctx_, 1.0f);
+  TensorHandle* y = CreateScalar(ctx_, 2.0f);
+  core::RefCountPtr<KernelAndDevice> kernel;
+  TF_ASSERT_OK(CompileAdd(ctx_, x, y, &kernel));
+  EXPECT_EQ(kernel->num_inputs(), 2);
+  EXPECT_EQ(kernel->num_outputs(), 1);
+
+  for (int i = 0; i < 3; ++i) {
+    TensorHandle* z = CreateScalar(ctx_, 10.0f * i);
+    TensorHandle* retval = nullptr;
+    TF_ASSERT_OK(EagerExecuteCompiledOp(ctx_, kernel, {x, z},
+                                        absl::MakeSpan(&retval, 1)));
+    ASSERT_NE(retval, nullptr);
+    const Tensor* t = nullptr;
+    TF_ASSERT_OK(retval->Tensor(&t));
+    test::ExpectTensorEqual<float>(*t, test::AsScalar<float>(1.0f + 10.0f * i));
+    retval->Unref();
+    z->Unref();
+  }
+
+  x->Unref();
+  y->Unref();
+}
+
+TEST_F(ExecuteTest, CompiledOpSharesKernelCache) {
+  TensorHandle* x = CreateScalar(ctx_, 1.0f);
+  core::RefCountPtr<KernelAndDevice> kernel1;
+  core::RefCountPtr<KernelAndDevice> kernel2;
+  TF_ASSERT_OK(CompileAdd(ctx_, x, x, &kernel1));
+  TF_ASSERT_OK(CompileAdd(ctx_, x, x, &kernel2));
+  EXPECT_EQ(kernel1.get(), kernel2.get());
+  x->Unref();
+}
+
+TEST_F(ExecuteTest, CompiledOpRejectsMismatchedInputs) {
+  TensorHandle* x = CreateScalar(ctx_, 1.0f);
+  core::RefCountPtr<KernelAndDevice> kernel;
+  TF_ASSERT_OK(CompileAdd(ctx_, x, x, &kernel));
+
+  TensorHandle* retval = nullptr;
+  Status s =
+      EagerExecuteCompiledOp(ctx_, kernel, {x}, absl::MakeSpan(&retval, 1));
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+  EXPECT_EQ(retval, nullptr);
+
+  Tensor int_tensor(DT_INT32, TensorShape({}));
+  int_tensor.scalar<int32>()() = 1;
+  TensorHandle* i = TensorHandle::CreateLocalHandle(
+      std::move(int_tensor), ctx_->HostCPU(), /*op_device=*/nullptr, ctx_);
+  s = EagerExecuteCompiledOp(ctx_, kernel, {x, i}, absl::MakeSpan(&retval, 1));
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+  EXPECT_EQ(retval, nullptr);
+
+  s = EagerExecuteCompiledOp(ctx_, kernel, {x, x}, {});
+  EXPECT_EQ(s.code(), error::INVALID_ARGUMENT);
+
+  i->Unref();
+  x->Unref();
+}
+
+// Executes AddV2 through the regular EagerExecute path, which builds the
+// attributes, fingerprints them and looks up the kernel cache on every call.
+void BM_EagerExecute(int iters) {
+  testing::StopTiming();
+  StaticDeviceMgr device_mgr(DeviceFactory::NewDevice(
+      "CPU", {}, "/job:localhost/replica:0/task:0/device:CPU:0"));
+  EagerContext* ctx = CreateTestContext(&device_mgr);
+  TensorHandle* x = CreateScalar(ctx, 1.0f);
+  EagerOperation op(ctx);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(op.Reset("AddV2", /*device_name=*/nullptr, /*remote=*/false,
+                         /*executor=*/nullptr));
+    TF_CHECK_OK(op.AddInput(x));
+    TF_CHECK_OK(op.AddInput(x));
+    TensorHandle* retval = nullptr;
+    int num_retvals = 1;
+    TF_CHECK_OK(EagerExecute(&op, &retval, &num_retvals));
+    retval->Unref();
+  }
+  testing::StopTiming();
+  x->Unref();
+  ctx->Unref();
+}
+BENCHMARK(BM_EagerExecute);
+
+void BM_EagerExecuteCompiledOp(int iters) {
+  testing::StopTiming();
+  StaticDeviceMgr device_mgr(DeviceFactory::NewDevice(
+      "CPU", {}, "/job:localhost/replica:0/task:0/device:CPU:0"));
+  EagerContext* ctx = CreateTestContext(&device_mgr);
+  TensorHandle* x = CreateScalar(ctx, 1.0f);
+  core::RefCountPtr<KernelAndDevice> kernel;
+  TF_CHECK_OK(CompileAdd(ctx, x, x, &kernel));
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TensorHandle* retval = nullptr;
+    TF_CHECK_OK(EagerExecuteCompiledOp(ctx, kernel, {x, x},
+                                       absl::MakeSpan(&retval, 1)));
+    retval->Unref();
+  }
+  testing::StopTiming();
+  kernel.reset();
+  x->Unref();
+  ctx->Unref();
+}
+BENCHMARK(BM_EagerExecuteCompiledOp);
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,111 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/eager/kernel_cache.h"
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+constexpr int KernelCache::kNumShards;
+
+KernelCache::KernelCache(int64 capacity)
+    : capacity_(capacity > 0 ? capacity : 0),
+      shard_capacity_(capacity > 0 ? (capacity + kNumShards - 1) / kNumShards
+                                   : 0) {}
+
+core::RefCountPtr<KernelAndDevice> KernelCache::Lookup(
+    const Fprint128& key) const {
+  Shard& shard = GetShard(key);
+  tf_shared_lock l(shard.mu);
+  auto iter = shard.entries.find(key);
+  if (iter == shard.entries.end()) {
+    return nullptr;
+  }
+  Entry& entry = iter->second;
+  // Avoid writing to the cache line of hot entries when the flag is already
+  // set.
+  if (!entry.referenced.load(std::memory_order_relaxed)) {
+    entry.referenced.store(true, std::memory_order_relaxed);
+  }
+  core::RefCountPtr<KernelAndDevice> new_ref(entry.kernel.get());
+  new_ref->Ref();
+  return new_ref;
+}
+
+void KernelCache::Insert(const Fprint128& key, KernelAndDevice* kernel,
+                         std::vector<EvictedKernel>* evicted) {
+  core::RefCountPtr<KernelAndDevice> new_ref(kernel);
+  new_ref->Ref();
+  Shard& shard = GetShard(key);
+  mutex_lock l(shard.mu);
+  if (shard.entries.find(key) == shard.entries.end()) {
+    MaybeEvict(&shard, evicted);
+  }
+  // New entries get a second chance only once they are looked up.
+  Entry& entry = shard.entries[key];
+  entry.kernel = std::move(new_ref);
+}
+
+void KernelCache::MaybeEvict(Shard* shard,
+                             std::vector<EvictedKernel>* evicted) {
+  if (shard_capacity_ == 0 ||
+      static_cast<int64>(shard->entries.size()) < shard_capacity_) {
+    return;
+  }
+  const int64 target = shard_capacity_ - 1 - shard_capacity_ / 8;
+  // The first pass clears every flag, so the second one always reaches the
+  // target.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (auto iter = shard->entries.begin(); iter != shard->entries.end();) {
+      if (static_cast<int64>(shard->entries.size()) <= target) return;
+      if (iter->second.referenced.load(std::memory_order_relaxed)) {
+        iter->second.referenced.store(false, std::memory_order_relaxed);
+        ++iter;
+      } else {
+        DVLOG(2) << "Evicting kernel " << iter->second.kernel->name()
+                 << " from the kernel cache";
+        if (evicted != nullptr) {
+          evicted->push_back({iter->first, iter->second.kernel->name()});
+        }
+        shard->entries.erase(iter++);
+      }
+    }
+  }
+}
+
+void KernelCache::Erase(const Fprint128& key) {
+  Shard& shard = GetShard(key);
+  mutex_lock l(shard.mu);
+  shard.entries.erase(key);
+}
+
+void KernelCache::Clear() {
+  for (Shard& shard : shards_) {
+    mutex_lock l(shard.mu);
+    shard.entries.clear();
+  }
+}
+
+int64 KernelCache::size() const {
+  int64 size = 0;
+  for (const Shard& shard : shards_) {
+    tf_shared_lock l(shard.mu);
+    size += shard.entries.size();
+  }
+  return size;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,111 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_KERNEL_CACHE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_KERNEL_CACHE_H_
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A thread-safe cache of kernels keyed by the fingerprint of the op, its
+// attributes and its device.
+//
+// Lookups vastly outnumber insertions, so the cache is split into shards that
+// are each guarded by a reader-writer lock: concurrent lookups only share a
+// lock with the lookups that hit the same shard, and never exclude each other.
+//
+// If the cache has a capacity, kernels are evicted with the CLOCK
+// (second-chance) policy, which only needs a lookup to set a flag on the
+// entry. Evicted kernels stay alive until their last user releases them.
+class KernelCache {
+ public:
+  // A `capacity` <= 0 means the cache is unbounded. The capacity is split
+  // evenly between shards and rounded up.
+  explicit KernelCache(int64 capacity);
+
+  KernelCache(const KernelCache&) = delete;
+  KernelCache& operator=(const KernelCache&) = delete;
+
+  // A kernel evicted to make room for another one.
+  struct EvictedKernel {
+    Fprint128 key;
+    string kernel_name;
+  };
+
+  // Returns a new reference to the kernel cached for `key`, or nullptr.
+  core::RefCountPtr<KernelAndDevice> Lookup(const Fprint128& key) const;
+
+  // Caches `kernel` for `key`, replacing any kernel previously cached for it.
+  // The cache takes its own reference to `kernel`. If `evicted` is not null,
+  // the kernels evicted to make room for `kernel` are appended to it.
+  void Insert(const Fprint128& key, KernelAndDevice* kernel,
+              std::vector<EvictedKernel>* evicted = nullptr);
+
+  // Removes the kernel cached for `key`, if any.
+  void Erase(const Fprint128& key);
+
+  // Removes all cached kernels.
+  void Clear();
+
+  // Number of cached kernels.
+  int64 size() const;
+
+  int64 capacity() const { return capacity_; }
+
+ private:
+  static constexpr int kNumShards = 16;
+
+  struct Entry {
+    core::RefCountPtr<KernelAndDevice> kernel;
+    // Set by lookups, cleared by eviction sweeps.
+    std::atomic<bool> referenced{false};
+  };
+
+  struct Shard {
+    mutable mutex mu;
+    std::unordered_map<Fprint128, Entry, Fprint128Hasher> entries
+        TF_GUARDED_BY(mu);
+  };
+
+  Shard& GetShard(const Fprint128& key) const {
+    // Fprint128Hasher uses the low bits to hash within a shard.
+    return shards_[key.high64 % kNumShards];
+  }
+
+  // If the shard is full, evicts unreferenced entries until it is well below
+  // its capacity, so that the cost of a sweep is amortized over many
+  // insertions. Appends the evicted entries to `evicted` if it is not null.
+  void MaybeEvict(Shard* shard, std::vector<EvictedKernel>* evicted)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(shard->mu);
+
+  const int64 capacity_;
+  // Maximum number of entries of a shard, or 0 if unbounded.
+  const int64 shard_capacity_;
+  mutable Shard shards_[kNumShards];
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_EAGER_KERNEL_CACHE_H_
@@ -0,0 +1,138 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/eager/kernel_cache.h"
+
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/strip.h"
+#include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+KernelAndDevice* CreateKernel(const string& name) {
+  return new KernelAndDeviceFunc(
+      /*flr=*/nullptr, /*pflr=*/nullptr, /*input_devices=*/{},
+      /*composite_devices=*/{}, /*input_resource_dtypes_and_shapes=*/{},
+      /*runner=*/nullptr, /*collective_executor=*/nullptr,
+      /*host_cpu_device=*/nullptr, name,
+      /*rendezvous_creator=*/nullptr, /*get_op_id=*/nullptr);
+}
+
+Fprint128 Key(int i) { return Fingerprint128(strings::StrCat("key", i)); }
+
+TEST(KernelCacheTest, LookupAndErase) {
+  KernelCache cache(/*capacity=*/0);
+  core::RefCountPtr<KernelAndDevice> kernel(CreateKernel("a"));
+  EXPECT_EQ(cache.Lookup(Key(0)), nullptr);
+
+  cache.Insert(Key(0), kernel.get());
+  EXPECT_FALSE(kernel->RefCountIsOne());
+  EXPECT_EQ(cache.Lookup(Key(0)).get(), kernel.get());
+  EXPECT_EQ(cache.Lookup(Key(1)), nullptr);
+  EXPECT_EQ(cache.size(), 1);
+
+  cache.Erase(Key(0));
+  EXPECT_EQ(cache.Lookup(Key(0)), nullptr);
+  EXPECT_TRUE(kernel->RefCountIsOne());
+}
+
+TEST(KernelCacheTest, InsertReplaces) {
+  KernelCache cache(/*capacity=*/0);
+  core::RefCountPtr<KernelAndDevice> kernel_a(CreateKernel("a"));
+  core::RefCountPtr<KernelAndDevice> kernel_b(CreateKernel("b"));
+  cache.Insert(Key(0), kernel_a.get());
+  cache.Insert(Key(0), kernel_b.get());
+  EXPECT_EQ(cache.Lookup(Key(0)).get(), kernel_b.get());
+  EXPECT_TRUE(kernel_a->RefCountIsOne());
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(KernelCacheTest, Unbounded) {
+  KernelCache cache(/*capacity=*/0);
+  core::RefCountPtr<KernelAndDevice> kernel(CreateKernel("a"));
+  for (int i = 0; i < 1000; ++i) {
+    cache.Insert(Key(i), kernel.get());
+  }
+  EXPECT_EQ(cache.size(), 1000);
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_TRUE(kernel->RefCountIsOne());
+}
+
+TEST(KernelCacheTest, EvictsUnusedKernels) {
+  const int kCapacity = 160;
+  KernelCache cache(kCapacity);
+  core::RefCountPtr<KernelAndDevice> kernel(CreateKernel("a"));
+  // Keep looking up the first kernels while inserting many others: the CLOCK
+  // policy gives them a second chance in every sweep.
+  const int kNumHot = 4;
+  for (int i = 0; i < 100 * kCapacity; ++i) {
+    cache.Insert(Key(i), kernel.get());
+    for (int j = 0; j < kNumHot; ++j) {
+      if (i >= j) {
+        EXPECT_NE(cache.Lookup(Key(j)), nullptr) << "i=" << i << ", j=" << j;
+      }
+    }
+    EXPECT_LE(cache.size(), kCapacity);
+  }
+  EXPECT_GT(cache.size(), kCapacity / 2);
+  EXPECT_EQ(cache.Lookup(Key(kNumHot)), nullptr);
+}
+
+TEST(KernelCacheTest, EvictedKernelsOutliveCache) {
+  KernelCache cache(/*capacity=*/1);
+  core::RefCountPtr<KernelAndDevice> kernel(CreateKernel("a"));
+  cache.Insert(Key(0), kernel.get());
+  core::RefCountPtr<KernelAndDevice> cached = cache.Lookup(Key(0));
+  core::RefCountPtr<KernelAndDevice> other_kernel(CreateKernel("b"));
+  for (int i = 1; i < 100; ++i) {
+    cache.Insert(Key(i), other_kernel.get());
+  }
+  cache.Clear();
+  ASSERT_NE(cached, nullptr);
+  EXPECT_EQ(cached->name(), "a");
+}
+
+TEST(KernelCacheTest, ReportsEvictedKernels) {
+  const int kCapacity = 160;
+  KernelCache cache(kCapacity);
+  std::vector<core::RefCountPtr<KernelAndDevice>> kernels;
+  std::vector<KernelCache::EvictedKernel> evicted;
+  for (int i = 0; i < 10 * kCapacity; ++i) {
+    kernels.emplace_back(CreateKernel(strings::StrCat("kernel", i)));
+    cache.Insert(Key(i), kernels.back().get(), &evicted);
+  }
+  // Every kernel is either still cached or reported as evicted, once.
+  EXPECT_EQ(cache.size() + static_cast<int64>(evicted.size()),
+            10 * kCapacity);
+  std::vector<bool> is_evicted(10 * kCapacity, false);
+  for (const KernelCache::EvictedKernel& evicted_kernel : evicted) {
+    EXPECT_EQ(cache.Lookup(evicted_kernel.key), nullptr);
+    int i;
+    ASSERT_TRUE(absl::SimpleAtoi(
+        absl::StripPrefix(evicted_kernel.kernel_name, "kernel"), &i));
+    EXPECT_TRUE(evicted_kernel.key == Key(i));
+    EXPECT_FALSE(is_evicted[i]);
+    is_evicted[i] = true;
+  }
+}
+
+}  // namespace
+}  // namespace tensorflow
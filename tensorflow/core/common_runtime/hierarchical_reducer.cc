@@ -0,0 +1,367 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/hierarchical_reducer.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/collective_util.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace tensorflow {
+
+namespace {
+// Key to be used for BufRendezvous by HierarchicalReducer.
+string HierarchicalReduceBufKey(const string& exec_key, const string& phase,
+                                int subdiv, int src_rank, int dst_rank) {
+  return strings::StrCat(exec_key, ":", phase, ":", subdiv, ":", src_rank, ":",
+                         dst_rank);
+}
+
+// Calls `start(i, done)` for every i in [0, n) and blocks until all of the
+// `done` callbacks have been invoked.  Returns the first error.
+Status StartAndWait(
+    int n, const std::function<void(int, const StatusCallback&)>& start) {
+  BlockingCounter pending(n);
+  mutex mu;
+  Status status;
+  for (int i = 0; i < n; ++i) {
+    start(i, [&pending, &mu, &status](const Status& s) {
+      {
+        mutex_lock l(mu);
+        status.Update(s);
+      }
+      pending.DecrementCount();
+    });
+  }
+  pending.Wait();
+  return status;
+}
+}  // namespace
+
+Status HierarchicalReducer::InitializeCollectiveParams(
+    CollectiveParams* col_params) {
+  CHECK_EQ(col_params->instance.type, REDUCTION_COLLECTIVE);
+  CHECK_EQ(col_params->instance.impl_details.collective_name,
+           "HierarchicalReduce");
+  if (col_params->group.device_type != DEVICE_CPU) {
+    return errors::InvalidArgument(
+        "HierarchicalReduce only supports CPU devices, got ",
+        col_params->group.device_type.type_string());
+  }
+  const string& device_name =
+      col_params->instance.device_names[col_params->default_rank];
+  // Group the devices by host.  Fall back to one host per task if the
+  // resolver did not provide host names.
+  const std::vector<string>& host_names =
+      col_params->instance.host_names.size() ==
+              col_params->instance.device_names.size()
+          ? col_params->instance.host_names
+          : col_params->instance.task_names;
+  // Hosts are numbered in order of first appearance; their devices need not
+  // be adjacent in device_names.
+  std::unordered_map<string, int> host_index;
+  std::vector<std::vector<int>> host_devices;
+  for (int di = 0; di < col_params->group.group_size; ++di) {
+    auto it = host_index
+                  .emplace(host_names[di], static_cast<int>(host_index.size()))
+                  .first;
+    if (it->second == static_cast<int>(host_devices.size())) {
+      host_devices.emplace_back();
+    }
+    host_devices[it->second].push_back(di);
+  }
+  const int num_hosts = static_cast<int>(host_devices.size());
+  const int inter_host_subdivs = num_hosts > 1 ? 1 : 0;
+
+  auto& subdiv_perms = col_params->instance.impl_details.subdiv_permutations;
+  subdiv_perms.clear();
+  subdiv_perms.resize(num_hosts + inter_host_subdivs);
+  col_params->subdiv_rank.assign(num_hosts + inter_host_subdivs, -1);
+
+  for (int hi = 0; hi < num_hosts; ++hi) {
+    // Inter-host subdiv: the first device of each host.
+    if (inter_host_subdivs > 0) {
+      const int leader = host_devices[hi][0];
+      subdiv_perms[0].push_back(leader);
+      if (col_params->instance.device_names[leader] == device_name) {
+        col_params->subdiv_rank[0] = hi;
+      }
+    }
+    // Intra-host subdiv: all devices of the host.
+    const int sdi = hi + inter_host_subdivs;
+    for (int i = 0; i < host_devices[hi].size(); ++i) {
+      const int di = host_devices[hi][i];
+      subdiv_perms[sdi].push_back(di);
+      if (col_params->instance.device_names[di] == device_name) {
+        col_params->subdiv_rank[sdi] = i;
+      }
+    }
+  }
+
+  VLOG(2) << collective_util::SubdivPermDebugString(*col_params);
+  return Status::OK();
+}
+
+Status HierarchicalReducer::InitializeCollectiveContext(
+    std::shared_ptr<CollectiveContext> col_ctx) {
+  CHECK(col_ctx->dev_mgr);
+  col_ctx_ = col_ctx;
+  col_params_ = &col_ctx->col_params;
+  return collective_util::InitializeDeviceAndLocality(
+      col_ctx->dev_mgr, col_ctx->device_name, &col_ctx->device,
+      &col_ctx->device_locality);
+}
+
+void HierarchicalReducer::Run(StatusCallback done) {
+  CHECK(col_ctx_);
+  CHECK(col_params_);
+  // Like `RingReducer`, this doesn't require non-overlapping collectives.
+  col_ctx_->col_exec->UnblockDependencies(*col_params_);
+
+  // Start by copying input to output if they're not already the same, i.e. if
+  // we're not computing in-place on the input tensor.
+  Status status;
+  if ((col_ctx_->input != col_ctx_->output) &&
+      (DMAHelper::base(col_ctx_->input) != DMAHelper::base(col_ctx_->output))) {
+    Notification note;
+    profiler::TraceMe activity("MemCpyAsync", profiler::TraceMeLevel::kInfo);
+    CollectiveRemoteAccessLocal::MemCpyAsync(
+        col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->op_device_context(), col_ctx_->device,
+        col_ctx_->device, col_ctx_->op_ctx->input_alloc_attr(0),
+        col_ctx_->op_ctx->output_alloc_attr(0), col_ctx_->input,
+        col_ctx_->output, 0 /*dev_to_dev_stream_index*/,
+        [&note, &status](const Status& s) {
+          status.Update(s);
+          note.Notify();
+        });
+    note.WaitForNotification();
+  }
+
+  const int local_subdiv = LocalSubdiv();
+  const bool is_host_leader = col_params_->subdiv_rank[local_subdiv] == 0;
+  if (status.ok()) status = ReduceWithinHost(local_subdiv);
+  if (status.ok() && is_host_leader) status = AllReduceAcrossHosts();
+  if (status.ok() && is_host_leader) status = Finalize();
+  if (status.ok()) status = BroadcastWithinHost(local_subdiv);
+  if (!status.ok()) {
+    LOG(ERROR) << "Aborting HierarchicalReduce with " << status;
+    // Cancel the pending transfers of the other devices.
+    col_ctx_->col_exec->StartAbort(status);
+  }
+  done(status);
+}
+
+int HierarchicalReducer::LocalSubdiv() const {
+  const int num_subdivs = static_cast<int>(col_params_->subdiv_rank.size());
+  for (int sdi = num_subdivs > 1 ? 1 : 0; sdi < num_subdivs; ++sdi) {
+    if (col_params_->subdiv_rank[sdi] >= 0) return sdi;
+  }
+  LOG(FATAL) << "Device " << col_ctx_->device_name
+             << " does not belong to any host subdiv";
+  return -1;
+}
+
+Status HierarchicalReducer::ReduceWithinHost(int subdiv) {
+  const int num_devices = static_cast<int>(
+      col_params_->instance.impl_details.subdiv_permutations[subdiv].size());
+  if (num_devices == 1) return Status::OK();
+  profiler::TraceMe activity("ReduceWithinHost",
+                             profiler::TraceMeLevel::kInfo);
+  Tensor* output = col_ctx_->output;
+  if (col_params_->subdiv_rank[subdiv] != 0) {
+    return StartAndWait(1, [this, subdiv, output](int,
+                                                  const StatusCallback& done) {
+      DispatchSend("reduce", subdiv, 0, output, done);
+    });
+  }
+  // Receive all values before merging them so that the copies overlap.  The
+  // merge order is fixed, so the result doesn't depend on arrival order.
+  Allocator* allocator =
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0));
+  std::vector<Tensor> values;
+  values.reserve(num_devices - 1);
+  for (int i = 1; i < num_devices; ++i) {
+    values.emplace_back(allocator, output->dtype(), output->shape());
+  }
+  TF_RETURN_IF_ERROR(StartAndWait(
+      num_devices - 1,
+      [this, subdiv, &values](int i, const StatusCallback& done) {
+        DispatchRecv("reduce", subdiv, i + 1, &values[i], done);
+      }));
+  for (Tensor& value : values) {
+    TF_RETURN_IF_ERROR(collective_util::ComputeBinOp(
+        col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+        col_params_->merge_op.get(), output, &value));
+  }
+  return Status::OK();
+}
+
+Status HierarchicalReducer::AllReduceAcrossHosts() {
+  const int num_subdivs = static_cast<int>(col_params_->subdiv_rank.size());
+  if (num_subdivs == 1) return Status::OK();
+  Tensor* output = col_ctx_->output;
+  if (output->NumElements() == 0) return Status::OK();
+  profiler::TraceMe activity("AllReduceAcrossHosts",
+                             profiler::TraceMeLevel::kInfo);
+
+  const int num_hosts = static_cast<int>(
+      col_params_->instance.impl_details.subdiv_permutations[0].size());
+  const int rank = col_params_->subdiv_rank[0];
+  const int next = (rank + 1) % num_hosts;
+  const int prev = (rank + num_hosts - 1) % num_hosts;
+  std::unique_ptr<CollectiveAdapter> ca(MakeCollectiveAdapter(
+      output, num_hosts,
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0))));
+
+  // Sends one chunk to the next leader while receiving another one from the
+  // previous leader.
+  auto exchange = [this, next, prev](const string& phase, Tensor* send_chunk,
+                                     Tensor* recv_chunk) {
+    return StartAndWait(2, [&](int i, const StatusCallback& done) {
+      if (i == 0) {
+        DispatchSend(phase, 0, next, send_chunk, done);
+      } else {
+        DispatchRecv(phase, 0, prev, recv_chunk, done);
+      }
+    });
+  };
+
+  // Reduce-scatter: after step s, chunk (rank - s - 1) holds the sum of s + 2
+  // hosts, so after num_hosts - 1 steps chunk (rank + 1) is fully reduced.
+  Status status;
+  for (int step = 0; status.ok() && step < num_hosts - 1; ++step) {
+    const int send_idx = (rank - step + num_hosts) % num_hosts;
+    const int recv_idx = (rank - step - 1 + num_hosts) % num_hosts;
+    Tensor send_chunk = ca->ChunkAlias(send_idx);
+    Tensor recv_chunk = ca->TempChunk(recv_idx);
+    status = exchange(strings::StrCat("scatter", step), &send_chunk,
+                      &recv_chunk);
+    if (status.ok()) {
+      Tensor chunk = ca->ChunkAlias(recv_idx);
+      status = collective_util::ComputeBinOp(
+          col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+          col_params_->merge_op.get(), &chunk, &recv_chunk);
+    }
+  }
+  // All-gather: circulate the fully reduced chunks.
+  for (int step = 0; status.ok() && step < num_hosts - 1; ++step) {
+    const int send_idx = (rank + 1 - step + num_hosts) % num_hosts;
+    const int recv_idx = (rank - step + num_hosts) % num_hosts;
+    Tensor send_chunk = ca->ChunkAlias(send_idx);
+    Tensor recv_chunk = ca->ChunkAlias(recv_idx);
+    status =
+        exchange(strings::StrCat("gather", step), &send_chunk, &recv_chunk);
+  }
+  ca->ConsumeFinalValue(output);
+  return status;
+}
+
+Status HierarchicalReducer::Finalize() {
+  Tensor* output = col_ctx_->output;
+  if (!col_params_->final_op || output->NumElements() == 0) {
+    return Status::OK();
+  }
+  std::unique_ptr<CollectiveAdapter> ca(MakeCollectiveAdapter(
+      output, 1,
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0))));
+  Tensor group_size = ca->Scalar(col_params_->group.group_size);
+  ca->ConsumeFinalValue(output);
+  return collective_util::ComputeBinOp(
+      col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+      col_params_->final_op.get(), output, &group_size);
+}
+
+Status HierarchicalReducer::BroadcastWithinHost(int subdiv) {
+  const int num_devices = static_cast<int>(
+      col_params_->instance.impl_details.subdiv_permutations[subdiv].size());
+  if (num_devices == 1) return Status::OK();
+  profiler::TraceMe activity("BroadcastWithinHost",
+                             profiler::TraceMeLevel::kInfo);
+  Tensor* output = col_ctx_->output;
+  if (col_params_->subdiv_rank[subdiv] != 0) {
+    return StartAndWait(1, [this, subdiv, output](int,
+                                                  const StatusCallback& done) {
+      DispatchRecv("broadcast", subdiv, 0, output, done);
+    });
+  }
+  return StartAndWait(num_devices - 1, [this, subdiv, output](
+                                           int i, const StatusCallback& done) {
+    DispatchSend("broadcast", subdiv, i + 1, output, done);
+  });
+}
+
+void HierarchicalReducer::DispatchSend(const string& phase, int subdiv,
+                                       int dst_rank, const Tensor* src_tensor,
+                                       const StatusCallback& done) {
+  const int src_rank = col_params_->subdiv_rank[subdiv];
+  string send_buf_key = HierarchicalReduceBufKey(col_ctx_->exec_key, phase,
+                                                 subdiv, src_rank, dst_rank);
+  int dst_idx =
+      col_params_->instance.impl_details.subdiv_permutations[subdiv][dst_rank];
+  VLOG(3) << "DispatchSend " << send_buf_key << " from_device "
+          << col_ctx_->device_name << " to_device "
+          << col_params_->instance.device_names[dst_idx];
+  col_ctx_->col_exec->remote_access()->PostToPeer(
+      col_params_->instance.device_names[dst_idx],
+      col_params_->instance.task_names[dst_idx], send_buf_key, col_ctx_->device,
+      col_ctx_->op_ctx->op_device_context(),
+      col_ctx_->op_ctx->output_alloc_attr(0), src_tensor,
+      col_ctx_->device_locality, done);
+}
+
+void HierarchicalReducer::DispatchRecv(const string& phase, int subdiv,
+                                       int src_rank, Tensor* dst_tensor,
+                                       const StatusCallback& done) {
+  const int dst_rank = col_params_->subdiv_rank[subdiv];
+  string recv_buf_key = HierarchicalReduceBufKey(col_ctx_->exec_key, phase,
+                                                 subdiv, src_rank, dst_rank);
+  int src_idx =
+      col_params_->instance.impl_details.subdiv_permutations[subdiv][src_rank];
+  VLOG(3) << "DispatchRecv " << recv_buf_key << " from_device "
+          << col_params_->instance.device_names[src_idx] << " to_device "
+          << col_ctx_->device_name;
+  col_ctx_->col_exec->remote_access()->RecvFromPeer(
+      col_params_->instance.device_names[src_idx],
+      col_params_->instance.task_names[src_idx],
+      col_params_->task.is_local[src_idx], recv_buf_key, col_ctx_->device,
+      col_ctx_->op_ctx->op_device_context(),
+      col_ctx_->op_ctx->output_alloc_attr(0), dst_tensor,
+      col_ctx_->device_locality, 0 /*stream_index*/, done);
+}
+
+namespace {
+REGISTER_COLLECTIVE(HierarchicalReduce, HierarchicalReducer);
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,94 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_REDUCER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+
+namespace tensorflow {
+
+// Hierarchical implementation of collective all-reduce for CPU devices spread
+// over several hosts.  The reduction proceeds in three phases:
+//   1. Every host reduces the values of its devices onto its first device, the
+//      host leader.  Tasks sharing a host exchange values over that host.
+//   2. The host leaders all-reduce among themselves with a ring
+//      reduce-scatter followed by a ring all-gather, so each leader sends and
+//      receives about 2 * (num_hosts - 1) / num_hosts of the tensor.
+//   3. Every leader broadcasts the result to the other devices of its host.
+// Compared to a flat ring over all devices, the traffic between hosts does
+// not grow with the number of devices per host.  Hosts are taken from
+// CollInstanceParams::host_names, or are the tasks if that is not set.
+class HierarchicalReducer : public CollectiveImplementationInterface {
+ public:
+  HierarchicalReducer() = default;
+  ~HierarchicalReducer() override = default;
+
+  // Establishes the subdiv permutations of the hierarchy.  If the devices
+  // span more than one host, the first subdiv comprises the first device of
+  // each host and subdiv i+1 comprises the devices of host i.  Otherwise
+  // there is a single subdiv with all devices.
+  Status InitializeCollectiveParams(CollectiveParams* col_params) override;
+
+  // Initializes members of CollectiveContext not yet initialized, i.e. device
+  // and device_locality.  Also saves the CollectiveContext in this object.
+  Status InitializeCollectiveContext(
+      std::shared_ptr<CollectiveContext> col_ctx) override;
+
+  // No-op for hierarchical reducer.
+  Status InitializeCollectiveGroupRuntimeDetails(
+      CollGroupRuntimeDetails*) override {
+    return Status::OK();
+  }
+
+  // Begins execution of the hierarchical all-reduce.
+  // Must be called in a blockable thread.
+  void Run(StatusCallback done) override;
+
+ private:
+  // Returns the index of the subdiv of this device's host.
+  int LocalSubdiv() const;
+
+  // Reduces the values of all devices of the host onto the host leader.
+  Status ReduceWithinHost(int subdiv);
+
+  // Runs a ring all-reduce over the host leaders.
+  Status AllReduceAcrossHosts();
+
+  // Applies final_op to the fully reduced value on the host leader.
+  Status Finalize();
+
+  // Broadcasts the value of the host leader to the other devices of the
+  // host.
+  Status BroadcastWithinHost(int subdiv);
+
+  // Sends `src_tensor` to the device at `dst_rank` in `subdiv`.
+  void DispatchSend(const string& phase, int subdiv, int dst_rank,
+                    const Tensor* src_tensor, const StatusCallback& done);
+
+  // Receives into `dst_tensor` from the device at `src_rank` in `subdiv`.
+  void DispatchRecv(const string& phase, int subdiv, int src_rank,
+                    Tensor* dst_tensor, const StatusCallback& done);
+
+  std::shared_ptr<CollectiveContext> col_ctx_;
+  const CollectiveParams* col_params_ = nullptr;  // Not owned
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_HIERARCHICAL_REDUCER_H_
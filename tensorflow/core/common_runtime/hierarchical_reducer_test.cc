@@ -0,0 +1,337 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/hierarchical_reducer.h"
+
+#include <atomic>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/unbounded_work_queue.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+static int64 kStepId = 123;
+
+std::unique_ptr<OpKernel> GetKernel(const NodeDef& node, DeviceBase* device) {
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()), node,
+      TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, DataType dtype,
+                                   DeviceBase* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder(strings::StrCat(op, "_node"), op)
+                  .Attr("T", dtype)
+                  .Input(FakeInput(dtype))
+                  .Input(FakeInput(dtype))
+                  .Finalize(&node_def));
+  return GetKernel(node_def, device);
+}
+
+CollectiveParams MakeCollectiveParams(int num_tasks, int num_devices_per_task,
+                                      DataType dtype) {
+  CollectiveParams cp;
+  cp.name = "test_collective";
+  cp.group.group_key = 5;
+  cp.group.group_size = num_tasks * num_devices_per_task;
+  cp.group.device_type = DEVICE_CPU;
+  cp.group.num_tasks = num_tasks;
+  cp.instance.instance_key = 17;
+  cp.instance.type = REDUCTION_COLLECTIVE;
+  cp.instance.data_type = dtype;
+  cp.instance.impl_details.collective_name = "HierarchicalReduce";
+  for (int ti = 0; ti < num_tasks; ++ti) {
+    string task_name = strings::StrCat("/job:worker/replica:0/task:", ti);
+    cp.instance.num_devices_per_task[task_name] = num_devices_per_task;
+    for (int di = 0; di < num_devices_per_task; ++di) {
+      cp.instance.device_names.push_back(
+          strings::StrCat(task_name, "/device:CPU:", di));
+      cp.instance.task_names.push_back(task_name);
+      // The test runs in a single process so every device is local.
+      cp.task.is_local.push_back(true);
+    }
+  }
+  return cp;
+}
+
+TEST(HierarchicalReducerInitParamsTest, MultipleTasks) {
+  CollectiveParams cp = MakeCollectiveParams(3, 2, DT_FLOAT);
+  cp.default_rank = 3;
+  HierarchicalReducer* reducer = new HierarchicalReducer;
+  core::ScopedUnref unref(reducer);
+  TF_ASSERT_OK(reducer->InitializeCollectiveParams(&cp));
+  EXPECT_EQ(std::vector<std::vector<int>>({{0, 2, 4}, {0, 1}, {2, 3}, {4, 5}}),
+            cp.instance.impl_details.subdiv_permutations);
+  EXPECT_EQ(std::vector<int>({-1, -1, 1, -1}), cp.subdiv_rank);
+
+  cp.default_rank = 4;
+  TF_ASSERT_OK(reducer->InitializeCollectiveParams(&cp));
+  EXPECT_EQ(std::vector<int>({2, -1, -1, 0}), cp.subdiv_rank);
+}
+
+TEST(HierarchicalReducerInitParamsTest, TasksSharingHosts) {
+  // Tasks 0 and 2 run on host A, task 1 on host B.
+  CollectiveParams cp = MakeCollectiveParams(3, 2, DT_FLOAT);
+  cp.instance.host_names = {"A", "A", "B", "B", "A", "A"};
+  cp.default_rank = 5;
+  HierarchicalReducer* reducer = new HierarchicalReducer;
+  core::ScopedUnref unref(reducer);
+  TF_ASSERT_OK(reducer->InitializeCollectiveParams(&cp));
+  EXPECT_EQ(std::vector<std::vector<int>>({{0, 2}, {0, 1, 4, 5}, {2, 3}}),
+            cp.instance.impl_details.subdiv_permutations);
+  EXPECT_EQ(std::vector<int>({-1, 3, -1}), cp.subdiv_rank);
+
+  cp.default_rank = 2;
+  TF_ASSERT_OK(reducer->InitializeCollectiveParams(&cp));
+  EXPECT_EQ(std::vector<int>({1, -1, 0}), cp.subdiv_rank);
+
+  // All tasks on one host form a single subdiv.
+  cp.instance.host_names.assign(6, "A");
+  TF_ASSERT_OK(reducer->InitializeCollectiveParams(&cp));
+  EXPECT_EQ(std::vector<std::vector<int>>({{0, 1, 2, 3, 4, 5}}),
+            cp.instance.impl_details.subdiv_permutations);
+  EXPECT_EQ(std::vector<int>({2}), cp.subdiv_rank);
+}
+
+TEST(HierarchicalReducerInitParamsTest, SingleTask) {
+  CollectiveParams cp = MakeCollectiveParams(1, 3, DT_FLOAT);
+  cp.default_rank = 1;
+  HierarchicalReducer* reducer = new HierarchicalReducer;
+  core::ScopedUnref unref(reducer);
+  TF_ASSERT_OK(reducer->InitializeCollectiveParams(&cp));
+  EXPECT_EQ(std::vector<std::vector<int>>({{0, 1, 2}}),
+            cp.instance.impl_details.subdiv_permutations);
+  EXPECT_EQ(std::vector<int>({1}), cp.subdiv_rank);
+}
+
+TEST(HierarchicalReducerInitParamsTest, RejectsGpu) {
+  CollectiveParams cp = MakeCollectiveParams(2, 1, DT_FLOAT);
+  cp.group.device_type = DEVICE_GPU;
+  cp.default_rank = 0;
+  HierarchicalReducer* reducer = new HierarchicalReducer;
+  core::ScopedUnref unref(reducer);
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(reducer->InitializeCollectiveParams(&cp)));
+}
+
+class HierarchicalReducerTest : public ::testing::Test {
+ protected:
+  ~HierarchicalReducerTest() override {
+    if (col_exec_) col_exec_->Unref();
+  }
+
+  void Init(int num_tasks, int num_devices_per_task, DataType dtype) {
+    std::vector<std::unique_ptr<Device>> local_devices;
+    SessionOptions sess_opts;
+    sess_opts.env = Env::Default();
+    Bytes mem_limit(4 << 20);
+    DeviceLocality dev_locality;
+    col_params_ = MakeCollectiveParams(num_tasks, num_devices_per_task, dtype);
+    col_params_.instance.host_names = host_names_;
+    for (const string& dev_name : col_params_.instance.device_names) {
+      local_devices.push_back(absl::make_unique<ThreadPoolDevice>(
+          sess_opts, dev_name, mem_limit, dev_locality, cpu_allocator()));
+    }
+    dev_mgr_ = absl::make_unique<StaticDeviceMgr>(std::move(local_devices));
+    dev_resolver_ = absl::make_unique<DeviceResolverLocal>(dev_mgr_.get());
+    work_queue_ = std::make_shared<UnboundedWorkQueue>(Env::Default(), "test");
+    rma_ = new CollectiveRemoteAccessLocal(dev_mgr_.get(), dev_resolver_.get(),
+                                           kStepId);
+    col_exec_ = new BaseCollectiveExecutor(&col_exec_mgr_, rma_, kStepId,
+                                           dev_mgr_.get(), &gpu_ring_order_,
+                                           work_queue_);
+  }
+
+  template <typename T>
+  void RunTest(DataType dtype, int num_tasks, int num_devices_per_task,
+               int tensor_len) {
+    Init(num_tasks, num_devices_per_task, dtype);
+    const int group_size = num_tasks * num_devices_per_task;
+    std::vector<T> expected(tensor_len, 0);
+    std::vector<Tensor> tensors;
+    for (int rank = 0; rank < group_size; ++rank) {
+      Tensor t(dtype, TensorShape({tensor_len}));
+      for (int i = 0; i < tensor_len; ++i) {
+        const T value = static_cast<T>(rank * 10 + i);
+        t.flat<T>()(i) = value;
+        expected[i] += value;
+      }
+      tensors.push_back(t);
+    }
+    for (int i = 0; i < tensor_len; ++i) expected[i] /= group_size;
+
+    std::vector<Status> statuses(group_size);
+    std::atomic<int> done(0);
+    for (int rank = 0; rank < group_size; ++rank) {
+      SchedClosure([this, rank, &tensors, &statuses, &done] {
+        statuses[rank] = DoReduce(rank, &tensors[rank]);
+        ++done;
+      });
+    }
+    while (done < group_size) {
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+
+    for (int rank = 0; rank < group_size; ++rank) {
+      TF_EXPECT_OK(statuses[rank]);
+      auto actual = tensors[rank].flat<T>();
+      for (int i = 0; i < tensor_len; ++i) {
+        EXPECT_EQ(expected[i], actual(i))
+            << "Mismatch at rank " << rank << " index " << i;
+      }
+    }
+  }
+
+  Status DoReduce(int rank, Tensor* tensor) {
+    Device* device = nullptr;
+    TF_CHECK_OK(dev_mgr_->LookupDevice(
+        col_params_.instance.device_names[rank], &device));
+    CollectiveParams col_params = col_params_;
+    col_params.default_rank = rank;
+    col_params.merge_op =
+        GetBinOp("Add", col_params.instance.data_type, device);
+    col_params.final_op =
+        GetBinOp("Div", col_params.instance.data_type, device);
+
+    HierarchicalReducer* reducer = new HierarchicalReducer;
+    core::ScopedUnref unref(reducer);
+    TF_CHECK_OK(reducer->InitializeCollectiveParams(&col_params));
+
+    // Prepare an OpKernelContext.
+    OpKernelContext::Params op_params;
+    op_params.step_id = kStepId;
+    op_params.device = device;
+    gtl::InlinedVector<TensorValue, 4> inputs;
+    inputs.push_back(TensorValue(tensor));
+    op_params.inputs = &inputs;
+    gtl::InlinedVector<AllocatorAttributes, 4> input_aa(
+        {AllocatorAttributes()});
+    op_params.input_alloc_attrs = &input_aa;
+    DeviceContext* dev_ctx = new DeviceContext;
+    core::ScopedUnref unref_dev_ctx(dev_ctx);
+    op_params.op_device_context = dev_ctx;
+    int forward_from = 0;
+    op_params.forward_from_array = &forward_from;
+    AllocatorAttributes generic_alloc_attr;
+    op_params.output_attr_array = &generic_alloc_attr;
+    NodeDef node_def;
+    TF_CHECK_OK(
+        NodeDefBuilder(strings::StrCat("collective_reduce_", rank),
+                       "CollectiveReduce")
+            .Attr("T", col_params.instance.data_type)
+            .Attr("merge_op", "Add")
+            .Attr("final_op", "Div")
+            .Attr("group_size", col_params.group.group_size)
+            .Attr("group_key", col_params.group.group_key)
+            .Attr("instance_key", col_params.instance.instance_key)
+            .Attr("subdiv_offsets", std::vector<int>())
+            .Attr("communication_hint", "hierarchical")
+            .Input(FakeInput(col_params.instance.data_type))
+            .Finalize(&node_def));
+    std::unique_ptr<OpKernel> op = GetKernel(node_def, device);
+    op_params.op_kernel = op.get();
+    OpKernelContext ctx(&op_params, 1);
+
+    // We never actually execute the kernel, so we need to do the output
+    // allocation it would do, ourselves.
+    Tensor* output = nullptr;
+    TF_CHECK_OK(
+        ctx.forward_input_or_allocate_output({0}, 0, tensor->shape(), &output));
+
+    string exec_key = strings::StrCat(col_params.instance.instance_key, ":0:0");
+    auto col_ctx = std::make_shared<CollectiveContext>(
+        col_exec_, dev_mgr_.get(), &ctx, &op_params, col_params, exec_key,
+        kStepId, tensor, output);
+    TF_CHECK_OK(reducer->InitializeCollectiveContext(col_ctx));
+
+    Status status;
+    reducer->Run([&status](Status s) { status = s; });
+    if (status.ok()) {
+      CHECK(tensor->CopyFrom(*ctx.mutable_output(0), tensor->shape()));
+    }
+    return status;
+  }
+
+  TestCollectiveExecutorMgr col_exec_mgr_;
+  CollectiveExecutor* col_exec_ = nullptr;
+  CollectiveRemoteAccessLocal* rma_;
+  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
+  std::shared_ptr<UnboundedWorkQueue> work_queue_;
+  std::unique_ptr<DeviceMgr> dev_mgr_;
+  string gpu_ring_order_;
+  CollectiveParams col_params_;
+  // Host of each device.  Empty means one host per task.
+  std::vector<string> host_names_;
+};
+
+#define DEF_TEST(B, N, D, L)                                             \
+  TEST_F(HierarchicalReducerTest,                                        \
+         DaTy##B##_Tasks##N##_DevsPerTask##D##_Len##L) {                 \
+    DataType dtype = DT_##B;                                             \
+    switch (dtype) {                                                     \
+      case DT_FLOAT: {                                                   \
+        RunTest<float>(dtype, N, D, L);                                  \
+      } break;                                                           \
+      case DT_INT32: {                                                   \
+        RunTest<int32>(dtype, N, D, L);                                  \
+      } break;                                                           \
+      case DT_INT64: {                                                   \
+        RunTest<int64>(dtype, N, D, L);                                  \
+      } break;                                                           \
+      default:                                                           \
+        LOG(FATAL) << "Unimplemented";                                   \
+    }                                                                    \
+  }
+
+DEF_TEST(FLOAT, 1, 1, 8)
+DEF_TEST(FLOAT, 1, 4, 1001)
+DEF_TEST(FLOAT, 2, 1, 1001)
+DEF_TEST(FLOAT, 2, 3, 4096)
+DEF_TEST(FLOAT, 3, 2, 1001)
+DEF_TEST(FLOAT, 4, 4, 9408)
+// Fewer elements than tasks, so some ring chunks are empty.
+DEF_TEST(FLOAT, 4, 2, 3)
+DEF_TEST(INT32, 3, 2, 1001)
+DEF_TEST(INT64, 2, 4, 4095)
+
+TEST_F(HierarchicalReducerTest, TasksSharingHosts) {
+  host_names_ = {"A", "B", "A", "B", "C", "C", "A", "B"};
+  RunTest<float>(DT_FLOAT, 4, 2, 1001);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -81,6 +81,10 @@ class RingAlg : public CollectiveImplementationInterface {
     bool is_final = false;  // is the last field in the pass for this rank
     Tensor chunk;           // alias to field values
     Tensor tmp_chunk;
+    // If use_wire_chunk is set, wire_chunk is sent or received in place of
+    // chunk, e.g. because it holds a compressed copy of chunk.
+    bool use_wire_chunk = false;
+    Tensor wire_chunk;
     Status status;
     string DebugString() const;
   };
@@ -20,6 +20,8 @@ limitations under the License.
 #include <functional>
 #include <utility>
 
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/collective_compression.h"
 #include "tensorflow/core/common_runtime/collective_rma_local.h"
 #include "tensorflow/core/common_runtime/collective_util.h"
 #include "tensorflow/core/common_runtime/copy_tensor.h"
@@ -49,6 +51,32 @@ Status RingReducer::InitializeCollectiveParams(CollectiveParams* col_params) {
   // TODO(b/113171733): change CHECKs to return errors.
   CHECK_EQ(col_params->instance.type, REDUCTION_COLLECTIVE);
   CHECK_EQ(col_params->instance.impl_details.collective_name, "RingReduce");
+  const CollImplDetails& impl_details = col_params->instance.impl_details;
+  CollectiveCompression compression;
+  TF_RETURN_IF_ERROR(
+      ParseCollectiveCompression(impl_details.compression, &compression));
+  if (compression != CollectiveCompression::kNone) {
+    if (col_params->group.device_type != DEVICE_CPU ||
+        col_params->instance.data_type != DT_FLOAT) {
+      return errors::InvalidArgument(
+          "Collective compression \"", impl_details.compression,
+          "\" is only supported for float tensors on CPU, got ",
+          DataTypeString(col_params->instance.data_type), " on ",
+          col_params->group.device_type.type_string());
+    }
+    if (compression == CollectiveCompression::kTopK) {
+      if (!(impl_details.topk_ratio > 0 && impl_details.topk_ratio <= 1)) {
+        return errors::InvalidArgument("topk_ratio must be in (0, 1], got ",
+                                       impl_details.topk_ratio);
+      }
+      // Error feedback relies on the reduction being a sum.
+      if (col_params->merge_op == nullptr ||
+          col_params->merge_op->type_string() != "Add") {
+        return errors::InvalidArgument(
+            "Collective compression \"topk\" requires merge_op Add");
+      }
+    }
+  }
   return RingAlg::InitializeCollectiveParams(col_params);
 }
 
@@ -64,6 +92,18 @@ void RingReducer::Run(StatusCallback done) {
   num_subdivs_ = static_cast<int>(
       col_params_->instance.impl_details.subdiv_permutations.size());
   CHECK_GT(num_subdivs_, 0);
+  CollectiveCompression compression;
+  Status status = ParseCollectiveCompression(
+      col_params_->instance.impl_details.compression, &compression);
+  if (!status.ok()) {
+    group_size_tensor_ready_.Notify();  // To unblock destructor.
+    done_(status);
+    return;
+  }
+  if (compression != CollectiveCompression::kNone) {
+    compressor_ = absl::make_unique<ChunkCompressor>(
+        compression, col_params_->instance.impl_details.topk_ratio);
+  }
 
   if (VLOG_IS_ON(1)) {
     string buf;
@@ -92,7 +132,6 @@ void RingReducer::Run(StatusCallback done) {
     // We are running in a blockable thread and the callback can't block so
     // just wait here on the copy.
     Notification note;
-    Status status;
     profiler::TraceMe activity("MemCpyAsync", profiler::TraceMeLevel::kInfo);
     CollectiveRemoteAccessLocal::MemCpyAsync(
         col_ctx_->op_ctx->op_device_context(),
@@ -169,6 +208,47 @@ void RingReducer::InitRingField(RingField* rf, int chunk_idx, int subdiv_idx,
   }
 }
 
+void RingReducer::AllocateWireChunk(RingField* rf) {
+  rf->use_wire_chunk = true;
+  rf->wire_chunk = Tensor(
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0)),
+      compressor_->WireType(),
+      compressor_->WireShape(rf->chunk.NumElements()));
+}
+
+Status RingReducer::CompressChunk(RingField* rf) {
+  if (rf->second_pass && rf->do_recv) {
+    // Forward the encoding we received unchanged.
+    DCHECK(rf->use_wire_chunk);
+    return Status::OK();
+  }
+  AllocateWireChunk(rf);
+  // Each pass 0 send carries a partial sum, and the pass 1 send from the
+  // device that completed the chunk carries the final value.  The error of
+  // both is fed back into the next execution of this instance.
+  // Residuals are keyed by the instance key, which identifies the reduced
+  // tensor; the op name does not, since eager reductions all share one.
+  Tensor residual;
+  CompressionResidualStore* residual_store =
+      col_ctx_->col_exec->residual_store();
+  if (compressor_->uses_error_feedback() && residual_store != nullptr) {
+    residual = residual_store->Get(
+        col_params_->group.group_key,
+        strings::StrCat(col_ctx_->device_name, ":",
+                        col_params_->instance.instance_key, ":", rf->sc_idx,
+                        rf->second_pass ? ":1" : ":0"),
+        rf->chunk.NumElements());
+  }
+  compressor_->Compress(rf->chunk,
+                        residual.IsInitialized() ? &residual : nullptr,
+                        &rf->wire_chunk);
+  if (rf->second_pass) {
+    // Keep the value the other devices will decode.
+    return compressor_->Decompress(rf->wire_chunk, &rf->chunk);
+  }
+  return Status::OK();
+}
+
 // At the beginning of the algorithm initialize a RingField struct for
 // every independent field of the tensor.
 bool RingReducer::RunAsyncParts() {
@@ -235,6 +315,9 @@ bool RingReducer::RunAsyncParts() {
           case RF_INIT:
             if (rf->do_recv) {
               rf->action = RF_RECV;
+              if (compressor_) {
+                AllocateWireChunk(rf);
+              }
               auto requeue = [this, rf, &ready_queue, &aborted](Status s) {
                 if (!s.ok()) {
                   aborted = true;
@@ -254,15 +337,28 @@ bool RingReducer::RunAsyncParts() {
             --recv_pending_count;
             if (!rf->second_pass) {
               rf->action = RF_REDUCE;
-              Status s = collective_util::ComputeBinOp(
-                  col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
-                  col_params_->merge_op.get(), &rf->chunk, &rf->tmp_chunk);
+              Status s;
+              if (compressor_) {
+                s = compressor_->Decompress(rf->wire_chunk, &rf->tmp_chunk);
+              }
+              if (s.ok()) {
+                s = collective_util::ComputeBinOp(
+                    col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+                    col_params_->merge_op.get(), &rf->chunk, &rf->tmp_chunk);
+              }
               if (!s.ok()) {
                 aborted = true;
                 StartAbort(s);
               }
             } else {
               rf->action = RF_SEND_READY;
+              if (compressor_) {
+                Status s = compressor_->Decompress(rf->wire_chunk, &rf->chunk);
+                if (!s.ok()) {
+                  aborted = true;
+                  StartAbort(s);
+                }
+              }
             }
             break;
           case RF_REDUCE:
@@ -286,6 +382,15 @@ bool RingReducer::RunAsyncParts() {
             break;
           case RF_SEND_READY:
             if (rf->do_send) {
+              if (compressor_) {
+                Status s = CompressChunk(rf);
+                if (!s.ok()) {
+                  aborted = true;
+                  StartAbort(s);
+                  rf->action = RF_DONE;
+                  break;
+                }
+              }
               rf->action = RF_SEND;
               auto send_complete = [this, rf, &ready_queue,
                                     &aborted](Status s) {
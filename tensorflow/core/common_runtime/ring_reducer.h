@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_compression.h"
 #include "tensorflow/core/common_runtime/ring_alg.h"
 #include "tensorflow/core/framework/collective.h"
 
@@ -28,6 +29,10 @@ namespace tensorflow {
 class Device;
 
 // Ring-algorithm implementation of collective all-reduce.
+//
+// If impl_details.compression is set, the chunks exchanged between devices
+// are compressed in flight (see collective_compression.h) while the
+// reduction itself runs in float.  Every device ends with the same value.
 class RingReducer : public RingAlg {
  public:
   RingReducer() : RingAlg(REDUCTION_COLLECTIVE, "Reduce") {}
@@ -49,6 +54,13 @@ class RingReducer : public RingAlg {
   void ContinueAfterInputCopy();
   bool RunAsyncParts();
 
+  // Allocates rf->wire_chunk to hold the compressed rf->chunk.
+  void AllocateWireChunk(RingField* rf);
+  // Encodes rf->chunk into rf->wire_chunk before it is sent.
+  Status CompressChunk(RingField* rf);
+
+  // Null unless chunks are compressed.
+  std::unique_ptr<ChunkCompressor> compressor_;
   Tensor group_size_tensor_;
   Notification group_size_tensor_ready_;
 
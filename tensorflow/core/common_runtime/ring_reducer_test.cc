@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/ring_reducer.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include "absl/memory/memory.h"
 #include "tensorflow/core/common_runtime/base_collective_executor.h"
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
@@ -209,6 +211,8 @@ class RingReducerTest : public ::testing::Test {
     col_params_.instance.impl_details.subdiv_offsets.clear();
     col_params_.instance.type = REDUCTION_COLLECTIVE;
     col_params_.instance.impl_details.collective_name = "RingReduce";
+    col_params_.instance.impl_details.compression = compression_;
+    col_params_.instance.impl_details.topk_ratio = topk_ratio_;
     col_params_.instance.data_type = dtype;
     col_params_.instance.impl_details.subdiv_permutations.resize(num_subdivs);
     col_params_.subdiv_rank.resize(num_subdivs);
@@ -363,6 +367,65 @@ class RingReducerTest : public ::testing::Test {
     }
   }
 
+  // Runs `num_rounds` float all-reduces of the same input with the given
+  // chunk compression.  Every device must end each round with the same value,
+  // and the sum of the values over all rounds must be within `tolerance` of
+  // the exact sum, relative to the largest magnitude of the exact sum.  Each
+  // round reduces a different input under each of `num_instances` instance
+  // keys, which share the name of the collective.
+  void RunCompressedTest(const string& compression, float topk_ratio,
+                         int num_workers, int num_devices, int num_subdivs,
+                         int tensor_len, int num_rounds, float tolerance,
+                         int num_instances = 1) {
+    compression_ = compression;
+    topk_ratio_ = topk_ratio;
+    Init(num_workers, num_devices, DT_FLOAT, DEVICE_CPU, num_subdivs,
+         /*fail_after=*/0);
+    const int group_size = num_workers * num_devices;
+    const int instance_key = col_params_.instance.instance_key;
+    std::vector<std::vector<double>> expected(
+        num_instances, std::vector<double>(tensor_len, 0.0));
+    std::vector<std::vector<double>> sum(num_instances,
+                                         std::vector<double>(tensor_len, 0.0));
+    for (int round = 0; round < num_rounds; ++round) {
+      for (int k = 0; k < num_instances; ++k) {
+        for (int di = 0; di < group_size; ++di) {
+          instances_[di]->col_params_.instance.instance_key = instance_key + k;
+          instances_[di]->InitTensor(
+              DT_FLOAT, TensorShape({tensor_len}),
+              [&expected, round, di, k, group_size](Tensor* t) {
+                for (int i = 0; i < t->NumElements(); ++i) {
+                  float value = (di + 1) * (((i + 5 * k) % 13) - 6) * 0.5f;
+                  if (k % 2 == 1) value = -2 * value;
+                  t->flat<float>()(i) = value;
+                  if (round == 0) expected[k][i] += value / group_size;
+                }
+              });
+        }
+        Reduce(/*fail_after=*/0);
+        const Tensor& first = instances_[0]->tensor_;
+        for (int di = 0; di < group_size; ++di) {
+          TF_ASSERT_OK(instances_[di]->status_);
+          test::ExpectTensorEqual<float>(first, instances_[di]->tensor_);
+        }
+        for (int i = 0; i < tensor_len; ++i) {
+          sum[k][i] += first.flat<float>()(i);
+        }
+      }
+    }
+    for (int k = 0; k < num_instances; ++k) {
+      double max_abs = 0;
+      for (int i = 0; i < tensor_len; ++i) {
+        max_abs = std::max(max_abs, num_rounds * std::abs(expected[k][i]));
+      }
+      for (int i = 0; i < tensor_len; ++i) {
+        EXPECT_NEAR(num_rounds * expected[k][i], sum[k][i],
+                    tolerance * max_abs)
+            << "Mismatch at instance " << k << " index " << i;
+      }
+    }
+  }
+
   std::unique_ptr<OpKernel> GetCollectiveReduce(const CollectiveParams& params,
                                                 Tensor* input,
                                                 const DeviceType& device_type,
@@ -402,6 +465,14 @@ class RingReducerTest : public ::testing::Test {
     reducer->group_size_tensor_ready_.Notify();  // To unblock destructor.
   }
 
+  Status InitializeParams(CollectiveParams* cp) {
+    RingReducer* reducer = new RingReducer;
+    core::ScopedUnref unref(reducer);
+    Status s = reducer->InitializeCollectiveParams(cp);
+    reducer->group_size_tensor_ready_.Notify();  // To unblock destructor.
+    return s;
+  }
+
   class DeviceInstance {
    public:
     DeviceInstance(int rank, const string& dev_name,
@@ -538,6 +609,8 @@ class RingReducerTest : public ::testing::Test {
   };
 
   bool stop_ = false;
+  string compression_;
+  float topk_ratio_ = 0.01;
   DeviceType device_type_;
   TestCollectiveExecutorMgr col_exec_mgr_;
   CollectiveExecutor* col_exec_;
@@ -702,6 +775,49 @@ DEF_TEST(INT64, CPU, 2, 8, 3, 4095, 0)
 DEF_TEST(FLOAT, CPU, 2, 8, 1, 9408, 1)
 DEF_TEST(FLOAT, CPU, 2, 8, 1, 9408, 7)
 DEF_TEST(FLOAT, CPU, 2, 8, 2, 9408, 11)
+
+TEST_F(RingReducerTest, CompressedBf16) {
+  RunCompressedTest("bf16", 0, 2, 4, 1, 1001, 1, 1e-2);
+}
+
+TEST_F(RingReducerTest, CompressedFp16) {
+  RunCompressedTest("fp16", 0, 1, 8, 2, 4095, 1, 2e-3);
+}
+
+TEST_F(RingReducerTest, CompressedTopKKeepingEverythingIsExact) {
+  RunCompressedTest("topk", 1.0, 2, 2, 1, 1001, 1, 1e-6);
+}
+
+TEST_F(RingReducerTest, CompressedTopKErrorFeedback) {
+  // Each round only sends a quarter of every chunk, but the dropped values
+  // are sent in later rounds, so the sum over the rounds stays accurate.
+  RunCompressedTest("topk", 0.25, 1, 4, 1, 64, 100, 5e-2);
+}
+
+TEST_F(RingReducerTest, CompressedTopKErrorFeedbackPerInstance) {
+  // Eager reductions share the name of the collective, so the residual of one
+  // tensor must not be fed into the reduction of another.
+  RunCompressedTest("topk", 0.25, 1, 4, 1, 64, 100, 5e-2,
+                    /*num_instances=*/2);
+}
+
+TEST_F(RingReducerTest, CompressionRequiresFloatOnCpu) {
+  CollectiveParams cp = SetUpCollectiveParams(2, 1);
+  cp.default_rank = 0;
+  cp.instance.impl_details.compression = "bf16";
+  Status s = InitializeParams(&cp);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+
+  cp.group.device_type = DeviceType(DEVICE_CPU);
+  cp.instance.data_type = DT_INT32;
+  s = InitializeParams(&cp);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+
+  cp.instance.data_type = DT_FLOAT;
+  cp.instance.impl_details.compression = "int4";
+  s = InitializeParams(&cp);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
 #endif
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
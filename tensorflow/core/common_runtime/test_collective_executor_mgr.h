@@ -56,6 +56,8 @@ class TestParamResolver : public ParamResolverInterface {
   }
 
   void StartAbort(const Status& s) override { return; }
+
+  void ResetGroups(const Status& s) override { return; }
 };
 
 class TestCollectiveExecutorMgr : public CollectiveExecutorMgrInterface {
@@ -100,6 +102,8 @@ class TestCollectiveExecutorMgr : public CollectiveExecutorMgrInterface {
     return nullptr;
   }
 
+  void ResetGroups(const Status& s) override { return; }
+
   void GetStepSequenceAsync(const GetStepSequenceRequest* request,
                             GetStepSequenceResponse* response,
                             const StatusCallback& done) override {
@@ -0,0 +1,152 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/distributed_runtime/adaptive_compression.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+// The sample of a message is made of up to kMaxSampleBytes / kSampleBlockBytes
+// blocks, evenly spaced over its payload.
+constexpr int64 kSampleBlockBytes = 4096;
+
+// When compressing is slower than the network, the compression throughput is
+// only measured again on every kResampleInterval-th message.
+constexpr int64 kResampleInterval = 16;
+
+// Weight of the latest measurement in the average compression throughput.
+constexpr double kThroughputSmoothing = 0.25;
+
+// Appends up to `num_bytes` bytes of the concatenation of `payload`, starting
+// at `offset`, to `out`.
+void AppendRange(const std::vector<StringPiece>& payload, int64 offset,
+                 int64 num_bytes, string* out) {
+  for (const StringPiece& piece : payload) {
+    if (num_bytes <= 0) return;
+    const int64 size = piece.size();
+    if (offset >= size) {
+      offset -= size;
+      continue;
+    }
+    const int64 n = std::min(size - offset, num_bytes);
+    out->append(piece.data() + offset, n);
+    num_bytes -= n;
+    offset = 0;
+  }
+}
+
+string Sample(const std::vector<StringPiece>& payload, int64 total_bytes) {
+  string sample;
+  if (total_bytes <= AdaptiveCompression::kMaxSampleBytes) {
+    AppendRange(payload, 0, total_bytes, &sample);
+    return sample;
+  }
+  const int64 num_blocks =
+      AdaptiveCompression::kMaxSampleBytes / kSampleBlockBytes;
+  const int64 stride = total_bytes / num_blocks;
+  sample.reserve(AdaptiveCompression::kMaxSampleBytes);
+  for (int64 i = 0; i < num_blocks; ++i) {
+    AppendRange(payload, i * stride, kSampleBlockBytes, &sample);
+  }
+  return sample;
+}
+
+}  // namespace
+
+constexpr int64 AdaptiveCompression::kMaxSampleBytes;
+
+std::unique_ptr<AdaptiveCompression> AdaptiveCompression::FromRPCOptions(
+    const RPCOptions& rpc_options) {
+  if (rpc_options.adaptive_compression_min_bytes() <= 0) return nullptr;
+  Options options;
+  options.min_bytes = rpc_options.adaptive_compression_min_bytes();
+  if (rpc_options.adaptive_compression_max_ratio() > 0) {
+    options.max_ratio = rpc_options.adaptive_compression_max_ratio();
+  }
+  options.network_bytes_per_sec =
+      rpc_options.adaptive_compression_network_bytes_per_sec();
+  return absl::make_unique<AdaptiveCompression>(Env::Default(), options);
+}
+
+bool AdaptiveCompression::ShouldCompress(
+    const std::vector<StringPiece>& payload) {
+  int64 total_bytes = 0;
+  for (const StringPiece& piece : payload) {
+    total_bytes += piece.size();
+  }
+  if (total_bytes == 0 || total_bytes < options_.min_bytes) return false;
+
+  if (options_.network_bytes_per_sec > 0) {
+    // Even a perfect compression ratio doesn't pay off if compressing is
+    // slower than the network, so don't bother sampling the message.
+    mutex_lock l(mu_);
+    if (compression_bytes_per_sec_ > 0 &&
+        compression_bytes_per_sec_ <= options_.network_bytes_per_sec &&
+        ++num_skipped_ % kResampleInterval != 0) {
+      return false;
+    }
+  }
+
+  const string sample = Sample(payload, total_bytes);
+  const double ratio = static_cast<double>(Deflate(sample)) / sample.size();
+  VLOG(2) << "Sampled " << sample.size() << " of " << total_bytes
+          << " bytes, compression ratio " << ratio;
+  if (ratio > options_.max_ratio) return false;
+  if (options_.network_bytes_per_sec <= 0) return true;
+
+  // Compressing takes total_bytes / compression_bytes_per_sec, and saves
+  // total_bytes * (1 - ratio) / network_bytes_per_sec on the network.
+  return (1 - ratio) * compression_bytes_per_sec() >
+         options_.network_bytes_per_sec;
+}
+
+double AdaptiveCompression::compression_bytes_per_sec() const {
+  mutex_lock l(mu_);
+  return compression_bytes_per_sec_;
+}
+
+size_t AdaptiveCompression::Deflate(const string& sample) {
+  uLongf compressed_size = compressBound(sample.size());
+  std::unique_ptr<Bytef[]> compressed(new Bytef[compressed_size]);
+  const uint64 start_micros = env_->NowMicros();
+  const int result = compress2(
+      compressed.get(), &compressed_size,
+      reinterpret_cast<const Bytef*>(sample.data()), sample.size(),
+      Z_DEFAULT_COMPRESSION);
+  const uint64 elapsed_micros =
+      std::max<uint64>(1, env_->NowMicros() - start_micros);
+  if (result != Z_OK) {
+    LOG(WARNING) << "Failed to compress a message sample: " << result;
+    return sample.size();
+  }
+
+  const double bytes_per_sec = sample.size() * 1e6 / elapsed_micros;
+  mutex_lock l(mu_);
+  compression_bytes_per_sec_ =
+      compression_bytes_per_sec_ > 0
+          ? (1 - kThroughputSmoothing) * compression_bytes_per_sec_ +
+                kThroughputSmoothing * bytes_per_sec
+          : bytes_per_sec;
+  return compressed_size;
+}
+
+}  // namespace tensorflow
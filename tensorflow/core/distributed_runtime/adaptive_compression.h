@@ -0,0 +1,84 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_ADAPTIVE_COMPRESSION_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_ADAPTIVE_COMPRESSION_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+
+// Decides whether RPC messages are worth compressing (see
+// RPCOptions.adaptive_compression_min_bytes). A message is compressed if it is
+// large enough, if a sample of its payload deflates well enough, and if the
+// time saved on the network outweighs the time spent compressing it.
+//
+// Compression throughput is measured on the samples, and averaged over the
+// messages seen so far.
+class AdaptiveCompression {
+ public:
+  struct Options {
+    // Messages with fewer payload bytes are never compressed.
+    int64 min_bytes = 1 << 20;
+    // Messages are only compressed if their sample compresses to at most this
+    // fraction of its size.
+    double max_ratio = 0.8;
+    // Estimated network throughput. If not positive, only the compression
+    // ratio is considered.
+    double network_bytes_per_sec = 0;
+  };
+
+  // Number of bytes deflated to estimate the compression ratio of a message.
+  static constexpr int64 kMaxSampleBytes = 64 * 1024;
+
+  // Returns nullptr if `rpc_options` disables adaptive compression.
+  static std::unique_ptr<AdaptiveCompression> FromRPCOptions(
+      const RPCOptions& rpc_options);
+
+  AdaptiveCompression(Env* env, const Options& options)
+      : env_(env), options_(options) {}
+
+  // Returns true if a message whose payload is made of `payload` should be
+  // compressed.
+  bool ShouldCompress(const std::vector<StringPiece>& payload);
+
+  // Average compression throughput measured so far, or 0 if unknown.
+  double compression_bytes_per_sec() const;
+
+ private:
+  // Returns the compressed size of `sample`, and records the compression
+  // throughput.
+  size_t Deflate(const string& sample);
+
+  Env* const env_;
+  const Options options_;
+
+  mutable mutex mu_;
+  double compression_bytes_per_sec_ TF_GUARDED_BY(mu_) = 0;
+  int64 num_skipped_ TF_GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AdaptiveCompression);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_ADAPTIVE_COMPRESSION_H_
@@ -0,0 +1,91 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/adaptive_compression.h"
+
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+string RandomBytes(size_t size) {
+  random::PhiloxRandom philox(17, 42);
+  random::SimplePhilox rnd(&philox);
+  string bytes(size, '\0');
+  for (char& c : bytes) {
+    c = static_cast<char>(rnd.Uniform(256));
+  }
+  return bytes;
+}
+
+AdaptiveCompression::Options MakeOptions(double network_bytes_per_sec) {
+  AdaptiveCompression::Options options;
+  options.min_bytes = 1024;
+  options.network_bytes_per_sec = network_bytes_per_sec;
+  return options;
+}
+
+TEST(AdaptiveCompressionTest, SkipsSmallMessages) {
+  AdaptiveCompression compression(Env::Default(), MakeOptions(0));
+  const string zeros(1000, '\0');
+  EXPECT_FALSE(compression.ShouldCompress({zeros}));
+  EXPECT_FALSE(compression.ShouldCompress({}));
+  // Nothing was sampled.
+  EXPECT_EQ(0, compression.compression_bytes_per_sec());
+}
+
+TEST(AdaptiveCompressionTest, CompressesCompressibleMessages) {
+  AdaptiveCompression compression(Env::Default(), MakeOptions(0));
+  const string zeros(1 << 20, '\0');
+  EXPECT_TRUE(compression.ShouldCompress({zeros}));
+  EXPECT_GT(compression.compression_bytes_per_sec(), 0);
+  // The payload can be split in several pieces.
+  EXPECT_TRUE(compression.ShouldCompress({zeros, zeros, StringPiece()}));
+}
+
+TEST(AdaptiveCompressionTest, SkipsIncompressibleMessages) {
+  AdaptiveCompression compression(Env::Default(), MakeOptions(0));
+  const string random = RandomBytes(1 << 20);
+  EXPECT_FALSE(compression.ShouldCompress({random}));
+  // A compressible prefix isn't enough, since the sample is taken from the
+  // whole payload.
+  const string zeros(4096, '\0');
+  EXPECT_FALSE(compression.ShouldCompress({zeros, random}));
+}
+
+TEST(AdaptiveCompressionTest, SkipsMessagesOnFastNetworks) {
+  const string zeros(1 << 20, '\0');
+  // No compressor is faster than 1 PB/s.
+  AdaptiveCompression fast_network(Env::Default(), MakeOptions(1e15));
+  EXPECT_FALSE(fast_network.ShouldCompress({zeros}));
+  // After the first sample, compression is known not to pay off.
+  EXPECT_FALSE(fast_network.ShouldCompress({zeros}));
+
+  // Every compressor is faster than 1 byte/s.
+  AdaptiveCompression slow_network(Env::Default(), MakeOptions(1));
+  EXPECT_TRUE(slow_network.ShouldCompress({zeros}));
+}
+
+TEST(AdaptiveCompressionTest, FromRPCOptions) {
+  RPCOptions rpc_options;
+  EXPECT_EQ(nullptr, AdaptiveCompression::FromRPCOptions(rpc_options));
+  rpc_options.set_adaptive_compression_min_bytes(1024);
+  EXPECT_NE(nullptr, AdaptiveCompression::FromRPCOptions(rpc_options));
+}
+
+}  // namespace
+}  // namespace tensorflow
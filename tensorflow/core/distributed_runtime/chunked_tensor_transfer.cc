@@ -0,0 +1,171 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/distributed_runtime/chunked_tensor_transfer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+
+bool ShouldSendInChunks(const Tensor& tensor, int64 chunk_bytes) {
+  return chunk_bytes > 0 && DataTypeCanUseMemcpy(tensor.dtype()) &&
+         static_cast<int64>(tensor.TotalBytes()) > chunk_bytes;
+}
+
+Status ValidateChunkedTensorExtra(const Tensor& tensor,
+                                  const ChunkedTensorExtra& extra) {
+  const int64 total_bytes = tensor.TotalBytes();
+  if (!DataTypeCanUseMemcpy(tensor.dtype()) || extra.chunk_bytes() <= 0 ||
+      extra.num_chunks() !=
+          (total_bytes + extra.chunk_bytes() - 1) / extra.chunk_bytes()) {
+    return errors::Internal("Invalid chunked transfer of a ",
+                            DataTypeString(tensor.dtype()), " tensor with ",
+                            total_bytes, " bytes: ", extra.ShortDebugString());
+  }
+  return Status::OK();
+}
+
+Status ChunkedTensorTable::Register(int64 step_id, const Tensor& tensor,
+                                    int64 chunk_bytes,
+                                    ChunkedTensorExtra* extra) {
+  if (!ShouldSendInChunks(tensor, chunk_bytes)) {
+    return errors::InvalidArgument("Cannot send a ",
+                                   DataTypeString(tensor.dtype()),
+                                   " tensor with ", tensor.TotalBytes(),
+                                   " bytes in chunks of ", chunk_bytes,
+                                   " bytes");
+  }
+  const int64 total_bytes = tensor.TotalBytes();
+  Transfer transfer;
+  TF_RETURN_IF_ERROR(transfer.bytes.BitcastFrom(tensor, DT_UINT8,
+                                                TensorShape({total_bytes})));
+  transfer.step_id = step_id;
+  transfer.chunk_bytes = chunk_bytes;
+  transfer.num_chunks = (total_bytes + chunk_bytes - 1) / chunk_bytes;
+
+  extra->set_chunk_bytes(chunk_bytes);
+  extra->set_num_chunks(transfer.num_chunks);
+  mutex_lock l(mu_);
+  extra->set_transfer_id(next_transfer_id_++);
+  transfers_.emplace(extra->transfer_id(), std::move(transfer));
+  return Status::OK();
+}
+
+Status ChunkedTensorTable::GetChunk(const RecvTensorChunkRequest& request,
+                                    Tensor* chunk) {
+  mutex_lock l(mu_);
+  auto it = transfers_.find(request.transfer_id());
+  if (it == transfers_.end()) {
+    return errors::NotFound("Unknown chunked tensor transfer ",
+                            request.transfer_id(),
+                            ", its step may have been cleaned up");
+  }
+  Transfer& transfer = it->second;
+  const int64 index = request.chunk_index();
+  if (index < 0 || index >= transfer.num_chunks) {
+    return errors::InvalidArgument("Chunk ", index,
+                                   " is out of range for transfer ",
+                                   request.transfer_id(), " with ",
+                                   transfer.num_chunks, " chunks");
+  }
+  const int64 begin = index * transfer.chunk_bytes;
+  const int64 end =
+      std::min(begin + transfer.chunk_bytes, transfer.bytes.NumElements());
+  *chunk = transfer.bytes.Slice(begin, end);
+  return Status::OK();
+}
+
+Status ChunkedTensorTable::Release(int64 transfer_id) {
+  mutex_lock l(mu_);
+  if (transfers_.erase(transfer_id) == 0) {
+    return errors::NotFound("Unknown chunked tensor transfer ", transfer_id,
+                            ", its step may have been cleaned up");
+  }
+  return Status::OK();
+}
+
+void ChunkedTensorTable::CleanupStep(int64 step_id) {
+  mutex_lock l(mu_);
+  for (auto it = transfers_.begin(); it != transfers_.end();) {
+    if (it->second.step_id == step_id) {
+      it = transfers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t ChunkedTensorTable::size() const {
+  mutex_lock l(mu_);
+  return transfers_.size();
+}
+
+void* TensorChunkResponse::InPlaceAllocator::AllocateRaw(size_t alignment,
+                                                         size_t num_bytes) {
+  if (!allocated_ && num_bytes == size_) {
+    allocated_ = true;
+    return data_;
+  }
+  return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+}
+
+void TensorChunkResponse::InPlaceAllocator::DeallocateRaw(void* ptr) {
+  if (ptr != data_) {
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+}
+
+TensorChunkResponse::ChunkDevice::ChunkDevice(Allocator* allocator)
+    : DeviceBase(Env::Default()), allocator_(allocator) {
+  attributes_.set_name("chunk_in_place");
+  attributes_.set_device_type(DEVICE_CPU);
+}
+
+TensorChunkResponse::TensorChunkResponse(const Tensor& tensor,
+                                         const ChunkedTensorExtra& extra,
+                                         int64 chunk_index)
+    : data_(const_cast<char*>(tensor.tensor_data().data()) +
+            chunk_index * extra.chunk_bytes()),
+      size_(std::min<int64>(extra.chunk_bytes(),
+                            tensor.TotalBytes() -
+                                chunk_index * extra.chunk_bytes())),
+      allocator_(data_, size_),
+      device_(&allocator_) {
+  AllocatorAttributes attr;
+  attr.set_on_host(true);
+  response_.InitAlloc(&device_, attr);
+}
+
+Status TensorChunkResponse::Finish() {
+  const Tensor& chunk = response_.tensor();
+  if (chunk.dtype() != DT_UINT8 || chunk.TotalBytes() != size_) {
+    return errors::Internal("Received a ", DataTypeString(chunk.dtype()),
+                            " chunk with ", chunk.TotalBytes(),
+                            " bytes, expected ", size_, " bytes");
+  }
+  const char* chunk_data = chunk.tensor_data().data();
+  if (chunk_data != data_) {
+    memcpy(data_, chunk_data, size_);
+  }
+  return Status::OK();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,154 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_CHUNKED_TENSOR_TRANSFER_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_CHUNKED_TENSOR_TRANSFER_H_
+
+#include <unordered_map>
+
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+
+namespace tensorflow {
+
+// Helpers to transfer the contents of large tensors received by RecvTensor in
+// several chunk requests (see RPCOptions.recv_tensor_chunk_bytes). The sender
+// replies to the original request with the tensor metadata only, and keeps
+// the tensor in a ChunkedTensorTable. The receiver allocates the destination
+// tensor from the metadata, and fetches the chunks directly into it.
+
+// Maximum number of chunk requests a receiver keeps in flight for a tensor.
+constexpr int kMaxOutstandingChunkRequests = 4;
+
+// Returns true if the contents of `tensor` are sent in chunks of at most
+// `chunk_bytes` bytes, i.e. it has a memcpy-able type and more than
+// `chunk_bytes` bytes of data.
+bool ShouldSendInChunks(const Tensor& tensor, int64 chunk_bytes);
+
+// Returns an error if `extra` does not describe the chunks of the contents of
+// `tensor`.
+Status ValidateChunkedTensorExtra(const Tensor& tensor,
+                                  const ChunkedTensorExtra& extra);
+
+// The tensors whose chunks are served by a worker.
+class ChunkedTensorTable {
+ public:
+  ChunkedTensorTable() {}
+
+  // Keeps a reference to `tensor` until Release() or CleanupStep(step_id) is
+  // called, and fills `extra` with the information the receiver needs to
+  // fetch the chunks.
+  Status Register(int64 step_id, const Tensor& tensor, int64 chunk_bytes,
+                  ChunkedTensorExtra* extra);
+
+  // Returns the requested chunk as a 1-D DT_UINT8 tensor that shares the
+  // buffer of the registered tensor. A chunk may be requested several times,
+  // e.g. if a response was lost.
+  Status GetChunk(const RecvTensorChunkRequest& request, Tensor* chunk);
+
+  // Releases the tensor of transfer `transfer_id`, once the receiver is done
+  // fetching its chunks.
+  Status Release(int64 transfer_id);
+
+  // Releases the tensors registered for `step_id`.
+  void CleanupStep(int64 step_id);
+
+  // Number of tensors that were not released yet.
+  size_t size() const;
+
+ private:
+  struct Transfer {
+    int64 step_id;
+    // The contents of the tensor, as a 1-D DT_UINT8 tensor.
+    Tensor bytes;
+    int64 chunk_bytes;
+    int64 num_chunks;
+  };
+
+  mutable mutex mu_;
+  int64 next_transfer_id_ TF_GUARDED_BY(mu_) = 1;
+  std::unordered_map<int64, Transfer> transfers_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ChunkedTensorTable);
+};
+
+// The destination of a RecvTensor response that carries one chunk of a
+// tensor. The chunk contents are parsed directly into the buffer of the
+// destination tensor.
+class TensorChunkResponse {
+ public:
+  // `tensor` must be allocated in host memory, and outlive this object.
+  // `extra` must have been validated with ValidateChunkedTensorExtra().
+  TensorChunkResponse(const Tensor& tensor, const ChunkedTensorExtra& extra,
+                      int64 chunk_index);
+
+  TensorResponse* response() { return &response_; }
+
+  // Checks the parsed response, and copies the chunk into the destination
+  // tensor if it could not be parsed in place.
+  Status Finish();
+
+ private:
+  // Hands out the chunk's range of the destination buffer for an allocation
+  // of exactly its size, and delegates any other allocation.
+  class InPlaceAllocator : public Allocator {
+   public:
+    InPlaceAllocator(char* data, size_t size) : data_(data), size_(size) {}
+
+    string Name() override { return "chunk_in_place"; }
+    void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+    void DeallocateRaw(void* ptr) override;
+
+   private:
+    char* const data_;
+    const size_t size_;
+    bool allocated_ = false;
+  };
+
+  // A host device that only provides the allocator to `response_`.
+  class ChunkDevice : public DeviceBase {
+   public:
+    explicit ChunkDevice(Allocator* allocator);
+
+    Allocator* GetAllocator(AllocatorAttributes attr) override {
+      return allocator_;
+    }
+    const DeviceAttributes& attributes() const override { return attributes_; }
+
+   private:
+    Allocator* const allocator_;
+    DeviceAttributes attributes_;
+  };
+
+  char* const data_;
+  const size_t size_;
+  InPlaceAllocator allocator_;
+  ChunkDevice device_;
+  // Declared last, so that the parsed chunk is released before the allocator.
+  TensorResponse response_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(TensorChunkResponse);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_CHUNKED_TENSOR_TRANSFER_H_
@@ -0,0 +1,179 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/distributed_runtime/chunked_tensor_transfer.h"
+
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int64 kChunkBytes = 1024;
+
+// A tensor with 4000 bytes of contents, i.e. 3 full chunks and a partial one.
+Tensor MakeTensor() {
+  Tensor tensor(DT_FLOAT, TensorShape({1000}));
+  for (int i = 0; i < 1000; ++i) {
+    tensor.flat<float>()(i) = i;
+  }
+  return tensor;
+}
+
+// Serializes the RecvTensor response the sender would encode for `chunk`.
+string SerializeChunk(const Tensor& chunk) {
+  RecvTensorResponse response;
+  chunk.AsProtoTensorContent(response.mutable_tensor());
+  return response.SerializeAsString();
+}
+
+class StringSource : public TensorResponse::Source {
+ public:
+  explicit StringSource(const string* s) : s_(s) {}
+
+  protobuf::io::ZeroCopyInputStream* contents() override {
+    stream_.reset(new protobuf::io::ArrayInputStream(s_->data(), s_->size()));
+    return stream_.get();
+  }
+
+ private:
+  const string* s_;
+  std::unique_ptr<protobuf::io::ArrayInputStream> stream_;
+};
+
+TEST(ChunkedTensorTransferTest, ShouldSendInChunks) {
+  EXPECT_FALSE(ShouldSendInChunks(MakeTensor(), 0));
+  EXPECT_FALSE(ShouldSendInChunks(MakeTensor(), 4000));
+  EXPECT_TRUE(ShouldSendInChunks(MakeTensor(), 3999));
+  EXPECT_FALSE(ShouldSendInChunks(Tensor(DT_STRING, {1000}), 16));
+}
+
+TEST(ChunkedTensorTransferTest, ServesChunksUntilReleased) {
+  const Tensor tensor = MakeTensor();
+  ChunkedTensorTable table;
+  ChunkedTensorExtra extra;
+  TF_ASSERT_OK(table.Register(/*step_id=*/1, tensor, kChunkBytes, &extra));
+  EXPECT_EQ(kChunkBytes, extra.chunk_bytes());
+  EXPECT_EQ(4, extra.num_chunks());
+  TF_EXPECT_OK(ValidateChunkedTensorExtra(tensor, extra));
+  EXPECT_EQ(1, table.size());
+
+  RecvTensorChunkRequest request;
+  request.set_transfer_id(extra.transfer_id());
+  Tensor chunk;
+  request.set_chunk_index(4);
+  EXPECT_TRUE(errors::IsInvalidArgument(table.GetChunk(request, &chunk)));
+
+  // Chunks can be fetched in any order, and more than once.
+  string contents(tensor.TotalBytes(), '\0');
+  for (int64 index : {3, 1, 1, 0, 2}) {
+    EXPECT_EQ(1, table.size());
+    request.set_chunk_index(index);
+    TF_ASSERT_OK(table.GetChunk(request, &chunk));
+    EXPECT_EQ(DT_UINT8, chunk.dtype());
+    EXPECT_EQ(index == 3 ? 4000 - 3 * kChunkBytes : kChunkBytes,
+              chunk.NumElements());
+    memcpy(&contents[index * kChunkBytes], chunk.tensor_data().data(),
+           chunk.TotalBytes());
+  }
+  EXPECT_EQ(tensor.tensor_data(), contents);
+
+  // A chunk can be fetched again until the receiver releases the transfer.
+  TF_EXPECT_OK(table.GetChunk(request, &chunk));
+  TF_EXPECT_OK(table.Release(extra.transfer_id()));
+  EXPECT_EQ(0, table.size());
+  EXPECT_TRUE(errors::IsNotFound(table.GetChunk(request, &chunk)));
+  EXPECT_TRUE(errors::IsNotFound(table.Release(extra.transfer_id())));
+}
+
+TEST(ChunkedTensorTransferTest, CleanupStep) {
+  ChunkedTensorTable table;
+  ChunkedTensorExtra extra1, extra2;
+  TF_ASSERT_OK(table.Register(/*step_id=*/1, MakeTensor(), kChunkBytes,
+                              &extra1));
+  TF_ASSERT_OK(table.Register(/*step_id=*/2, MakeTensor(), kChunkBytes,
+                              &extra2));
+  EXPECT_NE(extra1.transfer_id(), extra2.transfer_id());
+  table.CleanupStep(1);
+  EXPECT_EQ(1, table.size());
+
+  RecvTensorChunkRequest request;
+  request.set_transfer_id(extra1.transfer_id());
+  Tensor chunk;
+  EXPECT_TRUE(errors::IsNotFound(table.GetChunk(request, &chunk)));
+  request.set_transfer_id(extra2.transfer_id());
+  TF_EXPECT_OK(table.GetChunk(request, &chunk));
+}
+
+TEST(ChunkedTensorTransferTest, RejectsSmallTensors) {
+  ChunkedTensorTable table;
+  ChunkedTensorExtra extra;
+  EXPECT_FALSE(table.Register(/*step_id=*/1, MakeTensor(), 4000, &extra).ok());
+  EXPECT_EQ(0, table.size());
+}
+
+TEST(ChunkedTensorTransferTest, ParsesChunksInPlace) {
+  const Tensor tensor = MakeTensor();
+  ChunkedTensorTable table;
+  ChunkedTensorExtra extra;
+  TF_ASSERT_OK(table.Register(/*step_id=*/1, tensor, kChunkBytes, &extra));
+
+  Tensor received(DT_FLOAT, tensor.shape());
+  RecvTensorChunkRequest request;
+  request.set_transfer_id(extra.transfer_id());
+  for (int64 index = 0; index < extra.num_chunks(); ++index) {
+    request.set_chunk_index(index);
+    Tensor chunk;
+    TF_ASSERT_OK(table.GetChunk(request, &chunk));
+    const string serialized = SerializeChunk(chunk);
+    StringSource source(&serialized);
+    TensorChunkResponse response(received, extra, index);
+    TF_ASSERT_OK(response.response()->ParseFrom(&source));
+    EXPECT_EQ(received.tensor_data().data() + index * kChunkBytes,
+              response.response()->tensor().tensor_data().data());
+    TF_ASSERT_OK(response.Finish());
+  }
+  test::ExpectTensorEqual<float>(tensor, received);
+}
+
+TEST(ChunkedTensorTransferTest, RejectsChunkOfWrongSize) {
+  ChunkedTensorExtra extra;
+  extra.set_chunk_bytes(kChunkBytes);
+  extra.set_num_chunks(4);
+  Tensor received(DT_FLOAT, TensorShape({1000}));
+  TF_ASSERT_OK(ValidateChunkedTensorExtra(received, extra));
+
+  const string serialized = SerializeChunk(Tensor(DT_UINT8, {kChunkBytes}));
+  StringSource source(&serialized);
+  // The last chunk only has 4000 - 3 * 1024 bytes.
+  TensorChunkResponse response(received, extra, /*chunk_index=*/3);
+  TF_ASSERT_OK(response.response()->ParseFrom(&source));
+  EXPECT_TRUE(errors::IsInternal(response.Finish()));
+
+  extra.set_num_chunks(5);
+  EXPECT_TRUE(errors::IsInternal(ValidateChunkedTensorExtra(received, extra)));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -86,6 +86,7 @@ CollectiveParamResolverDistributed::CollectiveParamResolverDistributed(
     DeviceResolverDistributed* dev_resolver, WorkerCacheInterface* worker_cache,
     const string& task_name)
     : CollectiveParamResolverLocal(config, dev_mgr, dev_resolver, task_name),
+      dev_resolver_distributed_(dev_resolver),
       worker_cache_(worker_cache),
       group_leader_(task_name == config.experimental().collective_group_leader()
                         ? ""
@@ -210,16 +211,41 @@ void CollectiveParamResolverDistributed::CompleteInstanceAsync(
       });
 }
 
+void CollectiveParamResolverDistributed::ResetGroups(const Status& s) {
+  CollectiveParamResolverLocal::ResetGroups(s);
+  dev_resolver_distributed_->ClearCache();
+}
+
+string CollectiveParamResolverDistributed::TaskHost(const string& task_name) {
+  string address;
+  if (worker_cache_ == nullptr ||
+      !worker_cache_->GetTaskAddress(task_name, &address)) {
+    return task_name;
+  }
+  // Strip the port, keeping any brackets around an IPv6 address.
+  const size_t colon = address.rfind(':');
+  if (colon != string::npos && address.find(']', colon) == string::npos) {
+    address.resize(colon);
+  }
+  return address;
+}
+
 bool CollectiveParamResolverDistributed::GroupIsCached(int32 group_key) {
   mutex_lock l(group_mu_);
   const auto& it = group_table_.find(group_key);
   return it != group_table_.end();
 }
 
+int64 CollectiveParamResolverDistributed::GroupGeneration() {
+  mutex_lock l(group_mu_);
+  return group_generation_;
+}
+
 Status CollectiveParamResolverDistributed::UpdateGroupCache(
-    const CompleteGroupResponse& resp) {
+    const CompleteGroupResponse& resp, int64 generation) {
   // Build a new record from resp.
   std::unique_ptr<GroupRec> gr(new GroupRec);
+  gr->generation = generation;
   {
     mutex_lock grl(gr->mu);
     gr->group.device_type = DeviceType(resp.device_type());
@@ -248,9 +274,14 @@ Status CollectiveParamResolverDistributed::UpdateGroupCache(
             << absl::CEscape(gr->group.runtime_details.communicator_key);
   }
   {
-    // Group membership should never change. Once a record is in group_table_
-    // it never gets removed.
+    // Group membership only changes through ResetGroups(), which removes every
+    // record from group_table_ and starts a new generation.
     mutex_lock l(group_mu_);
+    if (gr->generation != group_generation_) {
+      return errors::Aborted(
+          "UpdateGroupCache: collective groups were reset while group ",
+          gr->group.group_key, " was being resolved");
+    }
     auto it = group_table_.find(gr->group.group_key);
     if (it == group_table_.end()) {
       VLOG(2) << "UpdateGroupCache: communicator_key="
@@ -282,12 +313,13 @@ void CollectiveParamResolverDistributed::CompleteGroupDistributed(
     return CompleteGroupLocal(device, cp, done);
   } else if (!GroupIsCached(cp->group.group_key)) {
     // Need to update Group cache from the leader.
+    const int64 generation = GroupGeneration();
     CompleteGroupCall* call =
         new CompleteGroupCall(cp->group, device, cp->instance.type, cancel_mgr,
                               group_leader_, worker_cache_);
-    call->Start([this, device, cp, call, done](const Status& s) {
+    call->Start([this, device, cp, call, generation, done](const Status& s) {
       if (s.ok()) {
-        Status status = UpdateGroupCache(call->resp_);
+        Status status = UpdateGroupCache(call->resp_, generation);
         if (status.ok()) {
           CompleteGroupLocal(device, cp, done);
         } else {
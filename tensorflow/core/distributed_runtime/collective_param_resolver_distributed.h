@@ -45,13 +45,28 @@ class CollectiveParamResolverDistributed : public CollectiveParamResolverLocal {
                              CancellationManager* cancel_mgr,
                              const StatusCallback& done) override;
 
+  // Also drops the cached attributes of remote devices, since a task may have
+  // been replaced by one with new device incarnations.
+  void ResetGroups(const Status& s) override;
+
  protected:
+  // Resolves the host from the task's address in the worker cache, so that
+  // tasks sharing a machine map to the same host.  Falls back to the task
+  // name if the address is unknown.
+  string TaskHost(const string& task_name) override;
+
   // Returns true iff there's an entry for this group_key in the
   // local group_table_.
   bool GroupIsCached(int32 group_key) TF_LOCKS_EXCLUDED(group_mu_);
 
-  // Updates group_table_ with contents of resp.
-  Status UpdateGroupCache(const CompleteGroupResponse& resp)
+  // Returns the current group generation, i.e. the number of
+  // ResetGroups() calls so far.
+  int64 GroupGeneration() TF_LOCKS_EXCLUDED(group_mu_);
+
+  // Updates group_table_ with contents of resp, which the leader returned for
+  // a request issued at group generation `generation`. Fails with Aborted if
+  // the groups have been reset since, as resp may describe the old cluster.
+  Status UpdateGroupCache(const CompleteGroupResponse& resp, int64 generation)
       TF_LOCKS_EXCLUDED(group_mu_);
 
   // Finds the GroupRec that corresponds to cp->group_key and also
@@ -83,7 +98,8 @@ class CollectiveParamResolverDistributed : public CollectiveParamResolverLocal {
                                    const StatusCallback& done)
       TF_LOCKS_EXCLUDED(instance_mu_, gr->mu, group_mu_);
 
-  WorkerCacheInterface* worker_cache_;  // Not owned
+  DeviceResolverDistributed* dev_resolver_distributed_;  // Not owned
+  WorkerCacheInterface* worker_cache_;                   // Not owned
   const string group_leader_;
 };
 
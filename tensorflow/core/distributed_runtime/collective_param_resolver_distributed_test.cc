@@ -65,7 +65,45 @@ class FakeWorker : public TestWorkerInterface {
                           const CompleteGroupRequest* request,
                           CompleteGroupResponse* response,
                           StatusCallback done) override {
-    param_resolver_->CompleteGroupAsync(request, response, &cm_, done);
+    param_resolver_->CompleteGroupAsync(
+        request, response, &cm_, [this, done](const Status& s) {
+          {
+            mutex_lock l(mu_);
+            if (hold_complete_group_) {
+              held_complete_group_.push_back([done, s]() { done(s); });
+              held_cv_.notify_all();
+              return;
+            }
+          }
+          done(s);
+        });
+  }
+
+  // Holds the CompleteGroup responses of this worker until
+  // ReleaseCompleteGroups() is called.
+  void HoldCompleteGroups() {
+    mutex_lock l(mu_);
+    hold_complete_group_ = true;
+  }
+
+  // Waits until a CompleteGroup response is held.
+  void WaitForHeldCompleteGroup() {
+    mutex_lock l(mu_);
+    while (held_complete_group_.empty()) {
+      held_cv_.wait(l);
+    }
+  }
+
+  void ReleaseCompleteGroups() {
+    std::vector<std::function<void()>> held;
+    {
+      mutex_lock l(mu_);
+      hold_complete_group_ = false;
+      held.swap(held_complete_group_);
+    }
+    for (const auto& done : held) {
+      done();
+    }
   }
 
   void CompleteInstanceAsync(CallOptions* ops,
@@ -80,6 +118,10 @@ class FakeWorker : public TestWorkerInterface {
   DeviceMgr* device_mgr_;
   CancellationManager cm_;
   CollectiveParamResolverDistributed* param_resolver_;
+  mutex mu_;
+  condition_variable held_cv_;
+  bool hold_complete_group_ TF_GUARDED_BY(mu_) = false;
+  std::vector<std::function<void()>> held_complete_group_ TF_GUARDED_BY(mu_);
 };
 
 class FakeCache : public TestWorkerCache {
@@ -128,8 +170,8 @@ class DeviceResDistTest : public ::testing::Test {
   DeviceResDistTest() {}
 
   ~DeviceResDistTest() override {
-    for (DeviceMgr* dm : device_mgrs_) {
-      delete dm;
+    for (auto it : device_mgrs_) {
+      delete it.second;
     }
     for (auto it : dev_resolvers_) {
       delete it.second;
@@ -165,8 +207,10 @@ class DeviceResDistTest : public ::testing::Test {
           device_type,
           strings::StrCat(worker_name, "/device:", device_type, ":", i)));
     }
-    DeviceMgr* dev_mgr = new StaticDeviceMgr(std::move(devices));
-    device_mgrs_.push_back(dev_mgr);
+    // Use a DynamicDeviceMgr so that tests can add devices to live tasks.
+    DynamicDeviceMgr* dev_mgr = new DynamicDeviceMgr;
+    TF_CHECK_OK(dev_mgr->AddDevices(std::move(devices)));
+    device_mgrs_[worker_name] = dev_mgr;
     std::vector<string>* dv = &dev_by_task_[worker_name];
     for (auto* d : dev_mgr->ListDevices()) {
       dv->push_back(d->name());
@@ -183,6 +227,26 @@ class DeviceResDistTest : public ::testing::Test {
     wc_.AddWorker(worker_name, fw);
   }
 
+  void AddDevice(const string& worker_name, const string& device_type,
+                 int device_index) {
+    const string device_name = strings::StrCat(worker_name, "/device:",
+                                               device_type, ":", device_index);
+    std::vector<std::unique_ptr<Device>> devices;
+    devices.push_back(NewDevice(device_type, device_name));
+    TF_CHECK_OK(device_mgrs_[worker_name]->AddDevices(std::move(devices)));
+    dev_by_task_[worker_name].push_back(device_name);
+  }
+
+  // Waits for the requests issued by IssueRequests and returns their
+  // statuses.
+  std::vector<Status> WaitForRequests(int device_count) {
+    mutex_lock l(mu_);
+    while (num_done_ < device_count) {
+      done_.wait(l);
+    }
+    return status_;
+  }
+
   void DefineCollectiveParams(int num_workers, int num_devices) {
     const int kGroupKey = 5;
     const int kInstanceKey = 3;
@@ -285,7 +349,7 @@ class DeviceResDistTest : public ::testing::Test {
 
   FakeCache wc_;
   CancellationManager cm_;
-  std::vector<DeviceMgr*> device_mgrs_;
+  std::unordered_map<string, DynamicDeviceMgr*> device_mgrs_;
   std::unordered_map<string, DeviceResolverDistributed*> dev_resolvers_;
   std::unordered_map<string, CollectiveParamResolverDistributed*> cp_resolvers_;
   std::unordered_map<string, std::vector<string>> dev_by_task_;
@@ -315,6 +379,64 @@ TEST_F(DeviceResDistTest, Workers2Devices2) {
   ValidateCollectiveParams(num_workers, num_devices);
 }
 
+TEST_F(DeviceResDistTest, ReformGroupWithNewMembership) {
+  DefineWorkers(/*num_workers=*/3, /*num_devices=*/1, "CPU", false);
+  DefineCollectiveParams(3, 1);
+  IssueRequests(3, 1);
+  ValidateCollectiveParams(3, 1);
+
+  // A collective failed because task 2 went away, which aborts the resolvers
+  // of the surviving tasks.
+  const Status failure = errors::Unavailable("task 2 is gone");
+  for (auto it : cp_resolvers_) {
+    it.second->StartAbort(failure);
+  }
+  cp_.clear();
+  DefineCollectiveParams(2, 1);
+  IssueRequests(2, 1);
+  for (const Status& s : WaitForRequests(2)) {
+    EXPECT_TRUE(errors::IsUnavailable(s));
+  }
+
+  // Reform the group with the same key on tasks 0 and 1 only, each of which
+  // gained a device in the meantime.
+  for (auto it : cp_resolvers_) {
+    it.second->ResetGroups(errors::Aborted("Cluster membership changed"));
+  }
+  AddDevice("/job:worker/replica:0/task:0", "CPU", 1);
+  AddDevice("/job:worker/replica:0/task:1", "CPU", 1);
+  cp_.clear();
+  DefineCollectiveParams(2, 2);
+  IssueRequests(2, 2);
+  ValidateCollectiveParams(2, 2);
+}
+
+TEST_F(DeviceResDistTest, DropStaleGroupAfterReset) {
+  DefineWorkers(/*num_workers=*/2, /*num_devices=*/1, "CPU", false);
+  // Hold the leader's answer to task 1 until the groups have been reset.
+  FakeWorker* leader = workers_[0];
+  leader->HoldCompleteGroups();
+  DefineCollectiveParams(2, 1);
+  IssueRequests(2, 1);
+  leader->WaitForHeldCompleteGroup();
+  for (auto it : cp_resolvers_) {
+    it.second->ResetGroups(errors::Aborted("Cluster membership changed"));
+  }
+  leader->ReleaseCompleteGroups();
+  // Task 1 only learns about the group after the reset.
+  std::vector<Status> statuses = WaitForRequests(2);
+  EXPECT_TRUE(errors::IsAborted(statuses[1])) << statuses[1];
+
+  // The stale answer describes the old group, so it must not be cached by
+  // task 1 when the group is formed again with more devices.
+  AddDevice("/job:worker/replica:0/task:0", "CPU", 1);
+  AddDevice("/job:worker/replica:0/task:1", "CPU", 1);
+  cp_.clear();
+  DefineCollectiveParams(2, 2);
+  IssueRequests(2, 2);
+  ValidateCollectiveParams(2, 2);
+}
+
 #if !GOOGLE_CUDA && !TENSORFLOW_USE_ROCM
 namespace {
 // A mock NcclReducer for testing group runtime details initialization with CPU
@@ -129,4 +129,9 @@ Status DeviceResolverDistributed::GetTaskCached(
   return Status::OK();
 }
 
+void DeviceResolverDistributed::ClearCache() {
+  mutex_lock l(mu_);
+  attr_table_.clear();
+}
+
 }  // namespace tensorflow
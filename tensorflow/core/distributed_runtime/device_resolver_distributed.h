@@ -46,6 +46,11 @@ class DeviceResolverDistributed : public DeviceResolverInterface {
   Status GetTaskCached(const string& task,
                        std::vector<DeviceAttributes>* attributes) override;
 
+  // Drops the cached attributes of all remote devices, e.g. after the cluster
+  // was updated and tasks may have restarted. They are fetched again on the
+  // next lookup.
+  void ClearCache() TF_LOCKS_EXCLUDED(mu_);
+
  protected:
   // Loads attr_table_ with device attributes retrieved from remote task.
   void RefreshRemoteAttributes(const string& device, const string& task,
@@ -18,6 +18,7 @@ limitations under the License.
 #include "absl/memory/memory.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/distributed_runtime/test_utils.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
@@ -212,5 +213,41 @@ TEST_F(DeviceResDistTest, Workers3Devices4) {
   }
 }
 
+TEST_F(DeviceResDistTest, ClearCacheAfterRestart) {
+  DefineWorkers(/*num_workers=*/2, /*num_devices=*/2, /*device_type=*/"CPU",
+                /*device_incarnation_base=*/1);
+  const string task0 = "/job:worker/replica:0/task:0";
+  const string task1 = "/job:worker/replica:0/task:1";
+  const string device = strings::StrCat(task1, "/device:CPU:1");
+  DeviceResolverDistributed* dres = resolvers_[task0];
+  auto get_incarnation = [dres, &task1, &device]() {
+    Notification note;
+    Status status;
+    DeviceAttributes attributes;
+    dres->GetDeviceAttributesAsync(device, task1, &attributes,
+                                   [&note, &status](const Status& s) {
+                                     status = s;
+                                     note.Notify();
+                                   });
+    note.WaitForNotification();
+    TF_EXPECT_OK(status);
+    return attributes.incarnation();
+  };
+  EXPECT_EQ(4u, get_incarnation());
+
+  // Restart task 1 with new device incarnations. The attributes cached by
+  // task 0 are stale until the cache is cleared.
+  delete resolvers_[task1];
+  DefineWorker(task1, "CPU", /*num_devices=*/2,
+               /*device_incarnation_base=*/100);
+  EXPECT_EQ(4u, get_incarnation());
+  dres->ClearCache();
+  std::vector<DeviceAttributes> attributes;
+  EXPECT_TRUE(errors::IsNotFound(dres->GetTaskCached(task1, &attributes)));
+  EXPECT_EQ(101u, get_incarnation());
+  TF_EXPECT_OK(dres->GetTaskCached(task1, &attributes));
+  EXPECT_EQ(2, attributes.size());
+}
+
 }  // namespace
 }  // namespace tensorflow
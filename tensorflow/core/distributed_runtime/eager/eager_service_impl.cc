@@ -36,10 +36,12 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_cache_wrapper.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
+#include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/cpu_info.h"
@@ -245,6 +247,7 @@ Status EagerServiceImpl::CreateContext(const CreateContextRequest* request,
   TF_RETURN_IF_ERROR(env_->session_mgr->CreateSession(
       session_name, request->server_def(), request->cluster_device_attributes(),
       true));
+  MaybeResetCollectiveGroups(request->server_def(), request->context_id());
   int64 context_id = request->context_id();
   std::function<void()> session_destroyer = [this, context_id, session_name]() {
     env_->rendezvous_mgr->Cleanup(context_id);
@@ -330,6 +333,25 @@ Status EagerServiceImpl::CreateContext(const CreateContextRequest* request,
   return Status::OK();
 }
 
+void EagerServiceImpl::MaybeResetCollectiveGroups(const ServerDef& server_def,
+                                                  uint64 context_id) {
+  if (!env_->collective_executor_mgr) return;
+  const uint64 fingerprint = DeterministicProtoHash64(server_def.cluster());
+  {
+    mutex_lock l(collective_cluster_mu_);
+    const bool first = !has_collective_cluster_;
+    if (!first && collective_cluster_fingerprint_ == fingerprint) return;
+    has_collective_cluster_ = true;
+    collective_cluster_fingerprint_ = fingerprint;
+    // No group can have been formed before the first context.
+    if (first) return;
+  }
+  VLOG(1) << "Resetting collective groups for the new cluster of context "
+          << context_id;
+  env_->collective_executor_mgr->ResetGroups(errors::Aborted(
+      "Cluster of context ", context_id, " was updated"));
+}
+
 Status EagerServiceImpl::UpdateContext(const UpdateContextRequest* request,
                                        UpdateContextResponse* response) {
   // make sure env_ , env_->rendezvous_mgr available
@@ -402,6 +424,12 @@ Status EagerServiceImpl::UpdateContext(const UpdateContextRequest* request,
     return s;
   }
 
+  // Tasks may have been added, removed or replaced, so collective groups have
+  // to be formed again. Every remote task, including the collective group
+  // leader, resets its groups here; the client rebuilds its collective
+  // executor manager in GrpcServer::UpdateServerDef().
+  MaybeResetCollectiveGroups(request->server_def(), request->context_id());
+
   std::vector<DeviceAttributes> device_attributes;
   device_mgr->ListDeviceAttributes(&device_attributes);
 
@@ -573,8 +601,23 @@ Status EagerServiceImpl::Enqueue(CallOptions* call_opts,
   for (const auto& item : request->queue()) {
     auto* queue_response = response->add_queue_response();
     if (item.has_operation()) {
-      s = ExecuteOp(call_opts, item.operation(), context->Context(), &executor,
+      Operation storage;
+      const Operation* operation = nullptr;
+      if (!context->ResolveCachedAttrs(item.operation(), &storage,
+                                       &operation)) {
+        // Let the client send this operation and the following items again
+        // with their attrs, instead of failing the whole request.
+        VLOG(1) << "Unknown attrs_cache_id "
+                << item.operation().attrs_cache_id() << " for operation "
+                << item.operation().id();
+        queue_response->set_attrs_cache_miss(true);
+        return Status::OK();
+      }
+      s = ExecuteOp(call_opts, *operation, context->Context(), &executor,
                     queue_response);
+      if (s.ok()) {
+        queue_response->set_attrs_cache_id(operation->attrs_cache_id());
+      }
     } else if (item.has_handle_to_decref()) {
       auto handle_to_decref = absl::make_unique<RemoteTensorHandleInternal>(
           item.handle_to_decref());
@@ -750,6 +793,33 @@ Status EagerServiceImpl::SendPackedHandle(
   return Status::OK();
 }
 
+bool EagerServiceImpl::ServerContext::ResolveCachedAttrs(
+    const Operation& operation, Operation* storage,
+    const Operation** resolved) {
+  *resolved = &operation;
+  if (operation.attrs_cache_id() == 0) {
+    return true;
+  }
+  mutex_lock l(attrs_cache_mu_);
+  if (!operation.name().empty()) {
+    Operation& cached = attrs_cache_[operation.attrs_cache_id()];
+    cached.set_name(operation.name());
+    *cached.mutable_attrs() = operation.attrs();
+    cached.set_device(operation.device());
+    return true;
+  }
+  auto it = attrs_cache_.find(operation.attrs_cache_id());
+  if (it == attrs_cache_.end()) {
+    return false;
+  }
+  *storage = operation;
+  storage->set_name(it->second.name());
+  *storage->mutable_attrs() = it->second.attrs();
+  storage->set_device(it->second.device());
+  *resolved = storage;
+  return true;
+}
+
 tensorflow::Status EagerServiceImpl::GetServerContext(
     uint64 context_id, ServerContext** server_context) {
   tf_shared_lock l(contexts_mu_);
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/protobuf/eager_service.pb.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
 
 namespace tensorflow {
 namespace eager {
@@ -153,6 +154,14 @@ class EagerServiceImpl {
       return (destroy_after_micros_ > 0 && time_passed > destroy_after_micros_);
     }
 
+    // Resolves the cached name, attrs and device of `operation` (see
+    // Operation.attrs_cache_id). Sets `*resolved` to `operation` if it doesn't
+    // refer to cached attrs, and otherwise to a copy of `operation` in
+    // `*storage` with the cached attrs filled in. Returns false if the attrs
+    // of `operation` are not cached.
+    bool ResolveCachedAttrs(const Operation& operation, Operation* storage,
+                            const Operation** resolved);
+
    private:
     // The context for this execution.
     tensorflow::EagerContext* ctx_;
@@ -164,6 +173,11 @@ class EagerServiceImpl {
     int64 destroy_after_micros_;
 
     const bool is_master_;
+
+    mutex attrs_cache_mu_;
+    // Operations that only have their name, attrs and device set.
+    std::unordered_map<int64, Operation> attrs_cache_
+        TF_GUARDED_BY(attrs_cache_mu_);
   };
   // The returned ServerContext will need to be Unrefed.
   tensorflow::Status GetServerContext(uint64, ServerContext**);
@@ -218,8 +232,21 @@ class EagerServiceImpl {
   Status RegisterFunction(const RegisterFunctionOp& register_function,
                           EagerContext* eager_context);
   Status CleanupFunction(const CleanupFunctionOp& cleanup_function);
+  // Resets the collective groups of this worker the first time a context of
+  // a cluster other than the one the groups were formed in is created or
+  // updated.  Every client of a multi-client cluster updates its own context,
+  // so only the first update to a new cluster may reset the groups.
+  void MaybeResetCollectiveGroups(const ServerDef& server_def,
+                                  uint64 context_id);
   const WorkerEnv* const env_;  // Not owned.
 
+  mutex collective_cluster_mu_;
+  // Fingerprint of the cluster of the last context created or updated, if
+  // any.
+  bool has_collective_cluster_ TF_GUARDED_BY(collective_cluster_mu_) = false;
+  uint64 collective_cluster_fingerprint_
+      TF_GUARDED_BY(collective_cluster_mu_) = 0;
+
   mutex contexts_mu_;
   std::unordered_map<uint64, ServerContext*> contexts_
       TF_GUARDED_BY(contexts_mu_);
@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/c/c_api_internal.h"
 #include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
 #include "tensorflow/core/common_runtime/eager/tensor_handle.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
 #include "tensorflow/core/distributed_runtime/eager/cluster_function_library_runtime.h"
 #include "tensorflow/core/distributed_runtime/eager/remote_mgr.h"
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
@@ -35,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/cluster.pb.h"
 #include "tensorflow/core/protobuf/eager_service.pb.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/protobuf/remote_tensor_handle.pb.h"
@@ -462,6 +464,79 @@ TEST_F(EagerServiceImplTest, BasicTest) {
                                                &close_context_response));
 }
 
+// Test that an operation whose cached attrs are unknown is reported in its
+// queue response, and stops the execution of the request.
+TEST_F(EagerServiceImplTest, UnknownAttrsCacheIdTest) {
+  TestEagerServiceImpl eager_service_impl(&worker_env_);
+
+  uint64 context_id = random::New64();
+
+  CreateContextRequest request;
+  request.mutable_server_def()->set_job_name("localhost");
+  request.mutable_server_def()->set_task_index(0);
+  request.set_context_id(context_id);
+  CreateContextResponse response;
+
+  TF_ASSERT_OK(eager_service_impl.CreateContext(&request, &response));
+
+  std::unordered_map<string, AttrValue> const_attrs;
+  AttrValue val;
+  val.set_type(tensorflow::DataType::DT_FLOAT);
+  const_attrs.insert({"dtype", val});
+  val.Clear();
+  SetTensorProto(val.mutable_tensor());
+  const_attrs.insert({"value", val});
+  const string device = "/job:localhost/replica:0/task:0/device:CPU:0";
+
+  EnqueueRequest remote_enqueue_request;
+  remote_enqueue_request.set_context_id(context_id);
+  for (int64 id = 1; id <= 4; ++id) {
+    AddOperationToEnqueueRequest(id, "Const", {}, const_attrs, device,
+                                 &remote_enqueue_request);
+  }
+  // The first operation defines the cached attrs, which the second one uses.
+  // The third one refers to attrs that the worker doesn't have.
+  remote_enqueue_request.mutable_queue(0)
+      ->mutable_operation()
+      ->set_attrs_cache_id(1);
+  Operation* cached =
+      remote_enqueue_request.mutable_queue(1)->mutable_operation();
+  cached->set_attrs_cache_id(1);
+  cached->clear_name();
+  cached->clear_attrs();
+  cached->clear_device();
+  Operation* unknown =
+      remote_enqueue_request.mutable_queue(2)->mutable_operation();
+  unknown->set_attrs_cache_id(2);
+  unknown->clear_name();
+  unknown->clear_attrs();
+  unknown->clear_device();
+
+  EnqueueResponse remote_enqueue_response;
+  TF_ASSERT_OK(eager_service_impl.Enqueue(nullptr, &remote_enqueue_request,
+                                          &remote_enqueue_response));
+  ASSERT_EQ(3, remote_enqueue_response.queue_response_size());
+  EXPECT_EQ(1, remote_enqueue_response.queue_response(0).attrs_cache_id());
+  EXPECT_EQ(1, remote_enqueue_response.queue_response(1).attrs_cache_id());
+  EXPECT_TRUE(remote_enqueue_response.queue_response(2).attrs_cache_miss());
+
+  tensorflow::TensorHandle* tensor_handle;
+  TF_EXPECT_OK(eager_service_impl.GetTensorHandle(
+      context_id, RemoteTensorHandleInternal(2, 0), &tensor_handle));
+  EXPECT_FALSE(eager_service_impl
+                   .GetTensorHandle(context_id,
+                                    RemoteTensorHandleInternal(4, 0),
+                                    &tensor_handle)
+                   .ok());
+
+  CloseContextRequest close_context_request;
+  close_context_request.set_context_id(context_id);
+  close_context_request.set_context_view_id(0);
+  CloseContextResponse close_context_response;
+  TF_ASSERT_OK(eager_service_impl.CloseContext(&close_context_request,
+                                               &close_context_response));
+}
+
 class EagerServiceImplFunctionTest : public EagerServiceImplTest {
  public:
   EagerServiceImplFunctionTest() : EagerServiceImplTest() {}
@@ -1302,6 +1377,81 @@ TEST_F(EagerServiceImplTest, KeepAliveTest) {
       eager_service_impl.KeepAlive(&keep_alive_request, &keep_alive_response));
 }
 
+// Records the group resets requested by the eager service.
+class RecordingCollectiveExecutorMgr : public TestCollectiveExecutorMgr {
+ public:
+  void ResetGroups(const Status& s) override { reset_statuses_.push_back(s); }
+
+  std::vector<Status> reset_statuses_;
+};
+
+TEST_F(EagerServiceImplTest, UpdateContextResetsCollectiveGroups) {
+  auto* collective_executor_mgr = new RecordingCollectiveExecutorMgr;
+  worker_env_.collective_executor_mgr.reset(collective_executor_mgr);
+  TestEagerServiceImpl eager_service_impl(&worker_env_);
+
+  uint64 context_id = random::New64();
+  CreateContextRequest request;
+  request.mutable_server_def()->set_job_name("localhost");
+  request.mutable_server_def()->set_task_index(0);
+  request.set_context_id(context_id);
+  CreateContextResponse response;
+  TF_ASSERT_OK(eager_service_impl.CreateContext(&request, &response));
+
+  // An update that is irrelevant to this worker keeps the groups.
+  UpdateContextRequest update_request;
+  *update_request.mutable_server_def() = request.server_def();
+  update_request.set_context_id(context_id);
+  update_request.set_context_view_id(1);
+  UpdateContextResponse update_response;
+  TF_ASSERT_OK(
+      eager_service_impl.UpdateContext(&update_request, &update_response));
+  EXPECT_TRUE(collective_executor_mgr->reset_statuses_.empty());
+
+  // So does an update that keeps the cluster.
+  update_request.set_context_view_id(2);
+  std::vector<DeviceAttributes> device_attributes;
+  device_mgr_->ListDeviceAttributes(&device_attributes);
+  for (const auto& da : device_attributes) {
+    *update_request.add_cluster_device_attributes() = da;
+  }
+  TF_ASSERT_OK(
+      eager_service_impl.UpdateContext(&update_request, &update_response));
+  EXPECT_TRUE(collective_executor_mgr->reset_statuses_.empty());
+
+  // The first update to a new cluster resets the groups.
+  JobDef* job_def =
+      update_request.mutable_server_def()->mutable_cluster()->add_job();
+  job_def->set_name("localhost");
+  (*job_def->mutable_tasks())[0] = "localhost:1";
+  update_request.set_context_view_id(3);
+  TF_ASSERT_OK(
+      eager_service_impl.UpdateContext(&update_request, &update_response));
+  ASSERT_EQ(collective_executor_mgr->reset_statuses_.size(), 1);
+  EXPECT_TRUE(errors::IsAborted(collective_executor_mgr->reset_statuses_[0]));
+
+  // Another client joins or moves to the same cluster, which keeps the groups
+  // that may already have been formed in it.
+  uint64 other_context_id = random::New64();
+  *request.mutable_server_def() = update_request.server_def();
+  request.set_context_id(other_context_id);
+  TF_ASSERT_OK(eager_service_impl.CreateContext(&request, &response));
+  update_request.set_context_id(other_context_id);
+  update_request.set_context_view_id(1);
+  TF_ASSERT_OK(
+      eager_service_impl.UpdateContext(&update_request, &update_response));
+  EXPECT_EQ(collective_executor_mgr->reset_statuses_.size(), 1);
+
+  for (uint64 id : {context_id, other_context_id}) {
+    CloseContextRequest close_context_request;
+    close_context_request.set_context_id(id);
+    close_context_request.set_context_view_id(id == context_id ? 3 : 1);
+    CloseContextResponse close_context_response;
+    TF_ASSERT_OK(eager_service_impl.CloseContext(&close_context_request,
+                                                 &close_context_response));
+  }
+}
+
 }  // namespace
 }  // namespace eager
 }  // namespace tensorflow
@@ -0,0 +1,265 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/distributed_runtime/eager/enqueue_batcher.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace eager {
+
+constexpr int EnqueueBatcher::kMaxBatchItems;
+constexpr int EnqueueBatcher::kMaxCachedAttrs;
+
+void EnqueueBatcher::EnqueueAsync(const EnqueueRequest* request,
+                                  EnqueueResponse* response,
+                                  StatusCallback done) {
+  std::unique_ptr<Batch> batch_to_send;
+  bool closed;
+  Status closed_status;
+  {
+    mutex_lock l(mu_);
+    closed = closed_;
+    if (closed) {
+      closed_status = closed_status_;
+    } else {
+      AddRequest(request, response, std::move(done));
+      if (!in_flight_) {
+        in_flight_ = true;
+        batch_to_send = std::move(pending_.front());
+        pending_.pop_front();
+      }
+    }
+  }
+  if (closed) {
+    done(closed_status);
+    return;
+  }
+  if (batch_to_send != nullptr) {
+    Send(std::move(batch_to_send));
+  }
+}
+
+void EnqueueBatcher::AddRequest(const EnqueueRequest* request,
+                                EnqueueResponse* response,
+                                StatusCallback done) {
+  if (pending_.empty() ||
+      pending_.back()->request.queue_size() >= kMaxBatchItems) {
+    pending_.push_back(absl::make_unique<Batch>());
+    pending_.back()->request.set_context_id(request->context_id());
+  }
+  Batch* batch = pending_.back().get();
+  DCHECK_EQ(batch->request.context_id(), request->context_id());
+  const int begin = batch->request.queue_size();
+  for (const QueueItem& item : request->queue()) {
+    if (item.has_operation()) {
+      AddOperation(item.operation(), batch);
+    } else {
+      *batch->request.add_queue() = item;
+    }
+  }
+  batch->callers.push_back(
+      {response, std::move(done), begin, batch->request.queue_size()});
+}
+
+void EnqueueBatcher::Close(const Status& status,
+                           std::function<void()> on_idle) {
+  DCHECK(!status.ok());
+  std::deque<std::unique_ptr<Batch>> pending;
+  bool idle;
+  {
+    mutex_lock l(mu_);
+    if (closed_) return;
+    closed_ = true;
+    closed_status_ = status;
+    pending.swap(pending_);
+    idle = !in_flight_;
+    if (!idle) {
+      on_idle_ = std::move(on_idle);
+    }
+  }
+  for (auto& batch : pending) {
+    for (Batch::Caller& caller : batch->callers) {
+      caller.done(status);
+    }
+  }
+  if (idle) {
+    on_idle();
+  }
+}
+
+void EnqueueBatcher::AddOperation(const Operation& operation, Batch* batch) {
+  Operation* added = batch->request.add_queue()->mutable_operation();
+  *added = operation;
+  if (operation.is_component_function() || operation.name().empty()) {
+    return;
+  }
+
+  Operation attrs_only;
+  *attrs_only.mutable_attrs() = operation.attrs();
+  string key = absl::StrCat(operation.name(), ";", operation.device(), ";");
+  string serialized_attrs;
+  if (!SerializeToStringDeterministic(attrs_only, &serialized_attrs)) {
+    return;
+  }
+  key.append(serialized_attrs);
+
+  auto it = attrs_cache_.find(key);
+  if (it == attrs_cache_.end()) {
+    if (attrs_cache_.size() >= kMaxCachedAttrs) return;
+    it = attrs_cache_.emplace(key, CachedAttrs{next_attrs_id_++}).first;
+    Operation& attrs = it->second.attrs;
+    attrs.set_name(operation.name());
+    *attrs.mutable_attrs() = operation.attrs();
+    attrs.set_device(operation.device());
+  }
+  CachedAttrs* cached = &it->second;
+  added->set_attrs_cache_id(cached->id);
+  // Keep sending the attrs until the worker acknowledged them, since the
+  // request that defines them may still be in flight, or may fail.
+  if (cached->acknowledged) {
+    added->clear_name();
+    added->clear_attrs();
+    added->clear_device();
+  }
+  batch->cached_items.emplace_back(batch->request.queue_size() - 1, cached);
+}
+
+/*static*/ std::unique_ptr<EnqueueBatcher::Batch>
+EnqueueBatcher::TakeUnexecutedItems(int num_executed, Batch* batch) {
+  auto unexecuted = absl::make_unique<Batch>();
+  unexecuted->request.set_context_id(batch->request.context_id());
+  for (int i = num_executed; i < batch->request.queue_size(); ++i) {
+    unexecuted->request.add_queue()->Swap(batch->request.mutable_queue(i));
+  }
+  for (const auto& item : batch->cached_items) {
+    if (item.first < num_executed) continue;
+    const int index = item.first - num_executed;
+    Operation* operation =
+        unexecuted->request.mutable_queue(index)->mutable_operation();
+    operation->set_name(item.second->attrs.name());
+    *operation->mutable_attrs() = item.second->attrs.attrs();
+    operation->set_device(item.second->attrs.device());
+    unexecuted->cached_items.emplace_back(index, item.second);
+  }
+
+  std::vector<Batch::Caller> executed_callers;
+  for (Batch::Caller& caller : batch->callers) {
+    if (caller.end <= num_executed) {
+      executed_callers.push_back(std::move(caller));
+      continue;
+    }
+    for (int i = caller.begin; i < num_executed; ++i) {
+      caller.response->add_queue_response()->Swap(
+          batch->response.mutable_queue_response(i));
+    }
+    unexecuted->callers.push_back(
+        {caller.response, std::move(caller.done),
+         std::max(caller.begin, num_executed) - num_executed,
+         caller.end - num_executed});
+  }
+  batch->callers.swap(executed_callers);
+  return unexecuted;
+}
+
+void EnqueueBatcher::Send(std::unique_ptr<Batch> batch) {
+  VLOG(3) << "Sending a batch of " << batch->request.queue_size()
+          << " queue items from " << batch->callers.size() << " requests";
+  Batch* raw_batch = batch.release();
+  send_(&raw_batch->request, &raw_batch->response,
+        [this, raw_batch](const Status& status) {
+          BatchDone(std::unique_ptr<Batch>(raw_batch), status);
+        });
+}
+
+void EnqueueBatcher::BatchDone(std::unique_ptr<Batch> batch, Status status) {
+  int num_executed = batch->response.queue_response_size();
+  const bool attrs_cache_miss =
+      status.ok() && num_executed > 0 &&
+      batch->response.queue_response(num_executed - 1).attrs_cache_miss();
+  if (attrs_cache_miss) {
+    --num_executed;
+  } else if (status.ok() && num_executed != batch->request.queue_size()) {
+    status = errors::Internal("Expected ", batch->request.queue_size(),
+                              " queue responses, got ", num_executed);
+  }
+  std::unique_ptr<Batch> next_batch;
+  std::function<void()> on_idle;
+  // The status of the callers of items that were not executed because of an
+  // attrs cache miss, if they are not sent again.
+  Status unexecuted_status;
+  {
+    mutex_lock l(mu_);
+    if (attrs_cache_miss) {
+      VLOG(1) << "The remote worker lost the cached attrs of context "
+              << batch->request.context_id() << ", sending them again";
+      for (auto& entry : attrs_cache_) {
+        entry.second.acknowledged = false;
+      }
+      if (closed_) {
+        unexecuted_status = closed_status_;
+      } else {
+        // Send the rest of the batch before the pending batches, to keep the
+        // order of the items.
+        next_batch = TakeUnexecutedItems(num_executed, batch.get());
+      }
+    } else if (status.ok()) {
+      for (const auto& item : batch->cached_items) {
+        if (batch->response.queue_response(item.first).attrs_cache_id() ==
+            item.second->id) {
+          item.second->acknowledged = true;
+        }
+      }
+    }
+    if (next_batch == nullptr) {
+      if (pending_.empty()) {
+        in_flight_ = false;
+        on_idle = std::move(on_idle_);
+      } else {
+        next_batch = std::move(pending_.front());
+        pending_.pop_front();
+      }
+    }
+  }
+  // Send the next batch before running the callbacks, which may release the
+  // last reference to the owner of this object.
+  if (next_batch != nullptr) {
+    Send(std::move(next_batch));
+  }
+  // May delete this object, so don't touch any member from here on.
+  if (on_idle != nullptr) {
+    on_idle();
+  }
+  for (Batch::Caller& caller : batch->callers) {
+    const Status& caller_status = attrs_cache_miss && caller.end > num_executed
+                                      ? unexecuted_status
+                                      : status;
+    if (caller_status.ok()) {
+      for (int i = caller.begin; i < caller.end; ++i) {
+        caller.response->add_queue_response()->Swap(
+            batch->response.mutable_queue_response(i));
+      }
+    }
+    caller.done(caller_status);
+  }
+}
+
+}  // namespace eager
+}  // namespace tensorflow
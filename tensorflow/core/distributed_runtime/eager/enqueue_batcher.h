@@ -0,0 +1,136 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_EAGER_ENQUEUE_BATCHER_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_EAGER_ENQUEUE_BATCHER_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/eager_service.pb.h"
+
+namespace tensorflow {
+namespace eager {
+
+// Coalesces the EnqueueRequests of one remote context into fewer RPCs. A
+// request is sent right away if no earlier request is in flight. Otherwise,
+// its items are appended to a pending batch, which is sent as a single
+// request when the one in flight completes.
+//
+// In addition, the name, attrs and device of the operations are cached on
+// the remote worker under a compact id (see Operation.attrs_cache_id), and
+// omitted from operations with the same name, attrs and device once the
+// worker acknowledged them. If the worker reports that it doesn't have the
+// attrs of an operation, the operation and the rest of its batch are sent
+// again, before any other batch, with their attrs.
+//
+// Like the requests of a streaming call, all the requests of a batch fail if
+// one of them fails.
+class EnqueueBatcher {
+ public:
+  // Sends `request` and fills `response`.
+  using SendFn = std::function<void(const EnqueueRequest* request,
+                                    EnqueueResponse* response,
+                                    StatusCallback done)>;
+
+  // Maximum number of queue items in a batch.
+  static constexpr int kMaxBatchItems = 256;
+  // Maximum number of distinct operation attrs that are cached.
+  static constexpr int kMaxCachedAttrs = 16384;
+
+  explicit EnqueueBatcher(SendFn send) : send_(std::move(send)) {}
+
+  // Sends the items of `request` in the next batch, and calls `done` with the
+  // status of the batch once `response` was filled with the responses of the
+  // items. `request` can be deleted as soon as this method returns.
+  void EnqueueAsync(const EnqueueRequest* request, EnqueueResponse* response,
+                    StatusCallback done);
+
+  // Fails the requests that were not sent yet, and every later request, with
+  // `status`, e.g. once the remote context was closed. `on_idle` is called as
+  // soon as no batch is in flight, which may be before this method returns,
+  // and may delete this object. Only the first call has an effect.
+  void Close(const Status& status, std::function<void()> on_idle);
+
+ private:
+  struct CachedAttrs {
+    int64 id;
+    // The name, attrs and device, to send them again if the worker lost them.
+    Operation attrs;
+    // True once the worker has cached the attrs.
+    bool acknowledged = false;
+  };
+
+  struct Batch {
+    EnqueueRequest request;
+    EnqueueResponse response;
+    struct Caller {
+      EnqueueResponse* response;
+      StatusCallback done;
+      // Range of the items of the caller in `request`.
+      int begin;
+      int end;
+    };
+    std::vector<Caller> callers;
+    // Items that refer to cached attrs, and the corresponding cache entries.
+    std::vector<std::pair<int, CachedAttrs*>> cached_items;
+  };
+
+  // Appends the items of `request` to the last pending batch, or to a new
+  // one if it is full.
+  void AddRequest(const EnqueueRequest* request, EnqueueResponse* response,
+                  StatusCallback done) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Appends `operation` to `batch`, replacing its name, attrs and device by
+  // an id if the worker already cached them.
+  void AddOperation(const Operation& operation, Batch* batch)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Moves the items of `batch` from `num_executed` on, with their attrs, and
+  // their callers to a new batch. The callers of both executed and moved
+  // items receive the responses of the executed ones right away.
+  static std::unique_ptr<Batch> TakeUnexecutedItems(int num_executed,
+                                                    Batch* batch);
+
+  void Send(std::unique_ptr<Batch> batch);
+  void BatchDone(std::unique_ptr<Batch> batch, Status status);
+
+  const SendFn send_;
+
+  mutex mu_;
+  bool in_flight_ TF_GUARDED_BY(mu_) = false;
+  std::deque<std::unique_ptr<Batch>> pending_ TF_GUARDED_BY(mu_);
+  bool closed_ TF_GUARDED_BY(mu_) = false;
+  Status closed_status_ TF_GUARDED_BY(mu_);
+  // Set by Close() while a batch is in flight.
+  std::function<void()> on_idle_ TF_GUARDED_BY(mu_);
+  // Keyed by the name, device and serialized attrs of an operation.
+  std::unordered_map<string, CachedAttrs> attrs_cache_ TF_GUARDED_BY(mu_);
+  int64 next_attrs_id_ TF_GUARDED_BY(mu_) = 1;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(EnqueueBatcher);
+};
+
+}  // namespace eager
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_EAGER_ENQUEUE_BATCHER_H_
@@ -0,0 +1,277 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/eager/enqueue_batcher.h"
+
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace eager {
+namespace {
+
+// Records the batches sent by an EnqueueBatcher and completes them on demand.
+class FakeWorker {
+ public:
+  EnqueueBatcher::SendFn SendFn() {
+    return [this](const EnqueueRequest* request, EnqueueResponse* response,
+                  StatusCallback done) {
+      sent_.push_back({*request, response, std::move(done)});
+    };
+  }
+
+  int num_sent() const { return sent_.size(); }
+  const EnqueueRequest& request(int i) const { return sent_[i].request; }
+
+  // Completes the i-th batch, echoing the attrs cache id of every operation.
+  void Complete(int i, const Status& status = Status::OK()) {
+    Sent& sent = sent_[i];
+    for (const QueueItem& item : sent.request.queue()) {
+      QueueResponse* queue_response = sent.response->add_queue_response();
+      queue_response->set_attrs_cache_id(item.operation().attrs_cache_id());
+      queue_response->add_shape()->add_dim()->set_size(
+          item.operation().id());
+    }
+    StatusCallback done = std::move(sent.done);
+    done(status);
+  }
+
+  // Completes the i-th batch as a worker that executed its first
+  // `num_executed` items and then didn't find the cached attrs of the next.
+  void CompleteWithAttrsCacheMiss(int i, int num_executed) {
+    Sent& sent = sent_[i];
+    for (int j = 0; j < num_executed; ++j) {
+      const Operation& operation = sent.request.queue(j).operation();
+      QueueResponse* queue_response = sent.response->add_queue_response();
+      queue_response->set_attrs_cache_id(operation.attrs_cache_id());
+      queue_response->add_shape()->add_dim()->set_size(operation.id());
+    }
+    sent.response->add_queue_response()->set_attrs_cache_miss(true);
+    StatusCallback done = std::move(sent.done);
+    done(Status::OK());
+  }
+
+ private:
+  struct Sent {
+    EnqueueRequest request;
+    EnqueueResponse* response;
+    StatusCallback done;
+  };
+  std::vector<Sent> sent_;
+};
+
+EnqueueRequest MakeRequest(int64 op_id) {
+  EnqueueRequest request;
+  request.set_context_id(1);
+  Operation* op = request.add_queue()->mutable_operation();
+  op->set_id(op_id);
+  op->set_name("MatMul");
+  op->set_device("/job:worker/replica:0/task:0/device:CPU:0");
+  (*op->mutable_attrs())["transpose_a"].set_b(false);
+  return request;
+}
+
+TEST(EnqueueBatcherTest, CoalescesRequestsWhileInFlight) {
+  FakeWorker worker;
+  EnqueueBatcher batcher(worker.SendFn());
+
+  EnqueueResponse responses[3];
+  Status statuses[3];
+  for (int i = 0; i < 3; ++i) {
+    const EnqueueRequest request = MakeRequest(i);
+    batcher.EnqueueAsync(&request, &responses[i],
+                         [&statuses, i](const Status& s) { statuses[i] = s; });
+  }
+  // The first request is sent right away, the others wait for it.
+  ASSERT_EQ(1, worker.num_sent());
+  EXPECT_EQ(1, worker.request(0).queue_size());
+
+  worker.Complete(0);
+  TF_EXPECT_OK(statuses[0]);
+  ASSERT_EQ(1, responses[0].queue_response_size());
+  EXPECT_EQ(0, responses[0].queue_response(0).shape(0).dim(0).size());
+
+  ASSERT_EQ(2, worker.num_sent());
+  EXPECT_EQ(2, worker.request(1).queue_size());
+  worker.Complete(1);
+  for (int i = 1; i < 3; ++i) {
+    TF_EXPECT_OK(statuses[i]);
+    ASSERT_EQ(1, responses[i].queue_response_size());
+    EXPECT_EQ(i, responses[i].queue_response(0).shape(0).dim(0).size());
+  }
+}
+
+TEST(EnqueueBatcherTest, OmitsAttrsOnceCached) {
+  FakeWorker worker;
+  EnqueueBatcher batcher(worker.SendFn());
+
+  for (int i = 0; i < 3; ++i) {
+    const EnqueueRequest request = MakeRequest(i);
+    EnqueueResponse response;
+    batcher.EnqueueAsync(&request, &response, [](const Status& s) {});
+    worker.Complete(i);
+  }
+  ASSERT_EQ(3, worker.num_sent());
+
+  const Operation& first = worker.request(0).queue(0).operation();
+  EXPECT_NE(0, first.attrs_cache_id());
+  EXPECT_EQ("MatMul", first.name());
+  EXPECT_EQ(1, first.attrs_size());
+  for (int i = 1; i < 3; ++i) {
+    const Operation& op = worker.request(i).queue(0).operation();
+    EXPECT_EQ(i, op.id());
+    EXPECT_EQ(first.attrs_cache_id(), op.attrs_cache_id());
+    EXPECT_TRUE(op.name().empty());
+    EXPECT_TRUE(op.device().empty());
+    EXPECT_EQ(0, op.attrs_size());
+  }
+}
+
+TEST(EnqueueBatcherTest, KeepsAttrsUntilAcknowledged) {
+  FakeWorker worker;
+  EnqueueBatcher batcher(worker.SendFn());
+
+  EnqueueResponse response;
+  const EnqueueRequest request = MakeRequest(0);
+  batcher.EnqueueAsync(&request, &response, [](const Status& s) {});
+  worker.Complete(0, errors::Unavailable("Connection reset"));
+
+  batcher.EnqueueAsync(&request, &response, [](const Status& s) {});
+  ASSERT_EQ(2, worker.num_sent());
+  EXPECT_EQ("MatMul", worker.request(1).queue(0).operation().name());
+  EXPECT_EQ(1, worker.request(1).queue(0).operation().attrs_size());
+}
+
+TEST(EnqueueBatcherTest, ResendsAttrsAfterCacheMiss) {
+  FakeWorker worker;
+  EnqueueBatcher batcher(worker.SendFn());
+
+  EnqueueResponse responses[4];
+  Status statuses[4];
+  auto enqueue = [&batcher, &responses, &statuses](int i) {
+    const EnqueueRequest request = MakeRequest(i);
+    batcher.EnqueueAsync(&request, &responses[i],
+                         [&statuses, i](const Status& s) { statuses[i] = s; });
+  };
+  enqueue(0);
+  worker.Complete(0);
+  enqueue(1);
+  enqueue(2);
+  enqueue(3);
+  ASSERT_EQ(2, worker.num_sent());
+  EXPECT_TRUE(worker.request(1).queue(0).operation().name().empty());
+
+  // The worker lost its cache: the operation is sent again with its attrs,
+  // before the pending batch.
+  worker.CompleteWithAttrsCacheMiss(1, /*num_executed=*/0);
+  EXPECT_EQ(0, responses[1].queue_response_size());
+  ASSERT_EQ(3, worker.num_sent());
+  ASSERT_EQ(1, worker.request(2).queue_size());
+  const Operation& resent = worker.request(2).queue(0).operation();
+  EXPECT_EQ(1, resent.id());
+  EXPECT_EQ("MatMul", resent.name());
+  EXPECT_EQ(1, resent.attrs_size());
+  EXPECT_EQ(worker.request(0).queue(0).operation().attrs_cache_id(),
+            resent.attrs_cache_id());
+  worker.Complete(2);
+  TF_EXPECT_OK(statuses[1]);
+  ASSERT_EQ(1, responses[1].queue_response_size());
+  EXPECT_EQ(1, responses[1].queue_response(0).shape(0).dim(0).size());
+
+  // Only the operations that were not executed are sent again, and the
+  // callers of the executed ones are done.
+  ASSERT_EQ(4, worker.num_sent());
+  EXPECT_EQ(2, worker.request(3).queue_size());
+  worker.CompleteWithAttrsCacheMiss(3, /*num_executed=*/1);
+  TF_EXPECT_OK(statuses[2]);
+  ASSERT_EQ(1, responses[2].queue_response_size());
+  EXPECT_EQ(2, responses[2].queue_response(0).shape(0).dim(0).size());
+  ASSERT_EQ(5, worker.num_sent());
+  ASSERT_EQ(1, worker.request(4).queue_size());
+  EXPECT_EQ(3, worker.request(4).queue(0).operation().id());
+  EXPECT_EQ("MatMul", worker.request(4).queue(0).operation().name());
+  worker.Complete(4);
+  TF_EXPECT_OK(statuses[3]);
+  ASSERT_EQ(1, responses[3].queue_response_size());
+  EXPECT_EQ(3, responses[3].queue_response(0).shape(0).dim(0).size());
+}
+
+TEST(EnqueueBatcherTest, ErrorFailsEveryRequestOfTheBatch) {
+  FakeWorker worker;
+  EnqueueBatcher batcher(worker.SendFn());
+
+  EnqueueResponse responses[3];
+  Status statuses[3];
+  for (int i = 0; i < 3; ++i) {
+    const EnqueueRequest request = MakeRequest(i);
+    batcher.EnqueueAsync(&request, &responses[i],
+                         [&statuses, i](const Status& s) { statuses[i] = s; });
+  }
+  worker.Complete(0);
+  worker.Complete(1, errors::Internal("Op failed"));
+
+  TF_EXPECT_OK(statuses[0]);
+  for (int i = 1; i < 3; ++i) {
+    EXPECT_EQ(error::INTERNAL, statuses[i].code());
+    EXPECT_EQ(0, responses[i].queue_response_size());
+  }
+}
+
+TEST(EnqueueBatcherTest, CloseFailsPendingAndLaterRequests) {
+  FakeWorker worker;
+  EnqueueBatcher batcher(worker.SendFn());
+
+  EnqueueResponse responses[3];
+  Status statuses[3];
+  for (int i = 0; i < 2; ++i) {
+    const EnqueueRequest request = MakeRequest(i);
+    batcher.EnqueueAsync(&request, &responses[i],
+                         [&statuses, i](const Status& s) { statuses[i] = s; });
+  }
+  ASSERT_EQ(1, worker.num_sent());
+
+  bool idle = false;
+  batcher.Close(errors::Cancelled("Context closed"),
+                [&idle]() { idle = true; });
+  // The pending request fails right away, the one in flight completes.
+  EXPECT_EQ(error::CANCELLED, statuses[1].code());
+  EXPECT_FALSE(idle);
+  const EnqueueRequest request = MakeRequest(2);
+  batcher.EnqueueAsync(&request, &responses[2],
+                       [&statuses](const Status& s) { statuses[2] = s; });
+  EXPECT_EQ(error::CANCELLED, statuses[2].code());
+
+  worker.Complete(0);
+  TF_EXPECT_OK(statuses[0]);
+  EXPECT_TRUE(idle);
+  // No other batch was sent.
+  EXPECT_EQ(1, worker.num_sent());
+}
+
+TEST(EnqueueBatcherTest, CloseWhileIdle) {
+  FakeWorker worker;
+  EnqueueBatcher batcher(worker.SendFn());
+  bool idle = false;
+  batcher.Close(errors::Cancelled("Context closed"),
+                [&idle]() { idle = true; });
+  EXPECT_TRUE(idle);
+}
+
+}  // namespace
+}  // namespace eager
+}  // namespace tensorflow
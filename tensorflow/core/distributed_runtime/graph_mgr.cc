@@ -413,12 +413,91 @@ void GraphMgr::RecvOutputsAsync(const int64 step_id, NamedTensors* out,
       });
 }
 
+Status GraphMgr::RegisterKeys(const string& handle,
+                              const std::vector<string>& send_keys,
+                              const std::vector<string>& recv_keys) {
+  std::vector<Rendezvous::ParsedKey> parsed_send_keys(send_keys.size());
+  for (size_t i = 0; i < send_keys.size(); ++i) {
+    TF_RETURN_IF_ERROR(
+        Rendezvous::ParseKey(send_keys[i], &parsed_send_keys[i]));
+  }
+  std::vector<Rendezvous::ParsedKey> parsed_recv_keys(recv_keys.size());
+  for (size_t i = 0; i < recv_keys.size(); ++i) {
+    TF_RETURN_IF_ERROR(
+        Rendezvous::ParseKey(recv_keys[i], &parsed_recv_keys[i]));
+  }
+
+  mutex_lock l(mu_);
+  auto iter = table_.find(handle);
+  if (iter == table_.end()) {
+    return errors::Aborted("Graph handle is not found: ", handle);
+  }
+  iter->second->send_keys = std::move(parsed_send_keys);
+  iter->second->recv_keys = std::move(parsed_recv_keys);
+  return Status::OK();
+}
+
+namespace {
+
+// Receives the values of "keys" into "out", in order.
+Status RecvRegisteredOutputs(RendezvousInterface* rendezvous,
+                             const int64 step_id,
+                             const std::vector<Rendezvous::ParsedKey>& keys,
+                             std::vector<Tensor>* out) {
+  out->resize(keys.size());
+  size_t output_size = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    bool is_dead = false;
+    Status s =
+        rendezvous->Recv(keys[i], Rendezvous::Args(), &(*out)[i], &is_dead);
+    if (s.ok() && is_dead) {
+      s = errors::InvalidArgument("The tensor returned for ",
+                                  keys[i].FullKey(), " was not valid.");
+    }
+    if (!s.ok()) {
+      // As in RecvOutputs(), failing to fetch the outputs should not be
+      // possible.
+      return errors::Internal("Failed to fetch outputs for step ", step_id,
+                              ". (Original error message: ", s.ToString(),
+                              ")");
+    }
+    output_size += (*out)[i].AllocatedBytes();
+  }
+  metrics::RecordGraphOutputTensors(output_size);
+  return Status::OK();
+}
+
+}  // namespace
+
 void GraphMgr::ExecuteAsync(const string& handle, const int64 step_id,
                             WorkerSession* session, const ExecutorOpts& opts,
                             StepStatsCollector* collector,
                             MutableRunGraphResponseWrapper* response,
                             CancellationManager* cancellation_manager,
                             const NamedTensors& in, StatusCallback done) {
+  ExecuteAsyncInternal(handle, step_id, session, opts, collector, response,
+                       cancellation_manager, &in, /*registered_in=*/nullptr,
+                       /*registered_out=*/nullptr, std::move(done));
+}
+
+void GraphMgr::ExecuteWithRegisteredKeysAsync(
+    const string& handle, const int64 step_id, WorkerSession* session,
+    const ExecutorOpts& opts, StepStatsCollector* collector,
+    MutableRunGraphResponseWrapper* response,
+    CancellationManager* cancellation_manager, const std::vector<Tensor>& in,
+    std::vector<Tensor>* out, StatusCallback done) {
+  ExecuteAsyncInternal(handle, step_id, session, opts, collector, response,
+                       cancellation_manager, /*named_in=*/nullptr, &in, out,
+                       std::move(done));
+}
+
+void GraphMgr::ExecuteAsyncInternal(
+    const string& handle, const int64 step_id, WorkerSession* session,
+    const ExecutorOpts& opts, StepStatsCollector* collector,
+    MutableRunGraphResponseWrapper* response,
+    CancellationManager* cancellation_manager, const NamedTensors* named_in,
+    const std::vector<Tensor>* registered_in,
+    std::vector<Tensor>* registered_out, StatusCallback done) {
   const uint64 start_time_usecs = Env::Default()->NowMicros();
   profiler::TraceMeProducer activity(
       // To TraceMeConsumers in ExecutorState::Process/Finish or RunGraphDone.
@@ -466,7 +545,21 @@ void GraphMgr::ExecuteAsync(const string& handle, const int64 step_id,
           : nullptr;
   // Sends values specified by the caller.
   size_t input_size = 0;
-  if (s.ok()) {
+  if (s.ok() && registered_in != nullptr) {
+    if (registered_in->size() != item->send_keys.size()) {
+      s = errors::InvalidArgument(
+          "Expected ", item->send_keys.size(),
+          " values for the registered send keys of graph ", handle, ", got ",
+          registered_in->size());
+    }
+    for (size_t i = 0; s.ok() && i < registered_in->size(); ++i) {
+      const Tensor& val = (*registered_in)[i];
+      input_size += val.AllocatedBytes();
+      s = rendezvous->Send(item->send_keys[i], Rendezvous::Args(), val,
+                           /*is_dead=*/false);
+    }
+  } else if (s.ok()) {
+    const NamedTensors& in = *named_in;
     std::vector<string> keys;
     std::vector<Tensor> tensors_to_send;
     keys.reserve(in.size());
@@ -491,7 +584,7 @@ void GraphMgr::ExecuteAsync(const string& handle, const int64 step_id,
       handle, step_id, item, rendezvous, ce_handle, collector, cost_graph,
       cancellation_manager, session,
       [item, rendezvous, ce_handle, done, start_time_usecs, input_size,
-       step_id](const Status& s) {
+       step_id, registered_out](const Status& s) {
         profiler::TraceMeConsumer activity(
             // From TraceMeProducer in GraphMgr::ExecuteAsync.
             [step_id] {
@@ -499,7 +592,12 @@ void GraphMgr::ExecuteAsync(const string& handle, const int64 step_id,
             },
             profiler::ContextType::kTfExecutor, step_id,
             profiler::TraceMeLevel::kInfo);
-        done(s);
+        if (s.ok() && registered_out != nullptr) {
+          done(RecvRegisteredOutputs(rendezvous, step_id, item->recv_keys,
+                                     registered_out));
+        } else {
+          done(s);
+        }
         metrics::RecordGraphInputTensors(input_size);
         metrics::UpdateGraphExecTime(Env::Default()->NowMicros() -
                                      start_time_usecs);
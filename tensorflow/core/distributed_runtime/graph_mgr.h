@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/cost_graph.pb.h"
 #include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
@@ -81,6 +82,13 @@ class GraphMgr {
                   DistributedFunctionLibraryRuntime* cluster_flr,
                   string* graph_handle);
 
+  // Registers the rendezvous keys of the tensors fed to and fetched from the
+  // registered graph "handle" by ExecuteWithRegisteredKeysAsync(). The keys
+  // are parsed once here instead of at every step.
+  Status RegisterKeys(const string& handle,
+                      const std::vector<string>& send_keys,
+                      const std::vector<string>& recv_keys);
+
   // Executes one step of a registered graph "handle".
   //
   // If "out" is not nullptr, "out" specifies all keys the execution
@@ -94,6 +102,16 @@ class GraphMgr {
                     CancellationManager* cancellation_manager,
                     const NamedTensors& in, StatusCallback done);
 
+  // Like ExecuteAsync(), but "in" holds the values of the send keys
+  // registered with RegisterKeys(), in order. Before calling "done", fills
+  // "out" with the values of the registered recv keys, in order.
+  void ExecuteWithRegisteredKeysAsync(
+      const string& handle, const int64 step_id, WorkerSession* session,
+      const ExecutorOpts& opts, StepStatsCollector* collector,
+      MutableRunGraphResponseWrapper* response,
+      CancellationManager* cancellation_manager, const std::vector<Tensor>& in,
+      std::vector<Tensor>* out, StatusCallback done);
+
   Status SendInputs(const int64 step_id, const NamedTensors& in);
   Status RecvOutputs(const int64 step_id, NamedTensors* out);
   void RecvOutputsAsync(const int64 step_id, NamedTensors* out,
@@ -142,6 +160,10 @@ class GraphMgr {
     GraphMgr* graph_mgr;
 
     int64 collective_graph_key;
+
+    // Keys registered with RegisterKeys().
+    std::vector<Rendezvous::ParsedKey> send_keys;
+    std::vector<Rendezvous::ParsedKey> recv_keys;
   };
 
   const WorkerEnv* worker_env_;  // Not owned.
@@ -163,6 +185,19 @@ class GraphMgr {
   // mechanism to gc these graphs.
   std::unordered_map<string, Item*> table_;
 
+  // Runs one step of "item". The inputs are either "named_in", or the values
+  // of the registered send keys in "registered_in". If "registered_out" is not
+  // null, the values of the registered recv keys are received into it.
+  void ExecuteAsyncInternal(const string& handle, const int64 step_id,
+                            WorkerSession* session, const ExecutorOpts& opts,
+                            StepStatsCollector* collector,
+                            MutableRunGraphResponseWrapper* response,
+                            CancellationManager* cancellation_manager,
+                            const NamedTensors* named_in,
+                            const std::vector<Tensor>* registered_in,
+                            std::vector<Tensor>* registered_out,
+                            StatusCallback done);
+
   void StartParallelExecutors(const string& handle, int64 step_id, Item* item,
                               Rendezvous* rendezvous,
                               CollectiveExecutor::Handle* ce_handle,
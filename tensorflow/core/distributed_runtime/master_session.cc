@@ -267,6 +267,13 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
     // this partition on the worker.
     string graph_handle;
 
+    // If true, the worker has the rendezvous keys of the partition, and
+    // RunGraph requests identify feeds and fetches by their position in
+    // registered_feeds and registered_fetches instead of by key.
+    bool use_registered_keys = false;
+    std::vector<string> registered_feeds;
+    std::vector<string> registered_fetches;
+
     Part() : feed_key(3), key_fetch(3) {}
   };
 
@@ -481,6 +488,19 @@ Status MasterSession::ReffedClientGraph::DoRegisterPartitions(
     *c->req.mutable_debug_options() =
         callable_opts_.run_options().debug_options();
     c->req.set_collective_graph_key(collective_graph_key_);
+    if (!is_partial_) {
+      // Partial runs feed and fetch a different subset of the keys in each
+      // step, so only full runs use the registered keys.
+      Part* mutable_part = &partitions_[i];
+      for (const auto& feed_key : part.feed_key) {
+        mutable_part->registered_feeds.push_back(feed_key.first);
+        c->req.add_send_key(feed_key.second);
+      }
+      for (const auto& key_fetch : part.key_fetch) {
+        mutable_part->registered_fetches.push_back(key_fetch.second);
+        c->req.add_recv_key(key_fetch.first);
+      }
+    }
     VLOG(2) << "Register " << c->req.graph_def().DebugString();
     auto cb = [c, &done](const Status& s) {
       c->status = s;
@@ -493,6 +513,7 @@ Status MasterSession::ReffedClientGraph::DoRegisterPartitions(
     Call* c = &calls[i];
     s.Update(c->status);
     partitions_[i].graph_handle = c->resp.graph_handle();
+    partitions_[i].use_registered_keys = c->resp.use_registered_keys();
   }
   return s;
 }
@@ -713,6 +734,16 @@ Status MasterSession::ReffedClientGraph::RunPartitionsHelper(
           }
         }
       }
+    } else if (part.use_registered_keys) {
+      c->req->set_use_registered_keys(true);
+      for (const string& feed : part.registered_feeds) {
+        auto iter = feeds.find(feed);
+        if (iter == feeds.end()) {
+          return errors::Internal("No feed index found for feed: ", feed);
+        }
+        TF_RETURN_IF_ERROR(
+            AddSendFromClientRequest(req, c->req.get(), iter->second, ""));
+      }
     } else {
       for (const auto& feed_key : part.feed_key) {
         const string& feed = feed_key.first;
@@ -768,18 +799,30 @@ Status MasterSession::ReffedClientGraph::RunPartitionsHelper(
   for (int i = 0; i < num; ++i) {
     const Part& part = partitions_[i];
     MutableRunGraphResponseWrapper* run_graph_resp = calls.get(i)->resp.get();
-    for (size_t j = 0; j < run_graph_resp->num_recvs(); ++j) {
-      auto iter = part.key_fetch.find(run_graph_resp->recv_key(j));
-      if (iter == part.key_fetch.end()) {
-        status.Update(errors::Internal("Unexpected fetch key: ",
-                                       run_graph_resp->recv_key(j)));
-        break;
+    if (part.use_registered_keys) {
+      if (run_graph_resp->num_recvs() != part.registered_fetches.size()) {
+        status.Update(errors::Internal(
+            "Expected ", part.registered_fetches.size(), " fetches from ",
+            part.name, " but got ", run_graph_resp->num_recvs()));
       }
-      const string& fetch = iter->second;
-      status.Update(
-          resp->AddTensorFromRunGraphResponse(fetch, run_graph_resp, j));
-      if (!status.ok()) {
-        break;
+      for (size_t j = 0; status.ok() && j < run_graph_resp->num_recvs(); ++j) {
+        status.Update(resp->AddTensorFromRunGraphResponse(
+            part.registered_fetches[j], run_graph_resp, j));
+      }
+    } else {
+      for (size_t j = 0; j < run_graph_resp->num_recvs(); ++j) {
+        auto iter = part.key_fetch.find(run_graph_resp->recv_key(j));
+        if (iter == part.key_fetch.end()) {
+          status.Update(errors::Internal("Unexpected fetch key: ",
+                                         run_graph_resp->recv_key(j)));
+          break;
+        }
+        const string& fetch = iter->second;
+        status.Update(
+            resp->AddTensorFromRunGraphResponse(fetch, run_graph_resp, j));
+        if (!status.ok()) {
+          break;
+        }
       }
     }
     if (pss->collect_timeline) {
@@ -360,6 +360,46 @@ TEST_F(MasterTest, ConcurrentExtendAndRun) {
   TF_ASSERT_OK(CloseSession(handle));
 }
 
+TEST_F(MasterTest, FeedAndFetchAcrossWorkers) {
+  // x is fed on task 0, y = -x runs on task 1 and z = -y on task 0, so each
+  // partition has both feeds or fetches and a cross-worker edge.
+  Graph graph(OpRegistry::Global());
+  Node* x_node = test::graph::Constant(&graph, test::AsScalar<float>(0), "x");
+  Node* y_node = test::graph::Unary(&graph, "Neg", x_node);
+  Node* z_node = test::graph::Unary(&graph, "Neg", y_node);
+  GraphDef def;
+  test::graph::ToGraphDef(&graph, &def);
+  for (NodeDef& node : *def.mutable_node()) {
+    node.set_device(node.name() == y_node->name()
+                        ? "/job:localhost/replica:0/task:1/cpu:0"
+                        : "/job:localhost/replica:0/task:0/cpu:0");
+  }
+
+  string handle;
+  int64 initial_version;
+  TF_ASSERT_OK(CreateSession(def, &handle, &initial_version));
+
+  // Repeated steps with the same signature reuse the registered partitions.
+  for (int i = 1; i <= 3; ++i) {
+    Tensor x = test::AsScalar<float>(i);
+    Tensor y(DT_FLOAT, TensorShape({}));
+    Tensor z(DT_FLOAT, TensorShape({}));
+    TF_ASSERT_OK(RunStep(handle, {{"x:0", &x}},
+                         {{y_node->name() + ":0", &y},
+                          {z_node->name() + ":0", &z}}));
+    test::ExpectTensorEqual<float>(test::AsScalar<float>(-i), y);
+    test::ExpectTensorEqual<float>(test::AsScalar<float>(i), z);
+  }
+
+  // A different signature registers its own partitions.
+  Tensor x = test::AsScalar<float>(5);
+  Tensor z(DT_FLOAT, TensorShape({}));
+  TF_ASSERT_OK(RunStep(handle, {{"x:0", &x}}, {{z_node->name() + ":0", &z}}));
+  test::ExpectTensorEqual<float>(test::AsScalar<float>(5), z);
+
+  TF_EXPECT_OK(CloseSession(handle));
+}
+
 TEST_F(MasterTest, EigenProblem) {
   // A = [3 2; -1 0]; x = rand(2, 1);
   // for i=1:100; x = A * x; end
@@ -396,6 +396,15 @@ void InMemoryRunGraphRequest::set_request_id(int64 request_id) {
   request_id_ = request_id;
 }
 
+bool InMemoryRunGraphRequest::use_registered_keys() const {
+  return use_registered_keys_;
+}
+
+void InMemoryRunGraphRequest::set_use_registered_keys(
+    bool use_registered_keys) {
+  use_registered_keys_ = use_registered_keys;
+}
+
 const RunGraphRequest& InMemoryRunGraphRequest::ToProto() const {
   if (!proto_version_) {
     proto_version_.reset(new RunGraphRequest);
@@ -415,6 +424,7 @@ const RunGraphRequest& InMemoryRunGraphRequest::ToProto() const {
     }
     proto_version_->set_is_partial(is_partial());
     proto_version_->set_is_last_partial_run(is_last_partial_run());
+    proto_version_->set_use_registered_keys(use_registered_keys());
   }
   proto_version_->set_store_errors_in_response_body(
       store_errors_in_response_body_);
@@ -547,6 +557,15 @@ void MutableProtoRunGraphRequest::set_request_id(int64 request_id) {
   request_.set_request_id(request_id);
 }
 
+bool MutableProtoRunGraphRequest::use_registered_keys() const {
+  return request_.use_registered_keys();
+}
+
+void MutableProtoRunGraphRequest::set_use_registered_keys(
+    bool use_registered_keys) {
+  request_.set_use_registered_keys(use_registered_keys);
+}
+
 const RunGraphRequest& MutableProtoRunGraphRequest::ToProto() const {
   return request_;
 }
@@ -608,6 +627,10 @@ int64 ProtoRunGraphRequest::request_id() const {
   return request_->request_id();
 }
 
+bool ProtoRunGraphRequest::use_registered_keys() const {
+  return request_->use_registered_keys();
+}
+
 const RunGraphRequest& ProtoRunGraphRequest::ToProto() const {
   return *request_;
 }
@@ -297,6 +297,10 @@ class RunGraphRequestWrapper {
 
   virtual int64 request_id() const = 0;
 
+  // If true, the sends are the values of the send keys registered with the
+  // graph, in order, and the recv keys registered with the graph are fetched.
+  virtual bool use_registered_keys() const = 0;
+
   // Returns the wrapped data as a protocol buffer message.
   virtual const RunGraphRequest& ToProto() const = 0;
 };
@@ -326,6 +330,7 @@ class MutableRunGraphRequestWrapper : public RunGraphRequestWrapper {
   virtual void set_is_last_partial_run(bool is_last_partial_run) = 0;
   virtual void set_store_errors_in_response_body(bool store_errors) = 0;
   virtual void set_request_id(int64 request_id) = 0;
+  virtual void set_use_registered_keys(bool use_registered_keys) = 0;
 };
 
 class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
@@ -346,6 +351,7 @@ class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
   const RunGraphRequest& ToProto() const override;
   bool store_errors_in_response_body() const override;
   int64 request_id() const override;
+  bool use_registered_keys() const override;
 
   // MutableRunGraphRequestWrapper methods.
   void set_session_handle(const string& handle) override;
@@ -364,6 +370,7 @@ class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
   void set_is_last_partial_run(bool is_last_partial_run) override;
   void set_store_errors_in_response_body(bool store_errors) override;
   void set_request_id(int64 request_id) override;
+  void set_use_registered_keys(bool use_registered_keys) override;
 
  private:
   string session_handle_;
@@ -377,6 +384,7 @@ class InMemoryRunGraphRequest : public MutableRunGraphRequestWrapper {
   bool is_last_partial_run_ = false;
   bool store_errors_in_response_body_ = false;
   int64 request_id_ = 0;
+  bool use_registered_keys_ = false;
 
   // Holds a cached and owned representation of the proto
   // representation of this request, if needed, so that `ToProto()`
@@ -405,6 +413,7 @@ class MutableProtoRunGraphRequest : public MutableRunGraphRequestWrapper {
   bool is_last_partial_run() const override;
   bool store_errors_in_response_body() const override;
   int64 request_id() const override;
+  bool use_registered_keys() const override;
   const RunGraphRequest& ToProto() const override;
 
   // MutableRunGraphRequestWrapper methods.
@@ -424,6 +433,7 @@ class MutableProtoRunGraphRequest : public MutableRunGraphRequestWrapper {
   void set_is_last_partial_run(bool is_last_partial_run) override;
   void set_store_errors_in_response_body(bool store_errors) override;
   void set_request_id(int64 request_id) override;
+  void set_use_registered_keys(bool use_registered_keys) override;
 
  private:
   RunGraphRequest request_;
@@ -448,6 +458,7 @@ class ProtoRunGraphRequest : public RunGraphRequestWrapper {
   bool is_last_partial_run() const override;
   bool store_errors_in_response_body() const override;
   int64 request_id() const override;
+  bool use_registered_keys() const override;
   const RunGraphRequest& ToProto() const override;
 
  private:
@@ -15,12 +15,16 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/eager/grpc_eager_client.h"
 
+#include <memory>
+
 #include "grpcpp/generic/generic_stub.h"
 #include "tensorflow/core/distributed_runtime/call_options.h"
+#include "tensorflow/core/distributed_runtime/eager/enqueue_batcher.h"
 #include "tensorflow/core/distributed_runtime/rpc/eager/grpc_eager_service.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_client_cq_tag.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_state.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/env.h"
@@ -63,6 +67,17 @@ bool EnableStreaming() {
   return result;
 }
 
+// Setting environment variable "TF_ENABLE_EAGER_CLIENT_ENQUEUE_BATCHING" to
+// false sends every streaming enqueue request in its own message, instead of
+// coalescing the requests issued while an earlier one is in flight (see
+// EnqueueBatcher).
+bool EnableEnqueueBatching() {
+  bool result;
+  TF_CHECK_OK(ReadBoolFromEnvVar("TF_ENABLE_EAGER_CLIENT_ENQUEUE_BATCHING",
+                                 true, &result));
+  return result;
+}
+
 // Ref-counted thread to handle callbacks for completed requests a GRPC
 // completion queue. The thread might be shared by multiple eager clients, and
 // each one of them should hold a reference count to ensure that the thread
@@ -168,14 +183,38 @@ class GrpcEagerClient : public EagerClient {
     VLOG(1) << "Sending RPC to close remote eager context "
             << request->DebugString();
 
-    mutex_lock l(mu_);
-    const auto& it = enqueue_dispatchers_.find(request->context_id());
-    if (it != enqueue_dispatchers_.end()) {
-      it->second.CancelCall();
-      enqueue_dispatchers_.erase(it);
-    } else if (EnableStreaming()) {
-      LOG(ERROR) << "Remote EagerContext with id " << request->context_id()
-                 << " does not seem to exist.";
+    const uint64 context_id = request->context_id();
+    std::shared_ptr<EnqueueBatcher> batcher;
+    {
+      mutex_lock l(mu_);
+      const auto& it = enqueue_dispatchers_.find(context_id);
+      if (it != enqueue_dispatchers_.end()) {
+        it->second->CancelCall();
+        enqueue_dispatchers_.erase(it);
+      } else if (EnableStreaming()) {
+        LOG(ERROR) << "Remote EagerContext with id " << context_id
+                   << " does not seem to exist.";
+      }
+      auto batcher_it = enqueue_batchers_.find(context_id);
+      if (batcher_it != enqueue_batchers_.end()) {
+        batcher = batcher_it->second;
+      }
+    }
+    if (batcher != nullptr) {
+      // Fail the batches that were not sent, so that they don't open a new
+      // stream, and drop the batcher once the batch in flight completed.
+      EnqueueBatcher* raw_batcher = batcher.get();
+      batcher->Close(
+          errors::Cancelled("Remote eager context ", context_id,
+                            " was closed"),
+          [this, context_id, raw_batcher]() {
+            mutex_lock l(mu_);
+            auto it = enqueue_batchers_.find(context_id);
+            if (it != enqueue_batchers_.end() &&
+                it->second.get() == raw_batcher) {
+              enqueue_batchers_.erase(it);
+            }
+          });
     }
   }
 
@@ -184,20 +223,26 @@ class GrpcEagerClient : public EagerClient {
                              EnqueueResponse* response,
                              StatusCallback done) override {
     StatusCallback done_wrapped = callback_wrapper(std::move(done));
-    if (EnableStreaming()) {
-      mutex_lock l(mu_);
-      auto it = enqueue_dispatchers_.find(request->context_id());
-      if (it == enqueue_dispatchers_.end()) {
-        auto it_and_bool = enqueue_dispatchers_.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(request->context_id()),
-            std::forward_as_tuple(
-                &stub_, cq_,
-                "/tensorflow.eager.EagerService/StreamingEnqueue"));
-        it = it_and_bool.first;
+    if (EnableStreaming() && EnableEnqueueBatching()) {
+      std::shared_ptr<EnqueueBatcher> batcher;
+      {
+        mutex_lock l(mu_);
+        std::shared_ptr<EnqueueBatcher>& entry =
+            enqueue_batchers_[request->context_id()];
+        if (entry == nullptr) {
+          entry = std::make_shared<EnqueueBatcher>(
+              [this](const EnqueueRequest* batch_request,
+                     EnqueueResponse* batch_response,
+                     StatusCallback batch_done) {
+                SendNextStreamingRequest(*batch_request, batch_response,
+                                         std::move(batch_done));
+              });
+        }
+        batcher = entry;
       }
-      // TODO(haoyuzhang): Consider supporting cancellation for streaming RPC?
-      it->second.SendNextRequest(*request, response, std::move(done_wrapped));
+      batcher->EnqueueAsync(request, response, std::move(done_wrapped));
+    } else if (EnableStreaming()) {
+      SendNextStreamingRequest(*request, response, std::move(done_wrapped));
     } else {
       Notification n;
       Status status;
@@ -212,6 +257,24 @@ class GrpcEagerClient : public EagerClient {
   }
 
  private:
+  void SendNextStreamingRequest(const EnqueueRequest& request,
+                                EnqueueResponse* response,
+                                StatusCallback done) TF_LOCKS_EXCLUDED(mu_) {
+    std::shared_ptr<StreamingRPCDispatcher<EnqueueResponse>> dispatcher;
+    {
+      mutex_lock l(mu_);
+      auto& entry = enqueue_dispatchers_[request.context_id()];
+      if (entry == nullptr) {
+        entry = std::make_shared<StreamingRPCDispatcher<EnqueueResponse>>(
+            &stub_, cq_, "/tensorflow.eager.EagerService/StreamingEnqueue");
+      }
+      dispatcher = entry;
+    }
+    // `done` may be called right away, so `mu_` must not be held.
+    // TODO(haoyuzhang): Consider supporting cancellation for streaming RPC?
+    dispatcher->SendNextRequest(request, response, std::move(done));
+  }
+
   ::grpc::GenericStub stub_;
   const GrpcEagerClientThread* thread_;
   const string target_;
@@ -220,8 +283,12 @@ class GrpcEagerClient : public EagerClient {
 
   mutable mutex mu_;
 
-  std::unordered_map<uint64, StreamingRPCDispatcher<EnqueueResponse>>
+  std::unordered_map<uint64,
+                     std::shared_ptr<StreamingRPCDispatcher<EnqueueResponse>>>
       enqueue_dispatchers_ TF_GUARDED_BY(mu_);
+  // Closed with the context, and erased once their last batch completed.
+  std::unordered_map<uint64, std::shared_ptr<EnqueueBatcher>>
+      enqueue_batchers_ TF_GUARDED_BY(mu_);
 
   StatusCallback callback_wrapper(StatusCallback done) {
     Ref();
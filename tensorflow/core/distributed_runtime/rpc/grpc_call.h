@@ -243,6 +243,13 @@ class Call : public UntypedCall<Service> {
                                     &call->request_received_tag_);
   }
 
+  // Compresses the response with `algorithm`, instead of the default
+  // compression algorithm of the server. Must be called before
+  // `SendResponse()`.
+  void SetResponseCompressionAlgorithm(grpc_compression_algorithm algorithm) {
+    ctx_.set_compression_algorithm(algorithm);
+  }
+
   RequestMessage request;
   ResponseMessage response;
 
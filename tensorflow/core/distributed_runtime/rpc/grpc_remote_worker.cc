@@ -15,15 +15,19 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_remote_worker.h"
 
+#include <memory>
+#include <unordered_set>
 #include <utility>
 
 #include "grpcpp/generic/generic_stub.h"
 #include "grpcpp/grpcpp.h"
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/distributed_runtime/chunked_tensor_transfer.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_client_cq_tag.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_state.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/worker_cache_logger.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
@@ -44,7 +48,9 @@ class GrpcRemoteWorker : public WorkerInterface {
   explicit GrpcRemoteWorker(SharedGrpcChannelPtr channel,
                             ::grpc::CompletionQueue* completion_queue,
                             thread::ThreadPool* callback_threadpool,
-                            WorkerCacheLogger* logger, const string& target)
+                            WorkerCacheLogger* logger, const string& target,
+                            bool use_shared_memory_transport,
+                            int64 recv_tensor_chunk_bytes)
       : channel_(std::move(channel)),
         stub_(channel_),
         cq_(completion_queue),
@@ -66,7 +72,10 @@ class GrpcRemoteWorker : public WorkerInterface {
         getstepsequence_(Method(GrpcWorkerMethod::kGetStepSequence)),
         markrecvfinished_(Method(GrpcWorkerMethod::kMarkRecvFinished)),
         logger_(logger),
-        target_(target) {}
+        target_(target),
+        use_shared_memory_transport_(use_shared_memory_transport &&
+                                     !SharedMemoryHostId().empty()),
+        recv_tensor_chunk_bytes_(recv_tensor_chunk_bytes) {}
 
   ~GrpcRemoteWorker() override {}
 
@@ -200,8 +209,8 @@ class GrpcRemoteWorker : public WorkerInterface {
     // Type-specialized logging for this method.
     bool logging_active = logger_->LoggingActive() || VLOG_IS_ON(2);
 
-    auto callback = [this, request, response, done, start_usec,
-                     logging_active](Status s) {
+    auto finish = [this, request, response, done, start_usec,
+                   logging_active](Status s) {
       if (logging_active) {
         if (logger_->LoggingActive()) {
           int64 end_usec = Env::Default()->NowMicros();
@@ -251,6 +260,64 @@ class GrpcRemoteWorker : public WorkerInterface {
       done(s);
     };
 
+    auto callback = [this, request, response, finish,
+                     call_opts](Status s) {
+      // The sender placed the tensor contents in shared memory.
+      SharedMemoryTensorExtra shared_memory_extra;
+      ChunkedTensorExtra chunked_extra;
+      if (s.ok() && response->metadata().transport_options().UnpackTo(
+                        &shared_memory_extra)) {
+        Tensor tensor = response->tensor();
+        s = ReadTensorFromSharedMemory(shared_memory_extra, &tensor);
+        if (s.ok()) {
+          // Let the sender release the tensor it kept for a fallback.
+          IssueMarkRecvFinishedRequest(/*request_id=*/0, &shared_memory_extra);
+        } else {
+          // Ask the sender for the tensor contents inline instead.
+          VLOG(1) << "Falling back to RPC for RecvTensor: " << s;
+          RecvTensorRequest fallback_request(*request);
+          SharedMemoryFallbackRequest fallback;
+          fallback.set_segment_name(shared_memory_extra.segment_name());
+          fallback_request.mutable_transport_options()->PackFrom(fallback);
+          response->ClearTensor();
+          IssueRequest(&fallback_request, response, recvtensor_, finish,
+                       call_opts);
+          return;
+        }
+      } else if (s.ok() && response->metadata().transport_options().UnpackTo(
+                               &chunked_extra)) {
+        // The response only carried the metadata, and the contents must be
+        // fetched into the tensor allocated from it.
+        s = ValidateChunkedTensorExtra(response->tensor(), chunked_extra);
+        if (s.ok()) {
+          RecvTensorChunks(*request, chunked_extra, response->tensor(),
+                           call_opts, finish);
+          return;
+        }
+      }
+      finish(s);
+    };
+
+    // Ask a sender on the same host to pass the tensor contents through
+    // shared memory, and other senders to send large tensors in chunks. Both
+    // are only supported for tensors received into host memory.
+    if (response->on_host() &&
+        (use_shared_memory_transport_ || recv_tensor_chunk_bytes_ > 0)) {
+      RecvTensorRequest transport_request(*request);
+      if (use_shared_memory_transport_) {
+        SharedMemoryRecvTensorOptions options;
+        options.set_host_id(SharedMemoryHostId());
+        options.set_chunk_bytes(recv_tensor_chunk_bytes_);
+        transport_request.mutable_transport_options()->PackFrom(options);
+      } else {
+        ChunkedRecvTensorOptions options;
+        options.set_chunk_bytes(recv_tensor_chunk_bytes_);
+        transport_request.mutable_transport_options()->PackFrom(options);
+      }
+      IssueRequest(&transport_request, response, recvtensor_, callback,
+                   call_opts);
+      return;
+    }
     IssueRequest(request, response, recvtensor_, callback, call_opts);
   }
 
@@ -265,6 +332,114 @@ class GrpcRemoteWorker : public WorkerInterface {
   }
 
  private:
+  // State of the chunk requests that fetch the contents of one tensor.
+  struct ChunkedRecvState {
+    RecvTensorRequest request;
+    ChunkedTensorExtra extra;
+    // The destination of the chunks.
+    Tensor tensor;
+    // The options of the original request, if any. Cancelling it cancels the
+    // chunk requests.
+    CallOptions* call_opts = nullptr;
+    StatusCallback done;
+
+    mutex mu;
+    int64 next_chunk TF_GUARDED_BY(mu) = 0;
+    int num_outstanding TF_GUARDED_BY(mu) = 0;
+    Status status TF_GUARDED_BY(mu);
+    // CallOptions only hold one cancellation callback, so each outstanding
+    // chunk request has options of its own.
+    std::unordered_set<CallOptions*> chunk_call_opts TF_GUARDED_BY(mu);
+  };
+
+  // Fetches the chunks described by `extra` into `tensor`, keeping up to
+  // kMaxOutstandingChunkRequests requests in flight, and calls `done` once
+  // they all completed.
+  void RecvTensorChunks(const RecvTensorRequest& request,
+                        const ChunkedTensorExtra& extra, const Tensor& tensor,
+                        CallOptions* call_opts, StatusCallback done) {
+    auto state = std::make_shared<ChunkedRecvState>();
+    state->request.set_step_id(request.step_id());
+    state->request.set_rendezvous_key(request.rendezvous_key());
+    state->extra = extra;
+    state->tensor = tensor;
+    state->call_opts = call_opts;
+    state->done = std::move(done);
+    if (call_opts != nullptr) {
+      // The callback is cleared once the last chunk request completed.
+      call_opts->SetCancelCallback([state]() {
+        mutex_lock l(state->mu);
+        state->status.Update(errors::Cancelled("RecvTensor was cancelled"));
+        for (CallOptions* chunk_call_opts : state->chunk_call_opts) {
+          chunk_call_opts->StartCancel();
+        }
+      });
+    }
+    for (int i = 0; i < kMaxOutstandingChunkRequests; ++i) {
+      IssueNextChunkRequest(state);
+    }
+  }
+
+  void IssueNextChunkRequest(const std::shared_ptr<ChunkedRecvState>& state) {
+    int64 chunk_index;
+    CallOptions* chunk_call_opts = new CallOptions;
+    if (state->call_opts != nullptr) {
+      chunk_call_opts->SetTimeout(state->call_opts->GetTimeout());
+    }
+    {
+      mutex_lock l(state->mu);
+      if (!state->status.ok() ||
+          state->next_chunk == state->extra.num_chunks()) {
+        delete chunk_call_opts;
+        return;
+      }
+      chunk_index = state->next_chunk++;
+      ++state->num_outstanding;
+      state->chunk_call_opts.insert(chunk_call_opts);
+    }
+    RecvTensorRequest chunk_request(state->request);
+    RecvTensorChunkRequest chunk_options;
+    chunk_options.set_transfer_id(state->extra.transfer_id());
+    chunk_options.set_chunk_index(chunk_index);
+    chunk_request.mutable_transport_options()->PackFrom(chunk_options);
+
+    auto* chunk =
+        new TensorChunkResponse(state->tensor, state->extra, chunk_index);
+    IssueRequest(
+        &chunk_request, chunk->response(), recvtensor_,
+        [this, state, chunk, chunk_call_opts](Status s) {
+          if (s.ok()) {
+            s = chunk->Finish();
+          }
+          delete chunk;
+          bool finished;
+          Status status;
+          {
+            mutex_lock l(state->mu);
+            state->chunk_call_opts.erase(chunk_call_opts);
+            state->status.Update(s);
+            --state->num_outstanding;
+            finished = state->num_outstanding == 0 &&
+                       (!state->status.ok() ||
+                        state->next_chunk == state->extra.num_chunks());
+            status = state->status;
+          }
+          delete chunk_call_opts;
+          if (finished) {
+            if (state->call_opts != nullptr) {
+              state->call_opts->ClearCancelCallback();
+            }
+            // Let the sender release the tensor, which it keeps until then
+            // in case a chunk is requested again.
+            IssueMarkRecvFinishedRequest(/*request_id=*/0, &state->extra);
+            state->done(status);
+          } else {
+            IssueNextChunkRequest(state);
+          }
+        },
+        chunk_call_opts);
+  }
+
   // Utility method for issuing a generic asynchronous request. The
   // given callback, `done`, will be called when the RPC completes.
   void IssueRequest(const protobuf::Message* request,
@@ -285,10 +460,16 @@ class GrpcRemoteWorker : public WorkerInterface {
                                  /*fail_fast=*/true, &target_);
   }
 
-  void IssueMarkRecvFinishedRequest(int64 request_id) {
+  // If `transport_extra` is not null, it describes an out-of-band transfer
+  // whose resources the sender can release.
+  void IssueMarkRecvFinishedRequest(
+      int64 request_id, const protobuf::Message* transport_extra = nullptr) {
     VLOG(2) << "Send MarkRecvFinishedRequest for request " << request_id;
     MarkRecvFinishedRequest request;
     request.set_request_id(request_id);
+    if (transport_extra != nullptr) {
+      request.mutable_transport_options()->PackFrom(*transport_extra);
+    }
 
     MarkRecvFinishedResponse* response = new MarkRecvFinishedResponse();
     auto done = [response](Status status) { delete response; };
@@ -332,6 +513,12 @@ class GrpcRemoteWorker : public WorkerInterface {
   WorkerCacheLogger* logger_;
   const string target_;
 
+  // If true, RecvTensor asks same-host senders to use shared memory.
+  const bool use_shared_memory_transport_;
+  // If positive, RecvTensor asks senders to send larger tensors in chunks of
+  // this size.
+  const int64 recv_tensor_chunk_bytes_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(GrpcRemoteWorker);
 };
 
@@ -339,9 +526,13 @@ WorkerInterface* NewGrpcRemoteWorker(SharedGrpcChannelPtr channel,
                                      ::grpc::CompletionQueue* completion_queue,
                                      thread::ThreadPool* callback_threadpool,
                                      WorkerCacheLogger* logger,
-                                     const string& target) {
+                                     const string& target,
+                                     bool use_shared_memory_transport,
+                                     int64 recv_tensor_chunk_bytes) {
   return new GrpcRemoteWorker(std::move(channel), completion_queue,
-                              callback_threadpool, logger, target);
+                              callback_threadpool, logger, target,
+                              use_shared_memory_transport,
+                              recv_tensor_chunk_bytes);
 }
 
 }  // namespace tensorflow
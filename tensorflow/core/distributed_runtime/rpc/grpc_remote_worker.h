@@ -26,11 +26,18 @@ namespace tensorflow {
 class WorkerCacheLogger;
 class WorkerInterface;
 
+// If `use_shared_memory_transport` is true, tensors received from a worker
+// on the same host are transferred through shared memory when the worker
+// supports it (see RPCOptions.use_shared_memory_transport). If
+// `recv_tensor_chunk_bytes` is positive, larger received tensors are fetched
+// in chunks of that size (see RPCOptions.recv_tensor_chunk_bytes).
 WorkerInterface* NewGrpcRemoteWorker(SharedGrpcChannelPtr channel,
                                      ::grpc::CompletionQueue* completion_queue,
                                      thread::ThreadPool* callback_threadpool,
                                      WorkerCacheLogger* logger,
-                                     const string& target);
+                                     const string& target,
+                                     bool use_shared_memory_transport = false,
+                                     int64 recv_tensor_chunk_bytes = 0);
 
 }  // namespace tensorflow
 
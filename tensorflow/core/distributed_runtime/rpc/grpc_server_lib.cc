@@ -388,8 +388,12 @@ Status GrpcServer::WorkerCacheFactory(const WorkerCacheFactoryOptions& options,
     return errors::InvalidArgument("Requested port ", requested_port,
                                    " differs from expected port ", bound_port_);
   }
+  const RPCOptions& rpc_options =
+      server_def_.default_session_config().rpc_options();
   *worker_cache = NewGrpcWorkerCacheWithLocalWorker(
-      channel_cache, grpc_worker_env(), worker_impl(), name_prefix);
+      channel_cache, grpc_worker_env(), worker_impl(), name_prefix,
+      rpc_options.use_shared_memory_transport(),
+      rpc_options.recv_tensor_chunk_bytes());
   return Status::OK();
 }
 
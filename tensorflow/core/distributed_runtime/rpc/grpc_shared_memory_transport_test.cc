@@ -0,0 +1,143 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_session.h"
+#include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/cluster.pb.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
+
+namespace tensorflow {
+namespace {
+
+// Starts `num_tasks` in-process servers that use the shared memory transport,
+// and returns their targets.
+std::vector<string> StartCluster(int num_tasks) {
+  std::vector<int> ports(num_tasks);
+  for (int i = 0; i < num_tasks; ++i) {
+    ports[i] = testing::PickUnusedPortOrDie();
+  }
+  std::vector<string> targets;
+  for (int task = 0; task < num_tasks; ++task) {
+    ServerDef server_def;
+    server_def.set_protocol("grpc");
+    server_def.set_job_name("localhost");
+    server_def.set_task_index(task);
+    auto* job_def = server_def.mutable_cluster()->add_job();
+    job_def->set_name("localhost");
+    for (int i = 0; i < num_tasks; ++i) {
+      (*job_def->mutable_tasks())[i] = strings::StrCat("localhost:", ports[i]);
+    }
+    ConfigProto* config = server_def.mutable_default_session_config();
+    (*config->mutable_device_count())["CPU"] = 1;
+    config->mutable_rpc_options()->set_use_shared_memory_transport(true);
+
+    std::unique_ptr<ServerInterface> server;
+    TF_CHECK_OK(NewServer(server_def, &server));
+    TF_CHECK_OK(server->Start());
+    targets.push_back(server->target());
+    // Started servers can't be shut down cleanly, so they live until the end
+    // of the test.
+    server.release();
+  }
+  return targets;
+}
+
+// Returns the shared memory segments created by this process that still
+// exist.
+std::vector<string> LeakedSegments() {
+  std::vector<string> segments;
+  Env::Default()
+      ->GetMatchingPaths(
+          strings::StrCat("/dev/shm/tf_recv_", getpid(), "_*"), &segments)
+      .IgnoreError();
+  return segments;
+}
+
+TEST(GrpcSharedMemoryTransportTest, RecvTensorBetweenTasks) {
+  if (SharedMemoryHostId().empty()) {
+    LOG(INFO) << "Shared memory not available, skipping test";
+    return;
+  }
+  const std::vector<string> targets = StartCluster(2);
+
+  // A tensor large enough to go through shared memory is fed on task 1 and
+  // consumed on task 0.  Feeding it keeps the optimizer from folding the
+  // transfer away.
+  const int kNumElements = 4 * kMinSharedMemoryTensorBytes / sizeof(float);
+  const char kTask0[] = "/job:localhost/replica:0/task:0/device:CPU:0";
+  const char kTask1[] = "/job:localhost/replica:0/task:1/device:CPU:0";
+  Scope root = Scope::NewRootScope();
+  auto large =
+      ops::Placeholder(root.WithOpName("large").WithDevice(kTask1), DT_FLOAT);
+  auto doubled =
+      ops::Mul(root.WithOpName("doubled").WithDevice(kTask0), large, 2.0f);
+  // A small tensor is sent inline in the RPC.
+  auto small =
+      ops::Placeholder(root.WithOpName("small").WithDevice(kTask1), DT_FLOAT);
+  auto small_doubled = ops::Mul(
+      root.WithOpName("small_doubled").WithDevice(kTask0), small, 2.0f);
+  GraphDef graph_def;
+  TF_ASSERT_OK(root.ToGraphDef(&graph_def));
+
+  SessionOptions options;
+  options.target = targets[0];
+  std::unique_ptr<GrpcSession> session;
+  TF_ASSERT_OK(GrpcSession::Create(options, &session));
+  TF_ASSERT_OK(session->Create(graph_def));
+
+  const int64 tensors_read = SharedMemoryTensorsReadCounter()->value();
+  for (int step = 0; step < 3; ++step) {
+    const float value = step + 3.0f;
+    Tensor large_value(DT_FLOAT, TensorShape({kNumElements}));
+    large_value.flat<float>().setConstant(value);
+    Tensor small_value(DT_FLOAT, TensorShape({16}));
+    small_value.flat<float>().setConstant(value + 2.0f);
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{"large:0", large_value},
+                               {"small:0", small_value}},
+                              {"doubled:0", "small_doubled:0"}, {}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>(std::vector<float>(kNumElements, 2 * value),
+                              TensorShape({kNumElements})),
+        outputs[0]);
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>(std::vector<float>(16, 2 * value + 4.0f),
+                              TensorShape({16})),
+        outputs[1]);
+  }
+  TF_ASSERT_OK(session->Close());
+
+  // Only the large tensor of each step went through shared memory.
+  EXPECT_EQ(3, SharedMemoryTensorsReadCounter()->value() - tensors_read);
+  EXPECT_TRUE(LeakedSegments().empty());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/io/proto_encode_helper.h"
 #include "tensorflow/core/platform/env.h"
@@ -137,11 +138,30 @@ static void EncodeSkeleton(const Tensor& val, io::ProtoEncodeHelper* e) {
 #endif
 }
 
+// Returns a grpc::Slice that points to the backing store of "val", and keeps a
+// reference to it until the slice is released.
+static ::grpc::Slice SharedTensorDataSlice(const Tensor& val) {
+  StringPiece tdata = val.tensor_data();
+  const TensorBuffer* buf = DMAHelper::buffer(&val);
+  buf->Ref();
+  return ::grpc::Slice(
+      const_cast<void*>(static_cast<const void*>(tdata.data())), tdata.size(),
+      [](void* backing) { static_cast<TensorBuffer*>(backing)->Unref(); },
+      const_cast<TensorBuffer*>(buf));
+}
+
+static const int kLargeTensorBytes = 1024;
+
+// Encoded protocol buffers must be smaller than this.
+static const int64 kProtoBufLimitBytes = 1LL << 31;
+
+// Upper bound of the tags and lengths of the fields that wrap the contents of
+// a large tensor in a RunGraphResponse: the recv entry, its name and tensor,
+// and the tensor content.
+static const int kMaxVarintHeaderBytes = 4 * (5 + 10);
+
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
                               ::grpc::ByteBuffer* result) {
-  const int kLargeTensorBytes = 1024;
-  const int64 kProtoBufLimitBytes = 1LL << 31;
-
   if (val.TotalBytes() > kProtoBufLimitBytes) {
     size_t exceeded_bytes = val.TotalBytes() - kProtoBufLimitBytes;
     LOG(FATAL) << "Cannot encode a Tensor that exceeds the 2GB protobuf limit. "
@@ -234,13 +254,7 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
 
     if (share_tensor_slice_memory) {
       // (E) Encode tensor data, but by sharing backing store
-      const TensorBuffer* buf = DMAHelper::buffer(&val);
-      buf->Ref();
-      slices[1] = ::grpc::Slice(
-          const_cast<void*>(static_cast<const void*>(tdata.data())),
-          tdata.size(),
-          [](void* backing) { static_cast<TensorBuffer*>(backing)->Unref(); },
-          const_cast<TensorBuffer*>(buf));
+      slices[1] = SharedTensorDataSlice(val);
       num_slices += 1;
     }
     size_t total_bytes = 0;
@@ -254,5 +268,110 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
   }
 }
 
+// We hand-encode the "recv" entries of large tensors the same way as the
+// "tensor" field in EncodeTensorToByteBuffer:
+//
+// <tag and varint32 length of RunGraphResponse::recv entry>
+// <NamedTensorProto::name field>
+// <tag and varint32 length of NamedTensorProto::tensor>
+// <skeleton of the TensorProto>
+// <tag and varint32 length of TensorProto::tensor_content>
+// <actual data for the tensor, in a grpc::Slice that shares its backing store>
+//
+// All the other fields, and the "recv" entries of small tensors, are
+// serialized with the protocol buffer library. Since parsers accept fields in
+// any order, the other fields are encoded first.
+Status EncodeRunGraphResponseToByteBuffer(
+    const RunGraphResponse& header,
+    const std::vector<std::pair<string, Tensor>>& recvs,
+    ::grpc::ByteBuffer* result) {
+  auto too_large = [](int64 bytes) {
+    return errors::ResourceExhausted(
+        "Cannot encode a RunGraphResponse that exceeds the 2GB protobuf "
+        "limit. Exceeded bytes: ",
+        bytes - kProtoBufLimitBytes + 1);
+  };
+  std::vector<::grpc::Slice> slices;
+  // Size of `slices`.
+  int64 total_bytes = 0;
+  string pending;
+  if (!header.AppendToString(&pending)) {
+    return errors::Internal("Failed to serialize a RunGraphResponse");
+  }
+  auto flush_pending = [&slices, &pending, &total_bytes]() {
+    if (pending.empty()) return;
+    slices.emplace_back(pending.data(), pending.size());
+    total_bytes += pending.size();
+    pending.clear();
+  };
+
+  for (const auto& recv : recvs) {
+    const string& name = recv.first;
+    const Tensor& val = recv.second;
+    if (!DataTypeCanUseMemcpy(val.dtype()) ||
+        val.TotalBytes() <= kLargeTensorBytes) {
+      RunGraphResponse small;
+      NamedTensorProto* named = small.add_recv();
+      named->set_name(name);
+      val.AsProtoTensorContent(named->mutable_tensor());
+      const int64 small_bytes = small.ByteSizeLong();
+      if (total_bytes + pending.size() + small_bytes >= kProtoBufLimitBytes) {
+        return too_large(total_bytes + pending.size() + small_bytes);
+      }
+      small.AppendToString(&pending);
+      continue;
+    }
+
+    // Bound the encoding size before it is computed with 32-bit lengths.
+    StringPiece tdata = val.tensor_data();
+    const int64 max_recv_bytes = tdata.size() + name.size() +
+                                 SkeletonEncodingSizeUpperBound(val) +
+                                 kMaxVarintHeaderBytes;
+    if (total_bytes + pending.size() + max_recv_bytes >= kProtoBufLimitBytes) {
+      return too_large(total_bytes + pending.size() + max_recv_bytes);
+    }
+
+    gtl::InlinedVector<char, 128> skeleton(SkeletonEncodingSizeUpperBound(val));
+    io::ProtoEncodeHelper e_skeleton(skeleton.data(), skeleton.size());
+    EncodeSkeleton(val, &e_skeleton);
+
+    const uint32 tensor_proto_bytes =
+        e_skeleton.size() +
+        VarLengthEncodingSize(TensorProto::kTensorContentFieldNumber,
+                              tdata.size());
+    const uint32 named_tensor_bytes =
+        VarLengthEncodingSize(NamedTensorProto::kNameFieldNumber,
+                              name.size()) +
+        VarLengthEncodingSize(NamedTensorProto::kTensorFieldNumber,
+                              tensor_proto_bytes);
+    const size_t encoder_size =
+        VarLengthEncodingSize(RunGraphResponse::kRecvFieldNumber,
+                              named_tensor_bytes) -
+        tdata.size();
+
+    gtl::InlinedVector<char, 1024> space(encoder_size);
+    io::ProtoEncodeHelper e(space.data(), space.size());
+    e.WriteVarlengthBeginning(RunGraphResponse::kRecvFieldNumber,
+                              named_tensor_bytes);
+    e.WriteString(NamedTensorProto::kNameFieldNumber, name);
+    e.WriteVarlengthBeginning(NamedTensorProto::kTensorFieldNumber,
+                              tensor_proto_bytes);
+    e.WriteRawBytes(StringPiece(e_skeleton.data(), e_skeleton.size()));
+    e.WriteVarlengthBeginning(TensorProto::kTensorContentFieldNumber,
+                              tdata.size());
+    CHECK_EQ(e.size(), encoder_size);
+
+    pending.append(e.data(), e.size());
+    flush_pending();
+    slices.push_back(SharedTensorDataSlice(val));
+    total_bytes += tdata.size();
+  }
+  flush_pending();
+
+  ::grpc::ByteBuffer tmp(slices.data(), slices.size());
+  result->Swap(&tmp);
+  return Status::OK();
+}
+
 }  // namespace grpc
 }  // namespace tensorflow
@@ -16,11 +16,17 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_TENSOR_CODING_H_
 
+#include <utility>
+#include <vector>
+
 #include "grpcpp/impl/codegen/byte_buffer.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 class Tensor;
 class RecvTensorResponse;
+class RunGraphResponse;
 
 // TODO(jeff,sanjay): this should not be grpc specific.  Instead of
 // grpc::ByteBuffer*, it should accept an object of an interface type
@@ -49,6 +55,20 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val, bool require_ack,
                               ::grpc::ByteBuffer* result);
 
+// Encode a RunGraphResponse into a byte buffer in a format that is parseable
+// as a RunGraphResponse protocol buffer holding the fields of "header", and
+// the tensors of "recvs" in its "recv" field.
+//
+// As in EncodeTensorToByteBuffer, the byte buffer shares the backing store of
+// large tensors instead of copying their contents.
+//
+// Returns an error if the encoding would exceed the 2GB protobuf limit.
+// Discards original contents of *result.
+Status EncodeRunGraphResponseToByteBuffer(
+    const RunGraphResponse& header,
+    const std::vector<std::pair<string, Tensor>>& recvs,
+    ::grpc::ByteBuffer* result);
+
 }  // namespace grpc
 }  // namespace tensorflow
 
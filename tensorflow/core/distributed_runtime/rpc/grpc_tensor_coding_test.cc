@@ -19,6 +19,7 @@ limitations under the License.
 #include "grpcpp/support/slice.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
@@ -100,4 +101,49 @@ TEST_F(GrpcTensorCodingTest, Simple) {
 
 TEST_F(GrpcTensorCodingTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(GrpcTensorCodingTest, RunGraphResponse) {
+  RunGraphResponse header;
+  header.mutable_step_stats()->add_dev_stats()->set_device("/cpu:0");
+  header.set_status_code(error::OUT_OF_RANGE);
+  header.set_status_error_message("End of sequence");
+
+  std::vector<std::pair<string, Tensor>> recvs;
+  recvs.emplace_back("small", test::AsTensor<float>({1.0, 2.0}));
+  Tensor large(DT_INT64, TensorShape({10, 1000}));
+  large.flat<int64>().setConstant(17);
+  recvs.emplace_back("large", large);
+  recvs.emplace_back("strings", test::AsTensor<tstring>({"a", "bc"}));
+  recvs.emplace_back("", Tensor(DT_FLOAT, TensorShape({1000, 0})));
+  recvs.emplace_back("large_copy", large);
+
+  ::grpc::ByteBuffer buf;
+  TF_ASSERT_OK(grpc::EncodeRunGraphResponseToByteBuffer(header, recvs, &buf));
+  std::vector<::grpc::Slice> slices;
+  (void)buf.Dump(&slices);
+  string tmp;
+  for (const auto& s : slices) {
+    tmp.append(reinterpret_cast<const char*>(s.begin()), s.size());
+  }
+
+  RunGraphResponse response;
+  ASSERT_TRUE(response.ParseFromString(tmp));
+  EXPECT_EQ(header.step_stats().DebugString(),
+            response.step_stats().DebugString());
+  EXPECT_EQ(error::OUT_OF_RANGE, response.status_code());
+  EXPECT_EQ("End of sequence", response.status_error_message());
+  ASSERT_EQ(5, response.recv_size());
+  for (int i = 0; i < response.recv_size(); ++i) {
+    EXPECT_EQ(recvs[i].first, response.recv(i).name());
+    Tensor result_tensor;
+    ASSERT_TRUE(result_tensor.FromProto(response.recv(i).tensor()));
+    EXPECT_EQ(recvs[i].second.dtype(), result_tensor.dtype());
+    EXPECT_EQ(recvs[i].second.shape(), result_tensor.shape());
+    if (recvs[i].second.dtype() == DT_INT64) {
+      test::ExpectTensorEqual<int64>(recvs[i].second, result_tensor);
+    } else {
+      EXPECT_EQ(recvs[i].second.DebugString(), result_tensor.DebugString());
+    }
+  }
+}
+
 }  // namespace tensorflow
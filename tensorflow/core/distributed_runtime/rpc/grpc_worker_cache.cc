@@ -34,11 +34,15 @@ class GrpcWorkerCache : public WorkerCachePartial {
   explicit GrpcWorkerCache(std::shared_ptr<GrpcChannelCache> channel_cache,
                            WorkerInterface* local_worker,
                            const string& local_target,
-                           GrpcWorkerEnv* worker_env)
+                           GrpcWorkerEnv* worker_env,
+                           bool use_shared_memory_transport,
+                           int64 recv_tensor_chunk_bytes)
       : local_target_(local_target),
         local_worker_(local_worker),
         channel_cache_(channel_cache),
         worker_env_(worker_env),
+        use_shared_memory_transport_(use_shared_memory_transport),
+        recv_tensor_chunk_bytes_(recv_tensor_chunk_bytes),
         next_round_robin_assignment_(0) {}
 
   void ListWorkers(std::vector<string>* workers) const override {
@@ -61,7 +65,8 @@ class GrpcWorkerCache : public WorkerCachePartial {
       size_t index = AssignWorkerToThread(target);
       return NewGrpcRemoteWorker(
           channel, worker_env_->GetCompletionQueue(index),
-          worker_env_->GetThreadPool(), &logger_, target);
+          worker_env_->GetThreadPool(), &logger_, target,
+          use_shared_memory_transport_, recv_tensor_chunk_bytes_);
     }
   }
 
@@ -74,6 +79,11 @@ class GrpcWorkerCache : public WorkerCachePartial {
     }
   }
 
+  bool GetTaskAddress(const string& task, string* address) override {
+    *address = channel_cache_->TranslateTask(task);
+    return !address->empty();
+  }
+
   Status GetEagerClientCache(
       std::unique_ptr<eager::EagerClientCache>* eager_client_cache) override {
     eager_client_cache->reset(eager::NewGrpcEagerClientCache(channel_cache_));
@@ -109,6 +119,8 @@ class GrpcWorkerCache : public WorkerCachePartial {
   std::shared_ptr<GrpcChannelCache> channel_cache_;
   WorkerCacheLogger logger_;
   GrpcWorkerEnv* worker_env_;  // Not owned
+  const bool use_shared_memory_transport_;
+  const int64 recv_tensor_chunk_bytes_;
 
   mutex assignment_mu_;
   std::unordered_map<std::string, size_t> target_assignments_
@@ -163,13 +175,18 @@ GrpcWorkerEnv* CreateGrpcWorkerEnv() {
 WorkerCacheInterface* NewGrpcWorkerCache(std::shared_ptr<GrpcChannelCache> cc,
                                          GrpcWorkerEnv* worker_env) {
   return new GrpcWorkerCache(cc, /*local_worker=*/nullptr, /*local_target=*/"",
-                             worker_env);
+                             worker_env,
+                             /*use_shared_memory_transport=*/false,
+                             /*recv_tensor_chunk_bytes=*/0);
 }
 
 WorkerCacheInterface* NewGrpcWorkerCacheWithLocalWorker(
     std::shared_ptr<GrpcChannelCache> cc, GrpcWorkerEnv* worker_env,
-    WorkerInterface* local_worker, const string& local_target) {
-  return new GrpcWorkerCache(cc, local_worker, local_target, worker_env);
+    WorkerInterface* local_worker, const string& local_target,
+    bool use_shared_memory_transport, int64 recv_tensor_chunk_bytes) {
+  return new GrpcWorkerCache(cc, local_worker, local_target, worker_env,
+                             use_shared_memory_transport,
+                             recv_tensor_chunk_bytes);
 }
 
 }  // namespace tensorflow
@@ -68,9 +68,15 @@ GrpcWorkerEnv* CreateGrpcWorkerEnv();
 WorkerCacheInterface* NewGrpcWorkerCache(std::shared_ptr<GrpcChannelCache> cc,
                                          GrpcWorkerEnv* worker_env);
 
+// If `use_shared_memory_transport` is true, the remote workers receive tensors
+// from workers on the same host through shared memory. If
+// `recv_tensor_chunk_bytes` is positive, they receive larger tensors in chunks
+// of that size.
 WorkerCacheInterface* NewGrpcWorkerCacheWithLocalWorker(
     std::shared_ptr<GrpcChannelCache> cc, GrpcWorkerEnv* worker_env,
-    WorkerInterface* local_worker, const string& local_target);
+    WorkerInterface* local_worker, const string& local_target,
+    bool use_shared_memory_transport = false,
+    int64 recv_tensor_chunk_bytes = 0);
 
 }  // namespace tensorflow
 #endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_WORKER_CACHE_H_
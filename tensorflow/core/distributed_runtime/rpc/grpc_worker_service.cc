@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/local_device.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/distributed_runtime/chunked_tensor_transfer.h"
 #include "tensorflow/core/distributed_runtime/graph_mgr.h"
 #include "tensorflow/core/distributed_runtime/rendezvous_mgr_interface.h"
 #include "tensorflow/core/distributed_runtime/rpc/async_service_interface.h"
@@ -39,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_session.h"
@@ -144,7 +146,6 @@ class GrpcWorkerServiceThread {
     SETUP_FOR_REQUEST(CompleteInstance, 10, true);
     SETUP_FOR_REQUEST(GetStepSequence, 10, true);
     SETUP_FOR_REQUEST(RecvBuf, 500, true);
-    SETUP_FOR_REQUEST(RunGraph, 100, true);
     SETUP_FOR_REQUEST(CleanupGraph, 100, false);
     SETUP_FOR_REQUEST(MarkRecvFinished, 10, false);
 
@@ -157,6 +158,13 @@ class GrpcWorkerServiceThread {
          ++i) {
       EnqueueRecvTensorRequestRaw();
     }
+    for (int i = 0;
+         i < gtl::FindWithDefault(
+                 queue_depth_, static_cast<int>(GrpcWorkerMethod::kRunGraph),
+                 100);
+         ++i) {
+      EnqueueRunGraphRequestRaw();
+    }
 
     void* tag;
     bool ok;
@@ -234,33 +242,35 @@ class GrpcWorkerServiceThread {
       WorkerCall<MarkRecvFinishedRequest, MarkRecvFinishedResponse>* call) {
     VLOG(1) << "Clean cache entry for request " << call->request.request_id();
     worker_->RemoveCacheEntryForId(call->request.request_id());
+    if (call->request.has_transport_options()) {
+      worker_->ReleaseRecvTensorTransfer(call->request.transport_options());
+    }
     call->SendResponse(::grpc::Status::OK);
     ENQUEUE_REQUEST(MarkRecvFinished, false);
   }
 
-  void RunGraphHandler(WorkerCall<RunGraphRequest, RunGraphResponse>* call) {
+  void RunGraphHandlerRaw(
+      WorkerCall<RunGraphRequest, ::grpc::ByteBuffer>* call) {
     Schedule([this, call]() {
       CallOptions* call_opts = new CallOptions;
-      ProtoRunGraphRequest* wrapped_request =
-          new ProtoRunGraphRequest(&call->request);
-      NonOwnedProtoRunGraphResponse* wrapped_response =
-          new NonOwnedProtoRunGraphResponse(&call->response);
+      bool* compress_response = new bool(false);
       call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
-      worker_->RunGraphAsync(call_opts, wrapped_request, wrapped_response,
-                             [call, call_opts, wrapped_request,
-                              wrapped_response](const Status& s) {
-                               VLOG(1) << "RunGraph::Done";
-                               if (!s.ok()) {
-                                 VLOG(1) << "Bad response from RunGraph:" << s;
-                               }
-                               call->ClearCancelCallback();
-                               delete call_opts;
-                               delete wrapped_request;
-                               delete wrapped_response;
-                               call->SendResponse(ToGrpcStatus(s));
-                             });
+      worker_->GrpcRunGraphAsync(
+          call_opts, &call->request, &call->response, compress_response,
+          [call, call_opts, compress_response](const Status& s) {
+            VLOG(1) << "RunGraph::Done";
+            if (!s.ok()) {
+              VLOG(1) << "Bad response from RunGraph:" << s;
+            } else if (*compress_response) {
+              call->SetResponseCompressionAlgorithm(GRPC_COMPRESS_GZIP);
+            }
+            call->ClearCancelCallback();
+            delete call_opts;
+            delete compress_response;
+            call->SendResponse(ToGrpcStatus(s));
+          });
     });
-    ENQUEUE_REQUEST(RunGraph, true);
+    EnqueueRunGraphRequestRaw();
   }
 
   void RecvTensorHandlerRaw(
@@ -352,6 +362,19 @@ class GrpcWorkerServiceThread {
     }
   }
 
+  void EnqueueRunGraphRequestRaw() {
+    mutex_lock l(shutdown_mu_);
+    if (!is_shutdown_) {
+      Call<GrpcWorkerServiceThread, grpc::WorkerService::AsyncService,
+           RunGraphRequest, ::grpc::ByteBuffer>::
+          EnqueueRequestForMethod(
+              worker_service_, cq_.get(),
+              static_cast<int>(GrpcWorkerMethod::kRunGraph),
+              &GrpcWorkerServiceThread::RunGraphHandlerRaw,
+              true /* supports cancel*/);
+    }
+  }
+
   GrpcWorker* const worker_ = nullptr;  // Not owned.
   std::unique_ptr<::grpc::ServerCompletionQueue> cq_;
   std::unique_ptr<Thread> thread_;
@@ -423,10 +446,19 @@ GrpcWorker::GrpcWorker(WorkerEnv* worker_env, const ConfigProto& config)
       recv_buf_max_chunk_(
           config.experimental().recv_buf_max_chunk() > 0
               ? config.experimental().recv_buf_max_chunk()
-              : (config.experimental().recv_buf_max_chunk() < 0 ? 0 : 4096)) {
+              : (config.experimental().recv_buf_max_chunk() < 0 ? 0 : 4096)),
+      run_graph_compression_(
+          AdaptiveCompression::FromRPCOptions(config.rpc_options())) {
   if (config.rpc_options().cache_rpc_response()) {
     EnableResponseCache();
   }
+  if (config.rpc_options().use_shared_memory_transport()) {
+    if (SharedMemoryHostId().empty()) {
+      LOG(WARNING) << "Shared memory transport is not available on this host.";
+    } else {
+      use_shared_memory_ = true;
+    }
+  }
 }
 
 void GrpcWorker::EnableResponseCache() {
@@ -434,6 +466,78 @@ void GrpcWorker::EnableResponseCache() {
   response_cache_ = absl::make_unique<GrpcResponseCache>();
 }
 
+namespace {
+
+// Encodes a response that only carries the tensor metadata and `extra`, the
+// information the receiver needs to get the contents out of band.
+void EncodeTensorMetadata(const Tensor& val, const protobuf::Message& extra,
+                          bool require_ack, ::grpc::ByteBuffer* result) {
+  RecvTensorResponse response;
+  response.mutable_tensor()->set_dtype(val.dtype());
+  val.shape().AsProto(response.mutable_tensor()->mutable_tensor_shape());
+  response.mutable_transport_options()->PackFrom(extra);
+  response.set_require_ack(require_ack);
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  grpc::EncodeRecvTensorResponseToByteBuffer(response, result);
+}
+
+}  // namespace
+
+void GrpcWorker::GrpcRunGraphAsync(CallOptions* opts,
+                                   const RunGraphRequest* request,
+                                   ::grpc::ByteBuffer* response,
+                                   bool* compress_response,
+                                   StatusCallback done) {
+  ProtoRunGraphRequest* wrapped_request = new ProtoRunGraphRequest(request);
+  InMemoryRunGraphResponse* wrapped_response = new InMemoryRunGraphResponse;
+  RunGraphAsync(
+      opts, wrapped_request, wrapped_response,
+      [this, wrapped_request, wrapped_response, response, compress_response,
+       done](const Status& s) {
+        std::unique_ptr<ProtoRunGraphRequest> request_deleter(wrapped_request);
+        std::unique_ptr<InMemoryRunGraphResponse> response_deleter(
+            wrapped_response);
+        if (!s.ok()) {
+          done(s);
+          return;
+        }
+
+        // Everything but the fetched tensors is serialized as usual.
+        RunGraphResponse header;
+        header.mutable_step_stats()->Swap(
+            wrapped_response->mutable_step_stats());
+        header.mutable_cost_graph()->Swap(
+            wrapped_response->mutable_cost_graph());
+        for (size_t i = 0; i < wrapped_response->num_partition_graphs(); ++i) {
+          header.add_partition_graph()->Swap(
+              wrapped_response->mutable_partition_graph(i));
+        }
+        if (wrapped_response->status_code() != error::OK) {
+          header.set_status_code(wrapped_response->status_code());
+          header.set_status_error_message(
+              wrapped_response->status_error_message());
+        }
+
+        std::vector<std::pair<string, Tensor>> recvs(
+            wrapped_response->num_recvs());
+        std::vector<StringPiece> payload;
+        for (size_t i = 0; i < recvs.size(); ++i) {
+          recvs[i].first = wrapped_response->recv_key(i);
+          Status status = wrapped_response->RecvValue(i, &recvs[i].second);
+          if (!status.ok()) {
+            done(status);
+            return;
+          }
+          if (DataTypeCanUseMemcpy(recvs[i].second.dtype())) {
+            payload.push_back(recvs[i].second.tensor_data());
+          }
+        }
+        *compress_response = run_graph_compression_ != nullptr &&
+                             run_graph_compression_->ShouldCompress(payload);
+        done(grpc::EncodeRunGraphResponseToByteBuffer(header, recvs, response));
+      });
+}
+
 // GrpcRecvTensorAsync: unlike the other Worker methods, which use protocol
 // buffers for a response object, to avoid extra protocol buffer serialization
 // overhead we generate our response directly into a ::grpc::ByteBuffer object
@@ -445,13 +549,83 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
   const int64 request_id = request->request_id();
   const int64 step_id = request->step_id();
 
+  // Chunks of a tensor announced by an earlier response are served from
+  // chunked_tensors_, without going through the rendezvous.
+  RecvTensorChunkRequest chunk_request;
+  if (request->transport_options().UnpackTo(&chunk_request)) {
+    Tensor chunk;
+    Status s = chunked_tensors_.GetChunk(chunk_request, &chunk);
+    if (s.ok()) {
+      grpc::EncodeTensorToByteBuffer(/*is_dead=*/false, chunk,
+                                     /*require_ack=*/false, response);
+    }
+    done(s);
+    return;
+  }
+
+  // Likewise for tensors whose shared memory segment the receiver could not
+  // read, which are sent inline instead.
+  SharedMemoryFallbackRequest fallback_request;
+  if (request->transport_options().UnpackTo(&fallback_request)) {
+    Tensor tensor;
+    Status s = shared_memory_tensors_.Release(
+        fallback_request.segment_name(), &tensor);
+    if (s.ok()) {
+      grpc::EncodeTensorToByteBuffer(/*is_dead=*/false, tensor,
+                                     /*require_ack=*/false, response);
+    }
+    done(s);
+    return;
+  }
+
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
 
-  auto do_response = [response, done, cache_enabled](const Tensor& tensor,
-                                                     bool is_dead,
-                                                     const Status& status) {
+  // Large tensors are passed through shared memory if the receiver asked for
+  // it and runs on the same host, and otherwise in chunks if the receiver
+  // asked for it.
+  bool use_shared_memory = false;
+  int64 chunk_bytes = 0;
+  SharedMemoryRecvTensorOptions shared_memory_options;
+  ChunkedRecvTensorOptions chunked_options;
+  if (request->transport_options().UnpackTo(&shared_memory_options)) {
+    use_shared_memory = use_shared_memory_ && shared_memory_options.host_id() ==
+                                                  SharedMemoryHostId();
+    chunk_bytes = shared_memory_options.chunk_bytes();
+  } else if (request->transport_options().UnpackTo(&chunked_options)) {
+    chunk_bytes = chunked_options.chunk_bytes();
+  }
+
+  auto do_response = [this, response, done, cache_enabled, use_shared_memory,
+                      chunk_bytes, step_id](const Tensor& tensor, bool is_dead,
+                                            const Status& status) {
     if (status.ok()) {
-      grpc::EncodeTensorToByteBuffer(is_dead, tensor, cache_enabled, response);
+      bool encoded = false;
+      if (use_shared_memory && !is_dead &&
+          CanSendThroughSharedMemory(tensor)) {
+        SharedMemoryTensorExtra extra;
+        Status s = shared_memory_tensors_.Write(step_id, tensor, &extra);
+        if (s.ok()) {
+          EncodeTensorMetadata(tensor, extra, cache_enabled, response);
+          encoded = true;
+        } else {
+          VLOG(1) << "Falling back to RPC for RecvTensor: " << s;
+        }
+      }
+      if (!encoded && !is_dead && ShouldSendInChunks(tensor, chunk_bytes)) {
+        ChunkedTensorExtra extra;
+        Status s =
+            chunked_tensors_.Register(step_id, tensor, chunk_bytes, &extra);
+        if (s.ok()) {
+          EncodeTensorMetadata(tensor, extra, cache_enabled, response);
+          encoded = true;
+        } else {
+          VLOG(1) << "Falling back to a single RecvTensor response: " << s;
+        }
+      }
+      if (!encoded) {
+        grpc::EncodeTensorToByteBuffer(is_dead, tensor, cache_enabled,
+                                       response);
+      }
     }
     done(status);
   };
@@ -734,6 +908,8 @@ void GrpcWorker::CleanupGraphAsync(const CleanupGraphRequest* request,
     // a worker crashes before acking a request.
     response_cache_->CleanEntriesForStep(request->step_id());
   }
+  chunked_tensors_.CleanupStep(request->step_id());
+  shared_memory_tensors_.CleanupStep(request->step_id());
   Worker::CleanupGraphAsync(request, response, done);
 }
 
@@ -745,6 +921,18 @@ void GrpcWorker::RemoveCacheEntryForId(int64 request_id) {
   }
 }
 
+void GrpcWorker::ReleaseRecvTensorTransfer(
+    const protobuf::Any& transport_options) {
+  SharedMemoryTensorExtra shared_memory_extra;
+  ChunkedTensorExtra chunked_extra;
+  if (transport_options.UnpackTo(&shared_memory_extra)) {
+    shared_memory_tensors_.Release(shared_memory_extra.segment_name(), nullptr)
+        .IgnoreError();
+  } else if (transport_options.UnpackTo(&chunked_extra)) {
+    chunked_tensors_.Release(chunked_extra.transfer_id()).IgnoreError();
+  }
+}
+
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* env,
                                           const ConfigProto& config) {
   return std::unique_ptr<GrpcWorker>(new GrpcWorker(env, config));
@@ -19,8 +19,11 @@ limitations under the License.
 #include <memory>
 #include <unordered_map>
 #include "grpcpp/server_builder.h"
+#include "tensorflow/core/distributed_runtime/adaptive_compression.h"
+#include "tensorflow/core/distributed_runtime/chunked_tensor_transfer.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_response_cache.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
 
@@ -46,6 +49,14 @@ class GrpcWorker : public Worker {
                                    ::grpc::ByteBuffer* response,
                                    StatusCallback done);
 
+  // Specialized version of RunGraph for gRPC, which avoids copying the
+  // fetched tensors. Sets `*compress_response` to true if the response is
+  // worth compressing (see RPCOptions.adaptive_compression_min_bytes).
+  virtual void GrpcRunGraphAsync(CallOptions* opts,
+                                 const RunGraphRequest* request,
+                                 ::grpc::ByteBuffer* response,
+                                 bool* compress_response, StatusCallback done);
+
   void LoggingAsync(const LoggingRequest* request, LoggingResponse* response,
                     StatusCallback done) override;
 
@@ -62,9 +73,23 @@ class GrpcWorker : public Worker {
 
   void RemoveCacheEntryForId(int64 request_id);
 
+  // Releases what the sender kept for a RecvTensor response whose contents
+  // were transferred out of band, as described by `transport_options`.
+  void ReleaseRecvTensorTransfer(const protobuf::Any& transport_options);
+
  private:
   std::unique_ptr<GrpcResponseCache> response_cache_;
   const int32 recv_buf_max_chunk_;
+  // If true, RecvTensor responses to same-host receivers that support it
+  // carry the tensor contents in shared memory.
+  bool use_shared_memory_ = false;
+  // Tensors sent through shared memory, until their receivers read them.
+  SharedMemoryTensorTable shared_memory_tensors_;
+  // Large tensors whose contents are fetched by their receivers in chunks.
+  ChunkedTensorTable chunked_tensors_;
+  // Decides whether RunGraph responses are compressed. Null if adaptive
+  // compression is disabled.
+  std::unique_ptr<AdaptiveCompression> run_graph_compression_;
 };
 
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* worker_env,
@@ -0,0 +1,257 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/error.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+#if defined(__linux__)
+
+namespace {
+
+string ComputeSharedMemoryHostId() {
+  // Processes only share segments if they run on the same kernel and see the
+  // same /dev/shm mount, e.g. not from different containers.
+  string boot_id;
+  Status s = ReadFileToString(Env::Default(),
+                              "/proc/sys/kernel/random/boot_id", &boot_id);
+  if (!s.ok()) {
+    VLOG(1) << "Shared memory transport disabled: " << s;
+    return "";
+  }
+  struct stat st;
+  if (stat("/dev/shm", &st) != 0) {
+    VLOG(1) << "Shared memory transport disabled: /dev/shm not found";
+    return "";
+  }
+  str_util::StripTrailingWhitespace(&boot_id);
+  // Segments are only accessible to the user that created them.
+  return strings::StrCat(boot_id, ":", static_cast<uint64>(st.st_dev), ":",
+                         static_cast<uint64>(st.st_ino), ":", geteuid());
+}
+
+// Closes a file descriptor and unmaps a region on destruction.
+class ScopedMapping {
+ public:
+  explicit ScopedMapping(int fd) : fd_(fd) {}
+  ~ScopedMapping() {
+    if (addr_ != nullptr) munmap(addr_, size_);
+    close(fd_);
+  }
+
+  Status Map(size_t size, int prot) {
+    void* addr = mmap(nullptr, size, prot, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) return IOError("mmap", errno);
+    addr_ = addr;
+    size_ = size;
+    return Status::OK();
+  }
+
+  void* addr() const { return addr_; }
+
+ private:
+  const int fd_;
+  void* addr_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace
+
+const string& SharedMemoryHostId() {
+  static const string* host_id = new string(ComputeSharedMemoryHostId());
+  return *host_id;
+}
+
+Status WriteTensorToSharedMemory(const Tensor& tensor,
+                                 SharedMemoryTensorExtra* extra) {
+  if (!DataTypeCanUseMemcpy(tensor.dtype())) {
+    return errors::InvalidArgument(
+        "Can't send tensors of type ", DataTypeString(tensor.dtype()),
+        " through shared memory");
+  }
+  const StringPiece data = tensor.tensor_data();
+  if (data.empty()) {
+    return errors::InvalidArgument("Can't send empty tensors through shared "
+                                   "memory");
+  }
+  const string name =
+      strings::StrCat("/tf_recv_", getpid(), "_", random::New64());
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) return IOError(strings::StrCat("shm_open ", name), errno);
+  Status s;
+  {
+    ScopedMapping mapping(fd);
+    // Reserves the pages up front: with ftruncate alone a full /dev/shm is
+    // only noticed when memcpy touches a missing page, which raises SIGBUS.
+    int err;
+    do {
+      err = posix_fallocate(fd, 0, data.size());
+    } while (err == EINTR);
+    if (err != 0) {
+      s = IOError(strings::StrCat("posix_fallocate ", name), err);
+    } else {
+      s = mapping.Map(data.size(), PROT_WRITE);
+    }
+    if (s.ok()) memcpy(mapping.addr(), data.data(), data.size());
+  }
+  if (!s.ok()) {
+    shm_unlink(name.c_str());
+    return s;
+  }
+  extra->set_segment_name(name);
+  extra->set_size(data.size());
+  return Status::OK();
+}
+
+Status ReadTensorFromSharedMemory(const SharedMemoryTensorExtra& extra,
+                                  Tensor* tensor) {
+  const string& name = extra.segment_name();
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  const int open_errno = errno;
+  // The sender is done with the segment, so it can be unlinked right away,
+  // even if it can't be read; it is freed once the mapping below goes away.
+  shm_unlink(name.c_str());
+  if (fd < 0) return IOError(strings::StrCat("shm_open ", name), open_errno);
+
+  ScopedMapping mapping(fd);
+  const StringPiece data = tensor->tensor_data();
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return IOError(strings::StrCat("fstat ", name), errno);
+  }
+  if (extra.size() != static_cast<int64>(data.size()) ||
+      st.st_size != extra.size()) {
+    return errors::Internal("Shared memory segment ", name, " has ",
+                            st.st_size, " bytes, expected ", data.size());
+  }
+  TF_RETURN_IF_ERROR(mapping.Map(data.size(), PROT_READ));
+  memcpy(const_cast<char*>(data.data()), mapping.addr(), data.size());
+  SharedMemoryTensorsReadCounter()->IncrementBy(1);
+  return Status::OK();
+}
+
+void RemoveSharedMemorySegment(const SharedMemoryTensorExtra& extra) {
+  shm_unlink(extra.segment_name().c_str());
+}
+
+#else  // defined(__linux__)
+
+const string& SharedMemoryHostId() {
+  static const string* host_id = new string();
+  return *host_id;
+}
+
+Status WriteTensorToSharedMemory(const Tensor& tensor,
+                                 SharedMemoryTensorExtra* extra) {
+  return errors::Unimplemented(
+      "Shared memory transport is not supported on this platform");
+}
+
+Status ReadTensorFromSharedMemory(const SharedMemoryTensorExtra& extra,
+                                  Tensor* tensor) {
+  return errors::Unimplemented(
+      "Shared memory transport is not supported on this platform");
+}
+
+void RemoveSharedMemorySegment(const SharedMemoryTensorExtra& extra) {}
+
+#endif  // defined(__linux__)
+
+bool CanSendThroughSharedMemory(const Tensor& tensor) {
+  return DataTypeCanUseMemcpy(tensor.dtype()) &&
+         static_cast<int64>(tensor.TotalBytes()) >= kMinSharedMemoryTensorBytes;
+}
+
+monitoring::CounterCell* SharedMemoryTensorsReadCounter() {
+  static auto* counter = monitoring::Counter<0>::New(
+      "/tensorflow/core/shared_memory_transport/tensors_read",
+      "The number of tensors received through shared memory.");
+  return counter->GetCell();
+}
+
+SharedMemoryTensorTable::~SharedMemoryTensorTable() {
+  mutex_lock l(mu_);
+  for (const auto& entry : tensors_) {
+    SharedMemoryTensorExtra extra;
+    extra.set_segment_name(entry.first);
+    RemoveSharedMemorySegment(extra);
+  }
+}
+
+Status SharedMemoryTensorTable::Write(int64 step_id, const Tensor& tensor,
+                                      SharedMemoryTensorExtra* extra) {
+  TF_RETURN_IF_ERROR(WriteTensorToSharedMemory(tensor, extra));
+  mutex_lock l(mu_);
+  tensors_[extra->segment_name()] = {step_id, tensor};
+  return Status::OK();
+}
+
+Status SharedMemoryTensorTable::Release(const string& segment_name,
+                                        Tensor* tensor) {
+  mutex_lock l(mu_);
+  auto it = tensors_.find(segment_name);
+  if (it == tensors_.end()) {
+    return errors::NotFound("Unknown shared memory segment ", segment_name,
+                            ", its step may have been cleaned up");
+  }
+  SharedMemoryTensorExtra extra;
+  extra.set_segment_name(segment_name);
+  RemoveSharedMemorySegment(extra);
+  if (tensor != nullptr) {
+    *tensor = std::move(it->second.tensor);
+  }
+  tensors_.erase(it);
+  return Status::OK();
+}
+
+void SharedMemoryTensorTable::CleanupStep(int64 step_id) {
+  mutex_lock l(mu_);
+  for (auto it = tensors_.begin(); it != tensors_.end();) {
+    if (it->second.step_id == step_id) {
+      SharedMemoryTensorExtra extra;
+      extra.set_segment_name(it->first);
+      RemoveSharedMemorySegment(extra);
+      it = tensors_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t SharedMemoryTensorTable::size() const {
+  mutex_lock l(mu_);
+  return tensors_.size();
+}
+
+}  // namespace tensorflow
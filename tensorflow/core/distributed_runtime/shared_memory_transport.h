@@ -0,0 +1,113 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
+
+#include <unordered_map>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+
+namespace tensorflow {
+
+// Helpers to transfer the contents of received tensors between tasks on the
+// same host through POSIX shared memory segments. The sender of a tensor
+// creates a segment holding its contents and passes the segment name to the
+// receiver, which copies the contents out and removes the segment. The sender
+// keeps the tensor until the receiver confirms the read, and sends it inline
+// instead if the receiver could not read the segment.
+//
+// Only supported on Linux.
+
+// Tensors smaller than this are cheaper to send inline in the RPC.
+constexpr int64 kMinSharedMemoryTensorBytes = 64 << 10;
+
+// Returns an identifier of the shared memory namespace of this process, or an
+// empty string if shared memory transfers are not supported. Two processes
+// can exchange tensors through shared memory iff they return the same
+// non-empty identifier, i.e. they run on the same host, see the same /dev/shm
+// and have the same effective user, which owns the segments.
+const string& SharedMemoryHostId();
+
+// Returns true if the contents of `tensor` can be sent through shared memory,
+// i.e. it has a memcpy-able type and at least kMinSharedMemoryTensorBytes of
+// data.
+bool CanSendThroughSharedMemory(const Tensor& tensor);
+
+// Creates a new shared memory segment holding the contents of `tensor`, and
+// fills `extra` with the information the receiver needs to read it. The
+// segment stays alive until it is read by ReadTensorFromSharedMemory() or
+// removed by RemoveSharedMemorySegment().
+Status WriteTensorToSharedMemory(const Tensor& tensor,
+                                 SharedMemoryTensorExtra* extra);
+
+// Copies the contents of the segment described by `extra` into the buffer of
+// `tensor`, which must be allocated in host memory with the same size. The
+// segment is removed even if it can't be read.
+Status ReadTensorFromSharedMemory(const SharedMemoryTensorExtra& extra,
+                                  Tensor* tensor);
+
+// Removes the segment described by `extra` without reading it.
+void RemoveSharedMemorySegment(const SharedMemoryTensorExtra& extra);
+
+// Counts the tensors read from shared memory by this process.
+monitoring::CounterCell* SharedMemoryTensorsReadCounter();
+
+// The tensors a worker sent through shared memory, until their receivers
+// confirmed the read.
+class SharedMemoryTensorTable {
+ public:
+  SharedMemoryTensorTable() {}
+  // Removes the segments of the tensors that were not released.
+  ~SharedMemoryTensorTable();
+
+  // Writes the contents of `tensor` to a new segment, fills `extra` with the
+  // information the receiver needs to read it, and keeps a reference to
+  // `tensor` until Release() or CleanupStep(step_id) is called.
+  Status Write(int64 step_id, const Tensor& tensor,
+               SharedMemoryTensorExtra* extra);
+
+  // Removes the segment named `segment_name` and releases its tensor. If
+  // `tensor` is not null, it is set to the released tensor, e.g. to send it
+  // inline to a receiver that could not read the segment.
+  Status Release(const string& segment_name, Tensor* tensor);
+
+  // Removes the segments and releases the tensors written for `step_id`.
+  void CleanupStep(int64 step_id);
+
+  // Number of tensors that were not released yet.
+  size_t size() const;
+
+ private:
+  struct Entry {
+    int64 step_id;
+    Tensor tensor;
+  };
+
+  mutable mutex mu_;
+  std::unordered_map<string, Entry> tensors_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemoryTensorTable);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHARED_MEMORY_TRANSPORT_H_
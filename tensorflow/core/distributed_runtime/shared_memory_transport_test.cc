@@ -0,0 +1,128 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shared_memory_transport.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(SharedMemoryTransportTest, CanSendThroughSharedMemory) {
+  EXPECT_FALSE(CanSendThroughSharedMemory(Tensor(DT_FLOAT, {16})));
+  EXPECT_TRUE(CanSendThroughSharedMemory(
+      Tensor(DT_FLOAT, {kMinSharedMemoryTensorBytes / 4})));
+  EXPECT_FALSE(CanSendThroughSharedMemory(
+      Tensor(DT_STRING, {kMinSharedMemoryTensorBytes})));
+}
+
+#if defined(__linux__)
+
+TEST(SharedMemoryTransportTest, RoundTrip) {
+  if (SharedMemoryHostId().empty()) {
+    LOG(INFO) << "Shared memory not available, skipping test";
+    return;
+  }
+  Tensor sent(DT_INT32, {100000});
+  for (int i = 0; i < sent.NumElements(); ++i) {
+    sent.flat<int32>()(i) = i;
+  }
+  SharedMemoryTensorExtra extra;
+  TF_ASSERT_OK(WriteTensorToSharedMemory(sent, &extra));
+  EXPECT_EQ(static_cast<int64>(sent.TotalBytes()), extra.size());
+
+  Tensor received(DT_INT32, {100000});
+  TF_ASSERT_OK(ReadTensorFromSharedMemory(extra, &received));
+  test::ExpectTensorEqual<int32>(sent, received);
+
+  // The segment is removed once read.
+  EXPECT_TRUE(
+      errors::IsNotFound(ReadTensorFromSharedMemory(extra, &received)));
+}
+
+TEST(SharedMemoryTransportTest, SizeMismatch) {
+  if (SharedMemoryHostId().empty()) {
+    LOG(INFO) << "Shared memory not available, skipping test";
+    return;
+  }
+  SharedMemoryTensorExtra extra;
+  TF_ASSERT_OK(WriteTensorToSharedMemory(Tensor(DT_FLOAT, {1024}), &extra));
+  Tensor received(DT_FLOAT, {512});
+  EXPECT_TRUE(
+      errors::IsInternal(ReadTensorFromSharedMemory(extra, &received)));
+}
+
+TEST(SharedMemoryTransportTest, RemoveSegment) {
+  if (SharedMemoryHostId().empty()) {
+    LOG(INFO) << "Shared memory not available, skipping test";
+    return;
+  }
+  SharedMemoryTensorExtra extra;
+  TF_ASSERT_OK(WriteTensorToSharedMemory(Tensor(DT_FLOAT, {1024}), &extra));
+  RemoveSharedMemorySegment(extra);
+  Tensor received(DT_FLOAT, {1024});
+  EXPECT_TRUE(
+      errors::IsNotFound(ReadTensorFromSharedMemory(extra, &received)));
+}
+
+TEST(SharedMemoryTransportTest, TableReleasesTensor) {
+  if (SharedMemoryHostId().empty()) {
+    LOG(INFO) << "Shared memory not available, skipping test";
+    return;
+  }
+  SharedMemoryTensorTable table;
+  const Tensor sent = test::AsTensor<float>({1, 2, 3, 4});
+  SharedMemoryTensorExtra extra;
+  TF_ASSERT_OK(table.Write(/*step_id=*/1, sent, &extra));
+  EXPECT_EQ(1, table.size());
+
+  // A receiver that could not read the segment gets the tensor itself.
+  Tensor released;
+  TF_ASSERT_OK(table.Release(extra.segment_name(), &released));
+  test::ExpectTensorEqual<float>(sent, released);
+  EXPECT_EQ(0, table.size());
+  Tensor received(DT_FLOAT, {4});
+  EXPECT_TRUE(
+      errors::IsNotFound(ReadTensorFromSharedMemory(extra, &received)));
+  EXPECT_TRUE(
+      errors::IsNotFound(table.Release(extra.segment_name(), nullptr)));
+}
+
+TEST(SharedMemoryTransportTest, TableCleanupStep) {
+  if (SharedMemoryHostId().empty()) {
+    LOG(INFO) << "Shared memory not available, skipping test";
+    return;
+  }
+  SharedMemoryTensorTable table;
+  SharedMemoryTensorExtra extra1, extra2;
+  TF_ASSERT_OK(table.Write(/*step_id=*/1, Tensor(DT_FLOAT, {16}), &extra1));
+  TF_ASSERT_OK(table.Write(/*step_id=*/2, Tensor(DT_FLOAT, {16}), &extra2));
+
+  table.CleanupStep(1);
+  EXPECT_EQ(1, table.size());
+  Tensor received(DT_FLOAT, {16});
+  EXPECT_TRUE(
+      errors::IsNotFound(ReadTensorFromSharedMemory(extra1, &received)));
+  TF_EXPECT_OK(ReadTensorFromSharedMemory(extra2, &received));
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace
+}  // namespace tensorflow
@@ -84,6 +84,18 @@ void Worker::RegisterGraphAsync(const RegisterGraphRequest* request,
         request->config_proto(), request->collective_graph_key(),
         session->cluster_flr(), response->mutable_graph_handle());
   }
+  if (s.ok() &&
+      (request->send_key_size() > 0 || request->recv_key_size() > 0)) {
+    s = session->graph_mgr()->RegisterKeys(
+        response->graph_handle(),
+        {request->send_key().begin(), request->send_key().end()},
+        {request->recv_key().begin(), request->recv_key().end()});
+    if (s.ok()) {
+      response->set_use_registered_keys(true);
+    } else {
+      session->graph_mgr()->Deregister(response->graph_handle()).IgnoreError();
+    }
+  }
   done(s);
 }
 
@@ -134,6 +146,19 @@ Status Worker::PrepareRunGraph(RunGraphRequestWrapper* req,
   return Status::OK();
 }
 
+Status Worker::PrepareRegisteredRunGraph(RunGraphRequestWrapper* req,
+                                         std::vector<Tensor>* in) {
+  if (req->num_recvs() > 0) {
+    return errors::InvalidArgument(
+        "RunGraph requests with registered keys can't have recv keys");
+  }
+  in->resize(req->num_sends());
+  for (size_t i = 0; i < req->num_sends(); ++i) {
+    TF_RETURN_IF_ERROR(req->SendValue(i, &(*in)[i]));
+  }
+  return Status::OK();
+}
+
 void Worker::RunGraphAsync(CallOptions* opts, RunGraphRequestWrapper* request,
                            MutableRunGraphResponseWrapper* response,
                            StatusCallback done) {
@@ -144,6 +169,11 @@ void Worker::RunGraphAsync(CallOptions* opts, RunGraphRequestWrapper* request,
     };
   }
   if (request->is_partial()) {
+    if (request->use_registered_keys()) {
+      done(errors::InvalidArgument(
+          "Partial runs don't support registered keys"));
+      return;
+    }
     DoPartialRunGraph(opts, request, response, std::move(done));
   } else {
     DoRunGraph(opts, request, response, std::move(done));
@@ -181,11 +211,21 @@ void Worker::DoRunGraph(CallOptions* opts, RunGraphRequestWrapper* request,
     done(s);
     return;
   }
+  // With registered keys, the tensors are identified by their position
+  // instead of by their rendezvous key.
+  const bool use_registered_keys = request->use_registered_keys();
   GraphMgr::NamedTensors in;
   GraphMgr::NamedTensors* out = new GraphMgr::NamedTensors;
-  s = PrepareRunGraph(request, &in, out);
+  std::vector<Tensor> registered_in;
+  std::vector<Tensor>* registered_out = new std::vector<Tensor>;
+  if (use_registered_keys) {
+    s = PrepareRegisteredRunGraph(request, &registered_in);
+  } else {
+    s = PrepareRunGraph(request, &in, out);
+  }
   if (!s.ok()) {
     delete out;
+    delete registered_out;
     done(s);
     return;
   }
@@ -218,16 +258,16 @@ void Worker::DoRunGraph(CallOptions* opts, RunGraphRequestWrapper* request,
     delete collector;
     delete profiler_session;
     delete out;
+    delete registered_out;
     done(errors::Aborted("Call was aborted"));
     return;
   }
-  session->graph_mgr()->ExecuteAsync(
-      request->graph_handle(), step_id, session.get(), request->exec_opts(),
-      collector, response, cm, in,
-      [this, step_id, response, session, cm, out, token, collector,
-       profiler_session, opts, done](const Status& status) {
+  StatusCallback executed =
+      [this, step_id, response, session, cm, out, registered_out,
+       use_registered_keys, token, collector, profiler_session, opts,
+       done](const Status& status) {
         Status s = status;
-        if (s.ok()) {
+        if (s.ok() && !use_registered_keys) {
           s = session->graph_mgr()->RecvOutputs(step_id, out);
         }
 
@@ -247,14 +287,28 @@ void Worker::DoRunGraph(CallOptions* opts, RunGraphRequestWrapper* request,
             const Tensor& val = p.second;
             response->AddRecv(key, val);
           }
+          for (const Tensor& val : *registered_out) {
+            response->AddRecv("", val);
+          }
         }
 
         if (collector) collector->Finalize();
         delete collector;
         delete profiler_session;
         delete out;
+        delete registered_out;
         done(s);
-      });
+      };
+  if (use_registered_keys) {
+    session->graph_mgr()->ExecuteWithRegisteredKeysAsync(
+        request->graph_handle(), step_id, session.get(), request->exec_opts(),
+        collector, response, cm, registered_in, registered_out,
+        std::move(executed));
+  } else {
+    session->graph_mgr()->ExecuteAsync(
+        request->graph_handle(), step_id, session.get(), request->exec_opts(),
+        collector, response, cm, in, std::move(executed));
+  }
 }
 
 // TODO(suharshs): Add stats collection support to partial run.
@@ -126,6 +126,11 @@ class Worker : public WorkerInterface {
                          GraphMgr::NamedTensors* in,
                          GraphMgr::NamedTensors* out);
 
+  // Like PrepareRunGraph, for requests that use the keys registered with the
+  // graph: the feeds are returned in the order of the registered send keys.
+  Status PrepareRegisteredRunGraph(RunGraphRequestWrapper* req,
+                                   std::vector<Tensor>* in);
+
   void DoRunGraph(CallOptions* opts, RunGraphRequestWrapper* request,
                   MutableRunGraphResponseWrapper* response,
                   StatusCallback done);
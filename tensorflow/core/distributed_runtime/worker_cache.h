@@ -56,6 +56,12 @@ class WorkerCacheInterface {
     delete worker;
   }
 
+  // Set *address with the "host:port" network address of the task named
+  // "task".  Returns false if the address is not known to this cache.
+  virtual bool GetTaskAddress(const string& task, string* address) {
+    return false;
+  }
+
   // Set *locality with the DeviceLocality of the specified remote device
   // within its local environment.  Returns true if *locality
   // was set, using only locally cached data.  Returns false
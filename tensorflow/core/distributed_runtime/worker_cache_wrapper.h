@@ -59,6 +59,10 @@ class WorkerCacheWrapper : public WorkerCacheInterface {
     return wrapped_->GetEagerClientCache(eager_client_cache);
   }
 
+  bool GetTaskAddress(const string& task, string* address) override {
+    return wrapped_->GetTaskAddress(task, address);
+  }
+
   // Set *locality with the DeviceLocality of the specified remote device
   // within its local environment.  Returns true if *locality
   // was set, using only locally cached data.  Returns false
@@ -70,6 +70,10 @@ class WorkerFreeListCache : public WorkerCacheInterface {
     // TODO(jeff,sanjay): Should decrement ref-count when we implement eviction.
   }
 
+  bool GetTaskAddress(const string& task, string* address) override {
+    return wrapped_->GetTaskAddress(task, address);
+  }
+
   bool GetDeviceLocalityNonBlocking(const string& device,
                                     DeviceLocality* locality) override {
     return wrapped_->GetDeviceLocalityNonBlocking(device, locality);
@@ -0,0 +1,268 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/worker.h"
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/distributed_runtime/call_options.h"
+#include "tensorflow/core/distributed_runtime/message_wrappers.h"
+#include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
+#include "tensorflow/core/distributed_runtime/session_mgr.h"
+#include "tensorflow/core/distributed_runtime/worker_env.h"
+#include "tensorflow/core/framework/rendezvous.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/worker.pb.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kWorkerName[] = "/job:worker/replica:0/task:0";
+constexpr char kDeviceName[] = "/job:worker/replica:0/task:0/device:CPU:0";
+
+class WorkerTest : public ::testing::Test {
+ protected:
+  WorkerTest() {
+    device_mgr_ = absl::make_unique<StaticDeviceMgr>(
+        DeviceFactory::NewDevice("CPU", SessionOptions(), kWorkerName));
+    env_.env = Env::Default();
+    env_.local_devices = device_mgr_->ListDevices();
+    env_.device_mgr = device_mgr_.get();
+    compute_pool_ = absl::make_unique<thread::ThreadPool>(Env::Default(),
+                                                          "worker_test", 2);
+    env_.compute_pool = compute_pool_.get();
+    rendezvous_mgr_ = absl::make_unique<RpcRendezvousMgr>(&env_);
+    env_.rendezvous_mgr = rendezvous_mgr_.get();
+    session_mgr_ = absl::make_unique<SessionMgr>(
+        &env_, kWorkerName, std::unique_ptr<WorkerCacheInterface>(),
+        [](const ServerDef& server_def, WorkerCacheInterface** worker_cache) {
+          *worker_cache = nullptr;
+          return Status::OK();
+        });
+    env_.session_mgr = session_mgr_.get();
+    worker_ = absl::make_unique<Worker>(&env_);
+
+    incarnation_ = env_.local_devices[0]->attributes().incarnation();
+    feed_key_ = Rendezvous::CreateKey(kDeviceName, incarnation_, kDeviceName,
+                                      "x", FrameAndIter(0, 0));
+    fetch_key_ = Rendezvous::CreateKey(kDeviceName, incarnation_, kDeviceName,
+                                       "y", FrameAndIter(0, 0));
+  }
+
+  // Returns a graph that receives "x" and sends "y" = -"x".
+  GraphDef NegGraph() {
+    Graph graph(OpRegistry::Global());
+    Node* x = test::graph::Recv(&graph, "x", "float", kDeviceName,
+                                incarnation_, kDeviceName);
+    Node* y = test::graph::Unary(&graph, "Neg", x);
+    test::graph::Send(&graph, y, "y", kDeviceName, incarnation_, kDeviceName);
+    GraphDef def;
+    test::graph::ToGraphDef(&graph, &def);
+    for (NodeDef& node : *def.mutable_node()) {
+      node.set_device(kDeviceName);
+    }
+    return def;
+  }
+
+  Status RegisterGraph(const RegisterGraphRequest& request,
+                       RegisterGraphResponse* response) {
+    Status status;
+    Notification n;
+    worker_->RegisterGraphAsync(&request, response, [&](const Status& s) {
+      status = s;
+      n.Notify();
+    });
+    n.WaitForNotification();
+    return status;
+  }
+
+  Status RunGraph(const RunGraphRequest& request,
+                  MutableRunGraphResponseWrapper* response) {
+    ProtoRunGraphRequest wrapped_request(&request);
+    CallOptions opts;
+    Status status;
+    Notification n;
+    worker_->RunGraphAsync(&opts, &wrapped_request, response,
+                           [&](const Status& s) {
+                             status = s;
+                             n.Notify();
+                           });
+    n.WaitForNotification();
+    return status;
+  }
+
+  // Returns a request that runs step "step_id" of "graph_handle" and feeds
+  // "x" with "keys" (positionally if "keys" is empty).
+  RunGraphRequest RunGraphRequestFor(const string& graph_handle, int64 step_id,
+                                     const std::vector<float>& xs,
+                                     const std::vector<string>& keys) {
+    RunGraphRequest request;
+    request.set_graph_handle(graph_handle);
+    request.set_step_id(step_id);
+    request.set_use_registered_keys(keys.empty());
+    for (size_t i = 0; i < xs.size(); ++i) {
+      NamedTensorProto* send = request.add_send();
+      if (!keys.empty()) send->set_key(keys[i]);
+      test::AsScalar<float>(xs[i]).AsProtoTensorContent(send->mutable_tensor());
+    }
+    return request;
+  }
+
+  std::unique_ptr<DeviceMgr> device_mgr_;
+  std::unique_ptr<thread::ThreadPool> compute_pool_;
+  std::unique_ptr<RpcRendezvousMgr> rendezvous_mgr_;
+  std::unique_ptr<SessionMgr> session_mgr_;
+  WorkerEnv env_;
+  std::unique_ptr<Worker> worker_;
+
+  int64 incarnation_;
+  string feed_key_;
+  string fetch_key_;
+};
+
+TEST_F(WorkerTest, RunGraphWithRegisteredKeys) {
+  RegisterGraphRequest register_request;
+  *register_request.mutable_graph_def() = NegGraph();
+  register_request.add_send_key(feed_key_);
+  register_request.add_recv_key(fetch_key_);
+  RegisterGraphResponse register_response;
+  TF_ASSERT_OK(RegisterGraph(register_request, &register_response));
+  EXPECT_TRUE(register_response.use_registered_keys());
+
+  // Every step feeds and fetches by position only.
+  for (int64 step_id = 1; step_id <= 3; ++step_id) {
+    RunGraphRequest request = RunGraphRequestFor(
+        register_response.graph_handle(), step_id, {step_id * 1.0f}, {});
+    InMemoryRunGraphResponse response;
+    TF_ASSERT_OK(RunGraph(request, &response));
+    ASSERT_EQ(1, response.num_recvs());
+    EXPECT_EQ("", response.recv_key(0));
+    Tensor y;
+    TF_ASSERT_OK(response.RecvValue(0, &y));
+    test::ExpectTensorEqual<float>(test::AsScalar<float>(-step_id * 1.0f), y);
+  }
+}
+
+TEST_F(WorkerTest, RunGraphWithoutRegisteredKeys) {
+  // Masters that don't send the keys get the named protocol.
+  RegisterGraphRequest register_request;
+  *register_request.mutable_graph_def() = NegGraph();
+  RegisterGraphResponse register_response;
+  TF_ASSERT_OK(RegisterGraph(register_request, &register_response));
+  EXPECT_FALSE(register_response.use_registered_keys());
+
+  RunGraphRequest request = RunGraphRequestFor(
+      register_response.graph_handle(), 1, {2.0f}, {feed_key_});
+  request.add_recv_key(fetch_key_);
+  InMemoryRunGraphResponse response;
+  TF_ASSERT_OK(RunGraph(request, &response));
+  ASSERT_EQ(1, response.num_recvs());
+  EXPECT_EQ(fetch_key_, response.recv_key(0));
+  Tensor y;
+  TF_ASSERT_OK(response.RecvValue(0, &y));
+  test::ExpectTensorEqual<float>(test::AsScalar<float>(-2.0f), y);
+}
+
+TEST_F(WorkerTest, RegisteredRunOfGraphWithoutKeysFails) {
+  RegisterGraphRequest register_request;
+  *register_request.mutable_graph_def() = NegGraph();
+  RegisterGraphResponse register_response;
+  TF_ASSERT_OK(RegisterGraph(register_request, &register_response));
+
+  RunGraphRequest request =
+      RunGraphRequestFor(register_response.graph_handle(), 1, {2.0f}, {});
+  InMemoryRunGraphResponse response;
+  EXPECT_TRUE(errors::IsInvalidArgument(RunGraph(request, &response)));
+}
+
+TEST_F(WorkerTest, RegisteredRunWithWrongNumberOfFeedsFails) {
+  RegisterGraphRequest register_request;
+  *register_request.mutable_graph_def() = NegGraph();
+  register_request.add_send_key(feed_key_);
+  register_request.add_recv_key(fetch_key_);
+  RegisterGraphResponse register_response;
+  TF_ASSERT_OK(RegisterGraph(register_request, &register_response));
+
+  RunGraphRequest request = RunGraphRequestFor(
+      register_response.graph_handle(), 1, {2.0f, 3.0f}, {});
+  InMemoryRunGraphResponse response;
+  Status s = RunGraph(request, &response);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_EQ(0, response.num_recvs());
+}
+
+TEST_F(WorkerTest, RegisteredRunWithRecvKeysFails) {
+  RegisterGraphRequest register_request;
+  *register_request.mutable_graph_def() = NegGraph();
+  register_request.add_send_key(feed_key_);
+  register_request.add_recv_key(fetch_key_);
+  RegisterGraphResponse register_response;
+  TF_ASSERT_OK(RegisterGraph(register_request, &register_response));
+
+  RunGraphRequest request =
+      RunGraphRequestFor(register_response.graph_handle(), 1, {2.0f}, {});
+  request.add_recv_key(fetch_key_);
+  InMemoryRunGraphResponse response;
+  Status s = RunGraph(request, &response);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST_F(WorkerTest, PartialRunWithRegisteredKeysFails) {
+  RegisterGraphRequest register_request;
+  *register_request.mutable_graph_def() = NegGraph();
+  register_request.add_send_key(feed_key_);
+  register_request.add_recv_key(fetch_key_);
+  RegisterGraphResponse register_response;
+  TF_ASSERT_OK(RegisterGraph(register_request, &register_response));
+
+  RunGraphRequest request =
+      RunGraphRequestFor(register_response.graph_handle(), 1, {2.0f}, {});
+  request.set_is_partial(true);
+  InMemoryRunGraphResponse response;
+  Status s = RunGraph(request, &response);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST_F(WorkerTest, RegisterGraphWithInvalidKeysFails) {
+  RegisterGraphRequest register_request;
+  *register_request.mutable_graph_def() = NegGraph();
+  register_request.add_send_key("not a rendezvous key");
+  register_request.add_recv_key(fetch_key_);
+  RegisterGraphResponse register_response;
+  Status s = RegisterGraph(register_request, &register_response);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+  EXPECT_FALSE(register_response.use_registered_keys());
+
+  // The graph is not left registered.
+  RunGraphRequest request = RunGraphRequestFor(
+      register_response.graph_handle(), 1, {2.0f}, {feed_key_});
+  request.add_recv_key(fetch_key_);
+  InMemoryRunGraphResponse response;
+  s = RunGraph(request, &response);
+  EXPECT_TRUE(errors::IsAborted(s)) << s;
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -70,6 +70,7 @@ CollInstanceParams& CollInstanceParams::operator=(
     device_names.clear();
     device_names.assign(other.device_names.begin(), other.device_names.end());
     task_names.assign(other.task_names.begin(), other.task_names.end());
+    host_names.assign(other.host_names.begin(), other.host_names.end());
     same_num_devices_per_task = other.same_num_devices_per_task;
     num_devices_per_task = other.num_devices_per_task;
     gpu_ring_order = other.gpu_ring_order;
@@ -85,6 +86,8 @@ CollInstanceParams& CollInstanceParams::operator=(
         other.impl_details.subdiv_source_rank.begin(),
         other.impl_details.subdiv_source_rank.end());
     impl_details.dependencies = other.impl_details.dependencies;
+    impl_details.compression = other.impl_details.compression;
+    impl_details.topk_ratio = other.impl_details.topk_ratio;
   }
   return *this;
 }
@@ -101,6 +104,10 @@ string CollInstanceParams::ToString() const {
   for (const auto& n : task_names) {
     strings::StrAppend(&v, n, ", ");
   }
+  strings::StrAppend(&v, "} host_names={");
+  for (const auto& n : host_names) {
+    strings::StrAppend(&v, n, ", ");
+  }
   strings::StrAppend(&v, "} num_devices_per_task={");
   for (const auto& dpt : num_devices_per_task) {
     strings::StrAppend(&v, dpt.first, ": ", dpt.second, ", ");
@@ -126,6 +133,10 @@ string CollInstanceParams::ToString() const {
     }
     strings::StrAppend(&v, "}");
   }
+  if (!impl_details.compression.empty()) {
+    strings::StrAppend(&v, " compression=", impl_details.compression,
+                       " topk_ratio=", impl_details.topk_ratio);
+  }
   strings::StrAppend(&v, "}");  // all subdivs
   return v;
 }
@@ -32,6 +32,7 @@ class CompleteGroupRequest;
 class CompleteGroupResponse;
 class CompleteInstanceRequest;
 class CompleteInstanceResponse;
+class CompressionResidualStore;
 class Device;
 class DeviceMgr;
 class GetStepSequenceRequest;
@@ -87,6 +88,9 @@ struct CollImplDetails {
                               // e.g. ring or nccl
   float timeout_seconds;      // If non zero, set a completion timeout for the
                               // collective op to detect staleness.
+  string compression;         // If non empty, lossy encoding of the values
+                              // exchanged by a reduction, e.g. bf16 or topk.
+  float topk_ratio = 0.01;    // Fraction of values sent by topk compression.
 };
 
 // Data common to all members of a collective instance.
@@ -101,6 +105,9 @@ struct CollInstanceParams {
   std::vector<string> device_names;
   // Task name prefix of corresponding device name.
   std::vector<string> task_names;
+  // Host running the task of corresponding device name.  Tasks that share a
+  // machine have the same host name.
+  std::vector<string> host_names;
   // True if every task has the same number of devices.
   bool same_num_devices_per_task = false;
   // Task -> number of devices on that task.
@@ -198,8 +205,16 @@ class ParamResolverInterface {
                                      CancellationManager* cancel_mgr,
                                      const StatusCallback& done) = 0;
 
-  // Aborts the resolver. After abortion the resolver can no longer be used.
+  // Aborts the resolver. After abortion the resolver can no longer be used,
+  // until ResetGroups() is called.
   virtual void StartAbort(const Status& s) = 0;
+
+  // Forgets all resolved groups and instances and clears a previous abort, so
+  // that groups can be formed again, e.g. with a different set of tasks and
+  // devices after a task failed or joined. Resolutions that are still pending
+  // fail with `s`. Should be called once the collectives that use the old
+  // groups have finished or have been aborted.
+  virtual void ResetGroups(const Status& s) = 0;
 };
 
 // Graphs which utilize Collective Ops in a common instance must
@@ -249,6 +264,11 @@ class CollectiveExecutorMgrInterface : public StepSequenceInterface {
   virtual ParamResolverInterface* GetParamResolver() const = 0;
 
   virtual DeviceResolverInterface* GetDeviceResolver() const = 0;
+
+  // Forgets all collective groups and the state kept for them, e.g. after the
+  // cluster was updated, so that groups are formed again with the current
+  // tasks. Pending resolutions fail with `s`.
+  virtual void ResetGroups(const Status& s) = 0;
 };
 
 // Interface that a Collective Op implementation uses to exchange data
@@ -314,6 +334,10 @@ class CollectiveExecutor : public core::RefCounted {
 
   virtual CollectiveRemoteAccess* remote_access() { return nullptr; }
 
+  // Error-feedback residuals of compressed reductions, which outlive this
+  // step.  Null if compressed reductions run without error feedback.
+  virtual CompressionResidualStore* residual_store() { return nullptr; }
+
   // `WaitForDependencies` and `Launched` are used for fine-grained control of
   // execution order between collective instances.  These functions are intended
   // to be called in `Run` function of collective implementations, and may be
@@ -16,10 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 #define TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
-#include "tensorflow/core/lib/gtl/flatmap.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
@@ -60,12 +60,21 @@ class LocalRendezvous {
     Item* tail = nullptr;
   };
 
-  typedef gtl::FlatMap<uint64, ItemQueue> Table;
+  typedef absl::flat_hash_map<uint64, ItemQueue> Table;
 
-  // TODO(zhifengc): shard table_.
-  mutex mu_;
-  Table table_ TF_GUARDED_BY(mu_);
-  Status status_ TF_GUARDED_BY(mu_);
+  // The table is sharded by key hash, so that Send and Recv calls for
+  // different keys rarely contend on the same lock. Each shard keeps a copy
+  // of the abort status, which StartAbort() sets in every shard.
+  struct Shard {
+    mutex mu;
+    Table table TF_GUARDED_BY(mu);
+    Status status TF_GUARDED_BY(mu);
+  };
+  static constexpr int kNumShards = 16;
+
+  Shard* GetShard(uint64 key_hash) { return &shards_[key_hash % kNumShards]; }
+
+  Shard shards_[kNumShards];
 
   TF_DISALLOW_COPY_AND_ASSIGN(LocalRendezvous);
 };
@@ -70,11 +70,17 @@ class RendezvousInterface {
     ParsedKey& operator=(const ParsedKey& b);
     StringPiece FullKey() const { return buf_; }
 
+    // A hash of FullKey(), computed once by ParseKey(). Keys that are parsed
+    // when the graph is set up (e.g. by SendOp and RecvOp outside of loops)
+    // are matched by LocalRendezvous without hashing the string again.
+    uint64 KeyHash() const { return hash_; }
+
    private:
     friend class Rendezvous;
     friend class SendOp;
     friend class RecvOp;
     std::string buf_;
+    uint64 hash_ = 0;
   };
 
   // The caller is a tensor producer and it sends a message (a tensor
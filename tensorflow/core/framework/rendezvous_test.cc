@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -56,6 +57,17 @@ TEST(RendezvousTest, Key) {
   EXPECT_EQ(parsed.dst_device, "/job:mnist/replica:1/task:2/device:GPU:0");
   EXPECT_EQ(parsed.dst.type, "GPU");
 
+  Rendezvous::ParsedKey copied(parsed);
+  EXPECT_EQ(copied.FullKey(), parsed.FullKey());
+  EXPECT_EQ(copied.KeyHash(), parsed.KeyHash());
+  Rendezvous::ParsedKey other;
+  TF_EXPECT_OK(Rendezvous::ParseKey(
+      Rendezvous::CreateKey("/job:mnist/replica:1/task:2/CPU:0", 7890,
+                            "/job:mnist/replica:1/task:2/device:GPU:0", "var1",
+                            FrameAndIter(0, 0)),
+      &other));
+  EXPECT_NE(other.KeyHash(), parsed.KeyHash());
+
   EXPECT_FALSE(Rendezvous::ParseKey("foo;bar;baz", &parsed).ok());
   EXPECT_FALSE(Rendezvous::ParseKey("/job:mnist/replica:1/task:2/CPU:0;"
                                     "/job:mnist/replica:1/task:2/device:GPU:0;",
@@ -355,6 +367,33 @@ TEST_F(LocalRendezvousTest, MultiSends) {
   }
 }
 
+TEST_F(LocalRendezvousTest, ManyKeys) {
+  static const int N = 100;
+  std::vector<Rendezvous::ParsedKey> keys;
+  for (int i = 0; i < N; ++i) {
+    keys.push_back(MakeKey(strings::StrCat("key", i)));
+  }
+  Rendezvous::Args args;
+  for (int i = 0; i < N; ++i) {
+    TF_ASSERT_OK(rendez_->Send(keys[i], args, V(strings::StrCat(i)), false));
+  }
+  Tensor val;
+  bool val_dead;
+  for (int i = N - 1; i >= 0; --i) {
+    TF_ASSERT_OK(rendez_->Recv(keys[i], args, &val, &val_dead));
+    EXPECT_EQ(strings::StrCat(i), V(val));
+  }
+
+  // Aborting fails the pending and subsequent calls for every key.
+  for (int i = 0; i < N; i += 2) {
+    TF_ASSERT_OK(rendez_->Send(keys[i], args, V("pending"), false));
+  }
+  rendez_->StartAbort(errors::Aborted(""));
+  for (int i = 0; i < N; ++i) {
+    EXPECT_TRUE(errors::IsAborted(rendez_->Send(keys[i], args, V(""), false)));
+  }
+}
+
 TEST_F(LocalRendezvousTest, RecvAbort) {
   rendez_->Ref();
   SchedClosure([this]() {
@@ -512,5 +551,47 @@ void BM_PingPong(int iters) {
 }
 BENCHMARK(BM_PingPong);
 
+// Each of `num_threads` threads sends and then receives its own set of keys,
+// as the Send and Recv kernels of independent edges in a large step do.
+void BM_ConcurrentSendRecv(int iters, int num_threads) {
+  testing::StopTiming();
+  static const int kKeysPerThread = 64;
+  std::vector<Rendezvous::ParsedKey> keys;
+  for (int i = 0; i < num_threads * kKeysPerThread; ++i) {
+    keys.push_back(MakeKey(strings::StrCat("edge", i)));
+  }
+  thread::ThreadPool* pool =
+      new thread::ThreadPool(Env::Default(), "test", num_threads);
+  Rendezvous* rendez = NewLocalRendezvous();
+  const Tensor orig = V("val");
+  testing::StartTiming();
+
+  BlockingCounter counter(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    pool->Schedule([rendez, iters, t, &keys, &orig, &counter]() {
+      Tensor val;
+      bool is_dead = false;
+      Rendezvous::Args args;
+      for (int i = 0; i < iters; ++i) {
+        for (int k = t * kKeysPerThread; k < (t + 1) * kKeysPerThread; ++k) {
+          TF_CHECK_OK(rendez->Send(keys[k], args, orig, is_dead));
+        }
+        for (int k = t * kKeysPerThread; k < (t + 1) * kKeysPerThread; ++k) {
+          TF_CHECK_OK(rendez->Recv(keys[k], args, &val, &is_dead));
+        }
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_threads *
+                          kKeysPerThread);
+  rendez->Unref();
+  delete pool;
+}
+BENCHMARK(BM_ConcurrentSendRecv)->Arg(1)->Arg(4)->Arg(16);
+
 }  // namespace
 }  // namespace tensorflow
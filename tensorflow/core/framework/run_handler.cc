@@ -399,7 +399,8 @@ void RunHandlerThreadPool::AddWorkToQueue(ThreadWorkSource* tws,
 // the profiler will be a bit harder to read.
 void RunHandlerThreadPool::SetThreadWorkSources(
     int tid, int start_request_idx, uint64 version,
-    const Eigen::MaxSizeVector<ThreadWorkSource*>& thread_work_sources) {
+    const Eigen::MaxSizeVector<ThreadWorkSource*>& thread_work_sources,
+    int num_urgent_requests) {
   mutex_lock l(thread_data_[tid].mu);
   if (version > thread_data_[tid].new_version) {
     thread_data_[tid].new_version = version;
@@ -408,6 +409,7 @@ void RunHandlerThreadPool::SetThreadWorkSources(
     return;
   }
   thread_data_[tid].new_thread_work_sources->resize(0);
+  thread_data_[tid].new_num_urgent_requests = num_urgent_requests;
   if (use_sub_thread_pool_) {
     for (int i = 0; i < thread_work_sources.size(); ++i) {
       thread_data_[tid].new_thread_work_sources->emplace_back(
@@ -472,11 +474,13 @@ RunHandlerThreadPool::ThreadData::ThreadData()
           new Eigen::MaxSizeVector<ThreadWorkSource*>(static_cast<int32>(
               ParamFromEnvWithDefault("TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS",
                                       kMaxConcurrentHandlers)))),
+      new_num_urgent_requests(0),
       current_version(0),
       current_thread_work_sources(
           new Eigen::MaxSizeVector<ThreadWorkSource*>(static_cast<int32>(
               ParamFromEnvWithDefault("TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS",
-                                      kMaxConcurrentHandlers)))) {}
+                                      kMaxConcurrentHandlers)))),
+      current_num_urgent_requests(0) {}
 
 Task RunHandlerThreadPool::FindTask(
     int searching_range_start, int searching_range_end, int thread_id,
@@ -538,6 +542,8 @@ void RunHandlerThreadPool::WorkerLoop(int thread_id,
             thread_data_[thread_id].new_version;
         thread_data_[thread_id].current_thread_work_sources.swap(
             thread_data_[thread_id].new_thread_work_sources);
+        thread_data_[thread_id].current_num_urgent_requests =
+            thread_data_[thread_id].new_num_urgent_requests;
       }
     }
     Eigen::MaxSizeVector<ThreadWorkSource*>* thread_work_sources =
@@ -545,7 +551,17 @@ void RunHandlerThreadPool::WorkerLoop(int thread_id,
     if (use_sub_thread_pool_) {
       sub_thread_pool_id = thread_data_[thread_id].sub_thread_pool_id;
       int active_requests = thread_work_sources->size();
-      if (may_steal_blocking_work) {
+      // The most urgent requests are searched before the requests that belong
+      // to the sub thread pool of the thread, so that they preempt the other
+      // requests.
+      const int num_urgent_requests = std::min(
+          active_requests, thread_data_[thread_id].current_num_urgent_requests);
+      if (num_urgent_requests > 0) {
+        t = FindTask(0, num_urgent_requests, thread_id, sub_thread_pool_id,
+                     kMaxBlockingInflight, may_steal_blocking_work,
+                     *thread_work_sources, &task_from_blocking_queue, &tws);
+      }
+      if (!t.f && may_steal_blocking_work) {
         // Each thread will first look for tasks from requests that belongs to
         // its sub thread pool.
         int search_range_start =
@@ -570,7 +586,7 @@ void RunHandlerThreadPool::WorkerLoop(int thread_id,
                        /*may_steal_blocking_work=*/true, *thread_work_sources,
                        &task_from_blocking_queue, &tws);
         }
-      } else {
+      } else if (!t.f) {
         // For non-blocking threads, it will always search from all pending
         // requests.
         t = FindTask(0, active_requests, thread_id, sub_thread_pool_id,
@@ -680,6 +696,8 @@ void RunHandlerThreadPool::WaitForWork(bool is_blocking, int thread_id,
         thread_data_[thread_id].current_version) {
       thread_data_[thread_id].current_thread_work_sources.swap(
           thread_data_[thread_id].new_thread_work_sources);
+      thread_data_[thread_id].current_num_urgent_requests =
+          thread_data_[thread_id].new_num_urgent_requests;
       thread_data_[thread_id].current_version =
           thread_data_[thread_id].new_version;
     }
@@ -692,6 +710,8 @@ void RunHandlerThreadPool::WaitForWork(bool is_blocking, int thread_id,
           thread_data_[thread_id].current_version) {
         thread_data_[thread_id].current_thread_work_sources.swap(
             thread_data_[thread_id].new_thread_work_sources);
+        thread_data_[thread_id].current_num_urgent_requests =
+            thread_data_[thread_id].new_num_urgent_requests;
         thread_data_[thread_id].current_version =
             thread_data_[thread_id].new_version;
         thread_work_sources =
@@ -741,6 +761,10 @@ class RunHandler::Impl {
 
   int64 priority() { return options_.priority(); }
 
+  // Absolute deadline in microseconds since the Unix epoch, or 0 if the
+  // request has none.
+  int64 deadline_micros() { return options_.deadline_micros(); }
+
  private:
   class ThreadPoolInterfaceWrapper : public thread::ThreadPoolInterface {
    public:
@@ -783,7 +807,9 @@ class RunHandlerPool::Impl {
         version_(0),
         sub_thread_pool_end_request_percentage_(ParamFromEnvWithDefault(
             "TF_RUN_HANDLER_SUB_THREAD_POOL_END_REQUEST_PERCENTAGE",
-            std::vector<double>({1}))) {
+            std::vector<double>({1}))),
+        strict_priority_(ParamFromEnvBoolWithDefault(
+            "TF_RUN_HANDLER_STRICT_PRIORITY", true)) {
     VLOG(1) << "Creating a RunHandlerPool with max handlers: " << max_handlers_;
     free_handlers_.reserve(max_handlers_);
     handlers_.reserve(max_handlers_);
@@ -808,6 +834,7 @@ class RunHandlerPool::Impl {
     DCHECK_EQ(handlers_.size(), max_handlers_);
     DCHECK_EQ(free_handlers_.size(), handlers_.size());
     DCHECK_EQ(sorted_active_handlers_.size(), 0);
+    DCHECK(pending_requests_.empty());
     // Stop the threads in run_handler_thread_pool_ before freeing other
     // pointers. Otherwise a thread may try to access a pointer after the
     // pointer has been freed.
@@ -834,40 +861,63 @@ class RunHandlerPool::Impl {
                     static_cast<int32>(ParamFromEnvWithDefault(
                         "TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS",
                         kMaxConcurrentHandlers))));
+    RunOptions::Experimental::RunHandlerPoolOptions handler_options =
+        options;
+    if (handler_options.deadline_micros() == 0 && timeout_in_ms > 0) {
+      handler_options.set_deadline_micros(EnvTime::NowMicros() +
+                                          timeout_in_ms * 1000);
+    }
     uint64 version;
     int num_active_requests;
+    int num_urgent_requests;
     RunHandler::Impl* handler_impl;
     {
       mutex_lock l(mu_);
-      if (!has_free_handler()) {
+      if (!has_free_handler() || !pending_requests_.empty()) {
         profiler::TraceMe activity(
             [&] {
               return strings::StrCat("WaitingForHandler#step_id=", step_id,
                                      "#");
             },
             profiler::TraceMeLevel::kInfo);
+        // Free handlers go to the most urgent waiting request first.
+        PendingRequest request(this, handler_options.priority(),
+                               handler_options.deadline_micros());
+        auto pos = pending_requests_.begin();
+        while (pos != pending_requests_.end() &&
+               !IsMoreUrgent(request.priority, request.deadline_micros,
+                             (*pos)->priority, (*pos)->deadline_micros)) {
+          ++pos;
+        }
+        pos = pending_requests_.insert(pos, &request);
+        const Condition admitted(&request, &PendingRequest::admitted);
         if (timeout_in_ms == 0) {
-          mu_.Await(Condition(this, &Impl::has_free_handler));
+          mu_.Await(admitted);
         } else if (!mu_.AwaitWithDeadline(
-                       Condition(this, &Impl::has_free_handler),
+                       admitted,
                        EnvTime::NowNanos() + timeout_in_ms * 1000 * 1000)) {
+          pending_requests_.erase(pos);
           return nullptr;
         }
+        pending_requests_.erase(pos);
       }
-      // Remove the last entry from free_handlers_ and add to the end of
-      // sorted_active_handlers_.
+      // Remove the last entry from free_handlers_ and insert it into
+      // sorted_active_handlers_ by urgency.
       handler_impl = free_handlers_.back();
-      handler_impl->Reset(step_id, options);
+      handler_impl->Reset(step_id, handler_options);
       free_handlers_.pop_back();
 
       num_active_requests = sorted_active_handlers_.size() + 1;
       thread_work_sources->resize(num_active_requests);
-      int priority = options.priority();
+      const int64 priority = handler_options.priority();
+      const int64 deadline_micros = handler_options.deadline_micros();
       auto it = sorted_active_handlers_.cbegin();
       bool new_handler_inserted = false;
       for (int i = 0; i < num_active_requests; ++i) {
-        if (!new_handler_inserted && (it == sorted_active_handlers_.cend() ||
-                                      priority > (*it)->priority())) {
+        if (!new_handler_inserted &&
+            (it == sorted_active_handlers_.cend() ||
+             IsMoreUrgent(priority, deadline_micros, (*it)->priority(),
+                          (*it)->deadline_micros()))) {
           sorted_active_handlers_.insert(it, handler_impl);
           new_handler_inserted = true;
           // Point to the newly added handler.
@@ -876,9 +926,16 @@ class RunHandlerPool::Impl {
         (*thread_work_sources)[i] = (*it)->tws();
         ++it;
       }
+      const int64 top_priority = sorted_active_handlers_.front()->priority();
+      num_urgent_requests = 0;
+      for (RunHandler::Impl* active : sorted_active_handlers_) {
+        if (active->priority() != top_priority) break;
+        ++num_urgent_requests;
+      }
       version = ++version_;
     }
-    RecomputePoolStats(num_active_requests, version, *thread_work_sources);
+    RecomputePoolStats(num_active_requests, num_urgent_requests, version,
+                       *thread_work_sources);
     return WrapUnique<RunHandler>(new RunHandler(handler_impl));
   }
 
@@ -923,9 +980,69 @@ class RunHandlerPool::Impl {
     return ret;
   }
 
+  std::vector<int64> GetActiveHandlerStepIdsForTesting()
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    std::vector<int64> ret;
+    for (const auto& handler_impl : sorted_active_handlers_) {
+      ret.push_back(handler_impl->step_id());
+    }
+    return ret;
+  }
+
+  void WaitForPendingRequestsForTesting(int num_requests)
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    PendingRequestsAtLeast pending(this, num_requests);
+    mu_.Await(Condition(&pending, &PendingRequestsAtLeast::reached));
+  }
+
  private:
+  // A request blocked in Get() until a handler becomes free.
+  struct PendingRequest {
+    PendingRequest(Impl* pool, int64 priority, int64 deadline_micros)
+        : pool(pool), priority(priority), deadline_micros(deadline_micros) {}
+
+    // Only evaluated by mu_.Await(), with pool->mu_ held.
+    bool admitted() TF_NO_THREAD_SAFETY_ANALYSIS {
+      return pool->has_free_handler() &&
+             pool->pending_requests_.front() == this;
+    }
+
+    Impl* const pool;
+    const int64 priority;
+    const int64 deadline_micros;
+  };
+
+  struct PendingRequestsAtLeast {
+    PendingRequestsAtLeast(Impl* pool, int num_requests)
+        : pool(pool), num_requests(num_requests) {}
+
+    // Only evaluated by mu_.Await(), with pool->mu_ held.
+    bool reached() TF_NO_THREAD_SAFETY_ANALYSIS {
+      return pool->pending_requests_.size() >= num_requests;
+    }
+
+    Impl* const pool;
+    const size_t num_requests;
+  };
+
+  // Returns true if a request with `priority` and `deadline_micros` should be
+  // scheduled before one with `other_priority` and `other_deadline_micros`.
+  // Requests without a deadline (0) are the least urgent in their priority
+  // class. Ties keep arrival order.
+  static bool IsMoreUrgent(int64 priority, int64 deadline_micros,
+                           int64 other_priority, int64 other_deadline_micros) {
+    if (priority != other_priority) return priority > other_priority;
+    if (deadline_micros == 0) return false;
+    return other_deadline_micros == 0 ||
+           deadline_micros < other_deadline_micros;
+  }
+
+  // `num_urgent_requests` is the number of leading entries of
+  // `thread_work_sources` that have the highest priority.
   void RecomputePoolStats(
-      int num_active_requests, uint64 version,
+      int num_active_requests, int num_urgent_requests, uint64 version,
       const Eigen::MaxSizeVector<internal::ThreadWorkSource*>&
           thread_work_sources);
 
@@ -942,13 +1059,14 @@ class RunHandlerPool::Impl {
 
   std::unique_ptr<internal::RunHandlerThreadPool> run_handler_thread_pool_;
   // Thread compatible part used only by lock under RunHandlerPool.
-  // Handlers are sorted by start time.
-  // TODO(azaks): sort by the remaining latency budget.
+  // Handlers are sorted by priority, then deadline, then start time.
   // TODO(chaox): Consider other data structure for maintaining the sorted
   // active handlers if the searching overhead(currently O(n)) becomes the
   // bottleneck.
   std::list<RunHandler::Impl*> sorted_active_handlers_ TF_GUARDED_BY(mu_);
   std::vector<RunHandler::Impl*> free_handlers_ TF_GUARDED_BY(mu_);
+  // Requests waiting for a free handler, most urgent first.
+  std::list<PendingRequest*> pending_requests_ TF_GUARDED_BY(mu_);
   std::vector<std::unique_ptr<RunHandler::Impl>> handlers_ TF_GUARDED_BY(mu_);
 
   // Histogram of elapsed runtime of every handler (in ms).
@@ -958,10 +1076,13 @@ class RunHandlerPool::Impl {
   mutex mu_;
   int64 version_ TF_GUARDED_BY(mu_);
   const std::vector<double> sub_thread_pool_end_request_percentage_;
+  // If true, inter-op threads look for work in the requests with the highest
+  // priority before any other request.
+  const bool strict_priority_;
 };
 
 void RunHandlerPool::Impl::RecomputePoolStats(
-    int num_active_requests, uint64 version,
+    int num_active_requests, int num_urgent_requests, uint64 version,
     const Eigen::MaxSizeVector<internal::ThreadWorkSource*>&
         thread_work_sources) {
   if (num_active_requests == 0) return;
@@ -984,23 +1105,37 @@ void RunHandlerPool::Impl::RecomputePoolStats(
   int num_blocking_threads = run_handler_thread_pool()->NumBlockingThreads();
   int num_non_blocking_threads = num_threads - num_blocking_threads;
 
+  // Threads scan the requests in order after their start request. When every
+  // thread starts at a highest-priority request, lower-priority requests only
+  // get threads while the higher-priority ones have no runnable ops, i.e.
+  // they are preempted at op boundaries.
+  const int num_start_requests =
+      strict_priority_ ? num_urgent_requests : num_active_requests;
+  // Sub thread pools search their own range of requests instead of starting
+  // at a request, so they are given the number of requests that preempt the
+  // others. There is nothing to preempt if all requests are equally urgent.
+  const int num_preempting_requests =
+      strict_priority_ && num_urgent_requests < num_active_requests
+          ? num_urgent_requests
+          : 0;
   std::vector<int> request_idx_list = ChooseRequestsWithExponentialDistribution(
-      num_active_requests, num_blocking_threads);
+      num_start_requests, num_blocking_threads);
   for (int i = 0; i < num_blocking_threads; ++i) {
     VLOG(2) << "Set work for tid=" << i
             << " with start_request_idx=" << request_idx_list[i];
     run_handler_thread_pool()->SetThreadWorkSources(
-        i, request_idx_list[i], version, thread_work_sources);
+        i, request_idx_list[i], version, thread_work_sources,
+        num_preempting_requests);
   }
 
   request_idx_list = ChooseRequestsWithExponentialDistribution(
-      num_active_requests, num_non_blocking_threads);
+      num_start_requests, num_non_blocking_threads);
   for (int i = 0; i < num_non_blocking_threads; ++i) {
     VLOG(2) << "Set work for tid=" << (i + num_blocking_threads)
             << " with start_request_idx=" << request_idx_list[i];
     run_handler_thread_pool()->SetThreadWorkSources(
         i + num_blocking_threads, request_idx_list[i], version,
-        thread_work_sources);
+        thread_work_sources, num_preempting_requests);
   }
 }
 
@@ -1092,6 +1227,14 @@ std::vector<int64> RunHandlerPool::GetActiveHandlerPrioritiesForTesting()
   return impl_->GetActiveHandlerPrioritiesForTesting();
 }
 
+std::vector<int64> RunHandlerPool::GetActiveHandlerStepIdsForTesting() const {
+  return impl_->GetActiveHandlerStepIdsForTesting();
+}
+
+void RunHandlerPool::WaitForPendingRequestsForTesting(int num_requests) const {
+  impl_->WaitForPendingRequestsForTesting(num_requests);
+}
+
 RunHandler::RunHandler(Impl* impl) : impl_(impl) {}
 
 void RunHandler::ScheduleInterOpClosure(std::function<void()> fn) {
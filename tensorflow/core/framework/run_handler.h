@@ -47,6 +47,13 @@ class RunHandler;
 // * Use handler for scheduling all inter-op work by:
 // handler->ScheduleInterOpClosure(closure);
 //
+// Requests are ordered by the priority in their RunHandlerPoolOptions, then
+// by deadline, then by arrival time. Inter-op threads look for work in the
+// highest-priority requests first, so ops of lower-priority requests only run
+// when no higher-priority op is runnable (this can be disabled by setting
+// TF_RUN_HANDLER_STRICT_PRIORITY=false). When all handlers are in use, freed
+// handlers are handed to the waiting requests in the same order.
+//
 // This class is thread safe.
 class RunHandlerPool {
  public:
@@ -62,7 +69,9 @@ class RunHandlerPool {
   // and is being used by a client.  It becomes 'inactive' once more when the
   // unique_ptr is destroyed.
   //
-  // Will block unless there is an inactive handler.
+  // Will block unless there is an inactive handler. If `timeout_in_ms` is
+  // non-zero, returns nullptr once it expires, and the request's deadline
+  // defaults to `timeout_in_ms` from now.
   std::unique_ptr<RunHandler> Get(
       int64 step_id = 0, int64 timeout_in_ms = 0,
       const RunOptions::Experimental::RunHandlerPoolOptions& options =
@@ -72,6 +81,12 @@ class RunHandlerPool {
   // order of the active handler list.
   std::vector<int64> GetActiveHandlerPrioritiesForTesting() const;
 
+  // Get the step ids of active handlers, in the same order as above.
+  std::vector<int64> GetActiveHandlerStepIdsForTesting() const;
+
+  // Blocks until at least `num_requests` requests wait for a handler in Get().
+  void WaitForPendingRequestsForTesting(int num_requests) const;
+
  private:
   class Impl;
   friend class RunHandler;
@@ -82,7 +97,7 @@ class RunHandlerPool {
 // RunHandler can be used to schedule inter/intra-op closures to run on a global
 // pool shared across all Session::Run(s). The closures are enqueued to a
 // handler specific queue, from which the work is stolen in a priority order
-// (time of the Get() call).
+// (priority, deadline and time of the Get() call).
 //
 // It can only be created via RunHandlerPool::Get().
 //
@@ -237,9 +252,14 @@ class RunHandlerThreadPool {
   // Set work queues from which the thread 'tid' can steal its work.
   // The request with start_request_idx will be attempted first. Other requests
   // will be attempted in FIFO order based on their arrival time.
+  //
+  // Sub thread pools ignore start_request_idx and search the requests of
+  // their range in a round robin fashion. If num_urgent_requests is non-zero,
+  // they search the first num_urgent_requests requests before their range.
   void SetThreadWorkSources(
       int tid, int start_request_idx, uint64 version,
-      const Eigen::MaxSizeVector<ThreadWorkSource*>& thread_work_sources);
+      const Eigen::MaxSizeVector<ThreadWorkSource*>& thread_work_sources,
+      int num_urgent_requests = 0);
 
   PerThread* GetPerThread();
 
@@ -278,11 +298,13 @@ class RunHandlerThreadPool {
     int current_index;
     std::unique_ptr<Eigen::MaxSizeVector<ThreadWorkSource*>>
         new_thread_work_sources TF_GUARDED_BY(mu);
+    int new_num_urgent_requests TF_GUARDED_BY(mu);
 
     uint64 current_version;
     // Should only be accessed by one thread.
     std::unique_ptr<Eigen::MaxSizeVector<ThreadWorkSource*>>
         current_thread_work_sources;
+    int current_num_urgent_requests;
 
     int sub_thread_pool_id;
   };
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/run_handler.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -32,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
@@ -113,6 +115,29 @@ TEST(RunHandlerUtilTest, PrioritySchedulingTest) {
   EXPECT_EQ(sorted_active_list[3], 1);
 }
 
+TEST(RunHandlerUtilTest, DeadlineSchedulingTest) {
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2, 2));
+
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  options.set_priority(1);
+  options.set_deadline_micros(300);
+  auto handler1 = pool->Get(/*step_id=*/1, /*timeout_in_ms=*/0, options);
+  options.set_deadline_micros(0);
+  auto handler2 = pool->Get(/*step_id=*/2, /*timeout_in_ms=*/0, options);
+  options.set_deadline_micros(100);
+  auto handler3 = pool->Get(/*step_id=*/3, /*timeout_in_ms=*/0, options);
+  options.set_deadline_micros(300);
+  auto handler4 = pool->Get(/*step_id=*/4, /*timeout_in_ms=*/0, options);
+  options.set_priority(2);
+  options.set_deadline_micros(0);
+  auto handler5 = pool->Get(/*step_id=*/5, /*timeout_in_ms=*/0, options);
+
+  // Within a priority, requests are ordered by deadline, then arrival time.
+  // Requests without a deadline come last.
+  EXPECT_EQ(pool->GetActiveHandlerStepIdsForTesting(),
+            std::vector<int64>({5, 3, 1, 4, 2}));
+}
+
 TEST(RunHandlerThreadPool, EnqueueTask) {
   Eigen::MaxSizeVector<mutex> waiters_mu(2);
   waiters_mu.resize(2);
@@ -811,5 +836,179 @@ TEST_F(RunHandlerTest, TestWaitTimeout) {
   EXPECT_NE(next_handle.get(), nullptr);
 }
 
+TEST_F(RunHandlerTest, TestWaitingRequestsAdmittedByPriority) {
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(1, 1));
+
+  std::vector<std::unique_ptr<RunHandler>> blocking_handles;
+  const int32 kMaxConcurrentHandlers = 128;  // Copied from run_handler.cc.
+  blocking_handles.reserve(kMaxConcurrentHandlers);
+  for (int i = 0; i < kMaxConcurrentHandlers; ++i) {
+    blocking_handles.push_back(pool->Get(i));
+  }
+
+  mutex mu;
+  std::vector<int64> admitted;
+  auto get = [&pool, &mu, &admitted](int64 step_id, int64 priority) {
+    RunOptions::Experimental::RunHandlerPoolOptions options;
+    options.set_priority(priority);
+    auto handle = pool->Get(step_id, /*timeout_in_ms=*/0, options);
+    mutex_lock l(mu);
+    admitted.push_back(step_id);
+  };
+  {
+    thread::ThreadPool tp(Env::Default(), "test", 2);
+    tp.Schedule([&get]() { get(1000, /*priority=*/0); });
+    pool->WaitForPendingRequestsForTesting(1);
+    tp.Schedule([&get]() { get(1001, /*priority=*/1); });
+    pool->WaitForPendingRequestsForTesting(2);
+
+    // The request that arrived last has the higher priority, so it gets the
+    // handler that is released first.
+    blocking_handles[0].reset();
+  }
+  EXPECT_EQ(admitted, std::vector<int64>({1001, 1000}));
+}
+
+TEST_F(RunHandlerTest, TestCriticalOpsPreemptBatchOps) {
+  // A single inter-op thread, so ops run one at a time in the order in which
+  // the thread picks them.
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(1));
+
+  RunOptions::Experimental::RunHandlerPoolOptions batch_options;
+  batch_options.set_priority(0);
+  auto batch_handler = pool->Get(1, /*timeout_in_ms=*/0, batch_options);
+
+  // Keep the thread busy until every op has been scheduled.
+  Notification blocked;
+  Notification unblock;
+  batch_handler->ScheduleInterOpClosure([&blocked, &unblock]() {
+    blocked.Notify();
+    unblock.WaitForNotification();
+  });
+  blocked.WaitForNotification();
+
+  const int kNumOps = 3;
+  mutex mu;
+  std::vector<string> order;
+  BlockingCounter ops_done(2 * kNumOps);
+  auto record = [&mu, &order, &ops_done](const string& request) {
+    {
+      mutex_lock l(mu);
+      order.push_back(request);
+    }
+    ops_done.DecrementCount();
+  };
+  for (int i = 0; i < kNumOps; ++i) {
+    batch_handler->ScheduleInterOpClosure([&record]() { record("batch"); });
+  }
+
+  // The critical request arrives after the batch ops were scheduled.
+  RunOptions::Experimental::RunHandlerPoolOptions critical_options;
+  critical_options.set_priority(1);
+  auto critical_handler = pool->Get(2, /*timeout_in_ms=*/0, critical_options);
+  for (int i = 0; i < kNumOps; ++i) {
+    critical_handler->ScheduleInterOpClosure(
+        [&record]() { record("critical"); });
+  }
+
+  unblock.Notify();
+  ops_done.Wait();
+  // Every runnable op of the critical request runs before the pending ops of
+  // the batch request.
+  EXPECT_EQ(order, std::vector<string>({"critical", "critical", "critical",
+                                        "batch", "batch", "batch"}));
+}
+
+// Blocks every inter-op thread of `pool` with an op of a batch request, then
+// schedules `num_threads` ops of the batch request and of a more urgent
+// critical request. Returns the requests of the first op that each thread
+// runs once released, sorted.
+std::vector<string> FirstOpPerThread(RunHandlerPool* pool, int num_threads) {
+  RunOptions::Experimental::RunHandlerPoolOptions batch_options;
+  batch_options.set_priority(0);
+  auto batch_handler = pool->Get(1, /*timeout_in_ms=*/0, batch_options);
+
+  BlockingCounter blocked(num_threads);
+  Notification unblock;
+  for (int i = 0; i < num_threads; ++i) {
+    batch_handler->ScheduleInterOpClosure([&blocked, &unblock]() {
+      blocked.DecrementCount();
+      unblock.WaitForNotification();
+    });
+  }
+  blocked.Wait();
+
+  mutex mu;
+  std::vector<string> order;
+  // Each thread waits in its first op until every thread has started one.
+  Notification first_ops_started;
+  BlockingCounter ops_done(2 * num_threads);
+  auto run_op = [&mu, &order, &first_ops_started, &ops_done,
+                 num_threads](const string& request) {
+    bool is_first_op;
+    {
+      mutex_lock l(mu);
+      order.push_back(request);
+      const int num_started = order.size();
+      is_first_op = num_started <= num_threads;
+      if (num_started == num_threads) first_ops_started.Notify();
+    }
+    if (is_first_op) first_ops_started.WaitForNotification();
+    ops_done.DecrementCount();
+  };
+  for (int i = 0; i < num_threads; ++i) {
+    batch_handler->ScheduleInterOpClosure([&run_op]() { run_op("batch"); });
+  }
+  RunOptions::Experimental::RunHandlerPoolOptions critical_options;
+  critical_options.set_priority(1);
+  auto critical_handler = pool->Get(2, /*timeout_in_ms=*/0, critical_options);
+  for (int i = 0; i < num_threads; ++i) {
+    critical_handler->ScheduleInterOpClosure(
+        [&run_op]() { run_op("critical"); });
+  }
+
+  unblock.Notify();
+  ops_done.Wait();
+  std::vector<string> first_ops(order.begin(), order.begin() + num_threads);
+  std::sort(first_ops.begin(), first_ops.end());
+  return first_ops;
+}
+
+TEST_F(RunHandlerTest, TestCriticalOpsPreemptBatchOpsOnEveryThread) {
+  ASSERT_EQ(setenv("TF_RUN_HANDLER_USE_SUB_THREAD_POOL", "false", true), 0);
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2));
+  // Every thread starts at the critical request.
+  EXPECT_EQ(FirstOpPerThread(pool.get(), 2),
+            std::vector<string>({"critical", "critical"}));
+}
+
+TEST_F(RunHandlerTest, TestBatchOpsNotPreemptedWithoutStrictPriority) {
+  ASSERT_EQ(setenv("TF_RUN_HANDLER_USE_SUB_THREAD_POOL", "false", true), 0);
+  ASSERT_EQ(setenv("TF_RUN_HANDLER_STRICT_PRIORITY", "false", true), 0);
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2));
+  ASSERT_EQ(unsetenv("TF_RUN_HANDLER_STRICT_PRIORITY"), 0);
+  // The threads are spread over both requests, so one of them runs a batch op
+  // while critical ops are runnable.
+  EXPECT_EQ(FirstOpPerThread(pool.get(), 2),
+            std::vector<string>({"batch", "critical"}));
+}
+
+TEST_F(RunHandlerTest, TestCriticalOpsPreemptBatchOpsInSubThreadPools) {
+  ASSERT_EQ(setenv("TF_RUN_HANDLER_USE_SUB_THREAD_POOL", "true", true), 0);
+  ASSERT_EQ(
+      setenv("TF_RUN_HANDLER_NUM_THREADS_IN_SUB_THREAD_POOL", "1,1", true), 0);
+  ASSERT_EQ(setenv("TF_RUN_HANDLER_SUB_THREAD_POOL_START_REQUEST_PERCENTAGE",
+                   "0,0.5", true),
+            0);
+  ASSERT_EQ(setenv("TF_RUN_HANDLER_SUB_THREAD_POOL_END_REQUEST_PERCENTAGE",
+                   "0.5,1", true),
+            0);
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2));
+  // The batch request is in the range of the second sub thread pool, but its
+  // thread runs the critical ops first.
+  EXPECT_EQ(FirstOpPerThread(pool.get(), 2),
+            std::vector<string>({"critical", "critical"}));
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -640,6 +640,12 @@ class SymbolicShapeRefiner {
     std::vector<ShapeHandle> input_tensors_as_shapes_to_propagate;
     std::vector<ShapeHandle> output_tensors_as_shapes;
 
+    // The one ShapeHandle (resp. DimensionHandle) used to denote a fully
+    // unknown shape (resp. dimension) of each output, keyed by output port
+    // (resp. output port and dimension index).
+    absl::flat_hash_map<int, ShapeHandle> unknown_shapes;
+    absl::flat_hash_map<std::pair<int, int>, DimensionHandle> unknown_dims;
+
     // Output shapes incompatible between annotation and shape inference.
     bool shape_incompatible = false;
 
@@ -1097,36 +1103,6 @@ class SymbolicShapeRefiner {
     return Status::OK();
   }
 
-  struct ShapeId {
-    const NodeDef* node;
-    int port_id;
-    bool operator==(const ShapeId& other) const {
-      return node == other.node && port_id == other.port_id;
-    }
-  };
-  struct HashShapeId {
-    std::size_t operator()(const ShapeId& shp) const {
-      return std::hash<const NodeDef*>{}(shp.node) + shp.port_id;
-    }
-  };
-
-  struct DimId {
-    const NodeDef* node;
-    int port_id;
-    int dim_index;
-    bool operator==(const DimId& other) const {
-      return node == other.node && port_id == other.port_id &&
-             dim_index == other.dim_index;
-    }
-  };
-
-  struct HashDimId {
-    std::size_t operator()(const DimId& dim) const {
-      return std::hash<const NodeDef*>{}(dim.node) + dim.port_id +
-             dim.dim_index;
-    }
-  };
-
   // 'port_index' as the union of shape1 and shape2.
   ShapeHandle OutputAsUnion(const NodeDef* node, int port_index,
                             ShapeHandle shape1, ShapeHandle shape2) {
@@ -1336,32 +1312,107 @@ class SymbolicShapeRefiner {
     return s;
   }
 
+  // Forgets the shapes inferred for `nodes`, which were modified or deleted
+  // from the graph, so that they are inferred again from scratch by
+  // UpdateNode(). The inference contexts of the nodes are retired rather than
+  // destroyed since other contexts may still refer to the shapes they own.
+  void RemoveNodes(const absl::flat_hash_set<const NodeDef*>& nodes) {
+    for (const NodeDef* node : nodes) {
+      auto it = node_to_context_.find(node);
+      if (it == node_to_context_.end()) continue;
+      retired_contexts_.push_back(std::move(it->second.inference_context));
+      node_to_context_.erase(it);
+    }
+  }
+
+  // Returns true if more inference contexts were retired by RemoveNodes() than
+  // there are live ones. The retired contexts are only freed with the refiner,
+  // so it should then be rebuilt to bound the memory used by updates.
+  bool TooManyRetiredContexts() const {
+    return retired_contexts_.size() > node_to_context_.size();
+  }
+
+  // Drops the input values that the node got from its fanins, since they may
+  // point to the attributes of modified fanins. They are set again the next
+  // time the node is updated.
+  void ClearInputValues(const NodeDef* node) {
+    NodeContext* ctx = GetNodeContext(node);
+    if (ctx == nullptr) return;
+    std::fill(ctx->input_tensor_protos.begin(), ctx->input_tensor_protos.end(),
+              nullptr);
+  }
+
+  // Returns the output shapes of the node if they fully describe its outputs,
+  // i.e. if the node doesn't also propagate tensor values or resource handles,
+  // so that comparing shapes is enough to tell if the outputs changed.
+  bool GetOutputShapesIfComparable(const NodeDef* node,
+                                   std::vector<ShapeHandle>* shapes) {
+    const NodeContext* ctx = GetNodeContext(node);
+    if (ctx == nullptr || ctx->inference_context == nullptr) {
+      return false;
+    }
+    for (const TensorProto* tensor_proto : ctx->output_tensor_protos) {
+      if (tensor_proto != nullptr) return false;
+    }
+    for (const ShapeHandle& shape : ctx->output_tensors_as_shapes) {
+      if (shape.IsSet()) return false;
+    }
+    InferenceContext* ic = ctx->inference_context.get();
+    shapes->clear();
+    for (int i = 0; i < ic->num_outputs(); ++i) {
+      if (ic->output_handle_shapes_and_types(i) != nullptr) return false;
+      shapes->push_back(ic->output(i));
+    }
+    return true;
+  }
+
+  // Restores the previous output shapes of the node if they're equivalent to
+  // the new ones. Returns true if the outputs were restored, in which case
+  // the fanout of the node doesn't need to be updated.
+  bool MaybeRestoreOutputShapes(const NodeDef* node,
+                                const std::vector<ShapeHandle>& old_shapes) {
+    std::vector<ShapeHandle> new_shapes;
+    if (!GetOutputShapesIfComparable(node, &new_shapes) ||
+        new_shapes.size() != old_shapes.size()) {
+      return false;
+    }
+    for (int i = 0, end = new_shapes.size(); i < end; ++i) {
+      if (!EquivalentShapes(old_shapes[i], new_shapes[i])) {
+        return false;
+      }
+    }
+    InferenceContext* ic = GetContext(node);
+    for (int i = 0, end = old_shapes.size(); i < end; ++i) {
+      ic->set_output(i, old_shapes[i]);
+    }
+    return true;
+  }
+
  private:
   // Return the one ShapeHandle used to denote a fully unknown shape for a node
   // output.
   ShapeHandle GetUnknownOutputShape(const NodeDef* node, int index) {
-    ShapeId id{node, index};
-    auto it = unknown_shapes_.find(id);
-    if (it != unknown_shapes_.end()) {
+    NodeContext* ctx = GetNodeContext(node);
+    auto it = ctx->unknown_shapes.find(index);
+    if (it != ctx->unknown_shapes.end()) {
       return it->second;
     }
-    InferenceContext* c = GetContext(node);
-    ShapeHandle shp = c->UnknownShape();
-    unknown_shapes_[id] = shp;
+    ShapeHandle shp = ctx->inference_context->UnknownShape();
+    ctx->unknown_shapes[index] = shp;
     return shp;
   }
   // Return the one ShapeHandle used to denote a fully unknown dimension for a
   // node output.
   DimensionHandle GetUnknownOutputDim(const NodeDef* node, int index,
                                       int dim_id) {
-    DimId id{node, index, dim_id};
-    auto it = unknown_dims_.find(id);
-    if (it != unknown_dims_.end()) {
+    NodeContext* ctx = GetNodeContext(node);
+    const std::pair<int, int> id(index, dim_id);
+    auto it = ctx->unknown_dims.find(id);
+    if (it != ctx->unknown_dims.end()) {
       return it->second;
     }
-    InferenceContext* c = GetContext(node);
-    DimensionHandle dim = c->UnknownDim();
-    unknown_dims_[id] = dim;
+    DimensionHandle dim = ctx->inference_context->UnknownDim();
+    ctx->unknown_dims[id] = dim;
     return dim;
   }
 
@@ -1985,8 +2036,8 @@ class SymbolicShapeRefiner {
   const GraphView& graph_;
   int graph_def_version_;
   absl::flat_hash_map<const NodeDef*, NodeContext> node_to_context_;
-  absl::flat_hash_map<ShapeId, ShapeHandle, HashShapeId> unknown_shapes_;
-  absl::flat_hash_map<DimId, DimensionHandle, HashDimId> unknown_dims_;
+  // Contexts of the nodes removed by RemoveNodes().
+  std::vector<std::unique_ptr<InferenceContext>> retired_contexts_;
   // Store function instantiations only for valid function. If function
   // instantiation failed it will have an `absl::nullopt`.
   absl::flat_hash_map<string, absl::optional<GrapplerFunctionItem>>
@@ -2190,7 +2241,7 @@ Status GraphProperties::UpdateShapes(
 Status GraphProperties::PropagateShapes(
     SymbolicShapeRefiner* shape_refiner, TopoQueue* new_shapes,
     const absl::flat_hash_map<const NodeDef*, const NodeDef*>& resource_handles,
-    int num_loops) const {
+    int num_loops, absl::flat_hash_set<const NodeDef*>* refined_nodes) const {
   // Limit the number of iterations to prevent infinite loops in the presence of
   // incorrect shape functions. The algorithm should converge in at most
   // num_nested_loops^2 * max_rank. We approximate max_rank with the constant 4.
@@ -2207,14 +2258,26 @@ Status GraphProperties::PropagateShapes(
   const int64 max_resource_iterations = num_queues * num_queues * max_rank;
 
   int64 num_resource_iterations = 0;
+  std::vector<ShapeHandle> old_shapes;
   do {
     int64 num_loop_iterations = 0;
     while (!new_shapes->empty() &&
            num_loop_iterations++ < max_loop_iterations) {
       const NodeDef* n = new_shapes->pop();
+      const bool compare_shapes =
+          refined_nodes != nullptr &&
+          shape_refiner->GetOutputShapesIfComparable(n, &old_shapes);
       bool updated = false;
       TF_RETURN_IF_ERROR(
           UpdateShapes(shape_refiner, resource_handles, n, &updated));
+      if (updated && refined_nodes != nullptr) {
+        refined_nodes->insert(n);
+        if (compare_shapes &&
+            shape_refiner->MaybeRestoreOutputShapes(n, old_shapes)) {
+          // The fanout of the node sees the same shapes as before.
+          updated = false;
+        }
+      }
       if (updated) {
         for (const auto& fanout : shape_refiner->graph().GetFanouts(
                  *n, /*include_controlled_nodes=*/false)) {
@@ -2333,21 +2396,220 @@ Status GraphProperties::UpdateEnqueue(
   return Status::OK();
 }
 
+namespace {
+
+// GraphView that can be kept in sync with a graph modified in place, so that
+// UpdateStatically() doesn't need to index the whole graph again. The nodes
+// are keyed by copies of their names, which remain valid when the nodes are
+// renamed or deleted.
+class IncrementalGraphView : public GraphView {
+ public:
+  explicit IncrementalGraphView(const GraphDef* graph) : GraphView(graph) {
+    nodes().clear();
+    fanouts().clear();
+    max_regular_input_port().clear();
+    max_regular_output_port().clear();
+    for (const NodeDef& node : graph->node()) AddNode(&node);
+    for (const NodeDef& node : graph->node()) AddFanins(&node);
+  }
+
+  // Returns the name of the node when it was added to the view, or nullptr if
+  // the node isn't in the view.
+  const string* IndexedName(const NodeDef* node) const {
+    auto it = indexed_nodes_.find(node);
+    return it == indexed_nodes_.end() ? nullptr : it->second.name.get();
+  }
+
+  // Adds a node to the view. Its fanins must be added with AddFanins() once
+  // all the new nodes are in the view.
+  void AddNode(const NodeDef* node) {
+    IndexedNode& indexed = indexed_nodes_[node];
+    indexed.name = absl::make_unique<string>(node->name());
+    nodes().emplace(*indexed.name, node);
+  }
+
+  void AddFanins(const NodeDef* node) {
+    IndexedNode& indexed = indexed_nodes_.at(node);
+    int max_input_port = -1;
+    for (int i = 0; i < node->input_size(); ++i) {
+      const TensorId tensor_id = ParseTensorName(node->input(i));
+      const NodeDef* fanin = GetNode(tensor_id.node());
+      if (fanin == nullptr) continue;
+      const OutputPort output(fanin, tensor_id.index());
+      const InputPort input(node, output.port_id < 0 ? -1 : i);
+      if (output.port_id >= 0) {
+        max_input_port = i;
+        int& max_output_port = max_regular_output_port()[fanin];
+        max_output_port = std::max(max_output_port, output.port_id);
+      }
+      fanouts()[output].insert(input);
+      indexed.fanins.emplace_back(output, input);
+    }
+    if (max_input_port > -1) {
+      max_regular_input_port()[node] = max_input_port;
+    }
+  }
+
+  // Removes a node that was modified or deleted from the view, along with the
+  // edges to its fanins as they were when the node was added. If the node was
+  // deleted, the edges to its fanouts are removed too: since the fanouts had
+  // to be modified, they are removed separately.
+  void RemoveNode(const NodeDef* node, bool deleted) {
+    auto it = indexed_nodes_.find(node);
+    if (it == indexed_nodes_.end()) return;
+    for (const Edge& fanin : it->second.fanins) {
+      auto fanouts_it = fanouts().find(fanin.src);
+      if (fanouts_it == fanouts().end()) continue;
+      fanouts_it->second.erase(fanin.dst);
+      if (fanouts_it->second.empty()) fanouts().erase(fanouts_it);
+    }
+    max_regular_input_port().erase(node);
+    if (deleted) {
+      const int max_output_port =
+          gtl::FindWithDefault(max_regular_output_port(), node, -1);
+      for (int port = -1; port <= max_output_port; ++port) {
+        fanouts().erase(OutputPort(node, port));
+      }
+      max_regular_output_port().erase(node);
+    }
+    nodes().erase(*it->second.name);
+    indexed_nodes_.erase(it);
+  }
+
+ private:
+  struct IndexedNode {
+    // Owns the key of the node in nodes().
+    std::unique_ptr<const string> name;
+    std::vector<Edge> fanins;
+  };
+  absl::flat_hash_map<const NodeDef*, IndexedNode> indexed_nodes_;
+};
+
+// Computes a topological order of the nodes in the transitive fanout of
+// `seeds`, following regular edges. Returns false if these nodes have a
+// cycle. The cost is linear in the size of the fanout, not of the graph.
+bool ComputeFanoutTopologicalOrder(const GraphView& graph_view,
+                                   const std::vector<const NodeDef*>& seeds,
+                                   std::vector<const NodeDef*>* topo_order) {
+  absl::flat_hash_map<const NodeDef*, int> num_pending_fanins;
+  std::vector<const NodeDef*> fanout_nodes;
+  for (const NodeDef* seed : seeds) {
+    if (num_pending_fanins.emplace(seed, 0).second) {
+      fanout_nodes.push_back(seed);
+    }
+  }
+  for (int i = 0; i < fanout_nodes.size(); ++i) {
+    for (const auto& fanout : graph_view.GetFanouts(
+             *fanout_nodes[i], /*include_controlled_nodes=*/false)) {
+      auto inserted = num_pending_fanins.emplace(fanout.node, 1);
+      if (inserted.second) {
+        fanout_nodes.push_back(fanout.node);
+      } else {
+        ++inserted.first->second;
+      }
+    }
+  }
+
+  topo_order->clear();
+  topo_order->reserve(fanout_nodes.size());
+  for (const NodeDef* node : fanout_nodes) {
+    if (num_pending_fanins[node] == 0) topo_order->push_back(node);
+  }
+  for (int i = 0; i < topo_order->size(); ++i) {
+    for (const auto& fanout : graph_view.GetFanouts(
+             *(*topo_order)[i], /*include_controlled_nodes=*/false)) {
+      if (--num_pending_fanins[fanout.node] == 0) {
+        topo_order->push_back(fanout.node);
+      }
+    }
+  }
+  return topo_order->size() == fanout_nodes.size();
+}
+
+}  // namespace
+
+struct GraphProperties::InferenceState {
+  bool aggressive_shape_inference = false;
+  bool include_input_tensor_values = false;
+  bool include_output_tensor_values = false;
+  // Referenced by the refiner.
+  absl::flat_hash_map<string, absl::flat_hash_set<int>> fed_ports;
+  // An IncrementalGraphView if the state is kept for incremental updates.
+  std::unique_ptr<GraphView> graph_view;
+  std::unique_ptr<SymbolicShapeRefiner> refiner;
+  std::unique_ptr<SymbolicShapeManager> shape_manager;
+  // Size of the function library when the refiner was created.
+  int num_functions = 0;
+  // True if the graph has loops or queues, which need the relaxations done by
+  // a full propagation.
+  bool has_loops_or_queues = false;
+};
+
+GraphProperties::GraphProperties(const GrapplerItem& item) : item_(item) {}
+
+GraphProperties::~GraphProperties() {}
+
+namespace {
+
+// Merges the symbolic shapes and dimensions that the shape functions of the
+// nodes found to be equal. Returns false if they are inconsistent.
+bool MergeSymbolicShapes(
+    const absl::flat_hash_map<string, absl::flat_hash_set<int>>& fed_ports,
+    const NodeDef& node, SymbolicShapeRefiner* refiner,
+    SymbolicShapeManager* shape_manager) {
+  auto node_ctx = refiner->GetContext(&node);
+  if (!node_ctx) {
+    return true;
+  }
+  // Skip any information that comes from fed nodes.
+  if (fed_ports.find(node.name()) != fed_ports.end()) {
+    VLOG(2) << "Skipping feed node shape: " << node.name();
+    return true;
+  }
+  for (const auto& merged_shapes : node_ctx->MergedShapes()) {
+    if (!shape_manager->Merge(merged_shapes.first, merged_shapes.second)
+             .ok()) {
+      return false;
+    }
+  }
+  for (const auto& merged_dims : node_ctx->MergedDims()) {
+    if (!shape_manager->Merge(merged_dims.first, merged_dims.second).ok()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
 Status GraphProperties::InferStatically(bool assume_valid_feeds,
                                         bool aggressive_shape_inference,
                                         bool include_input_tensor_values,
                                         bool include_output_tensor_values) {
-  FunctionLibraryDefinition function_library(OpRegistry::Global(),
-                                             item_.graph.library());
-  absl::flat_hash_map<string, absl::flat_hash_set<int>> fed_ports;
+  auto state = absl::make_unique<InferenceState>();
+  state->aggressive_shape_inference = aggressive_shape_inference;
+  state->include_input_tensor_values = include_input_tensor_values;
+  state->include_output_tensor_values = include_output_tensor_values;
   if (!assume_valid_feeds) {
     for (const auto& feed : item_.feed) {
       SafeTensorId tensor_id = ParseTensorName(feed.first);
-      fed_ports[tensor_id.node()].insert(tensor_id.index());
+      state->fed_ports[tensor_id.node()].insert(tensor_id.index());
     }
   }
+  return InferStaticallyFromScratch(std::move(state));
+}
 
-  GraphView graph_view(&item_.graph);
+Status GraphProperties::InferStaticallyFromScratch(
+    std::unique_ptr<InferenceState> state) {
+  state_.reset();
+  const absl::flat_hash_map<string, absl::flat_hash_set<int>>& fed_ports =
+      state->fed_ports;
+  if (incremental_updates_) {
+    state->graph_view = absl::make_unique<IncrementalGraphView>(&item_.graph);
+  } else {
+    state->graph_view = absl::make_unique<GraphView>(&item_.graph);
+  }
+  const GraphView& graph_view = *state->graph_view;
 
   // List the resources and the nodes using them. Also collect the Merge nodes,
   // fed nodes, and primary inputs.
@@ -2392,7 +2654,11 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
     if (fed_ports.find(node.name()) != fed_ports.end()) {
       fed_nodes.insert(&node);
     }
+    if (IsQueue(node) || IsEnqueue(node)) {
+      state->has_loops_or_queues = true;
+    }
   }
+  state->has_loops_or_queues |= !merge_nodes.empty() || num_loops > 0;
 
   absl::flat_hash_map<const NodeDef*, const NodeDef*> resource_handles;
   std::vector<TopologicalDependency> extra_deps;
@@ -2423,8 +2689,10 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
 
   // Heap-allocate SymbolicShapeRefiner in order to not consume a large amount
   // of stack space.
-  auto refiner = absl::make_unique<SymbolicShapeRefiner>(
-      graph_view, fed_ports, aggressive_shape_inference);
+  state->refiner = absl::make_unique<SymbolicShapeRefiner>(
+      graph_view, fed_ports, state->aggressive_shape_inference);
+  state->num_functions = item_.graph.library().function_size();
+  SymbolicShapeRefiner* refiner = state->refiner.get();
 
   TopoQueue new_shapes(topo_order);
   // Also seed the propagation of shapes in the fanout of primary inputs.
@@ -2437,138 +2705,270 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
   }
   // Propagate shapes normally.
   TF_RETURN_IF_ERROR(
-      PropagateShapes(refiner.get(), &new_shapes, resource_handles, num_loops));
+      PropagateShapes(refiner, &new_shapes, resource_handles, num_loops));
 
   // Track shapes globally across the graph.
-  std::unique_ptr<SymbolicShapeManager> shape_manager =
-      absl::make_unique<SymbolicShapeManager>();
-  bool found_error = false;
+  state->shape_manager = absl::make_unique<SymbolicShapeManager>();
   for (const NodeDef& node : item_.graph.node()) {
-    auto node_ctx = refiner->GetContext(&node);
-    if (!node_ctx) {
-      continue;
-    }
-    // Skip any information that comes from fed nodes.
-    if (fed_ports.find(node.name()) != fed_ports.end()) {
-      VLOG(2) << "Skipping feed node shape: " << node.name();
-      continue;
-    }
-    for (const auto& merged_shapes : node_ctx->MergedShapes()) {
-      if (!shape_manager->Merge(merged_shapes.first, merged_shapes.second)
-               .ok()) {
-        found_error = true;
-        break;
-      }
-    }
-    for (const auto& merged_dims : node_ctx->MergedDims()) {
-      if (!shape_manager->Merge(merged_dims.first, merged_dims.second).ok()) {
-        found_error = true;
-        break;
-      }
-    }
-    if (found_error) {
+    if (!MergeSymbolicShapes(fed_ports, node, refiner,
+                             state->shape_manager.get())) {
       // The shapes aren't consistent, we can't infer safely: discard all the
       // information discovered so far.
-      shape_manager = absl::make_unique<SymbolicShapeManager>();
+      state->shape_manager = absl::make_unique<SymbolicShapeManager>();
       break;
     }
   }
 
   for (const NodeDef& node : item_.graph.node()) {
-    VLOG(3) << "Filling in graph properties for node: " << node.name();
-    auto ctx = refiner->GetNodeContext(&node);
-    if (!ctx) {
-      continue;
-    }
+    FillProperties(*state, node);
+  }
 
-    auto* ic = ctx->inference_context.get();
+  if (state->aggressive_shape_inference && !incompatible_shape_nodes_.empty())
+    LOG(WARNING) << incompatible_shape_nodes_.size()
+                 << " nodes have incompatible output shapes.";
 
-    // Fill input properties.
-    {
-      auto& input_properties = input_properties_[node.name()];
-
-      // Should always be empty, node names in graph are supposed to be unique.
-      CHECK_EQ(input_properties.size(), 0);
-
-      input_properties.resize(ic->num_inputs());
-      GraphView::InputPort input(&node, -1);
-      for (int i = 0; i < ic->num_inputs(); ++i) {
-        shape_manager->AsTensorProperties(ic->input(i), ctx->input_types[i],
-                                          &input_properties[i]);
-        input.port_id = i;
-        GraphView::OutputPort fanin = graph_view.GetRegularFanin(input);
-        if (include_input_tensor_values) {
-          // Export tensor value to input_properties.value.
-          if (IsConstant(*fanin.node)) {
-            const TensorProto& raw_val =
-                fanin.node->attr().at("value").tensor();
-            *input_properties[i].mutable_value() = raw_val;
-          } else if (static_cast<int>(ctx->input_tensor_protos.size()) > i &&
-                     ctx->input_tensor_protos[i] != nullptr) {
-            *input_properties[i].mutable_value() = *ctx->input_tensor_protos[i];
-          } else if (static_cast<int>(ic->input_tensors_as_shapes().size()) >
-                         i &&
-                     IsShapeFullyDefinedIntegerVectorOrScalar(
-                         ic, ic->input(i), ic->input_tensors_as_shapes()[i],
-                         ctx->input_types[i])) {
-            *input_properties[i].mutable_value() = MakeTensorProtoFromShape(
-                ic, ic->input(i), ic->input_tensors_as_shapes()[i],
-                ctx->input_types[i]);
-          }
+  // Help trace the unknown dimensions to their origins.
+  VerboseLogUnknownDimensionSources(item_.graph, input_properties_,
+                                    output_properties_);
+
+  if (incremental_updates_) {
+    state_ = std::move(state);
+  }
+  return Status::OK();
+}
+
+void GraphProperties::FillProperties(const InferenceState& state,
+                                     const NodeDef& node) {
+  VLOG(3) << "Filling in graph properties for node: " << node.name();
+  SymbolicShapeRefiner* refiner = state.refiner.get();
+  SymbolicShapeManager* shape_manager = state.shape_manager.get();
+  const GraphView& graph_view = *state.graph_view;
+  const bool include_input_tensor_values = state.include_input_tensor_values;
+  const bool include_output_tensor_values = state.include_output_tensor_values;
+  const bool aggressive_shape_inference = state.aggressive_shape_inference;
+  auto ctx = refiner->GetNodeContext(&node);
+  if (!ctx) {
+    return;
+  }
+
+  auto* ic = ctx->inference_context.get();
+
+  // Fill input properties.
+  {
+    auto& input_properties = input_properties_[node.name()];
+
+    // Should always be empty, node names in graph are supposed to be unique.
+    CHECK_EQ(input_properties.size(), 0);
+
+    input_properties.resize(ic->num_inputs());
+    GraphView::InputPort input(&node, -1);
+    for (int i = 0; i < ic->num_inputs(); ++i) {
+      shape_manager->AsTensorProperties(ic->input(i), ctx->input_types[i],
+                                        &input_properties[i]);
+      input.port_id = i;
+      GraphView::OutputPort fanin = graph_view.GetRegularFanin(input);
+      if (include_input_tensor_values) {
+        // Export tensor value to input_properties.value.
+        if (IsConstant(*fanin.node)) {
+          const TensorProto& raw_val = fanin.node->attr().at("value").tensor();
+          *input_properties[i].mutable_value() = raw_val;
+        } else if (static_cast<int>(ctx->input_tensor_protos.size()) > i &&
+                   ctx->input_tensor_protos[i] != nullptr) {
+          *input_properties[i].mutable_value() = *ctx->input_tensor_protos[i];
+        } else if (static_cast<int>(ic->input_tensors_as_shapes().size()) >
+                       i &&
+                   IsShapeFullyDefinedIntegerVectorOrScalar(
+                       ic, ic->input(i), ic->input_tensors_as_shapes()[i],
+                       ctx->input_types[i])) {
+          *input_properties[i].mutable_value() = MakeTensorProtoFromShape(
+              ic, ic->input(i), ic->input_tensors_as_shapes()[i],
+              ctx->input_types[i]);
         }
       }
     }
+  }
 
-    // Fill output properties.
-    {
-      auto& output_properties = output_properties_[node.name()];
+  // Fill output properties.
+  {
+    auto& output_properties = output_properties_[node.name()];
+
+    // Should always be empty, node names in graph are supposed to be unique.
+    CHECK_EQ(output_properties.size(), 0);
+
+    output_properties.resize(ic->num_outputs());
+    for (int i = 0; i < ic->num_outputs(); ++i) {
+      shape_manager->AsTensorProperties(ic->output(i), ctx->output_types[i],
+                                        &output_properties[i]);
+      auto converted_output_tensors_as_shapes =
+          ReplaceUnknownDimFromConstWithUnknownDim(
+              ic, ctx->output_tensors_as_shapes);
+      if (include_output_tensor_values) {
+        // Export tensor value to output_properties.value.
+        if (IsConstant(node)) {
+          // TODO(rmlarsen): Eliminate this copy.
+          const TensorProto& raw_val = node.attr().at("value").tensor();
+          *output_properties[i].mutable_value() = raw_val;
+        } else if (static_cast<int>(ctx->output_tensor_protos.size()) > i &&
+                   ctx->output_tensor_protos[i] != nullptr) {
+          *output_properties[i].mutable_value() = *ctx->output_tensor_protos[i];
+        } else if (static_cast<int>(
+                       converted_output_tensors_as_shapes.size()) > i &&
+                   IsShapeFullyDefinedIntegerVectorOrScalar(
+                       ic, ic->output(i), converted_output_tensors_as_shapes[i],
+                       ctx->output_types[i])) {
+          *output_properties[i].mutable_value() = MakeTensorProtoFromShape(
+              ic, ic->output(i), converted_output_tensors_as_shapes[i],
+              ctx->output_types[i]);
+        }
+      }
+    }
+  }
 
-      // Should always be empty, node names in graph are supposed to be unique.
-      CHECK_EQ(output_properties.size(), 0);
+  if (aggressive_shape_inference && ctx->shape_incompatible)
+    incompatible_shape_nodes_.insert(node.name());
+}
 
-      output_properties.resize(ic->num_outputs());
-      for (int i = 0; i < ic->num_outputs(); ++i) {
-        shape_manager->AsTensorProperties(ic->output(i), ctx->output_types[i],
-                                          &output_properties[i]);
-        auto converted_output_tensors_as_shapes =
-            ReplaceUnknownDimFromConstWithUnknownDim(
-                ic, ctx->output_tensors_as_shapes);
-        if (include_output_tensor_values) {
-          // Export tensor value to output_properties.value.
-          if (IsConstant(node)) {
-            // TODO(rmlarsen): Eliminate this copy.
-            const TensorProto& raw_val = node.attr().at("value").tensor();
-            *output_properties[i].mutable_value() = raw_val;
-          } else if (static_cast<int>(ctx->output_tensor_protos.size()) > i &&
-                     ctx->output_tensor_protos[i] != nullptr) {
-            *output_properties[i].mutable_value() =
-                *ctx->output_tensor_protos[i];
-          } else if (static_cast<int>(
-                         converted_output_tensors_as_shapes.size()) > i &&
-                     IsShapeFullyDefinedIntegerVectorOrScalar(
-                         ic, ic->output(i),
-                         converted_output_tensors_as_shapes[i],
-                         ctx->output_types[i])) {
-            *output_properties[i].mutable_value() = MakeTensorProtoFromShape(
-                ic, ic->output(i), converted_output_tensors_as_shapes[i],
-                ctx->output_types[i]);
-          }
-        }
+Status GraphProperties::UpdateStatically(
+    const MutableGraphView& graph_view,
+    const absl::flat_hash_set<string>& updated_nodes) {
+  if (state_ == nullptr) {
+    return errors::FailedPrecondition(
+        "UpdateStatically() requires a prior call to InferStatically() with "
+        "incremental updates enabled");
+  }
+  if (graph_view.graph() != &item_.graph) {
+    return errors::InvalidArgument(
+        "UpdateStatically() requires a view of the graph of the item");
+  }
+  std::unique_ptr<InferenceState> state = std::move(state_);
+  const auto infer_from_scratch = [this, &state]() {
+    input_properties_.clear();
+    output_properties_.clear();
+    incompatible_shape_nodes_.clear();
+    return InferStaticallyFromScratch(std::move(state));
+  };
+
+  // The refiner instantiates the functions of the library when it's created.
+  if (item_.graph.library().function_size() != state->num_functions) {
+    VLOG(1) << "The function library changed, inferring all the shapes again";
+    return infer_from_scratch();
+  }
+  // Loops and queues need the relaxations done by a full propagation.
+  if (state->has_loops_or_queues) {
+    return infer_from_scratch();
+  }
+
+  // Match the updated nodes with the nodes of the same name that were in the
+  // graph the last time the shapes were inferred. Nodes may be deleted, and
+  // new nodes may reuse the address of deleted nodes, so all of them are
+  // stale. The properties of the deleted nodes and of the old names of the
+  // renamed nodes are dropped.
+  auto* indexed_view =
+      static_cast<IncrementalGraphView*>(state->graph_view.get());
+  std::vector<const NodeDef*> seeds;
+  absl::flat_hash_set<const NodeDef*> stale_nodes;
+  absl::flat_hash_set<const NodeDef*> indexed_nodes;
+  std::vector<string> stale_names;
+  for (const string& node_name : updated_nodes) {
+    const NodeDef* node = graph_view.GetNode(node_name);
+    if (node != nullptr) {
+      if (IsMerge(*node) || IsNextIteration(*node) || IsQueue(*node) ||
+          IsEnqueue(*node)) {
+        VLOG(1) << "Found " << node->op()
+                << " node, inferring all the shapes again";
+        return infer_from_scratch();
+      }
+      seeds.push_back(node);
+      stale_nodes.insert(node);
+      const string* indexed_name = indexed_view->IndexedName(node);
+      if (indexed_name != nullptr && *indexed_name != node_name) {
+        stale_names.push_back(*indexed_name);
       }
+    } else {
+      stale_names.push_back(node_name);
     }
+    const NodeDef* indexed_node = indexed_view->GetNode(node_name);
+    if (indexed_node != nullptr) {
+      stale_nodes.insert(indexed_node);
+      indexed_nodes.insert(indexed_node);
+    }
+  }
 
-    if (aggressive_shape_inference && ctx->shape_incompatible)
-      incompatible_shape_nodes_.insert(node.name());
+  // Bring the graph view up to date. The nodes that were indexed under the
+  // name of an updated node but are no longer in the graph were deleted.
+  const absl::flat_hash_set<const NodeDef*> current_nodes(seeds.begin(),
+                                                          seeds.end());
+  for (const NodeDef* node : stale_nodes) {
+    const bool deleted =
+        indexed_nodes.contains(node) && !current_nodes.contains(node);
+    indexed_view->RemoveNode(node, deleted);
+  }
+  for (const NodeDef* node : seeds) {
+    indexed_view->AddNode(node);
+  }
+  for (const NodeDef* node : seeds) {
+    indexed_view->AddFanins(node);
   }
 
-  if (aggressive_shape_inference && !incompatible_shape_nodes_.empty())
-    LOG(WARNING) << incompatible_shape_nodes_.size()
-                 << " nodes have incompatible output shapes.";
+  SymbolicShapeRefiner* refiner = state->refiner.get();
+  refiner->RemoveNodes(stale_nodes);
+  if (refiner->TooManyRetiredContexts()) {
+    VLOG(1) << "Too many shapes were retired, inferring all the shapes again";
+    return infer_from_scratch();
+  }
+  for (const NodeDef* node : seeds) {
+    for (const auto& fanout : indexed_view->GetFanouts(
+             *node, /*include_controlled_nodes=*/false)) {
+      refiner->ClearInputValues(fanout.node);
+    }
+  }
 
-  // Help trace the unknown dimensions to their origins.
-  VerboseLogUnknownDimensionSources(item_.graph, input_properties_,
-                                    output_properties_);
+  std::vector<const NodeDef*> topo_order;
+  if (!ComputeFanoutTopologicalOrder(*indexed_view, seeds, &topo_order)) {
+    VLOG(1) << "Found a cycle, inferring all the shapes again";
+    return infer_from_scratch();
+  }
+  TopoQueue new_shapes(topo_order);
+  for (const NodeDef* node : seeds) {
+    new_shapes.push(node);
+  }
+  absl::flat_hash_set<const NodeDef*> refined_nodes;
+  Status status = PropagateShapes(refiner, &new_shapes, {}, /*num_loops=*/0,
+                                  &refined_nodes);
+  if (!status.ok()) {
+    VLOG(1) << "Incremental shape inference failed, inferring all the shapes "
+            << "again: " << status;
+    return infer_from_scratch();
+  }
+  VLOG(1) << "Inferred the shapes of " << refined_nodes.size() << " out of "
+          << item_.graph.node_size() << " nodes";
+
+  // Only merge the symbolic shapes of the refined nodes. The merges done
+  // before the update remain valid since graph rewrites preserve the shapes
+  // of the tensors that are still in use.
+  for (const NodeDef* node : refined_nodes) {
+    if (!MergeSymbolicShapes(state->fed_ports, *node, refiner,
+                             state->shape_manager.get())) {
+      VLOG(1) << "Found inconsistent shapes, inferring all the shapes again";
+      return infer_from_scratch();
+    }
+  }
+
+  // Refresh the properties of the updated and refined nodes.
+  refined_nodes.insert(seeds.begin(), seeds.end());
+  for (const NodeDef* node : refined_nodes) {
+    stale_names.push_back(node->name());
+  }
+  for (const string& node_name : stale_names) {
+    input_properties_.erase(node_name);
+    output_properties_.erase(node_name);
+    incompatible_shape_nodes_.erase(node_name);
+  }
+  for (const NodeDef* node : refined_nodes) {
+    FillProperties(*state, *node);
+  }
 
+  state_ = std::move(state);
   return Status::OK();
 }
 
@@ -16,11 +16,13 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_GRAPH_PROPERTIES_H_
 #define TENSORFLOW_CORE_GRAPPLER_COSTS_GRAPH_PROPERTIES_H_
 
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/framework/shape_inference.h"
 #include "tensorflow/core/grappler/clusters/cluster.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
@@ -69,6 +71,8 @@ ABSL_CONST_INIT const char kOutputTypes[] = "_output_dtype_vector";
 // Outputs TensorShapeProto vector.
 ABSL_CONST_INIT const char kOutputShapes[] = "_output_shape_vector";
 
+class MutableGraphView;
+class SymbolicShapeManager;
 class SymbolicShapeRefiner;
 class TopoQueue;
 
@@ -81,7 +85,8 @@ class TopoQueue;
 class GraphProperties {
  public:
   // The item must outlive the properties
-  explicit GraphProperties(const GrapplerItem& item) : item_(item) {}
+  explicit GraphProperties(const GrapplerItem& item);
+  ~GraphProperties();
 
   // Infer the shapes through abstract interpretation. Feed information can be
   // incorrect so it should be discarded to ensure correctness of the analysis.
@@ -114,6 +119,26 @@ class GraphProperties {
                            /*aggressive_shape_inference=*/false,
                            /*include_tensor_values=*/true);
   }
+  // If enabled before calling InferStatically(), the state of the shape
+  // inference is kept so that the properties can be refreshed with
+  // UpdateStatically() after the graph is modified. This keeps the inference
+  // contexts of all the nodes alive, so it's disabled by default.
+  void set_incremental_updates(bool enabled) {
+    incremental_updates_ = enabled;
+  }
+  // Refreshes the properties after `item_.graph` was modified. `graph_view`
+  // must be a view of `item_.graph` that is up to date, and `updated_nodes`
+  // the names of the nodes that were added, deleted or modified since the
+  // last inference, e.g. as recorded by MutableGraphView::set_updated_nodes().
+  // Only the updated nodes and the part of their transitive fanout whose input
+  // shapes change are inferred again, so the cost doesn't depend on the size
+  // of the graph. The inference options are the ones of the last call to
+  // InferStatically(). Falls back to inferring the shapes of the whole graph
+  // when the update can't be done incrementally, e.g. for graphs with loops or
+  // queues.
+  Status UpdateStatically(const MutableGraphView& graph_view,
+                          const absl::flat_hash_set<string>& updated_nodes);
+
   // Infer the shape by running the graph on the specified cluster and recording
   // the shapes of the processed tensors.
   Status InferDynamically(Cluster* cluster);
@@ -158,6 +183,16 @@ class GraphProperties {
   }
 
  private:
+  // State of the static shape inference, kept for incremental updates.
+  struct InferenceState;
+
+  // Runs the shape inference on the whole graph and fills in the properties
+  // of all the nodes.
+  Status InferStaticallyFromScratch(std::unique_ptr<InferenceState> state);
+
+  // Fills in the input and output properties of `node`.
+  void FillProperties(const InferenceState& state, const NodeDef& node);
+
   // Relaxes shapes <shapes_and_types>, determined from an EnqueueV2 node, into
   // <*queue_shapes_and_types>.
   static Status RelaxEnqueueShapesAndMergeTypes(
@@ -192,12 +227,16 @@ class GraphProperties {
                           resource_handles,
                       const NodeDef* n, bool* new_shapes) const;
   // Propagate the shapes for the nodes enqueued in new_shapes and their
-  // transitive fanout until a fixed point is reached.
+  // transitive fanout until a fixed point is reached. If `refined_nodes` is
+  // not null, the nodes whose shapes were updated are added to it, and the
+  // propagation stops at nodes whose output shapes are equivalent to the ones
+  // previously inferred.
   Status PropagateShapes(
       SymbolicShapeRefiner* shape_refiner, TopoQueue* new_shapes,
       const absl::flat_hash_map<const NodeDef*, const NodeDef*>&
           resource_handles,
-      int num_loops) const;
+      int num_loops,
+      absl::flat_hash_set<const NodeDef*>* refined_nodes = nullptr) const;
 
   // Data members
   const GrapplerItem& item_;
@@ -210,6 +249,9 @@ class GraphProperties {
   // Nodes with output shape incompatible between shape inference and
   // annotation.
   std::unordered_set<string> incompatible_shape_nodes_;
+
+  bool incremental_updates_ = false;
+  std::unique_ptr<InferenceState> state_;
 };
 
 // Helper function for GraphProperties.
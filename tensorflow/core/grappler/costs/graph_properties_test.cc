@@ -29,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
 #include "tensorflow/core/grappler/inputs/utils.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/strings/strcat.h"
@@ -2426,6 +2427,242 @@ TEST(HelperFunctions, IsShapeFullyDefinedIntegerVectorOrScalar) {
   EXPECT_FALSE(IsShapeFullyDefinedIntegerVectorOrScalar(
       &ic, fully_defined_vector, vector_with_unknown_from_const, DT_INT32));
 }
+
+void ExpectSameProperties(const GraphDef& graph,
+                          const GraphProperties& expected,
+                          const GraphProperties& actual) {
+  for (const NodeDef& node : graph.node()) {
+    ASSERT_EQ(expected.HasInputProperties(node.name()),
+              actual.HasInputProperties(node.name()))
+        << node.name();
+    ASSERT_EQ(expected.HasOutputProperties(node.name()),
+              actual.HasOutputProperties(node.name()))
+        << node.name();
+    const auto& expected_inputs = expected.GetInputProperties(node.name());
+    const auto& actual_inputs = actual.GetInputProperties(node.name());
+    ASSERT_EQ(expected_inputs.size(), actual_inputs.size()) << node.name();
+    for (int i = 0; i < expected_inputs.size(); ++i) {
+      EXPECT_EQ(expected_inputs[i].DebugString(),
+                actual_inputs[i].DebugString())
+          << node.name() << ":" << i;
+    }
+    const auto& expected_outputs = expected.GetOutputProperties(node.name());
+    const auto& actual_outputs = actual.GetOutputProperties(node.name());
+    ASSERT_EQ(expected_outputs.size(), actual_outputs.size()) << node.name();
+    for (int i = 0; i < expected_outputs.size(); ++i) {
+      EXPECT_EQ(expected_outputs[i].DebugString(),
+                actual_outputs[i].DebugString())
+          << node.name() << ":" << i;
+    }
+  }
+}
+
+TEST_F(GraphPropertiesTest, UpdateStatically) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({4, 8}));
+  Output y = ops::Placeholder(s.WithOpName("y"), DT_FLOAT,
+                              ops::Placeholder::Shape({2, 8}));
+  Output z = ops::Placeholder(s.WithOpName("z"), DT_FLOAT,
+                              ops::Placeholder::Shape({4, 8}));
+  Output w = ops::Const(s.WithOpName("w"), 1.0f, {8, 16});
+  Output relu1 = ops::Relu(s.WithOpName("relu1"), x);
+  Output relu2 = ops::Relu(s.WithOpName("relu2"), relu1);
+  Output matmul = ops::MatMul(s.WithOpName("matmul"), relu2, w);
+  Output shape = ops::Shape(s.WithOpName("shape"), matmul);
+  Output other = ops::Relu(s.WithOpName("other"), z);
+
+  GrapplerItem item;
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  GraphProperties properties(item);
+  properties.set_incremental_updates(true);
+  TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+
+  MutableGraphView graph_view(&item.graph);
+  absl::flat_hash_set<string> updated_nodes;
+  graph_view.set_updated_nodes(&updated_nodes);
+
+  // Change the shape of the inputs of the chain.
+  TF_ASSERT_OK(graph_view.UpdateRegularFaninByPort("relu1", 0, {"y", 0}));
+  TF_ASSERT_OK(properties.UpdateStatically(graph_view, updated_nodes));
+  EXPECT_EQ("float: [2,16]",
+            PropToString(properties.GetOutputProperties("matmul")[0]));
+  {
+    GraphProperties expected(item);
+    TF_ASSERT_OK(expected.InferStatically(/*assume_valid_feeds=*/false));
+    ExpectSameProperties(item.graph, expected, properties);
+  }
+
+  // Replace the input with a tensor of the same shape, and delete the node
+  // that isn't used anymore.
+  updated_nodes.clear();
+  TF_ASSERT_OK(graph_view.UpdateRegularFaninByPort("relu1", 0, {"z", 0}));
+  TF_ASSERT_OK(graph_view.DeleteNodes({"y"}));
+  TF_ASSERT_OK(properties.UpdateStatically(graph_view, updated_nodes));
+  EXPECT_FALSE(properties.HasOutputProperties("y"));
+  EXPECT_EQ("float: [4,16]",
+            PropToString(properties.GetOutputProperties("matmul")[0]));
+  {
+    GraphProperties expected(item);
+    TF_ASSERT_OK(expected.InferStatically(/*assume_valid_feeds=*/false));
+    ExpectSameProperties(item.graph, expected, properties);
+  }
+
+  // Add and rename nodes.
+  updated_nodes.clear();
+  NodeDef neg;
+  neg.set_name("neg");
+  neg.set_op("Neg");
+  neg.add_input("matmul");
+  (*neg.mutable_attr())["T"].set_type(DT_FLOAT);
+  graph_view.AddNode(std::move(neg));
+  TF_ASSERT_OK(graph_view.UpdateNodeName("other", "renamed",
+                                         /*update_fanouts=*/true));
+  TF_ASSERT_OK(properties.UpdateStatically(graph_view, updated_nodes));
+  EXPECT_FALSE(properties.HasOutputProperties("other"));
+  EXPECT_EQ("float: [4,8]",
+            PropToString(properties.GetOutputProperties("renamed")[0]));
+  EXPECT_EQ("float: [4,16]",
+            PropToString(properties.GetOutputProperties("neg")[0]));
+  {
+    GraphProperties expected(item);
+    TF_ASSERT_OK(expected.InferStatically(/*assume_valid_feeds=*/false));
+    ExpectSameProperties(item.graph, expected, properties);
+  }
+
+  // Replace a node with a different node of the same name.
+  updated_nodes.clear();
+  TF_ASSERT_OK(graph_view.DeleteNodes({"neg"}));
+  NodeDef new_neg;
+  new_neg.set_name("neg");
+  new_neg.set_op("Shape");
+  new_neg.add_input("matmul");
+  (*new_neg.mutable_attr())["T"].set_type(DT_FLOAT);
+  (*new_neg.mutable_attr())["out_type"].set_type(DT_INT32);
+  graph_view.AddNode(std::move(new_neg));
+  TF_ASSERT_OK(properties.UpdateStatically(graph_view, updated_nodes));
+  EXPECT_EQ("int32: [2]",
+            PropToString(properties.GetOutputProperties("neg")[0]));
+  {
+    GraphProperties expected(item);
+    TF_ASSERT_OK(expected.InferStatically(/*assume_valid_feeds=*/false));
+    ExpectSameProperties(item.graph, expected, properties);
+  }
+}
+
+TEST_F(GraphPropertiesTest, UpdateStaticallyRequiresIncrementalUpdates) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false,
+                                          cluster_->GetDeviceNames());
+  GrapplerItem item;
+  CHECK(fake_input.NextItem(&item));
+
+  GraphProperties properties(item);
+  TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+  MutableGraphView graph_view(&item.graph);
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      properties.UpdateStatically(graph_view, {})));
+
+  // The view must be of the graph of the item.
+  properties.set_incremental_updates(true);
+  TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+  GraphDef other_graph = item.graph;
+  MutableGraphView other_graph_view(&other_graph);
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      properties.UpdateStatically(other_graph_view, {})));
+}
+
+GraphDef CreateReluChains(int num_nodes) {
+  GraphDef graph;
+  for (const char* name : {"x0", "x1"}) {
+    NodeDef* node = graph.add_node();
+    node->set_name(name);
+    node->set_op("Placeholder");
+    (*node->mutable_attr())["dtype"].set_type(DT_FLOAT);
+    TensorShapeProto* shape =
+        (*node->mutable_attr())["shape"].mutable_shape();
+    shape->add_dim()->set_size(32);
+    shape->add_dim()->set_size(32);
+  }
+  const int kChainLength = 100;
+  for (int i = 0; i < num_nodes; ++i) {
+    NodeDef* node = graph.add_node();
+    node->set_name(strings::StrCat("relu_", i));
+    node->set_op("Relu");
+    node->add_input(i % kChainLength == 0 ? "x0"
+                                          : strings::StrCat("relu_", i - 1));
+    (*node->mutable_attr())["T"].set_type(DT_FLOAT);
+  }
+  return graph;
+}
+
+TEST_F(GraphPropertiesTest, UpdateStaticallyManyTimes) {
+  GrapplerItem item;
+  item.graph = CreateReluChains(/*num_nodes=*/300);
+  // Give the two inputs different shapes.
+  TensorShapeProto* shape =
+      (*item.graph.mutable_node(1)->mutable_attr())["shape"].mutable_shape();
+  shape->mutable_dim(1)->set_size(16);
+  MutableGraphView graph_view(&item.graph);
+  absl::flat_hash_set<string> updated_nodes;
+  graph_view.set_updated_nodes(&updated_nodes);
+  GraphProperties properties(item);
+  properties.set_incremental_updates(true);
+  TF_ASSERT_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+
+  // Every update retires the contexts of a chain, so the inference is redone
+  // from scratch from time to time.
+  for (int i = 0; i < 20; ++i) {
+    const string relu = strings::StrCat("relu_", (i % 3) * 100);
+    TF_ASSERT_OK(graph_view.UpdateRegularFaninByPort(
+        relu, 0, {i % 2 == 0 ? "x1" : "x0", 0}));
+    TF_ASSERT_OK(properties.UpdateStatically(graph_view, updated_nodes));
+    updated_nodes.clear();
+    EXPECT_EQ(i % 2 == 0 ? "float: [32,16]" : "float: [32,32]",
+              PropToString(properties.GetOutputProperties(
+                  strings::StrCat("relu_", (i % 3) * 100 + 99))[0]));
+  }
+  GraphProperties expected(item);
+  TF_ASSERT_OK(expected.InferStatically(/*assume_valid_feeds=*/false));
+  ExpectSameProperties(item.graph, expected, properties);
+}
+
+static void BM_GraphPropertiesUpdate(int iters, int num_nodes,
+                                     int incremental) {
+  testing::StopTiming();
+  GrapplerItem item;
+  item.graph = CreateReluChains(num_nodes);
+  MutableGraphView graph_view(&item.graph);
+  absl::flat_hash_set<string> updated_nodes;
+  graph_view.set_updated_nodes(&updated_nodes);
+  GraphProperties properties(item);
+  properties.set_incremental_updates(true);
+  TF_CHECK_OK(properties.InferStatically(/*assume_valid_feeds=*/false));
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    // Make the first node read from the other placeholder.
+    TF_CHECK_OK(graph_view.UpdateRegularFaninByPort(
+        "relu_0", 0, {i % 2 == 0 ? "x1" : "x0", 0}));
+    if (incremental) {
+      TF_CHECK_OK(properties.UpdateStatically(graph_view, updated_nodes));
+    } else {
+      GraphProperties full_properties(item);
+      TF_CHECK_OK(
+          full_properties.InferStatically(/*assume_valid_feeds=*/false));
+    }
+    updated_nodes.clear();
+  }
+  testing::StopTiming();
+}
+
+BENCHMARK(BM_GraphPropertiesUpdate)
+    ->ArgPair(1000, 0)
+    ->ArgPair(1000, 1)
+    ->ArgPair(10000, 0)
+    ->ArgPair(10000, 1)
+    ->ArgPair(100000, 0)
+    ->ArgPair(100000, 1);
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -0,0 +1,147 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/measured_op_costs.h"
+
+#include <algorithm>
+#include <map>
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace grappler {
+
+constexpr char MeasuredOpCosts::kEnvVar[];
+
+MeasuredOpCosts::MeasuredOpCosts(const OpPerformanceList& performance_list) {
+  for (const OpPerformance& performance : performance_list.op_performance()) {
+    if (performance.compute_cost() <= 0) continue;
+    const string key = MeasurementKey(performance.op());
+    if (key.empty()) continue;
+    measurements_[key].push_back(
+        {NumInputElements(performance.op()),
+         static_cast<double>(performance.compute_cost())});
+    ++num_measurements_;
+  }
+  for (auto& entry : measurements_) {
+    std::sort(entry.second.begin(), entry.second.end(),
+              [](const Measurement& a, const Measurement& b) {
+                return a.num_elements < b.num_elements;
+              });
+  }
+}
+
+Status MeasuredOpCosts::Load(Env* env, const string& path,
+                             std::unique_ptr<MeasuredOpCosts>* measured_costs) {
+  OpPerformanceList performance_list;
+  TF_RETURN_IF_ERROR(ReadBinaryProto(env, path, &performance_list));
+  measured_costs->reset(new MeasuredOpCosts(performance_list));
+  VLOG(1) << "Loaded " << (*measured_costs)->size()
+          << " op cost measurements from " << path;
+  return Status::OK();
+}
+
+std::shared_ptr<const MeasuredOpCosts> MeasuredOpCosts::FromEnvironment() {
+  static const auto* measured_costs = []() {
+    auto* result = new std::shared_ptr<const MeasuredOpCosts>();
+    const char* path = getenv(kEnvVar);
+    if (path == nullptr || *path == '\0') return result;
+    std::unique_ptr<MeasuredOpCosts> loaded;
+    const Status status = Load(Env::Default(), path, &loaded);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to load op cost measurements from " << path
+                   << ": " << status;
+      return result;
+    }
+    *result = std::move(loaded);
+    return result;
+  }();
+  return *measured_costs;
+}
+
+bool MeasuredOpCosts::PredictExecutionTime(
+    const OpInfo& op_info, Costs::Duration* execution_time) const {
+  const string key = MeasurementKey(op_info);
+  if (key.empty()) return false;
+  auto it = measurements_.find(key);
+  if (it == measurements_.end()) return false;
+  const std::vector<Measurement>& measurements = it->second;
+
+  const double num_elements = NumInputElements(op_info);
+  auto upper = std::lower_bound(
+      measurements.begin(), measurements.end(), num_elements,
+      [](const Measurement& m, double value) {
+        return m.num_elements < value;
+      });
+
+  double time_ns;
+  if (upper == measurements.begin()) {
+    // Smaller than every measurement: small ops are dominated by fixed
+    // overheads, so don't scale the time down.
+    time_ns = upper->time_ns;
+  } else if (upper == measurements.end()) {
+    // Larger than every measurement: assume the throughput of the largest
+    // measured op.
+    const Measurement& largest = measurements.back();
+    time_ns = largest.num_elements > 0
+                  ? largest.time_ns * num_elements / largest.num_elements
+                  : largest.time_ns;
+  } else {
+    const Measurement& lower = *(upper - 1);
+    const double span = upper->num_elements - lower.num_elements;
+    const double weight =
+        span > 0 ? (num_elements - lower.num_elements) / span : 1.0;
+    time_ns = lower.time_ns + weight * (upper->time_ns - lower.time_ns);
+  }
+
+  *execution_time = Costs::Duration(time_ns);
+  return true;
+}
+
+string MeasuredOpCosts::MeasurementKey(const OpInfo& op_info) {
+  string key = strings::StrCat(op_info.op(), ";", op_info.device().type());
+  for (const auto& input : op_info.inputs()) {
+    const PartialTensorShape shape(input.shape());
+    if (!shape.IsFullyDefined()) return "";
+    strings::StrAppend(&key, ";", DataTypeString(input.dtype()), "[",
+                       shape.dims(), "]");
+  }
+  // Internal attributes (e.g. colocation constraints) don't affect the cost.
+  std::map<string, string> attrs;
+  for (const auto& attr : op_info.attr()) {
+    if (attr.first.empty() || attr.first[0] == '_') continue;
+    attrs[attr.first] = SummarizeAttrValue(attr.second);
+  }
+  for (const auto& attr : attrs) {
+    strings::StrAppend(&key, ";", attr.first, "=", attr.second);
+  }
+  return key;
+}
+
+double MeasuredOpCosts::NumInputElements(const OpInfo& op_info) {
+  double num_elements = 0;
+  for (const auto& input : op_info.inputs()) {
+    num_elements += PartialTensorShape(input.shape()).num_elements();
+  }
+  return num_elements;
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,83 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_MEASURED_OP_COSTS_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_MEASURED_OP_COSTS_H_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// A database of measured op execution times, e.g. produced by the
+// op_cost_profiler tool or extracted from a step trace with
+// CostGraphToOpPerformanceData. Measurements are grouped by op, device type,
+// attributes and input types and ranks. Within a group, the execution time of
+// an op is interpolated from the measurements with the closest number of input
+// elements.
+class MeasuredOpCosts {
+ public:
+  // Name of the environment variable that points to an OpPerformanceList
+  // loaded by default into every OpLevelCostEstimator.
+  static constexpr char kEnvVar[] = "TF_GRAPPLER_MEASURED_OP_COSTS";
+
+  explicit MeasuredOpCosts(const OpPerformanceList& performance_list);
+
+  // Loads a binary OpPerformanceList from `path`.
+  static Status Load(Env* env, const string& path,
+                     std::unique_ptr<MeasuredOpCosts>* measured_costs);
+
+  // Returns the database pointed to by kEnvVar, or nullptr if the variable is
+  // not set or the file can't be loaded. The file is loaded once per process.
+  static std::shared_ptr<const MeasuredOpCosts> FromEnvironment();
+
+  // Predicts the execution time of the op. Returns false if there are no
+  // measurements for the same kind of op, or if the input shapes of the op
+  // are unknown.
+  bool PredictExecutionTime(const OpInfo& op_info,
+                            Costs::Duration* execution_time) const;
+
+  // Number of measurements in the database.
+  int size() const { return num_measurements_; }
+
+ private:
+  struct Measurement {
+    // Total number of input elements.
+    double num_elements;
+    // Execution time in nanoseconds.
+    double time_ns;
+  };
+
+  // Returns the key that groups comparable measurements, or an empty string if
+  // the input shapes of the op are not fully known.
+  static string MeasurementKey(const OpInfo& op_info);
+  static double NumInputElements(const OpInfo& op_info);
+
+  // Measurements sorted by number of input elements.
+  std::unordered_map<string, std::vector<Measurement>> measurements_;
+  int num_measurements_ = 0;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_MEASURED_OP_COSTS_H_
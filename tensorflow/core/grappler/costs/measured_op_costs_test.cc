@@ -0,0 +1,163 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/measured_op_costs.h"
+
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+OpInfo DescribeMatMul(int m, int k, int n, DataType dtype = DT_FLOAT) {
+  OpInfo op_info;
+  op_info.set_op("MatMul");
+  op_info.mutable_device()->set_type("CPU");
+  for (const auto& dims : {std::make_pair(m, k), std::make_pair(k, n)}) {
+    auto* input = op_info.add_inputs();
+    input->set_dtype(dtype);
+    input->mutable_shape()->add_dim()->set_size(dims.first);
+    input->mutable_shape()->add_dim()->set_size(dims.second);
+  }
+  (*op_info.mutable_attr())["transpose_a"].set_b(false);
+  (*op_info.mutable_attr())["transpose_b"].set_b(false);
+  return op_info;
+}
+
+void AddMeasurement(const OpInfo& op_info, int64 time_ns,
+                    OpPerformanceList* performance_list) {
+  OpPerformance* performance = performance_list->add_op_performance();
+  *performance->mutable_op() = op_info;
+  performance->set_compute_cost(time_ns);
+}
+
+class MeasuredOpCostsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // 2 * 10 * 10 = 200 input elements.
+    AddMeasurement(DescribeMatMul(10, 10, 10), 1000, &performance_list_);
+    // 2 * 20 * 20 = 800 input elements.
+    AddMeasurement(DescribeMatMul(20, 20, 20), 4000, &performance_list_);
+    // Entries without a compute cost are ignored.
+    AddMeasurement(DescribeMatMul(30, 30, 30), 0, &performance_list_);
+  }
+
+  OpPerformanceList performance_list_;
+};
+
+TEST_F(MeasuredOpCostsTest, Size) {
+  MeasuredOpCosts measured_costs(performance_list_);
+  EXPECT_EQ(2, measured_costs.size());
+}
+
+TEST_F(MeasuredOpCostsTest, ExactMatch) {
+  MeasuredOpCosts measured_costs(performance_list_);
+  Costs::Duration time;
+  ASSERT_TRUE(
+      measured_costs.PredictExecutionTime(DescribeMatMul(10, 10, 10), &time));
+  EXPECT_EQ(1000, time.count());
+  ASSERT_TRUE(
+      measured_costs.PredictExecutionTime(DescribeMatMul(20, 20, 20), &time));
+  EXPECT_EQ(4000, time.count());
+}
+
+TEST_F(MeasuredOpCostsTest, Interpolation) {
+  MeasuredOpCosts measured_costs(performance_list_);
+  Costs::Duration time;
+  // 2 * 10 * 25 = 500 input elements, half way between the measurements.
+  ASSERT_TRUE(
+      measured_costs.PredictExecutionTime(DescribeMatMul(10, 25, 10), &time));
+  EXPECT_EQ(2500, time.count());
+}
+
+TEST_F(MeasuredOpCostsTest, Extrapolation) {
+  MeasuredOpCosts measured_costs(performance_list_);
+  Costs::Duration time;
+  // Smaller ops take at least as long as the smallest measurement.
+  ASSERT_TRUE(
+      measured_costs.PredictExecutionTime(DescribeMatMul(1, 1, 1), &time));
+  EXPECT_EQ(1000, time.count());
+  // Larger ops scale linearly from the largest measurement.
+  ASSERT_TRUE(
+      measured_costs.PredictExecutionTime(DescribeMatMul(40, 40, 40), &time));
+  EXPECT_EQ(16000, time.count());
+}
+
+TEST_F(MeasuredOpCostsTest, Mismatch) {
+  MeasuredOpCosts measured_costs(performance_list_);
+  Costs::Duration time;
+  EXPECT_FALSE(measured_costs.PredictExecutionTime(
+      DescribeMatMul(10, 10, 10, DT_DOUBLE), &time));
+
+  OpInfo transposed = DescribeMatMul(10, 10, 10);
+  (*transposed.mutable_attr())["transpose_a"].set_b(true);
+  EXPECT_FALSE(measured_costs.PredictExecutionTime(transposed, &time));
+
+  OpInfo on_gpu = DescribeMatMul(10, 10, 10);
+  on_gpu.mutable_device()->set_type("GPU");
+  EXPECT_FALSE(measured_costs.PredictExecutionTime(on_gpu, &time));
+
+  // Internal attributes are ignored.
+  OpInfo colocated = DescribeMatMul(10, 10, 10);
+  (*colocated.mutable_attr())["_class"].mutable_list()->add_s("loc:@a");
+  EXPECT_TRUE(measured_costs.PredictExecutionTime(colocated, &time));
+}
+
+TEST_F(MeasuredOpCostsTest, UnknownShape) {
+  MeasuredOpCosts measured_costs(performance_list_);
+  OpInfo op_info = DescribeMatMul(10, 10, 10);
+  op_info.mutable_inputs(0)->mutable_shape()->mutable_dim(0)->set_size(-1);
+  Costs::Duration time;
+  EXPECT_FALSE(measured_costs.PredictExecutionTime(op_info, &time));
+}
+
+TEST_F(MeasuredOpCostsTest, Load) {
+  const string path = io::JoinPath(testing::TmpDir(), "op_costs.pb");
+  TF_ASSERT_OK(WriteBinaryProto(Env::Default(), path, performance_list_));
+  std::unique_ptr<MeasuredOpCosts> measured_costs;
+  TF_ASSERT_OK(MeasuredOpCosts::Load(Env::Default(), path, &measured_costs));
+  EXPECT_EQ(2, measured_costs->size());
+
+  EXPECT_FALSE(MeasuredOpCosts::Load(Env::Default(), path + ".missing",
+                                     &measured_costs)
+                   .ok());
+}
+
+TEST_F(MeasuredOpCostsTest, OpLevelCostEstimator) {
+  OpLevelCostEstimator estimator;
+  estimator.set_measured_costs(
+      std::make_shared<MeasuredOpCosts>(performance_list_));
+
+  OpContext op_context;
+  op_context.op_info = DescribeMatMul(10, 25, 10);
+  Costs costs = estimator.PredictCosts(op_context);
+  EXPECT_EQ(2500, costs.execution_time.count());
+  EXPECT_FALSE(costs.inaccurate);
+
+  // Ops without measurements fall back to the analytical model.
+  op_context.op_info = DescribeMatMul(10, 10, 10, DT_DOUBLE);
+  OpLevelCostEstimator analytical_estimator;
+  analytical_estimator.set_measured_costs(nullptr);
+  EXPECT_EQ(analytical_estimator.PredictCosts(op_context).execution_time,
+            estimator.PredictCosts(op_context).execution_time);
+}
+
+}  // namespace
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,240 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_profiler.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "tensorflow/core/common_runtime/graph_constructor.h"
+#include "tensorflow/core/common_runtime/graph_runner.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/grappler/clusters/utils.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+constexpr char kProfiledNodeName[] = "profiled_op";
+
+// Fills `tensor` with an input of the given type and shape. Floating point
+// inputs are random; integer and boolean inputs are zeros, which are valid
+// indices for most gather-like ops.
+Status MakeInput(const OpInfo::TensorProperties& input, Tensor* tensor) {
+  if (input.has_value()) {
+    if (!tensor->FromProto(input.value())) {
+      return errors::InvalidArgument("Invalid input value: ",
+                                     input.value().ShortDebugString());
+    }
+    return Status::OK();
+  }
+
+  const PartialTensorShape shape(input.shape());
+  TensorShape fully_defined_shape;
+  if (!shape.AsTensorShape(&fully_defined_shape)) {
+    return errors::InvalidArgument("Input shape is not fully defined: ",
+                                   shape.DebugString());
+  }
+  *tensor = Tensor(input.dtype(), fully_defined_shape);
+
+#define RANDOM_CASE(T)                    \
+  case DataTypeToEnum<T>::value:          \
+    tensor->flat<T>().setRandom();        \
+    return Status::OK();
+#define ZERO_CASE(T)                      \
+  case DataTypeToEnum<T>::value:          \
+    tensor->flat<T>().setZero();          \
+    return Status::OK();
+
+  switch (input.dtype()) {
+    TF_CALL_half(RANDOM_CASE);
+    TF_CALL_float(RANDOM_CASE);
+    TF_CALL_double(RANDOM_CASE);
+    TF_CALL_INTEGRAL_TYPES(ZERO_CASE);
+    TF_CALL_bool(ZERO_CASE);
+    default:
+      return errors::Unimplemented("Can't generate inputs of type ",
+                                   DataTypeString(input.dtype()));
+  }
+
+#undef RANDOM_CASE
+#undef ZERO_CASE
+}
+
+// Returns true if the node can be run in isolation, with constant inputs.
+bool IsProfilable(const NodeDef& node) {
+  if (node.input_size() == 0 || IsPersistent(node) || IsControlFlow(node) ||
+      IsSend(node) || IsRecv(node)) {
+    return false;
+  }
+  const OpDef* op_def = nullptr;
+  if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok() ||
+      op_def->is_stateful() || op_def->output_arg_size() == 0) {
+    return false;
+  }
+  // Function attributes refer to a function library we don't have.
+  for (const auto& attr : node.attr()) {
+    if (attr.second.has_func() || attr.second.list().func_size() > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+Status OpCostProfiler::ProfileNode(const NodeDef& node, const OpInfo& op_info,
+                                   OpPerformance* performance) const {
+  GraphDef graph;
+  for (int i = 0; i < op_info.inputs_size(); ++i) {
+    Tensor input;
+    TF_RETURN_IF_ERROR(MakeInput(op_info.inputs(i), &input));
+    NodeDef* input_node = graph.add_node();
+    input_node->set_name(strings::StrCat("input_", i));
+    input_node->set_op("Const");
+    AddNodeAttr("dtype", input.dtype(), input_node);
+    TensorProto value;
+    input.AsProtoTensorContent(&value);
+    AddNodeAttr("value", value, input_node);
+  }
+  const GraphDef inputs_only = graph;
+
+  NodeDef* profiled_node = graph.add_node();
+  profiled_node->set_name(kProfiledNodeName);
+  profiled_node->set_op(node.op());
+  *profiled_node->mutable_attr() = node.attr();
+  for (int i = 0; i < op_info.inputs_size(); ++i) {
+    profiled_node->add_input(strings::StrCat("input_", i));
+  }
+
+  // The benchmark harness aborts the process on kernel errors, so make sure
+  // the op runs successfully first.
+  {
+    Graph validation_graph(OpRegistry::Global());
+    TF_RETURN_IF_ERROR(ConvertGraphDefToGraph(GraphConstructorOptions(), graph,
+                                              &validation_graph));
+    GraphRunner runner(Env::Default());
+    std::vector<Tensor> outputs;
+    TF_RETURN_IF_ERROR(runner.Run(&validation_graph, nullptr, {},
+                                  {strings::StrCat(kProfiledNodeName, ":0")},
+                                  &outputs));
+  }
+
+  // Subtract the cost of producing the constant inputs and of the executor
+  // itself.
+  double total_time_ns;
+  double inputs_time_ns;
+  TF_RETURN_IF_ERROR(TimeGraph(graph, &total_time_ns));
+  TF_RETURN_IF_ERROR(TimeGraph(inputs_only, &inputs_time_ns));
+  const int64 op_time_ns =
+      std::max<int64>(1, static_cast<int64>(total_time_ns - inputs_time_ns));
+
+  performance->Clear();
+  *performance->mutable_op() = op_info;
+  *performance->mutable_op()->mutable_device() = GetLocalCPUInfo();
+  performance->set_node(node.name());
+  performance->set_compute_cost(op_time_ns);
+  VLOG(1) << "Profiled " << node.name() << " (" << node.op()
+          << "): " << op_time_ns << " ns";
+  return Status::OK();
+}
+
+Status OpCostProfiler::ProfileGraph(const GrapplerItem& item,
+                                    OpPerformanceList* performance_list) const {
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(
+      /*assume_valid_feeds=*/false,
+      /*aggressive_shape_inference=*/false,
+      /*include_input_tensor_values=*/true,
+      /*include_output_tensor_values=*/false));
+
+  std::unordered_map<string, const NodeDef*> name_to_node;
+  for (const NodeDef& node : item.graph.node()) {
+    name_to_node[node.name()] = &node;
+  }
+
+  std::unordered_set<string> profiled_ops;
+  for (const NodeDef& node : item.graph.node()) {
+    if (!IsProfilable(node)) continue;
+    const OpInfo op_info = BuildOpInfoWithoutDevice(
+        node, name_to_node, properties.GetInputProperties(node.name()));
+
+    string key;
+    if (!SerializeToStringDeterministic(op_info, &key) ||
+        !profiled_ops.insert(key).second) {
+      continue;
+    }
+
+    OpPerformance performance;
+    const Status status = ProfileNode(node, op_info, &performance);
+    if (!status.ok()) {
+      VLOG(1) << "Skipping " << node.name() << ": " << status;
+      continue;
+    }
+    *performance_list->add_op_performance() = std::move(performance);
+  }
+  return Status::OK();
+}
+
+Status OpCostProfiler::TimeGraph(const GraphDef& graph_def,
+                                 double* time_ns) const {
+  Graph* graph = new Graph(OpRegistry::Global());
+  Status status =
+      ConvertGraphDefToGraph(GraphConstructorOptions(), graph_def, graph);
+  if (!status.ok()) {
+    delete graph;
+    return status;
+  }
+  test::Benchmark benchmark("cpu", graph);
+
+  // Every call to Run() starts with a few warmup runs. Cancel them out by
+  // subtracting the time of a call with a single timed run.
+  Env* env = Env::Default();
+  const auto time_runs = [&](int iters) {
+    const uint64 start_us = env->NowMicros();
+    benchmark.Run(iters);
+    return static_cast<double>(env->NowMicros() - start_us);
+  };
+  const double base_us = time_runs(1);
+  int iters = options_.min_iters;
+  while (true) {
+    const double elapsed_us = time_runs(iters + 1) - base_us;
+    if (elapsed_us >= options_.min_time_us || iters >= options_.max_iters) {
+      *time_ns = std::max(0.0, elapsed_us) * 1000.0 / iters;
+      return Status::OK();
+    }
+    iters = std::min(2 * iters, options_.max_iters);
+  }
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
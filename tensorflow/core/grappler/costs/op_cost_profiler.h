@@ -0,0 +1,66 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILER_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILER_H_
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Microbenchmarks kernels on the local CPU and records their execution times
+// as OpPerformance entries, which MeasuredOpCosts uses to refine the
+// predictions of OpLevelCostEstimator.
+class OpCostProfiler {
+ public:
+  struct Options {
+    // Minimum wall time spent running each op.
+    int64 min_time_us = 100 * 1000;
+    // Bounds on the number of timed runs of each op.
+    int min_iters = 10;
+    int max_iters = 100 * 1000;
+  };
+
+  explicit OpCostProfiler(const Options& options) : options_(options) {}
+
+  // Measures the execution time of `node` with inputs of the types and shapes
+  // described by `op_info`. Inputs with a known value (e.g. shape arguments)
+  // use that value; other inputs are filled with random floating point values
+  // or zeros. Returns an error if the op can't be run in isolation.
+  Status ProfileNode(const NodeDef& node, const OpInfo& op_info,
+                     OpPerformance* performance) const;
+
+  // Measures every distinct op configuration (op, attributes, input types and
+  // shapes) of the graph. Ops that can't be profiled, such as stateful ops or
+  // ops with unknown input shapes, are skipped.
+  Status ProfileGraph(const GrapplerItem& item,
+                      OpPerformanceList* performance_list) const;
+
+ private:
+  // Measures the average time of a single run of `graph` in nanoseconds.
+  Status TimeGraph(const GraphDef& graph, double* time_ns) const;
+
+  const Options options_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILER_H_
@@ -0,0 +1,101 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks every distinct op of a graph on the local CPU and writes the
+// measurements as a binary OpPerformanceList. Point the
+// TF_GRAPPLER_MEASURED_OP_COSTS environment variable to the output to make
+// Grappler's OpLevelCostEstimator use the measurements. Example:
+//
+//   op_cost_profiler_main --graph=/tmp/model.pb --output=/tmp/op_costs.pb
+
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/costs/op_cost_profiler.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+Status ReadGraph(const string& path, GraphDef* graph) {
+  if (absl::EndsWith(path, ".pbtxt")) {
+    return ReadTextProto(Env::Default(), path, graph);
+  }
+  return ReadBinaryProto(Env::Default(), path, graph);
+}
+
+int Run(int argc, char** argv) {
+  string graph_path;
+  string output_path;
+  int64 min_time_ms = 100;
+  int max_iters = 100 * 1000;
+  std::vector<Flag> flag_list = {
+      Flag("graph", &graph_path,
+           "GraphDef to profile (text format if the name ends in .pbtxt)"),
+      Flag("output", &output_path, "where to write the OpPerformanceList"),
+      Flag("min_time_ms", &min_time_ms, "minimum time spent running each op"),
+      Flag("max_iters", &max_iters, "maximum number of runs of each op"),
+  };
+  const string usage = Flags::Usage(argv[0], flag_list);
+  if (!Flags::Parse(&argc, argv, flag_list) || graph_path.empty() ||
+      output_path.empty()) {
+    LOG(ERROR) << usage;
+    return -1;
+  }
+  port::InitMain(argv[0], &argc, &argv);
+
+  GrapplerItem item;
+  item.id = graph_path;
+  Status status = ReadGraph(graph_path, &item.graph);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to read " << graph_path << ": " << status;
+    return -1;
+  }
+
+  OpCostProfiler::Options options;
+  options.min_time_us = min_time_ms * 1000;
+  options.max_iters = max_iters;
+  OpCostProfiler profiler(options);
+  OpPerformanceList performance_list;
+  status = profiler.ProfileGraph(item, &performance_list);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to profile " << graph_path << ": " << status;
+    return -1;
+  }
+
+  status = WriteBinaryProto(Env::Default(), output_path, performance_list);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to write " << output_path << ": " << status;
+    return -1;
+  }
+  LOG(INFO) << "Wrote " << performance_list.op_performance_size()
+            << " op measurements to " << output_path;
+  return 0;
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
+
+int main(int argc, char** argv) {
+  return tensorflow::grappler::Run(argc, argv);
+}
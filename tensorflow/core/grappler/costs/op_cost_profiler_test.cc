@@ -0,0 +1,107 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_profiler.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/grappler/costs/measured_op_costs.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+OpCostProfiler::Options FastOptions() {
+  OpCostProfiler::Options options;
+  options.min_time_us = 1000;
+  options.min_iters = 1;
+  options.max_iters = 10;
+  return options;
+}
+
+TEST(OpCostProfilerTest, ProfileGraph) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Placeholder(s.WithOpName("a"), DT_FLOAT,
+                              ops::Placeholder::Shape({16, 16}));
+  Output b = ops::Placeholder(s.WithOpName("b"), DT_FLOAT,
+                              ops::Placeholder::Shape({16, 16}));
+  // Two identical matmuls are only profiled once.
+  Output mm1 = ops::MatMul(s.WithOpName("mm1"), a, b);
+  Output mm2 = ops::MatMul(s.WithOpName("mm2"), b, a);
+  Output relu = ops::Relu(s.WithOpName("relu"), mm1);
+  // Stateful ops aren't profiled.
+  Output random = ops::RandomUniform(s.WithOpName("random"),
+                                     ops::Const(s, {16, 16}), DT_FLOAT);
+  // Neither are ops with unknown input shapes.
+  Output c = ops::Placeholder(s.WithOpName("c"), DT_FLOAT);
+  Output neg = ops::Neg(s.WithOpName("neg"), c);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpCostProfiler profiler(FastOptions());
+  OpPerformanceList performance_list;
+  TF_ASSERT_OK(profiler.ProfileGraph(item, &performance_list));
+
+  ASSERT_EQ(2, performance_list.op_performance_size());
+  EXPECT_EQ("mm1", performance_list.op_performance(0).node());
+  EXPECT_EQ("MatMul", performance_list.op_performance(0).op().op());
+  EXPECT_EQ("relu", performance_list.op_performance(1).node());
+  for (const OpPerformance& performance : performance_list.op_performance()) {
+    EXPECT_GT(performance.compute_cost(), 0);
+    EXPECT_EQ("CPU", performance.op().device().type());
+  }
+
+  // The measurements are usable by the cost model.
+  MeasuredOpCosts measured_costs(performance_list);
+  EXPECT_EQ(2, measured_costs.size());
+  Costs::Duration time;
+  EXPECT_TRUE(measured_costs.PredictExecutionTime(
+      performance_list.op_performance(0).op(), &time));
+  EXPECT_EQ(performance_list.op_performance(0).compute_cost(), time.count());
+}
+
+TEST(OpCostProfilerTest, KernelError) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Placeholder(s.WithOpName("a"), DT_FLOAT,
+                              ops::Placeholder::Shape({4, 4}));
+  Output b = ops::Placeholder(s.WithOpName("b"), DT_FLOAT,
+                              ops::Placeholder::Shape({4, 4}));
+  Output mm = ops::MatMul(s.WithOpName("mm"), a, b);
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  // Describe inputs whose shapes the kernel rejects.
+  OpInfo op_info;
+  op_info.set_op("MatMul");
+  for (int size : {3, 5}) {
+    auto* input = op_info.add_inputs();
+    input->set_dtype(DT_FLOAT);
+    input->mutable_shape()->add_dim()->set_size(size);
+    input->mutable_shape()->add_dim()->set_size(size);
+  }
+
+  OpCostProfiler profiler(FastOptions());
+  OpPerformance performance;
+  for (const NodeDef& node : item.graph.node()) {
+    if (node.name() != "mm") continue;
+    EXPECT_FALSE(profiler.ProfileNode(node, op_info, &performance).ok());
+  }
+}
+
+}  // namespace
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -636,9 +636,39 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
 
   // By default, use sum of memory_time and compute_time for execution_time.
   compute_memory_overlap_ = false;
+
+  measured_costs_ = MeasuredOpCosts::FromEnvironment();
 }
 
 Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
+  Costs costs = PredictAnalyticalCosts(op_context);
+  Costs::Duration measured_time;
+  if (measured_costs_ == nullptr ||
+      !measured_costs_->PredictExecutionTime(op_context.op_info,
+                                             &measured_time)) {
+    return costs;
+  }
+
+  // Keep the analytical split between compute and memory time, scaled to the
+  // measured execution time.
+  const double scale =
+      SafeDiv(measured_time.count(), costs.execution_time.count());
+  if (scale > 0) {
+    costs.compute_time = Costs::Duration(costs.compute_time.count() * scale);
+    costs.memory_time = Costs::Duration(costs.memory_time.count() * scale);
+  } else {
+    costs.compute_time = measured_time;
+    costs.memory_time = Costs::Duration(0);
+  }
+  costs.execution_time = measured_time;
+  costs.inaccurate = false;
+  VLOG(1) << "Operation " << op_context.op_info.op() << " takes "
+          << measured_time.count() << " ns (measured).";
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictAnalyticalCosts(
+    const OpContext& op_context) const {
   const auto& op_info = op_context.op_info;
   auto it = device_cost_impl_.find(op_info.op());
   if (it != device_cost_impl_.end()) {
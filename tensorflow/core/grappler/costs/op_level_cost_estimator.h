@@ -16,7 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_LEVEL_COST_ESTIMATOR_H_
 #define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_LEVEL_COST_ESTIMATOR_H_
 
+#include <memory>
+
 #include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/measured_op_costs.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/util/padding.h"
@@ -39,7 +42,18 @@ class OpLevelCostEstimator {
   // Returns basic device performance info.
   virtual DeviceInfo GetDeviceInfo(const DeviceProperties& device) const;
 
+  // Uses measured execution times, when available, instead of the analytical
+  // estimates. By default, the measurements pointed to by the
+  // TF_GRAPPLER_MEASURED_OP_COSTS environment variable are used.
+  void set_measured_costs(
+      std::shared_ptr<const MeasuredOpCosts> measured_costs) {
+    measured_costs_ = std::move(measured_costs);
+  }
+
  protected:
+  // Predicts the cost of an op from its analytical model only.
+  Costs PredictAnalyticalCosts(const OpContext& op_context) const;
+
   // Predict cost of an op for which no accurate estimator is defined.
   Costs PredictCostOfAnUnknownOp(const OpContext& op_context) const;
 
@@ -210,6 +224,7 @@ class OpLevelCostEstimator {
   // compute_time and memory_time, instead of sum of those two.
   bool compute_memory_overlap_;
   std::set<string> persistent_ops_;
+  std::shared_ptr<const MeasuredOpCosts> measured_costs_;
 
  private:
   friend class OpLevelCostEstimatorTest;
@@ -438,6 +438,7 @@ NodeDef* MutableGraphView::AddNode(NodeDef&& node) {
   AddUniqueNodeOrDie(node_in_graph);
 
   AddAndDedupFanouts(node_in_graph);
+  MarkNodeUpdated(node_in_graph);
   return node_in_graph;
 }
 
@@ -485,6 +486,7 @@ Status MutableGraphView::AddSubgraph(GraphDef&& subgraph) {
   for (int i = node_size_before; i < graph()->node_size(); ++i) {
     NodeDef* node = graph()->mutable_node(i);
     AddAndDedupFanouts(node);
+    MarkNodeUpdated(node);
   }
 
   return Status::OK();
@@ -526,6 +528,7 @@ Status MutableGraphView::UpdateNode(
   for (const auto& attr : attrs) {
     (*node->mutable_attr())[attr.first] = attr.second;
   }
+  MarkNodeUpdated(node);
 
   if (node->op() == op) {
     return Status::OK();
@@ -584,6 +587,7 @@ Status MutableGraphView::UpdateNodeName(absl::string_view from_node_name,
   nodes().erase(node->name());
   node->set_name(string(to_node_name));
   nodes().emplace(node->name(), node);
+  MarkNodeUpdated(node);
   return Status::OK();
 }
 
@@ -612,6 +616,8 @@ Status MutableGraphView::SwapNodeNames(absl::string_view from_node_name,
     std::swap(*from_node->mutable_name(), *to_node->mutable_name());
     nodes().emplace(from_node->name(), from_node);
     nodes().emplace(to_node->name(), to_node);
+    MarkNodeUpdated(from_node);
+    MarkNodeUpdated(to_node);
   };
 
   if (update_fanouts) {
@@ -817,6 +823,7 @@ Status MutableGraphView::UpdateFanoutsInternal(NodeDef* from_node,
     input_port.node->set_input(
         input_port.port_id,
         TensorIdToString({to_node->name(), output_port.port_id}));
+    MarkNodeUpdated(input_port.node);
 
     // Remove old edge between the `from_node` and the fanout node.
     remove_edge(output_port, input_port);
@@ -881,6 +888,7 @@ bool MutableGraphView::AddFaninInternal(NodeDef* node,
 
   // Update max input port and dedup control dependencies.
   if (!input_is_control) {
+    MarkNodeUpdated(node);
     max_regular_input_port()[node] = num_regular_fanins;
     if (can_dedup_control_with_regular_input) {
       RemoveControllingFaninInternal(node, fanin.node);
@@ -946,6 +954,7 @@ Status MutableGraphView::AddRegularFaninByPort(absl::string_view node_name,
   UpdateMaxRegularOutputPortForAddedFanin(fanin_port);
 
   max_regular_input_port()[node] = num_regular_fanins;
+  MarkNodeUpdated(node);
   if (CanDedupControlWithRegularInput(*this, *fanin_node)) {
     RemoveControllingFaninInternal(node, fanin_node);
   }
@@ -1084,6 +1093,7 @@ bool MutableGraphView::RemoveRegularFaninInternal(NodeDef* node,
   }
 
   if (modified) {
+    MarkNodeUpdated(node);
     const int last_regular_input_port = curr_pos - 1;
     if (last_regular_input_port < 0) {
       max_regular_input_port().erase(node);
@@ -1151,6 +1161,7 @@ Status MutableGraphView::RemoveRegularFaninByPort(absl::string_view node_name,
     mutable_inputs->SwapElements(last_regular_fanin_port, last_node_input);
   }
   mutable_inputs->RemoveLast();
+  MarkNodeUpdated(node);
 
   const int updated_last_regular_input_port = last_regular_fanin_port - 1;
   if (updated_last_regular_input_port < 0) {
@@ -1218,6 +1229,9 @@ Status MutableGraphView::RemoveAllFanins(absl::string_view node_name,
   const int num_regular_fanins =
       NumFanins(*node, /*include_controlling_nodes=*/false);
   RemoveFaninsInternal(node, keep_controlling_fanins);
+  if (num_regular_fanins > 0) {
+    MarkNodeUpdated(node);
+  }
   if (keep_controlling_fanins) {
     if (num_regular_fanins == 0) {
       return Status::OK();
@@ -1315,6 +1329,7 @@ Status MutableGraphView::UpdateFanin(absl::string_view node_name,
 
   // Dedup control dependencies and update max regular output ports.
   if (modified) {
+    MarkNodeUpdated(node);
     UpdateMaxRegularOutputPortForRemovedFanin(
         {from_fanin_node, from_fanin.index()}, *from_fanin_port_fanouts);
     if (max_regular_output_port()[to_fanin_node] < to_fanin.index()) {
@@ -1364,6 +1379,7 @@ Status MutableGraphView::UpdateRegularFaninByPort(absl::string_view node_name,
   UpdateMaxRegularOutputPortForAddedFanin(to_fanin_port);
 
   node->set_input(port, TensorIdToString(fanin));
+  MarkNodeUpdated(node);
 
   if (CanDedupControlWithRegularInput(*this, *fanin_node)) {
     RemoveControllingFaninInternal(node, fanin_node);
@@ -1412,6 +1428,7 @@ Status MutableGraphView::SwapRegularFaninsByPorts(absl::string_view node_name,
   to_fanouts->insert(from_input);
 
   node->mutable_input()->SwapElements(from_port, to_port);
+  MarkNodeUpdated(node);
 
   return Status::OK();
 }
@@ -1483,6 +1500,9 @@ Status MutableGraphView::UpdateAllRegularFaninsToControlling(
   // Remove duplicate controls and leftover regular fanins.
   node->mutable_input()->DeleteSubrange(pos, node->input_size() - pos);
   max_regular_input_port().erase(node);
+  if (num_regular_fanins > 0) {
+    MarkNodeUpdated(node);
+  }
 
   return Status::OK();
 }
@@ -1560,6 +1580,7 @@ Status MutableGraphView::DeleteNodes(
     if (node != nullptr) {
       RemoveFaninsInternal(node, /*keep_controlling_fanins=*/false);
       RemoveFanoutsInternal(node);
+      MarkNodeUpdated(node);
     }
   }
   for (const string& node_name_to_delete : nodes_to_delete) {
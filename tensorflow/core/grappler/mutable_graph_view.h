@@ -248,6 +248,16 @@ class MutableGraphView : public internal::GraphViewInternal<GraphDef, NodeDef> {
   // that can't be found are ignored.
   Status DeleteNodes(const absl::flat_hash_set<string>& nodes_to_delete);
 
+  // Starts recording the names of the nodes added or deleted by this view, and
+  // of the nodes whose name, op, attributes or regular fanins are updated by
+  // it. Changes to controlling fanins are not recorded. The recorded set can
+  // be passed to GraphProperties::UpdateStatically() to refresh the inferred
+  // shapes of the modified subgraph only. Passing nullptr stops the recording.
+  // `updated_nodes` must outlive the recording.
+  void set_updated_nodes(absl::flat_hash_set<string>* updated_nodes) {
+    updated_nodes_ = updated_nodes;
+  }
+
  private:
   // Adds fanouts for fanins of node to graph, while deduping control
   // dependencies from existing control dependencies and regular fanins. Note,
@@ -323,6 +333,13 @@ class MutableGraphView : public internal::GraphViewInternal<GraphDef, NodeDef> {
 
   // Removes fanouts of the deleted node from internal state.
   void RemoveFanoutsInternal(NodeDef* deleted_node);
+
+  // Records the node in `updated_nodes_`, if set.
+  void MarkNodeUpdated(const NodeDef* node) {
+    if (updated_nodes_ != nullptr) updated_nodes_->insert(node->name());
+  }
+
+  absl::flat_hash_set<string>* updated_nodes_ = nullptr;
 };
 
 }  // end namespace grappler
@@ -2996,6 +2996,50 @@ TEST(MutableGraphViewTest, DeleteNodesWithLargeError) {
   CheckGraph(graph);
 }
 
+TEST(MutableGraphViewTest, RecordUpdatedNodes) {
+  GraphDef graph_def = test::function::GDef(
+      {NDef("a", "NotImportant", {}, {}), NDef("b", "NotImportant", {}, {}),
+       NDef("c", "NotImportant", {"a"}, {}),
+       NDef("d", "NotImportant", {"c", "^b"}, {}),
+       NDef("e", "NotImportant", {"c"}, {})},
+      /*funcs=*/{});
+
+  MutableGraphView graph(&graph_def);
+  absl::flat_hash_set<string> updated_nodes;
+  graph.set_updated_nodes(&updated_nodes);
+
+  // Controlling fanins don't affect the outputs of a node.
+  TF_EXPECT_OK(graph.AddControllingFanin("e", {"b", Graph::kControlSlot}));
+  TF_EXPECT_OK(graph.RemoveControllingFanin("d", "b"));
+  EXPECT_TRUE(updated_nodes.empty());
+
+  TF_EXPECT_OK(graph.UpdateRegularFaninByPort("c", 0, {"b", 0}));
+  EXPECT_THAT(updated_nodes, ::testing::UnorderedElementsAre("c"));
+
+  NodeDef f = NDef("f", "NotImportant", {"a"}, {});
+  graph.AddNode(std::move(f));
+  TF_EXPECT_OK(graph.UpdateFanouts("c", "f"));
+  EXPECT_THAT(updated_nodes,
+              ::testing::UnorderedElementsAre("c", "d", "e", "f"));
+
+  updated_nodes.clear();
+  TF_EXPECT_OK(graph.UpdateNode("a", "OtherOp", "", {}));
+  TF_EXPECT_OK(graph.UpdateNodeName("b", "g", /*update_fanouts=*/true));
+  EXPECT_THAT(updated_nodes, ::testing::UnorderedElementsAre("a", "g"));
+
+  updated_nodes.clear();
+  TF_EXPECT_OK(graph.DeleteNodes({"c"}));
+  EXPECT_THAT(updated_nodes, ::testing::UnorderedElementsAre("c"));
+
+  // Nothing is recorded once the recording stops.
+  updated_nodes.clear();
+  graph.set_updated_nodes(nullptr);
+  TF_EXPECT_OK(graph.RemoveRegularFanin("f", {"a", 0}));
+  EXPECT_TRUE(updated_nodes.empty());
+
+  CheckGraph(graph);
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
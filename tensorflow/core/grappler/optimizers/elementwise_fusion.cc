@@ -0,0 +1,321 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/elementwise_fusion.h"
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+constexpr char kFusedElementwise[] = "_FusedElementwise";
+
+// Upper bound on the number of ops fused into a single node. The fused kernel
+// keeps one block of intermediate results per op in its scratch buffer.
+constexpr int kMaxFusedOps = 32;
+
+// Returns the number of inputs of an element-wise op supported by the
+// _FusedElementwise kernel, or 0 if the op is not supported.
+// NOTE: Keep in sync with the list of supported ops in
+// kernels/fused_elementwise_op.cc.
+int FusableOpArity(const NodeDef& node) {
+  static const auto* arity = new absl::flat_hash_map<string, int>({
+      {"Abs", 1},     {"Exp", 1},       {"Inv", 1},
+      {"Log", 1},     {"Neg", 1},       {"Reciprocal", 1},
+      {"Relu", 1},    {"Rsqrt", 1},     {"Sigmoid", 1},
+      {"Sqrt", 1},    {"Square", 1},    {"Tanh", 1},
+      {"Add", 2},     {"AddV2", 2},     {"Div", 2},
+      {"Maximum", 2}, {"Minimum", 2},   {"Mul", 2},
+      {"RealDiv", 2}, {"Sub", 2},       {"SquaredDifference", 2},
+  });
+  auto it = arity->find(node.op());
+  return it == arity->end() ? 0 : it->second;
+}
+
+struct FusionContext {
+  explicit FusionContext(const GrapplerItem& item, GraphDef* graph)
+      : nodes_to_preserve(item.NodesToPreserve()),
+        node_map(graph),
+        graph_properties(item) {
+    for (const NodeDef& node : graph->node()) {
+      name_to_node.emplace(node.name(), &node);
+    }
+  }
+
+  std::unordered_set<string> nodes_to_preserve;
+  NodeMap node_map;
+  GraphProperties graph_properties;
+  std::unordered_map<string, const NodeDef*> name_to_node;
+  OpLevelCostEstimator cost_estimator;
+  // Nodes that are already part of a fused cluster.
+  absl::flat_hash_set<const NodeDef*> fused_nodes;
+};
+
+// A tree of fusable nodes, in post order (the root is the last node).
+struct ElementwiseCluster {
+  std::vector<const NodeDef*> nodes;
+};
+
+// Returns true if the node can be evaluated by the _FusedElementwise kernel:
+// a supported op on CPU with a float or double output of a fully defined
+// shape, and with all inputs of the same shape (broadcasting is not
+// supported).
+bool IsFusable(const FusionContext& ctx, const NodeDef& node) {
+  const int arity = FusableOpArity(node);
+  if (arity == 0 || !NodeIsOnCpu(&node)) return false;
+
+  const DataType dtype = GetDataTypeFromAttr(node, "T");
+  if (dtype != DT_FLOAT && dtype != DT_DOUBLE) return false;
+
+  if (!ctx.graph_properties.HasInputProperties(node.name()) ||
+      !ctx.graph_properties.HasOutputProperties(node.name())) {
+    return false;
+  }
+  const auto& outputs = ctx.graph_properties.GetOutputProperties(node.name());
+  const auto& inputs = ctx.graph_properties.GetInputProperties(node.name());
+  if (outputs.size() != 1 || inputs.size() != arity) return false;
+
+  const PartialTensorShape output_shape(outputs[0].shape());
+  if (!output_shape.IsFullyDefined()) return false;
+  for (const auto& input : inputs) {
+    if (input.dtype() != dtype ||
+        !PartialTensorShape(input.shape()).IsIdenticalTo(output_shape)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if the node can be folded into the cluster of its only
+// consumer. Nodes with other consumers must stay in the graph, and so do nodes
+// with control dependencies in either direction. The fused node runs on the
+// device of the consumer, so the node must be placed on the same device.
+bool IsFusableIntoConsumer(const FusionContext& ctx, const NodeDef& node,
+                           const NodeDef& consumer) {
+  if (node.device() != consumer.device()) return false;
+  if (ctx.nodes_to_preserve.count(node.name()) > 0) return false;
+  if (ctx.fused_nodes.contains(&node)) return false;
+  if (HasControlInputs(node)) return false;
+
+  const auto& fanouts = ctx.node_map.GetOutputs(node.name());
+  if (fanouts.size() != 1 || *fanouts.begin() != &consumer) return false;
+  // The consumer must use the node exactly once, as a data input.
+  int num_uses = 0;
+  for (const string& input : consumer.input()) {
+    if (NodeName(input) != node.name()) continue;
+    if (IsControlInput(input)) return false;
+    ++num_uses;
+  }
+  return num_uses == 1;
+}
+
+// Adds `node` and the fusable part of its input tree to the cluster, in post
+// order. `budget` is the number of nodes that can still be added.
+void CollectCluster(const FusionContext& ctx, const NodeDef& node,
+                    int* budget, ElementwiseCluster* cluster) {
+  --*budget;
+  const int arity = FusableOpArity(node);
+  for (int i = 0; i < arity; ++i) {
+    const NodeDef* input = ctx.node_map.GetNode(node.input(i));
+    if (input == nullptr || *budget <= 0 ||
+        NodePosition(node.input(i)) != 0 || !IsFusable(ctx, *input) ||
+        !IsFusableIntoConsumer(ctx, *input, node)) {
+      continue;
+    }
+    CollectCluster(ctx, *input, budget, cluster);
+  }
+  cluster->nodes.push_back(&node);
+}
+
+// Returns true if the cost model predicts that evaluating the cluster op by op
+// is memory bound. Fusion removes the memory traffic for all intermediate
+// results, but does not change the amount of computation.
+bool IsMemoryBound(FusionContext* ctx, const ElementwiseCluster& cluster) {
+  const DeviceProperties device =
+      GetDeviceInfo(cluster.nodes.back()->device());
+  Costs::Duration compute_time;
+  Costs::Duration memory_time;
+  for (const NodeDef* node : cluster.nodes) {
+    OpContext op_context;
+    op_context.name = node->name();
+    op_context.op_info = BuildOpInfoWithoutDevice(
+        *node, ctx->name_to_node,
+        ctx->graph_properties.GetInputProperties(node->name()));
+    *op_context.op_info.mutable_device() = device;
+    const Costs costs = ctx->cost_estimator.PredictCosts(op_context);
+    compute_time += costs.compute_time;
+    memory_time += costs.memory_time;
+  }
+  VLOG(2) << "Elementwise cluster rooted at " << cluster.nodes.back()->name()
+          << " with " << cluster.nodes.size()
+          << " ops: compute_time=" << compute_time.count()
+          << "ns memory_time=" << memory_time.count() << "ns";
+  return memory_time > compute_time;
+}
+
+// Replaces the root of the cluster with a _FusedElementwise node that
+// evaluates the whole cluster.
+void FuseCluster(const ElementwiseCluster& cluster, NodeDef* root) {
+  absl::flat_hash_map<const NodeDef*, int> result_index;
+  for (int i = 0; i < cluster.nodes.size(); ++i) {
+    result_index[cluster.nodes[i]] = i;
+  }
+
+  // Inputs that are produced outside of the cluster become arguments of the
+  // fused node. Each distinct tensor is passed only once.
+  std::vector<string> args;
+  absl::flat_hash_map<string, int> arg_index;
+  for (const NodeDef* node : cluster.nodes) {
+    for (int i = 0; i < FusableOpArity(*node); ++i) {
+      const string& input = node->input(i);
+      const string tensor =
+          strings::StrCat(NodeName(input), ":", NodePosition(input));
+      if (arg_index.contains(tensor)) continue;
+      bool produced_in_cluster = false;
+      for (const NodeDef* other : cluster.nodes) {
+        if (other->name() == NodeName(input)) produced_in_cluster = true;
+      }
+      if (produced_in_cluster) continue;
+      arg_index[tensor] = args.size();
+      args.push_back(input);
+    }
+  }
+
+  std::vector<string> fused_ops;
+  std::vector<int> fused_op_inputs;
+  const int num_args = args.size();
+  for (const NodeDef* node : cluster.nodes) {
+    fused_ops.push_back(node->op());
+    for (int i = 0; i < FusableOpArity(*node); ++i) {
+      const string& input = node->input(i);
+      const string tensor =
+          strings::StrCat(NodeName(input), ":", NodePosition(input));
+      auto arg = arg_index.find(tensor);
+      if (arg != arg_index.end()) {
+        fused_op_inputs.push_back(arg->second);
+        continue;
+      }
+      for (const NodeDef* other : cluster.nodes) {
+        if (other->name() == NodeName(input)) {
+          fused_op_inputs.push_back(num_args + result_index[other]);
+        }
+      }
+    }
+  }
+
+  NodeDef fused;
+  fused.set_name(root->name());
+  fused.set_op(kFusedElementwise);
+  fused.set_device(root->device());
+  for (const string& arg : args) fused.add_input(arg);
+  for (const string& input : root->input()) {
+    if (IsControlInput(input)) fused.add_input(input);
+  }
+
+  auto* attr = fused.mutable_attr();
+  (*attr)["T"] = root->attr().at("T");
+  SetAttrValue(num_args, &(*attr)["num_args"]);
+  SetAttrValue(fused_ops, &(*attr)["fused_ops"]);
+  SetAttrValue(fused_op_inputs, &(*attr)["fused_op_inputs"]);
+
+  VLOG(1) << "Fused " << cluster.nodes.size() << " element-wise ops into "
+          << fused.name() << ": " << absl::StrJoin(fused_ops, ",");
+  *root = std::move(fused);
+}
+
+}  // namespace
+
+Status ElementwiseFusion::Optimize(Cluster* /*cluster*/,
+                                   const GrapplerItem& item,
+                                   GraphDef* optimized_graph) {
+  // _FusedElementwise does not have a gradient function.
+  if (!item.optimization_options().allow_non_differentiable_rewrites) {
+    return errors::Aborted(
+        "Elementwise fusion requires non-differentiable rewrites.");
+  }
+
+  GrapplerItem mutable_item = item;
+  GraphDef* graph = &mutable_item.graph;
+  TF_RETURN_IF_ERROR(TopologicalSort(graph));
+
+  FusionContext ctx(mutable_item, graph);
+  TF_RETURN_IF_ERROR(ctx.graph_properties.InferStatically(
+      /*assume_valid_feeds=*/opt_level_ == RewriterConfig::AGGRESSIVE,
+      /*aggressive_shape_inference=*/false,
+      /*include_tensor_values=*/false));
+
+  // Visit consumers before producers, so that every cluster is grown from the
+  // last op of a chain.
+  std::set<string> nodes_to_delete;
+  for (int i = graph->node_size() - 1; i >= 0; --i) {
+    NodeDef* root = graph->mutable_node(i);
+    if (ctx.fused_nodes.contains(root) || !IsFusable(ctx, *root)) continue;
+
+    ElementwiseCluster cluster;
+    int budget = kMaxFusedOps;
+    CollectCluster(ctx, *root, &budget, &cluster);
+    if (cluster.nodes.size() < 2) continue;
+    if (opt_level_ != RewriterConfig::AGGRESSIVE &&
+        !IsMemoryBound(&ctx, cluster)) {
+      continue;
+    }
+
+    for (const NodeDef* node : cluster.nodes) {
+      ctx.fused_nodes.insert(node);
+      if (node != root) nodes_to_delete.insert(node->name());
+    }
+    FuseCluster(cluster, root);
+  }
+
+  if (nodes_to_delete.empty()) {
+    return errors::Aborted("Nothing to do.");
+  }
+  EraseNodesFromGraph(nodes_to_delete, graph);
+  *optimized_graph = std::move(*graph);
+  return Status::OK();
+}
+
+void ElementwiseFusion::Feedback(Cluster* /*cluster*/,
+                                 const GrapplerItem& /*item*/,
+                                 const GraphDef& /*optimized_graph*/,
+                                 double /*result*/) {
+  // Nothing to do for ElementwiseFusion.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
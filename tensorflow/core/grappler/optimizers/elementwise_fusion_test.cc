@@ -0,0 +1,223 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/elementwise_fusion.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+
+class ElementwiseFusionTest : public GrapplerTest {
+ protected:
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) return &node;
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(ElementwiseFusionTest, FuseExpressionTree) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/job:localhost/replica:0/task:0/device:CPU:0");
+  auto a = ops::Placeholder(s.WithOpName("a"), DT_FLOAT,
+                            ops::Placeholder::Shape({8, 32}));
+  auto b = ops::Placeholder(s.WithOpName("b"), DT_FLOAT,
+                            ops::Placeholder::Shape({8, 32}));
+  auto mul = ops::Mul(s.WithOpName("mul"), a, b);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), mul);
+  auto sub = ops::Sub(s.WithOpName("sub"), a, b);
+  auto sigmoid = ops::Sigmoid(s.WithOpName("sigmoid"), sub);
+  auto add = ops::AddV2(s.WithOpName("add"), tanh, sigmoid);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), add);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  auto a_t = GenerateRandomTensor<DT_FLOAT>(TensorShape({8, 32}));
+  auto b_t = GenerateRandomTensor<DT_FLOAT>(TensorShape({8, 32}));
+  item.feed = {{"a", a_t}, {"b", b_t}};
+
+  ElementwiseFusion optimizer(RewriterConfig::AGGRESSIVE);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // a, b, add (fused) and fetch.
+  EXPECT_EQ(output.node_size(), 4);
+  const NodeDef* fused = FindNode(output, "add");
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(fused->op(), "_FusedElementwise");
+  ASSERT_EQ(fused->input_size(), 2);
+  EXPECT_EQ(fused->input(0), "a");
+  EXPECT_EQ(fused->input(1), "b");
+  EXPECT_EQ(fused->attr().at("num_args").i(), 2);
+  EXPECT_EQ(fused->attr().at("fused_ops").list().s_size(), 5);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-6);
+}
+
+TEST_F(ElementwiseFusionTest, FuseMemoryBoundChain) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/job:localhost/replica:0/task:0/device:CPU:0");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({256, 256}));
+  auto neg = ops::Neg(s.WithOpName("neg"), x);
+  auto add = ops::Add(s.WithOpName("add"), neg, x);
+  auto mul = ops::Mul(s.WithOpName("mul"), add, x);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), mul);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  auto x_t = GenerateRandomTensor<DT_FLOAT>(TensorShape({256, 256}));
+  item.feed = {{"x", x_t}};
+
+  ElementwiseFusion optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const NodeDef* fused = FindNode(output, "mul");
+  ASSERT_NE(fused, nullptr);
+  EXPECT_EQ(fused->op(), "_FusedElementwise");
+  EXPECT_EQ(fused->attr().at("num_args").i(), 1);
+  EXPECT_EQ(FindNode(output, "neg"), nullptr);
+  EXPECT_EQ(FindNode(output, "add"), nullptr);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-6);
+}
+
+TEST_F(ElementwiseFusionTest, KeepIntermediateWithMultipleConsumers) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/job:localhost/replica:0/task:0/device:CPU:0");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({16}));
+  auto exp = ops::Exp(s.WithOpName("exp"), x);
+  auto relu = ops::Relu(s.WithOpName("relu"), exp);
+  auto square = ops::Square(s.WithOpName("square"), relu);
+  auto fetch1 = ops::Identity(s.WithOpName("fetch1"), square);
+  // `relu` is also consumed outside of the chain.
+  auto fetch2 = ops::Identity(s.WithOpName("fetch2"), relu);
+
+  GrapplerItem item;
+  item.fetch = {"fetch1", "fetch2"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  ElementwiseFusion optimizer(RewriterConfig::AGGRESSIVE);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // Only exp can be folded into relu; square stays on its own.
+  const NodeDef* square_node = FindNode(output, "square");
+  ASSERT_NE(square_node, nullptr);
+  EXPECT_EQ(square_node->op(), "Square");
+  const NodeDef* relu_node = FindNode(output, "relu");
+  ASSERT_NE(relu_node, nullptr);
+  EXPECT_EQ(relu_node->op(), "_FusedElementwise");
+  EXPECT_EQ(FindNode(output, "exp"), nullptr);
+}
+
+TEST_F(ElementwiseFusionTest, DoNotFuseAcrossDevices) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/job:localhost/replica:0/task:0/device:CPU:0");
+  tensorflow::Scope s1 =
+      s.WithDevice("/job:localhost/replica:0/task:0/device:CPU:1");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({16}));
+  auto neg = ops::Neg(s1.WithOpName("neg"), x);
+  auto exp = ops::Exp(s.WithOpName("exp"), neg);
+  auto relu = ops::Relu(s.WithOpName("relu"), exp);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), relu);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  ElementwiseFusion optimizer(RewriterConfig::AGGRESSIVE);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // Only exp, which is on the same device as relu, is folded into it.
+  const NodeDef* relu_node = FindNode(output, "relu");
+  ASSERT_NE(relu_node, nullptr);
+  EXPECT_EQ(relu_node->op(), "_FusedElementwise");
+  EXPECT_EQ(relu_node->device(),
+            "/job:localhost/replica:0/task:0/device:CPU:0");
+  EXPECT_EQ(FindNode(output, "exp"), nullptr);
+  const NodeDef* neg_node = FindNode(output, "neg");
+  ASSERT_NE(neg_node, nullptr);
+  EXPECT_EQ(neg_node->op(), "Neg");
+  EXPECT_EQ(relu_node->input(0), "neg");
+}
+
+TEST_F(ElementwiseFusionTest, DoNotFuseBroadcasts) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/job:localhost/replica:0/task:0/device:CPU:0");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 16}));
+  auto bias = ops::Placeholder(s.WithOpName("bias"), DT_FLOAT,
+                               ops::Placeholder::Shape({16}));
+  auto add = ops::Add(s.WithOpName("add"), x, bias);
+  auto tanh = ops::Tanh(s.WithOpName("tanh"), add);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), tanh);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  ElementwiseFusion optimizer(RewriterConfig::AGGRESSIVE);
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status));
+}
+
+TEST_F(ElementwiseFusionTest, DoNotFuseWithoutNonDifferentiableRewrites) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(
+      "/job:localhost/replica:0/task:0/device:CPU:0");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({16}));
+  auto neg = ops::Neg(s.WithOpName("neg"), x);
+  auto exp = ops::Exp(s.WithOpName("exp"), neg);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), exp);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  item.optimization_options().allow_non_differentiable_rewrites = false;
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  ElementwiseFusion optimizer(RewriterConfig::AGGRESSIVE);
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status));
+}
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,374 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/memory_aware_scheduler.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/costs/graph_memory.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// With the ON toggle, only nodes that allocate at least this many bytes are
+// constrained to follow the computed order. Ordering smaller nodes would cost
+// parallelism for little memory savings.
+constexpr int64 kMinScheduledAllocationBytes = 1 << 20;
+
+int64 TensorBytes(const OpInfo::TensorProperties& tensor) {
+  // Reference outputs alias the buffer of a variable.
+  if (IsRefType(tensor.dtype())) return 0;
+  const PartialTensorShape shape(tensor.shape());
+  if (!shape.IsFullyDefined()) return 0;
+  return shape.num_elements() * DataTypeSize(tensor.dtype());
+}
+
+}  // namespace
+
+PeakMemoryScheduler::PeakMemoryScheduler(
+    const GraphDef& graph, const GraphProperties& properties,
+    const std::unordered_set<string>& nodes_to_preserve)
+    : graph_(graph) {
+  const int num_nodes = graph.node_size();
+  node_inputs_.resize(num_nodes);
+  node_outputs_.resize(num_nodes);
+  fanins_.resize(num_nodes);
+  fanouts_.resize(num_nodes);
+
+  absl::flat_hash_map<string, int> node_index;
+  for (int i = 0; i < num_nodes; ++i) {
+    node_index[graph.node(i).name()] = i;
+  }
+
+  absl::flat_hash_map<std::pair<int, int>, int> tensor_index;
+  const auto get_tensor = [&](int node, int port) {
+    auto it = tensor_index.find({node, port});
+    if (it != tensor_index.end()) return it->second;
+
+    const NodeDef& producer = graph.node(node);
+    const auto& outputs = properties.GetOutputProperties(producer.name());
+    TensorInfo tensor;
+    tensor.producer = node;
+    // Persistent tensors (e.g. constants and variables) are not allocated by
+    // the step, so they don't affect the schedule.
+    tensor.bytes = port < outputs.size() && !IsPersistent(producer)
+                       ? TensorBytes(outputs[port])
+                       : 0;
+    tensor.persistent = nodes_to_preserve.count(producer.name()) > 0;
+
+    const int index = tensors_.size();
+    tensors_.push_back(std::move(tensor));
+    node_outputs_[node].push_back(index);
+    tensor_index.emplace(std::make_pair(node, port), index);
+    return index;
+  };
+
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& node = graph.node(i);
+    const int num_outputs =
+        properties.GetOutputProperties(node.name()).size();
+    for (int port = 0; port < num_outputs; ++port) {
+      get_tensor(i, port);
+    }
+    for (const string& input : node.input()) {
+      const TensorId tensor_id = ParseTensorName(input);
+      auto it = node_index.find(tensor_id.node());
+      if (it == node_index.end()) continue;
+      fanins_[i].push_back(it->second);
+      if (tensor_id.index() >= 0) {
+        node_inputs_[i].push_back(get_tensor(it->second, tensor_id.index()));
+      }
+    }
+  }
+
+  const auto sort_and_dedup = [](std::vector<int>* values) {
+    std::sort(values->begin(), values->end());
+    values->erase(std::unique(values->begin(), values->end()), values->end());
+  };
+  for (int i = 0; i < num_nodes; ++i) {
+    sort_and_dedup(&fanins_[i]);
+    sort_and_dedup(&node_inputs_[i]);
+    for (int fanin : fanins_[i]) fanouts_[fanin].push_back(i);
+    for (int tensor : node_inputs_[i]) tensors_[tensor].consumers.push_back(i);
+  }
+}
+
+int64 PeakMemoryScheduler::AllocatedBytes(int node) const {
+  int64 bytes = 0;
+  for (int tensor : node_outputs_[node]) bytes += tensors_[tensor].bytes;
+  return bytes;
+}
+
+int64 PeakMemoryScheduler::MemoryDelta(
+    int node, const std::vector<int>& pending_consumers) const {
+  int64 delta = 0;
+  for (int tensor : node_outputs_[node]) {
+    const TensorInfo& info = tensors_[tensor];
+    // Outputs that nobody reads are released as soon as the node is done.
+    if (!info.consumers.empty() || info.persistent) delta += info.bytes;
+  }
+  for (int tensor : node_inputs_[node]) {
+    const TensorInfo& info = tensors_[tensor];
+    if (pending_consumers[tensor] == 1 && !info.persistent) {
+      delta -= info.bytes;
+    }
+  }
+  return delta;
+}
+
+Status PeakMemoryScheduler::ComputeSchedule(std::vector<int>* schedule) const {
+  const int num_nodes = graph_.node_size();
+  std::vector<int> pending_fanins(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    pending_fanins[i] = fanins_[i].size();
+  }
+  std::vector<int> pending_consumers(tensors_.size());
+  for (int i = 0; i < tensors_.size(); ++i) {
+    pending_consumers[i] = tensors_[i].consumers.size();
+  }
+
+  // Candidates are ordered by memory delta, then by position in the original
+  // topological order to keep the schedule deterministic. The delta of a
+  // ready node can only decrease as other consumers of its inputs run, so
+  // outdated entries are detected and refreshed when they are popped.
+  using Candidate = std::pair<int64, int>;
+  std::priority_queue<Candidate, std::vector<Candidate>,
+                      std::greater<Candidate>>
+      ready;
+  std::vector<bool> scheduled(num_nodes, false);
+  for (int i = 0; i < num_nodes; ++i) {
+    if (pending_fanins[i] == 0) {
+      ready.emplace(MemoryDelta(i, pending_consumers), i);
+    }
+  }
+
+  schedule->clear();
+  schedule->reserve(num_nodes);
+  while (!ready.empty()) {
+    const Candidate candidate = ready.top();
+    ready.pop();
+    const int node = candidate.second;
+    if (scheduled[node]) continue;
+    const int64 delta = MemoryDelta(node, pending_consumers);
+    if (delta < candidate.first) {
+      ready.emplace(delta, node);
+      continue;
+    }
+
+    scheduled[node] = true;
+    schedule->push_back(node);
+    for (int tensor : node_inputs_[node]) {
+      if (--pending_consumers[tensor] != 1) continue;
+      // The last pending consumer of the tensor now frees it when it runs.
+      for (int consumer : tensors_[tensor].consumers) {
+        if (!scheduled[consumer] && pending_fanins[consumer] == 0) {
+          ready.emplace(MemoryDelta(consumer, pending_consumers), consumer);
+        }
+      }
+    }
+    for (int fanout : fanouts_[node]) {
+      if (--pending_fanins[fanout] == 0) {
+        ready.emplace(MemoryDelta(fanout, pending_consumers), fanout);
+      }
+    }
+  }
+
+  if (schedule->size() != num_nodes) {
+    return errors::InvalidArgument(
+        "The graph contains a cycle: only ", schedule->size(), " of ",
+        num_nodes, " nodes could be scheduled.");
+  }
+  return Status::OK();
+}
+
+std::unordered_map<string, int64> PeakMemoryScheduler::PeakMemoryUsage(
+    const std::vector<int>& schedule) const {
+  std::vector<int> pending_consumers(tensors_.size());
+  for (int i = 0; i < tensors_.size(); ++i) {
+    pending_consumers[i] = tensors_[i].consumers.size();
+  }
+
+  std::unordered_map<string, int64> live;
+  std::unordered_map<string, int64> peak;
+  const auto release = [&](const TensorInfo& info) {
+    if (!info.persistent) {
+      live[graph_.node(info.producer).device()] -= info.bytes;
+    }
+  };
+  for (int node : schedule) {
+    const string& device = graph_.node(node).device();
+    live[device] += AllocatedBytes(node);
+    peak[device] = std::max(peak[device], live[device]);
+    for (int tensor : node_inputs_[node]) {
+      if (--pending_consumers[tensor] == 0) release(tensors_[tensor]);
+    }
+    for (int tensor : node_outputs_[node]) {
+      if (tensors_[tensor].consumers.empty()) release(tensors_[tensor]);
+    }
+  }
+  return peak;
+}
+
+Status MemoryAwareScheduler::Optimize(Cluster* /*cluster*/,
+                                      const GrapplerItem& item,
+                                      GraphDef* optimized_graph) {
+  std::unordered_map<string, DeviceProperties> devices;
+  for (const NodeDef& node : item.graph.node()) {
+    // The executor runs the nodes of each frame independently, so a single
+    // order can't be enforced across loop iterations.
+    if (IsControlFlow(node)) {
+      return errors::Aborted(
+          "Memory aware scheduling does not support control flow.");
+    }
+    if (!node.device().empty() && devices.count(node.device()) == 0) {
+      devices[node.device()] = GetDeviceInfo(node.device());
+    }
+  }
+
+  *optimized_graph = item.graph;
+  TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
+
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(
+      /*assume_valid_feeds=*/false,
+      /*aggressive_shape_inference=*/false,
+      /*include_tensor_values=*/false));
+
+  PeakMemoryScheduler scheduler(*optimized_graph, properties,
+                                item.NodesToPreserve());
+  std::vector<int> schedule;
+  TF_RETURN_IF_ERROR(scheduler.ComputeSchedule(&schedule));
+  const std::unordered_map<string, int64> peak_usage =
+      scheduler.PeakMemoryUsage(schedule);
+
+  // Estimate the peak memory of the current graph by simulating its execution
+  // with the virtual scheduler. If that fails, fall back to running the nodes
+  // in their original topological order.
+  GraphMemory memory(item);
+  const bool has_memory_estimate = memory.InferStatically(devices).ok();
+  std::vector<int> original_order(optimized_graph->node_size());
+  for (int i = 0; i < original_order.size(); ++i) original_order[i] = i;
+  const std::unordered_map<string, int64> original_peak_usage =
+      scheduler.PeakMemoryUsage(original_order);
+
+  absl::flat_hash_set<string> devices_to_schedule;
+  for (const auto& device_usage : peak_usage) {
+    const string& device = device_usage.first;
+    if (device.empty()) continue;
+    int64 baseline = -1;
+    if (has_memory_estimate) {
+      baseline = memory.GetPeakMemoryUsage(device).used_memory;
+    }
+    if (baseline < 0) baseline = original_peak_usage.at(device);
+    VLOG(1) << "Peak memory on " << device << ": " << baseline
+            << " bytes before scheduling, " << device_usage.second
+            << " bytes after scheduling";
+    if (device_usage.second < baseline) devices_to_schedule.insert(device);
+  }
+
+  // Make every large node wait until the previous large node on the same
+  // device has been consumed: the control dependencies go to the consumers of
+  // the previous large node that precede this node in the schedule, since they
+  // release its output, or to the previous large node itself if there are no
+  // such consumers. Since the schedule is a topological order, the new control
+  // dependencies can't create cycles.
+  const int64 min_scheduled_bytes = opt_level_ == RewriterConfig::AGGRESSIVE
+                                        ? 1
+                                        : kMinScheduledAllocationBytes;
+  std::vector<int> position(optimized_graph->node_size());
+  for (int i = 0; i < schedule.size(); ++i) position[schedule[i]] = i;
+  absl::flat_hash_map<string, int> node_index_by_name;
+  for (int i = 0; i < optimized_graph->node_size(); ++i) {
+    node_index_by_name[optimized_graph->node(i).name()] = i;
+  }
+  std::vector<std::vector<int>> fanouts(optimized_graph->node_size());
+  for (int i = 0; i < optimized_graph->node_size(); ++i) {
+    for (const string& input : optimized_graph->node(i).input()) {
+      if (IsControlInput(input)) continue;
+      auto it = node_index_by_name.find(NodeName(input));
+      if (it != node_index_by_name.end()) fanouts[it->second].push_back(i);
+    }
+  }
+
+  absl::flat_hash_map<string, int> previous_large_node;
+  int num_control_dependencies = 0;
+  for (int node_index : schedule) {
+    NodeDef* node = optimized_graph->mutable_node(node_index);
+    if (!NodeIsOnCpu(node) || devices_to_schedule.count(node->device()) == 0) {
+      continue;
+    }
+    const bool is_large =
+        node->input_size() > 0 &&
+        scheduler.AllocatedBytes(node_index) >= min_scheduled_bytes;
+    if (!is_large) continue;
+
+    auto previous = previous_large_node.find(node->device());
+    if (previous != previous_large_node.end()) {
+      std::vector<int> predecessors;
+      for (int fanout : fanouts[previous->second]) {
+        if (position[fanout] < position[node_index]) {
+          predecessors.push_back(fanout);
+        }
+      }
+      if (predecessors.empty()) predecessors.push_back(previous->second);
+
+      absl::flat_hash_set<string> fanins;
+      for (const string& input : node->input()) {
+        fanins.insert(NodeName(input));
+      }
+      for (int predecessor : predecessors) {
+        const string& name = optimized_graph->node(predecessor).name();
+        if (!fanins.insert(name).second) continue;
+        node->add_input(AsControlDependency(name));
+        ++num_control_dependencies;
+      }
+    }
+    previous_large_node[node->device()] = node_index;
+  }
+
+  if (num_control_dependencies == 0) {
+    return errors::Aborted("Nothing to do.");
+  }
+  VLOG(1) << "Added " << num_control_dependencies
+          << " control dependencies to reduce peak memory usage";
+  return Status::OK();
+}
+
+void MemoryAwareScheduler::Feedback(Cluster* /*cluster*/,
+                                    const GrapplerItem& /*item*/,
+                                    const GraphDef& /*optimized_graph*/,
+                                    double /*result*/) {
+  // Nothing to do for MemoryAwareScheduler.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
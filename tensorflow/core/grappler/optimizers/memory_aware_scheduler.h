@@ -0,0 +1,108 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_AWARE_SCHEDULER_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_AWARE_SCHEDULER_H_
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Computes a sequential order of the nodes of a graph that keeps the amount of
+// live tensor memory low, and estimates the peak memory of a given order.
+// Tensor sizes come from statically inferred shapes; tensors with unknown
+// sizes are ignored.
+class PeakMemoryScheduler {
+ public:
+  // `graph` must be topologically sorted and must outlive the scheduler.
+  // Outputs of `nodes_to_preserve` are assumed to stay alive until the end of
+  // the step.
+  PeakMemoryScheduler(const GraphDef& graph,
+                      const GraphProperties& properties,
+                      const std::unordered_set<string>& nodes_to_preserve);
+
+  // Greedily schedules, among the nodes whose inputs are all available, the
+  // node that increases the amount of live memory the least. Returns the
+  // indices of the graph nodes in execution order.
+  Status ComputeSchedule(std::vector<int>* schedule) const;
+
+  // Returns the peak live memory per device when the nodes run one at a time
+  // in the given order.
+  std::unordered_map<string, int64> PeakMemoryUsage(
+      const std::vector<int>& schedule) const;
+
+  // Returns the number of bytes allocated for the outputs of the node.
+  int64 AllocatedBytes(int node) const;
+
+ private:
+  struct TensorInfo {
+    int producer;
+    int64 bytes;
+    // Distinct nodes that consume the tensor.
+    std::vector<int> consumers;
+    bool persistent;
+  };
+
+  // Returns the change in live memory caused by running `node`, given the
+  // number of pending consumers of each tensor.
+  int64 MemoryDelta(int node, const std::vector<int>& pending_consumers) const;
+
+  const GraphDef& graph_;
+  std::vector<TensorInfo> tensors_;
+  // Tensors read and produced by each node.
+  std::vector<std::vector<int>> node_inputs_;
+  std::vector<std::vector<int>> node_outputs_;
+  // Distinct data and control fanins and fanouts of each node.
+  std::vector<std::vector<int>> fanins_;
+  std::vector<std::vector<int>> fanouts_;
+};
+
+// Adds control dependencies that make the executor follow a peak memory
+// minimizing order on CPU devices. Only nodes that allocate large outputs are
+// constrained (every node with AGGRESSIVE), so small ops keep running in
+// parallel. The rewrite is applied on a device only if the computed order is
+// predicted to use less memory than the schedule estimated by GraphMemory.
+class MemoryAwareScheduler : public GraphOptimizer {
+ public:
+  explicit MemoryAwareScheduler(RewriterConfig::Toggle opt_level)
+      : opt_level_(opt_level) {}
+
+  ~MemoryAwareScheduler() override {}
+
+  string name() const override { return "memory_aware_scheduler"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override;
+
+ private:
+  RewriterConfig::Toggle opt_level_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_MEMORY_AWARE_SCHEDULER_H_
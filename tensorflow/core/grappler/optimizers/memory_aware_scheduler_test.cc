@@ -0,0 +1,180 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/memory_aware_scheduler.h"
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kCpu[] = "/job:localhost/replica:0/task:0/device:CPU:0";
+constexpr int kNumBranches = 4;
+
+class MemoryAwareSchedulerTest : public GrapplerTest {
+ protected:
+  // Builds `kNumBranches` independent branches that each produce a large
+  // temporary (Exp of the 1024x1024 input) and immediately reduce it to a
+  // scalar. Running all the Exp nodes first keeps every temporary alive at
+  // once.
+  GrapplerItem MakeBranchesItem() {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu);
+    auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({1024, 1024}));
+    auto axes = ops::Const(s.WithOpName("axes"), {0, 1}, {2});
+    std::vector<Output> sums;
+    for (int i = 0; i < kNumBranches; ++i) {
+      auto exp = ops::Exp(s.WithOpName(strings::StrCat("exp_", i)), x);
+      sums.push_back(
+          ops::Sum(s.WithOpName(strings::StrCat("sum_", i)), exp, axes));
+    }
+    auto total = ops::AddN(s.WithOpName("total"), sums);
+
+    GrapplerItem item;
+    item.fetch = {"total"};
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>(
+                           TensorShape({1024, 1024}))}};
+    return item;
+  }
+
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) return &node;
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(MemoryAwareSchedulerTest, ScheduleReducesPeakMemory) {
+  GrapplerItem item = MakeBranchesItem();
+  TF_ASSERT_OK(TopologicalSort(&item.graph));
+  GraphProperties properties(item);
+  TF_ASSERT_OK(properties.InferStatically(false, false, false));
+
+  PeakMemoryScheduler scheduler(item.graph, properties,
+                                item.NodesToPreserve());
+  std::vector<int> schedule;
+  TF_ASSERT_OK(scheduler.ComputeSchedule(&schedule));
+  ASSERT_EQ(schedule.size(), item.graph.node_size());
+
+  // Every Exp is immediately followed by the reduction that consumes it.
+  for (int i = 0; i + 1 < schedule.size(); ++i) {
+    const NodeDef& node = item.graph.node(schedule[i]);
+    if (IsExp(node)) {
+      EXPECT_EQ(item.graph.node(schedule[i + 1]).op(), "Sum");
+    }
+  }
+
+  constexpr int64 kTensorBytes = 1024 * 1024 * sizeof(float);
+  std::vector<int> original_order(item.graph.node_size());
+  for (int i = 0; i < original_order.size(); ++i) original_order[i] = i;
+  // The input and a single temporary are alive at the same time, instead of
+  // the input and all the temporaries.
+  EXPECT_LE(scheduler.PeakMemoryUsage(schedule).at(kCpu),
+            2 * kTensorBytes + 64);
+  EXPECT_GE(scheduler.PeakMemoryUsage(original_order).at(kCpu),
+            (1 + kNumBranches) * kTensorBytes);
+}
+
+TEST_F(MemoryAwareSchedulerTest, AddsControlDependencies) {
+  GrapplerItem item = MakeBranchesItem();
+
+  MemoryAwareScheduler optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // Each Exp except the first one waits for the reduction of the previous
+  // branch, which releases the previous temporary.
+  int num_constrained = 0;
+  for (int i = 0; i < kNumBranches; ++i) {
+    const NodeDef* exp = FindNode(output, strings::StrCat("exp_", i));
+    ASSERT_NE(exp, nullptr);
+    for (const string& input : exp->input()) {
+      if (!IsControlInput(input)) continue;
+      const NodeDef* predecessor = FindNode(output, NodeName(input));
+      ASSERT_NE(predecessor, nullptr);
+      EXPECT_EQ(predecessor->op(), "Sum");
+      ++num_constrained;
+    }
+  }
+  EXPECT_EQ(num_constrained, kNumBranches - 1);
+  // Small nodes are never constrained.
+  for (const NodeDef& node : output.node()) {
+    if (IsExp(node)) continue;
+    for (const string& input : node.input()) {
+      EXPECT_FALSE(IsControlInput(input)) << node.name();
+    }
+  }
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 1);
+  ASSERT_EQ(tensors.size(), 1);
+  test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-3);
+}
+
+TEST_F(MemoryAwareSchedulerTest, SmallNodesAreNotConstrained) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu);
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({16}));
+  auto a = ops::Exp(s.WithOpName("a"), x);
+  auto b = ops::Exp(s.WithOpName("b"), x);
+  auto total = ops::AddN(s.WithOpName("total"), {a, b});
+
+  GrapplerItem item;
+  item.fetch = {"total"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  MemoryAwareScheduler optimizer(RewriterConfig::ON);
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status));
+}
+
+TEST_F(MemoryAwareSchedulerTest, SkipControlFlow) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu);
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({1024, 1024}));
+  auto pred = ops::Placeholder(s.WithOpName("pred"), DT_BOOL,
+                               ops::Placeholder::Shape({}));
+  auto sw = ops::Switch(s.WithOpName("switch"), x, pred);
+  auto exp = ops::Exp(s.WithOpName("exp"), sw.output_true);
+  auto neg = ops::Neg(s.WithOpName("neg"), sw.output_false);
+  auto merge = ops::Merge(s.WithOpName("merge"), {exp, neg});
+
+  GrapplerItem item;
+  item.fetch = {"merge"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  MemoryAwareScheduler optimizer(RewriterConfig::AGGRESSIVE);
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  EXPECT_TRUE(errors::IsAborted(status));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
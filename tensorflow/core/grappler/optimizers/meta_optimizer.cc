@@ -35,12 +35,15 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
 #include "tensorflow/core/grappler/optimizers/debug_stripper.h"
 #include "tensorflow/core/grappler/optimizers/dependency_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/elementwise_fusion.h"
 #include "tensorflow/core/grappler/optimizers/function_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/generic_layout_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/implementation_selector.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/memory_aware_scheduler.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
 #include "tensorflow/core/grappler/optimizers/pin_to_host_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 #include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
@@ -51,7 +54,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/topological_sort.h"
 #include "tensorflow/core/grappler/utils/tpu.h"
 #include "tensorflow/core/grappler/verifiers/structure_verifier.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/util/dump_graph.h"
 #include "tensorflow/core/util/ptr_util.h"
@@ -127,6 +132,14 @@ uint64 DeadlineMicroSeconds(const RewriterConfig& cfg) {
   }
 }
 
+// Returns an error if `deadline_usec` has passed. Zero means no deadline.
+Status CheckDeadline(uint64 deadline_usec) {
+  if (deadline_usec > 0 && Env::Default()->NowMicros() > deadline_usec) {
+    return errors::DeadlineExceeded("meta_optimizer exceeded deadline.");
+  }
+  return Status::OK();
+}
+
 // A helper function to decide whether to enable the automatic mixed precision
 // optimizer.
 bool AutoMixedPrecisionEnabled(RewriterConfig::Toggle opt_level) {
@@ -191,6 +204,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
              cfg_.experimental_disable_compressed_tensor_optimization()));
   MK_OPT("shape", new ShapeOptimizer());
   MK_OPT("remap", new Remapper(cfg_.remapping()));
+  MK_OPT("elementwise_fusion",
+         new ElementwiseFusion(cfg_.elementwise_fusion()));
   MK_OPT("layout", new GenericLayoutOptimizer(
                        /*optimization level*/ cfg_.layout_optimizer(),
                        /*CPU layout conversion*/ cfg_.cpu_layout_conversion()));
@@ -199,6 +214,8 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
   MK_OPT("auto_mixed_precision_mkl",
          new AutoMixedPrecision(AutoMixedPrecisionMode::MKL));
   MK_OPT("memory", new MemoryOptimizer(RewriterConfig::MANUAL));
+  MK_OPT("memory_aware_scheduler",
+         new MemoryAwareScheduler(cfg_.memory_aware_scheduling()));
   MK_OPT("common_subgraph_elimination",
          new CommonSubgraphElimination(cfg_.common_subgraph_elimination()));
   MK_OPT("arithmetic", new ArithmeticOptimizer(cfg_.arithmetic_optimization()));
@@ -280,6 +297,11 @@ Status MetaOptimizer::InitializeOptimizers(
   if (cfg_.remapping() != RewriterConfig::OFF) {
     optimizers->push_back(MakeUnique<Remapper>(cfg_.remapping()));
   }
+  if (cfg_.elementwise_fusion() == RewriterConfig::ON ||
+      cfg_.elementwise_fusion() == RewriterConfig::AGGRESSIVE) {
+    optimizers->push_back(
+        MakeUnique<ElementwiseFusion>(cfg_.elementwise_fusion()));
+  }
   if (cfg_.loop_optimization() != RewriterConfig::OFF) {
     optimizers->push_back(
         MakeUnique<LoopOptimizer>(cfg_.loop_optimization(), cpu_device_));
@@ -309,6 +331,11 @@ Status MetaOptimizer::InitializeOptimizers(
     optimizers->push_back(MakeUnique<ScopedAllocatorOptimizer>(
         cfg_.scoped_allocator_optimization(), cfg_.scoped_allocator_opts()));
   }
+  if (cfg_.memory_aware_scheduling() == RewriterConfig::ON ||
+      cfg_.memory_aware_scheduling() == RewriterConfig::AGGRESSIVE) {
+    optimizers->push_back(
+        MakeUnique<MemoryAwareScheduler>(cfg_.memory_aware_scheduling()));
+  }
   return InitializeCustomGraphOptimizers(std::set<string>(), optimizers);
 }
 
@@ -400,8 +427,10 @@ void MetaOptimizer::InitializeVerifiers(
   }
 }
 
-Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
-                                    GraphDef* optimized_graph) {
+Status MetaOptimizer::OptimizeGraph(
+    Cluster* cluster, GrapplerItem&& item, GraphDef* optimized_graph,
+    uint64 deadline_usec,
+    std::vector<GraphOptimizationResult>* optimization_results) {
   int min_graph_nodes = cfg_.min_graph_nodes() == 0 ? kDefaultMinGraphNodes
                                                     : cfg_.min_graph_nodes();
   if (item.graph.node_size() < min_graph_nodes) {
@@ -454,6 +483,7 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
 
   GraphOptimizationResult optimization_result(item.id);
   GraphOptimizer* sa_optimizer = nullptr;
+  GraphOptimizer* mas_optimizer = nullptr;
 
   // Constants in the graph are normally compressed after model_pruner.
   // Do it here if model pruner is disabled.
@@ -479,7 +509,7 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
     }
 
     for (const auto& optimizer : optimizers) {
-      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+      TF_RETURN_IF_ERROR(CheckDeadline(deadline_usec));
       // Some optimizers can run only once.
       if (iteration > 0 && IsRunOnceOptimizer(optimizer->name())) continue;
       // Some must run only on the last iteration.
@@ -487,9 +517,14 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
         if (sa_optimizer == nullptr) sa_optimizer = optimizer.get();
         continue;
       }
+      if (optimizer->name() == "memory_aware_scheduler") {
+        if (mas_optimizer == nullptr) mas_optimizer = optimizer.get();
+        continue;
+      }
 
       TF_RETURN_IF_ERROR(RunOptimizer(optimizer.get(), cluster, &item,
-                                      optimized_graph, &optimization_result));
+                                      optimized_graph, deadline_usec,
+                                      &optimization_result));
 
       if (iteration == 0 && optimizer->name() == "model_pruner") {
         CompressConstants(optimized_graph);
@@ -519,11 +554,22 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
     }
   }
 
+  // MemoryAwareScheduler schedules the final graph, so it runs once after the
+  // main loop. The control dependencies it adds would otherwise constrain the
+  // next iteration of the other optimizers.
+  if (mas_optimizer != nullptr) {
+    TF_RETURN_IF_ERROR(RunOptimizer(mas_optimizer, cluster, &item,
+                                    optimized_graph, deadline_usec,
+                                    &optimization_result));
+    TF_RETURN_IF_ERROR(CheckDeadline(deadline_usec));
+  }
+
   // ScopedAllocatorOptimizer must run last.
   if (sa_optimizer != nullptr) {
     TF_RETURN_IF_ERROR(RunOptimizer(sa_optimizer, cluster, &item,
-                                    optimized_graph, &optimization_result));
-    GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+                                    optimized_graph, deadline_usec,
+                                    &optimization_result));
+    TF_RETURN_IF_ERROR(CheckDeadline(deadline_usec));
   }
 
   bool is_optimized = std::find_if(optimization_result.results.begin(),
@@ -533,7 +579,7 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
                                    }) != optimization_result.results.end();
 
   // Record graph optimization result.
-  optimization_results_.push_back(optimization_result);
+  optimization_results->push_back(optimization_result);
 
   if (is_optimized) {
     TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
@@ -550,7 +596,8 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
 
 Status MetaOptimizer::RunOptimizer(
     GraphOptimizer* optimizer, Cluster* cluster, GrapplerItem* optimized_item,
-    GraphDef* optimized_graph, GraphOptimizationResult* optimization_result) {
+    GraphDef* optimized_graph, uint64 deadline_usec,
+    GraphOptimizationResult* optimization_result) {
   const uint64 start_us = Env::Default()->NowMicros();
 
   // If optimizer doesn't need a function library, we will replace it with a
@@ -570,7 +617,7 @@ Status MetaOptimizer::RunOptimizer(
   // resets optimized_graph to an empty graph.
   optimized_graph->Swap(&optimized_item->graph);
   *optimized_graph = GraphDef();
-  optimizer->set_deadline_usec(this->deadline_usec());
+  optimizer->set_deadline_usec(deadline_usec);
   Status status =
       optimizer->Optimize(cluster, *optimized_item, optimized_graph);
   const uint64 end_us = Env::Default()->NowMicros();
@@ -622,6 +669,29 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   VLOG(1) << "Starting optimization for grappler item: " << item.id;
   optimization_results_.clear();
 
+  // Try to reuse a graph optimized by a previous run (possibly by another
+  // process) from the persistent cache.
+  std::unique_ptr<OptimizedGraphCache> cache;
+  string cache_key;
+  if (!cfg_.experimental_optimized_graph_cache_dir().empty()) {
+    cache = MakeUnique<OptimizedGraphCache>(
+        Env::Default(), cfg_.experimental_optimized_graph_cache_dir());
+    cache_key = OptimizedGraphCache::ComputeKey(item, config_proto_, cluster);
+    if (cache->Lookup(cache_key, optimized_graph)) {
+      VLOG(1) << "Loaded optimized graph for grappler item " << item.id
+              << " from cache: " << cache->EntryPath(cache_key);
+      GraphOptimizationResult optimization_result(item.id);
+      optimization_result.results.push_back(
+          {"optimized_graph_cache",
+           strings::StrCat("loaded from ", cache->EntryPath(cache_key)),
+           Status::OK()});
+      optimization_results_.push_back(optimization_result);
+      const uint64 end_us = Env::Default()->NowMicros();
+      metrics::UpdateGrapplerPassTime("*", end_us - start_us);
+      return Status::OK();
+    }
+  }
+
   // Constructs a FunctionLibraryDefinition with functions that are reachable
   // from the nodes of the graph.
   const auto minimized_flib =
@@ -723,12 +793,147 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
     find_xla_compiled_functions(function.node_def());
   }
 
+  // A function selected for optimization in a single pass over the library.
+  struct FunctionOptimizationTask {
+    const FunctionDef* func;
+    GrapplerFunctionItem func_item;
+    GraphDef optimized_func_graph;
+    std::vector<GraphOptimizationResult> optimization_results;
+    Status status;
+  };
+
+  const int num_threads =
+      cfg_.experimental_function_library_optimization_threads();
+  const int64 function_timeout_ms =
+      cfg_.experimental_function_optimization_timeout_ms();
+  const bool is_tpu_graph = IsTPUGraphDef(*optimized_graph);
+
+  // Optimizes a single function body. When functions are optimized in
+  // parallel, `flib` is not modified until all tasks in a pass are completed.
+  const auto optimize_function = [&](FunctionOptimizationTask* task) {
+    const FunctionDef& func = *task->func;
+    const string& func_name = func.signature().name();
+    GrapplerFunctionItem& func_item = task->func_item;
+    VLOG(3) << "Optimize function: function=" << func_name;
+
+    // Make a GrapplerItem from a FunctionDef.
+    task->status = MakeGrapplerFunctionItem(func, flib, producer, &func_item);
+    if (!task->status.ok()) return;
+
+    // If we need to compute the gradient of optimized function at runtime, we
+    // can't perform non-differentiable rewrites.
+    func_item.optimization_options().allow_non_differentiable_rewrites =
+        !differentiable_functions.contains(func_name);
+
+    // Device set available to the function is defined only by the runtime,
+    // when we instantiate and execute the function. We can't use all devices
+    // available to the main graph, because after partitioning the function
+    // call node might execute on a remote worker.
+    if (!func_item.devices().empty()) {
+      task->status =
+          errors::Internal("GrapplerFunctionItem devices must be empty.");
+      return;
+    }
+
+    // We are not allowed to prune certain types of ops from the graph
+    // instantiated by the function definition, because we must guarantee
+    // function execution semantics wrt side effects (see
+    // function_optimizer.cc).
+    func_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
+        false;
+
+    // Optimize function body graph.
+    if (is_tpu_graph) {
+      // Skip optimizing functions if this is a TPU graph. Currently, Grappler
+      // passes do not handle TPU functions correctly in a variety of ways
+      // (Note that due to the pre-placement TPU graph rewriting passes, the
+      // TPU-related ops are encapsulated away into functions). For example,
+      // TPU graphs contain TPUReplicateMetadata node that carries relevant
+      // TPU metadata and Grappler passes could prune that away. Grappler
+      // passes could also cause issues around shape inference. Since the
+      // desired and existing behavior is to not optimize TPU functions with
+      // Grappler, this check preserves that. The only exception is
+      // implementation selector what is required to swap in some TPU specific
+      // lowering code and is verified the work correctly on TPUs.
+      ImplementationSelector implementation_selector;
+
+      // Implementation selector needs to have access to valid function
+      // signature and attributes, and it doesn't need actual function body.
+      FunctionDefLibrary func_item_function_library;
+      func_item_function_library.Swap(func_item.graph.mutable_library());
+      *func_item.graph.mutable_library() =
+          GetFunctionDefLibraryStub(func_item_function_library);
+
+      task->status = implementation_selector.Optimize(
+          cluster, func_item, &task->optimized_func_graph);
+    } else {
+      // Each function gets its own time budget, bounded by the deadline of
+      // the whole meta optimizer.
+      uint64 func_deadline_usec = deadline_usec();
+      if (function_timeout_ms > 0) {
+        const uint64 budget_deadline_usec =
+            Env::Default()->NowMicros() + function_timeout_ms * 1000;
+        if (func_deadline_usec == 0 ||
+            budget_deadline_usec < func_deadline_usec) {
+          func_deadline_usec = budget_deadline_usec;
+        }
+      }
+      GrapplerFunctionItem func_item_copy = func_item;
+      task->status = OptimizeGraph(
+          cluster, std::move(func_item_copy), &task->optimized_func_graph,
+          func_deadline_usec, &task->optimization_results);
+    }
+  };
+
+  // Adds an optimized function body (and all functions specialized while
+  // optimizing it) to the library.
+  const auto commit_function = [&](FunctionOptimizationTask* task) -> Status {
+    const string& func_name = task->func->signature().name();
+    optimization_results_.insert(
+        optimization_results_.end(),
+        std::make_move_iterator(task->optimization_results.begin()),
+        std::make_move_iterator(task->optimization_results.end()));
+
+    if (errors::IsDeadlineExceeded(task->status) && !DeadlineExceeded()) {
+      // Function ran out of its own time budget: keep the original body.
+      LOG(WARNING) << "Function " << func_name << " was not optimized: "
+                   << task->status;
+      return Status::OK();
+    }
+    TF_RETURN_IF_ERROR(task->status);
+
+    // Function body optimization might have created new specialized
+    // functions for each instantiation context. Add them to the library.
+    for (const FunctionDef& func_def :
+         task->optimized_func_graph.library().function()) {
+      if (flib.Find(func_def.signature().name()) == nullptr) {
+        TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
+      }
+    }
+
+    // Convert optimized graph back to FunctionDef.
+    FunctionDef optimized_func;
+    task->func_item.SwapFunctionBody(std::move(task->optimized_func_graph));
+    TF_RETURN_IF_ERROR(MakeFunctionDef(task->func_item, flib, &optimized_func));
+
+    // Replace optimized function with a new FunctionDef.
+    return flib.ReplaceFunction(func_name, optimized_func);
+  };
+
+  std::unique_ptr<thread::ThreadPool> thread_pool;
+  if (num_threads > 1) {
+    thread_pool = MakeUnique<thread::ThreadPool>(
+        Env::Default(), "meta_optimizer_function_library", num_threads);
+  }
+
   // Optimize each function only once.
   absl::flat_hash_set<string> optimized_funcs;
   while (optimize_function_library) {
     optimize_function_library = false;
 
-    int function_idx = 0;
+    // Tasks are stored in the library order, and committed in the same order
+    // after optimization, so the result does not depend on thread scheduling.
+    std::vector<FunctionOptimizationTask> tasks;
     for (const FunctionDef& func : optimized_graph->library().function()) {
       GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
 
@@ -750,87 +955,39 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       // Skip tf.data functions as they are optimized by tf.data meta optimizer.
       if (IsTFDataFunction(func)) continue;
 
-      VLOG(3) << "Optimize function: function=" << func_name << " ["
-              << function_idx++ << " of "
-              << optimized_graph->library().function_size() << "]";
-
       // Function optimization might specialize nested function calls, so we
       // have to reset the flag and do at least one more pass over the library.
       optimize_function_library = true;
       optimized_funcs.insert(func_name);
 
-      // Make a GrapplerItem from a FunctionDef.
-      GrapplerFunctionItem func_item;
-      TF_RETURN_IF_ERROR(
-          MakeGrapplerFunctionItem(func, flib, producer, &func_item));
-
-      // If we need to compute the gradient of optimized function at runtime, we
-      // can't perform non-differentiable rewrites.
-      func_item.optimization_options().allow_non_differentiable_rewrites =
-          !differentiable_functions.contains(func_name);
-
-      // Device set available to the function is defined only by the runtime,
-      // when we instantiate and execute the function. We can't use all devices
-      // available to the main graph, because after partitioning the function
-      // call node might execute on a remote worker.
-      if (!func_item.devices().empty()) {
-        return errors::Internal("GrapplerFunctionItem devices must be empty.");
-      }
+      tasks.emplace_back();
+      tasks.back().func = &func;
+    }
 
-      // We are not allowed to prune certain types of ops from the graph
-      // instantiated by the function definition, because we must guarantee
-      // function execution semantics wrt side effects (see
-      // function_optimizer.cc).
-      func_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
-          false;
-
-      // Optimize function body graph.
-      GraphDef optimized_func_graph;
-      if (IsTPUGraphDef(*optimized_graph)) {
-        // Skip optimizing functions if this is a TPU graph. Currently, Grappler
-        // passes do not handle TPU functions correctly in a variety of ways
-        // (Note that due to the pre-placement TPU graph rewriting passes, the
-        // TPU-related ops are encapsulated away into functions). For example,
-        // TPU graphs contain TPUReplicateMetadata node that carries relevant
-        // TPU metadata and Grappler passes could prune that away. Grappler
-        // passes could also cause issues around shape inference. Since the
-        // desired and existing behavior is to not optimize TPU functions with
-        // Grappler, this check preserves that. The only exception is
-        // implementation selector what is required to swap in some TPU specific
-        // lowering code and is verified the work correctly on TPUs.
-        ImplementationSelector implementation_selector;
-
-        // Implementation selector needs to have access to valid function
-        // signature and attributes, and it doesn't need actual function body.
-        FunctionDefLibrary func_item_function_library;
-        func_item_function_library.Swap(func_item.graph.mutable_library());
-        *func_item.graph.mutable_library() =
-            GetFunctionDefLibraryStub(func_item_function_library);
-
-        TF_RETURN_IF_ERROR(implementation_selector.Optimize(
-            cluster, func_item, &optimized_func_graph));
-      } else {
-        GrapplerFunctionItem func_item_copy = func_item;
-        TF_RETURN_IF_ERROR(OptimizeGraph(cluster, std::move(func_item_copy),
-                                         &optimized_func_graph));
-      }
+    VLOG(3) << "Optimize " << tasks.size() << " functions using "
+            << std::max(num_threads, 1) << " threads";
 
-      // Function body optimization might have created new specialized
-      // functions for each instantiation context. Add them to the library.
-      for (const FunctionDef& func_def :
-           optimized_func_graph.library().function()) {
-        if (flib.Find(func_def.signature().name()) == nullptr) {
-          TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
-        }
+    if (thread_pool == nullptr) {
+      // Optimize functions one by one, so that each function sees already
+      // optimized bodies of the functions optimized before it.
+      for (FunctionOptimizationTask& task : tasks) {
+        GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+        optimize_function(&task);
+        TF_RETURN_IF_ERROR(commit_function(&task));
+      }
+    } else {
+      BlockingCounter counter(tasks.size());
+      for (FunctionOptimizationTask& task : tasks) {
+        thread_pool->Schedule([&optimize_function, &task, &counter]() {
+          optimize_function(&task);
+          counter.DecrementCount();
+        });
+      }
+      counter.Wait();
+      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+      for (FunctionOptimizationTask& task : tasks) {
+        TF_RETURN_IF_ERROR(commit_function(&task));
       }
-
-      // Convert optimized graph back to FunctionDef.
-      FunctionDef optimized_func;
-      func_item.SwapFunctionBody(std::move(optimized_func_graph));
-      TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
-
-      // Replace optimized function with a new FunctionDef.
-      TF_RETURN_IF_ERROR(flib.ReplaceFunction(func_name, optimized_func));
     }
 
     // If optimized at least one function, update the graph library.
@@ -849,6 +1006,23 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
         *optimized_graph);
   }
 
+  // Do not cache graphs if any of the optimizers failed (e.g. timed out), so
+  // that the next run gets a chance to fully optimize the graph.
+  if (cache != nullptr) {
+    bool all_optimizers_succeeded = true;
+    for (const GraphOptimizationResult& graph_result : optimization_results_) {
+      for (const OptimizerResult& result : graph_result.results) {
+        all_optimizers_succeeded &= result.status.ok();
+      }
+    }
+    if (all_optimizers_succeeded) {
+      Status status = cache->Insert(cache_key, *optimized_graph);
+      if (!status.ok()) {
+        LOG(WARNING) << "Failed to store optimized graph in cache: " << status;
+      }
+    }
+  }
+
   const uint64 end_us = Env::Default()->NowMicros();
   metrics::UpdateGrapplerPassTime("*", end_us - start_us);
 
@@ -891,6 +1065,10 @@ bool MetaOptimizerEnabled(const ConfigProto& cfg) {
          rewrite_cfg.debug_stripper() == RewriterConfig::ON ||
          rewrite_cfg.scoped_allocator_optimization() == RewriterConfig::ON ||
          rewrite_cfg.pin_to_host_optimization() == RewriterConfig::ON ||
+         rewrite_cfg.elementwise_fusion() == RewriterConfig::ON ||
+         rewrite_cfg.elementwise_fusion() == RewriterConfig::AGGRESSIVE ||
+         rewrite_cfg.memory_aware_scheduling() == RewriterConfig::ON ||
+         rewrite_cfg.memory_aware_scheduling() == RewriterConfig::AGGRESSIVE ||
          AutoMixedPrecisionEnabled(rewrite_cfg.auto_mixed_precision()) ||
          AutoMixedPrecisionEnabled(rewrite_cfg.auto_mixed_precision_mkl()) ||
          !rewrite_cfg.optimizers().empty() ||
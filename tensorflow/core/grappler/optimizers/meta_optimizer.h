@@ -83,15 +83,6 @@ class MetaOptimizer : public GraphOptimizer {
       std::vector<std::unique_ptr<GraphVerifier>>* post_optimization_verifiers)
       const;
 
-  // Run optimization pass over a single GrapplerItem. Meta optimizer might run
-  // multiple such passes: 1) for the main graph 2) for the function library
-  Status OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
-                       GraphDef* optimized_graph);
-
-  DeviceBase* const cpu_device_;  // may be NULL
-  ConfigProto config_proto_;
-  RewriterConfig& cfg_;
-
   struct OptimizerResult {
     string optimizer_name;
     string message;
@@ -104,8 +95,29 @@ class MetaOptimizer : public GraphOptimizer {
     std::vector<OptimizerResult> results;
   };
 
+  // Run optimization pass over a single GrapplerItem. Meta optimizer might run
+  // multiple such passes: 1) for the main graph 2) for the function library
+  Status OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
+                       GraphDef* optimized_graph) {
+    return OptimizeGraph(cluster, std::move(item), optimized_graph,
+                         deadline_usec(), &optimization_results_);
+  }
+
+  // Same as above, but stops at `deadline_usec` (zero means no deadline) and
+  // records optimizer results into `optimization_results`. Does not mutate the
+  // meta optimizer state, and can be called concurrently for different items.
+  Status OptimizeGraph(
+      Cluster* cluster, GrapplerItem&& item, GraphDef* optimized_graph,
+      uint64 deadline_usec,
+      std::vector<GraphOptimizationResult>* optimization_results);
+
+  DeviceBase* const cpu_device_;  // may be NULL
+  ConfigProto config_proto_;
+  RewriterConfig& cfg_;
+
   Status RunOptimizer(GraphOptimizer* optimizer, Cluster* cluster,
                       GrapplerItem* optimized_item, GraphDef* optimized_graph,
+                      uint64 deadline_usec,
                       GraphOptimizationResult* optimization_result);
 
   std::vector<GraphOptimizationResult> optimization_results_;
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
 
 #include "absl/strings/match.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/function_testlib.h"
@@ -29,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/config.pb.h"
@@ -214,6 +216,69 @@ TEST_F(MetaOptimizerTest, RunOptimizersTwice) {
   TF_EXPECT_OK(status);
 }
 
+TEST_F(MetaOptimizerTest, RunsMemoryAwareSchedulerOnce) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_memory_aware_scheduling(RewriterConfig::ON);
+  rewriter_config.set_meta_optimizer_iterations(RewriterConfig::TWO);
+  rewriter_config.set_min_graph_nodes(-1);
+
+  MetaOptimizer optimizer(nullptr, config_proto);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The scheduler runs once, after every iteration of the main loop.
+  const std::vector<string> lines =
+      absl::StrSplit(optimizer.GetResultString(), '\n');
+  int num_runs = 0;
+  for (int i = 0; i < lines.size(); ++i) {
+    if (!absl::StrContains(lines[i], "memory_aware_scheduler:")) continue;
+    ++num_runs;
+    // Only the last-pass optimizers can follow it.
+    for (int j = i + 1; j < lines.size(); ++j) {
+      if (lines[j].empty()) continue;
+      EXPECT_TRUE(absl::StrContains(lines[j], "scoped_allocator_optimizer:"))
+          << lines[j];
+    }
+  }
+  EXPECT_EQ(num_runs, 1);
+}
+
+TEST_F(MetaOptimizerTest, ReusesOptimizedGraphFromCache) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_experimental_optimized_graph_cache_dir(
+      io::JoinPath(testing::TmpDir(),
+                   strings::StrCat("meta_optimizer_cache_",
+                                   Env::Default()->NowMicros())));
+
+  MetaOptimizer optimizer(nullptr, config_proto);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_FALSE(
+      absl::StrContains(optimizer.GetResultString(), "optimized_graph_cache"));
+
+  // A new meta optimizer must load the graph from the cache instead of running
+  // the optimizers again.
+  MetaOptimizer cached_optimizer(nullptr, config_proto);
+  GraphDef cached_output;
+  TF_EXPECT_OK(cached_optimizer.Optimize(nullptr, item, &cached_output));
+  EXPECT_TRUE(absl::StrContains(cached_optimizer.GetResultString(),
+                                "optimized_graph_cache"));
+  CompareGraphs(output, cached_output);
+}
+
 TEST_F(MetaOptimizerTest, RunToggleOptimizersAndCustomGraphOptimizerTwice) {
   TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
   GrapplerItem item;
@@ -682,6 +747,81 @@ TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryWithRestrictions) {
       optimization_options_my_mul_2->allow_non_differentiable_rewrites);
 }
 
+// Returns a graph that calls `num_functions` distinct non-inlinable functions.
+GrapplerItem MakeItemWithFunctions(int num_functions) {
+  using test::function::NDef;
+
+  std::vector<NodeDef> nodes = {
+      NDef("x", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice)};
+  std::vector<FunctionDef> functions;
+  GrapplerItem item;
+  item.id = "tf_graph";
+  for (int i = 0; i < num_functions; ++i) {
+    const string func_name = strings::StrCat("MyFunc", i);
+    FunctionDef func = FunctionDefHelper::Create(
+        func_name, {"x:float"}, {"z:float"}, {},
+        {FunctionDefHelper::Const("one", 1.0f),
+         FunctionDefHelper::Const("two", 2.0f),
+         {{"scale"}, "Mul", {"one:output:0", "two:output:0"},
+          {{"T", DT_FLOAT}}},
+         {{"mul"}, "Mul", {"x", "scale:z:0"}, {{"T", DT_FLOAT}}},
+         {{"add"}, "Add", {"mul:z:0", "x"}, {{"T", DT_FLOAT}}}},
+        /*ret_def=*/
+        {{"z", "add:z:0"}});
+    (*func.mutable_attr())["_noinline"].set_b(true);
+    functions.push_back(std::move(func));
+
+    const string call_name = strings::StrCat("call", i);
+    nodes.push_back(NDef(call_name, func_name, {"x"}, {}, kDevice));
+    item.fetch.push_back(call_name);
+  }
+  item.graph = test::function::GDef(nodes, functions);
+  return item;
+}
+
+// Returns function definitions of the graph library keyed by function name.
+std::map<string, string> FunctionsByName(const GraphDef& graph) {
+  std::map<string, string> functions;
+  for (const FunctionDef& func : graph.library().function()) {
+    functions[func.signature().name()] = func.DebugString();
+  }
+  return functions;
+}
+
+TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryInParallel) {
+  GrapplerItem item = MakeItemWithFunctions(32);
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_min_graph_nodes(-1);
+
+  MetaOptimizer sequential_optimizer(nullptr, config_proto);
+  GraphDef sequential_output;
+  TF_EXPECT_OK(
+      sequential_optimizer.Optimize(nullptr, item, &sequential_output));
+
+  rewriter_config.set_experimental_function_library_optimization_threads(4);
+  for (int i = 0; i < 3; ++i) {
+    MetaOptimizer parallel_optimizer(nullptr, config_proto);
+    GraphDef parallel_output;
+    TF_EXPECT_OK(parallel_optimizer.Optimize(nullptr, item, &parallel_output));
+
+    // Functions do not call each other, so the result must be identical to the
+    // sequential optimization regardless of the thread scheduling.
+    CompareGraphs(sequential_output, parallel_output);
+    EXPECT_EQ(FunctionsByName(sequential_output),
+              FunctionsByName(parallel_output));
+  }
+
+  // Constant subexpression in every function body must be folded.
+  for (const FunctionDef& func : sequential_output.library().function()) {
+    for (const NodeDef& node : func.node_def()) {
+      if (node.name() == "scale") EXPECT_EQ(node.op(), "Const");
+    }
+  }
+}
+
 class SleepingOptimizer : public CustomGraphOptimizer {
  public:
   SleepingOptimizer() {}
@@ -774,6 +914,33 @@ TEST_F(MetaOptimizerTest, OptimizerDoesNotTimeOut) {
   EXPECT_EQ(original_node_size + 2, output.node_size());
 }
 
+TEST_F(MetaOptimizerTest, FunctionOptimizationTimesOut) {
+  GrapplerItem item = MakeItemWithFunctions(2);
+
+  ConfigProto config;
+  RewriterConfig& rewriter_config =
+      *config.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.add_optimizers("SleepingOptimizer");
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_meta_optimizer_timeout_ms(-1);
+  rewriter_config.set_experimental_function_optimization_timeout_ms(500);
+  rewriter_config.set_meta_optimizer_iterations(RewriterConfig::ONE);
+
+  GraphDef output;
+  const GraphDef original = item.graph;
+  const Status status =
+      RunMetaOptimizer(std::move(item), config, nullptr, nullptr, &output);
+  TF_EXPECT_OK(status);
+  // The main graph has no time budget and must be optimized.
+  EXPECT_EQ(original.node_size() + 1, output.node_size());
+  // Functions ran out of their time budget and must be left unchanged.
+  const int original_func_size = original.library().function(0).node_def_size();
+  ASSERT_EQ(output.library().function_size(), 2);
+  for (const FunctionDef& func : output.library().function()) {
+    EXPECT_EQ(func.node_def_size(), original_func_size);
+  }
+}
+
 TEST_F(MetaOptimizerTest, RunPostOptimizationVerifiersOnValidGraph) {
   TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
   GrapplerItem item;
@@ -1016,6 +1183,35 @@ TEST_F(MetaOptimizerTest, CompressConstants) {
   }
 }
 
+static void BM_OptimizeFunctionLibrary(int iters, int num_functions,
+                                       int num_threads) {
+  testing::StopTiming();
+  const GrapplerItem item = MakeItemWithFunctions(num_functions);
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_experimental_function_library_optimization_threads(
+      num_threads);
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    MetaOptimizer optimizer(nullptr, config_proto);
+    GraphDef output;
+    TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+  }
+  testing::StopTiming();
+}
+
+BENCHMARK(BM_OptimizeFunctionLibrary)
+    ->ArgPair(100, 1)
+    ->ArgPair(100, 4)
+    ->ArgPair(100, 16)
+    ->ArgPair(500, 1)
+    ->ArgPair(500, 4)
+    ->ArgPair(500, 16);
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
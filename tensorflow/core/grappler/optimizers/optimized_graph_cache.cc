@@ -0,0 +1,168 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+constexpr char kCacheEntrySuffix[] = ".graph_def.pb";
+
+// Appends a length-prefixed field to the key material, so that adjacent
+// fields can't be confused with each other.
+void AppendField(absl::string_view field, string* key_material) {
+  absl::StrAppend(key_material, field.size(), ":", field, ";");
+}
+
+void AppendProto(const protobuf::MessageLite& proto, string* key_material) {
+  string serialized;
+  SerializeToStringDeterministic(proto, &serialized);
+  AppendField(serialized, key_material);
+}
+
+void AppendSorted(std::vector<string> values, string* key_material) {
+  std::sort(values.begin(), values.end());
+  AppendField(absl::StrCat(values.size()), key_material);
+  for (const string& value : values) AppendField(value, key_material);
+}
+
+}  // namespace
+
+string OptimizedGraphCache::ComputeKey(const GrapplerItem& item,
+                                       const ConfigProto& config_proto,
+                                       const Cluster* cluster) {
+  string key_material;
+
+  // Optimized graphs produced by a different TensorFlow version can't be
+  // reused, because optimizers and op definitions might have changed.
+  AppendField(TF_VERSION_STRING, &key_material);
+  AppendField(absl::StrCat(TF_GRAPH_DEF_VERSION), &key_material);
+
+  // Grappler item.
+  AppendProto(item.graph, &key_material);
+  std::vector<string> feeds;
+  feeds.reserve(item.feed.size());
+  for (const auto& feed : item.feed) {
+    feeds.push_back(absl::StrCat(feed.first, "/",
+                                 DataTypeString(feed.second.dtype()), "/",
+                                 feed.second.shape().DebugString()));
+  }
+  AppendSorted(std::move(feeds), &key_material);
+  AppendSorted(item.fetch, &key_material);
+  AppendSorted(item.keep_ops, &key_material);
+  AppendSorted(item.init_ops, &key_material);
+  AppendField(item.save_op, &key_material);
+  AppendField(item.restore_op, &key_material);
+  AppendField(item.save_restore_loc_tensor, &key_material);
+  AppendField(absl::StrCat(item.queue_runners.size()), &key_material);
+  for (const QueueRunnerDef& queue_runner : item.queue_runners) {
+    AppendProto(queue_runner, &key_material);
+  }
+  // Optimizers must not prune these nodes, so items that preserve different
+  // nodes can't share an optimized graph.
+  const std::unordered_set<string> nodes_to_preserve = item.NodesToPreserve();
+  AppendSorted(std::vector<string>(nodes_to_preserve.begin(),
+                                   nodes_to_preserve.end()),
+               &key_material);
+  AppendSorted(
+      std::vector<string>(item.devices().begin(), item.devices().end()),
+      &key_material);
+
+  const GrapplerItem::OptimizationOptions& opts = item.optimization_options();
+  AppendField(absl::StrCat(opts.allow_non_differentiable_rewrites,
+                           opts.allow_pruning_stateful_and_dataset_ops,
+                           opts.optimize_function_library, opts.is_eager_mode),
+              &key_material);
+
+  // Grappler configuration.
+  AppendProto(config_proto.graph_options().rewrite_options(), &key_material);
+  AppendField(config_proto.experimental().executor_type(), &key_material);
+  AppendField(
+      absl::StrCat(
+          config_proto.graph_options().optimizer_options().global_jit_level()),
+      &key_material);
+
+  // Cluster devices and their properties.
+  if (cluster != nullptr) {
+    std::vector<string> devices;
+    for (const auto& device : cluster->GetDevices()) {
+      string properties;
+      SerializeToStringDeterministic(device.second, &properties);
+      devices.push_back(absl::StrCat(device.first, "/", properties));
+    }
+    AppendSorted(std::move(devices), &key_material);
+  }
+
+  const Fprint128 fingerprint = Fingerprint128(key_material);
+  return absl::StrCat(absl::Hex(fingerprint.high64, absl::kZeroPad16),
+                      absl::Hex(fingerprint.low64, absl::kZeroPad16));
+}
+
+string OptimizedGraphCache::EntryPath(const string& key) const {
+  return io::JoinPath(cache_dir_, absl::StrCat(key, kCacheEntrySuffix));
+}
+
+bool OptimizedGraphCache::Lookup(const string& key,
+                                 GraphDef* optimized_graph) const {
+  const string path = EntryPath(key);
+  if (!env_->FileExists(path).ok()) return false;
+
+  GraphDef cached_graph;
+  Status status = ReadBinaryProto(env_, path, &cached_graph);
+  if (!status.ok()) {
+    LOG(WARNING) << "Ignoring unreadable optimized graph cache entry " << path
+                 << ": " << status;
+    return false;
+  }
+
+  optimized_graph->Swap(&cached_graph);
+  return true;
+}
+
+Status OptimizedGraphCache::Insert(const string& key,
+                                   const GraphDef& optimized_graph) const {
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(cache_dir_));
+
+  // Write to a unique temporary file first and then atomically move it into
+  // place, so that concurrent readers never observe a partially written entry.
+  const string path = EntryPath(key);
+  string tmp_path = path;
+  if (!env_->CreateUniqueFileName(&tmp_path, ".tmp")) {
+    return errors::Internal("Failed to create a temporary file name for ",
+                            path);
+  }
+  TF_RETURN_IF_ERROR(WriteBinaryProto(env_, tmp_path, optimized_graph));
+
+  Status status = env_->RenameFile(tmp_path, path);
+  if (!status.ok()) {
+    env_->DeleteFile(tmp_path).IgnoreError();
+  }
+  return status;
+}
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,67 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// A persistent on-disk cache of graphs produced by the MetaOptimizer.
+//
+// Each entry is a binary serialized GraphDef stored in `cache_dir` under a
+// file name derived from a fingerprint of everything that can affect the
+// result of the optimization: the input graph (including its function
+// library), feeds, fetches, nodes to preserve, the available devices, the
+// grappler configuration, and the TensorFlow version. Entries are written
+// atomically (write to a temporary file, then rename), so multiple processes
+// can safely share the same cache directory.
+class OptimizedGraphCache {
+ public:
+  OptimizedGraphCache(Env* env, const string& cache_dir)
+      : env_(env), cache_dir_(cache_dir) {}
+
+  // Computes a cache key for optimizing `item` with `config_proto` on
+  // `cluster` (may be NULL).
+  static string ComputeKey(const GrapplerItem& item,
+                           const ConfigProto& config_proto,
+                           const Cluster* cluster);
+
+  // Returns true and fills `optimized_graph` if an entry for `key` exists and
+  // is readable. Corrupted entries are ignored and treated as a cache miss.
+  bool Lookup(const string& key, GraphDef* optimized_graph) const;
+
+  // Stores `optimized_graph` under `key`, overwriting any existing entry.
+  Status Insert(const string& key, const GraphDef& optimized_graph) const;
+
+  // Returns the path of the file storing the entry for `key`.
+  string EntryPath(const string& key) const;
+
+ private:
+  Env* const env_;
+  const string cache_dir_;
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
@@ -0,0 +1,109 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class OptimizedGraphCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+    ASSERT_TRUE(fake_input.NextItem(&item_));
+    cache_dir_ = io::JoinPath(testing::TmpDir(), "optimized_graph_cache");
+  }
+
+  GrapplerItem item_;
+  string cache_dir_;
+};
+
+TEST_F(OptimizedGraphCacheTest, KeyIsStable) {
+  ConfigProto config;
+  EXPECT_EQ(OptimizedGraphCache::ComputeKey(item_, config, nullptr),
+            OptimizedGraphCache::ComputeKey(item_, config, nullptr));
+}
+
+TEST_F(OptimizedGraphCacheTest, KeyDependsOnGraphAndConfig) {
+  ConfigProto config;
+  const string key = OptimizedGraphCache::ComputeKey(item_, config, nullptr);
+
+  GrapplerItem modified_item = item_;
+  modified_item.graph.mutable_node(0)->set_name("renamed");
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(modified_item, config,
+                                                 /*cluster=*/nullptr));
+
+  GrapplerItem modified_fetch = item_;
+  modified_fetch.fetch.push_back("extra_fetch");
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(modified_fetch, config,
+                                                 /*cluster=*/nullptr));
+
+  GrapplerItem modified_save_op = item_;
+  modified_save_op.save_op = "save/control_dependency";
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(modified_save_op, config,
+                                                 /*cluster=*/nullptr));
+
+  GrapplerItem modified_queue_runners = item_;
+  modified_queue_runners.queue_runners.emplace_back();
+  modified_queue_runners.queue_runners.back().add_enqueue_op_name("enqueue");
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(modified_queue_runners,
+                                                 config, /*cluster=*/nullptr));
+
+  ConfigProto modified_config;
+  modified_config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_constant_folding(RewriterConfig::OFF);
+  EXPECT_NE(key, OptimizedGraphCache::ComputeKey(item_, modified_config,
+                                                 /*cluster=*/nullptr));
+}
+
+TEST_F(OptimizedGraphCacheTest, InsertAndLookup) {
+  OptimizedGraphCache cache(Env::Default(), cache_dir_);
+  const string key = OptimizedGraphCache::ComputeKey(item_, ConfigProto(),
+                                                     /*cluster=*/nullptr);
+
+  GraphDef output;
+  EXPECT_FALSE(cache.Lookup("missing_key", &output));
+
+  TF_ASSERT_OK(cache.Insert(key, item_.graph));
+  ASSERT_TRUE(cache.Lookup(key, &output));
+  EXPECT_EQ(output.DebugString(), item_.graph.DebugString());
+
+  // Overwriting an existing entry is allowed.
+  GraphDef empty_graph;
+  TF_ASSERT_OK(cache.Insert(key, empty_graph));
+  ASSERT_TRUE(cache.Lookup(key, &output));
+  EXPECT_EQ(output.node_size(), 0);
+}
+
+TEST_F(OptimizedGraphCacheTest, IgnoresCorruptedEntries) {
+  OptimizedGraphCache cache(Env::Default(), cache_dir_);
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(cache_dir_));
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), cache.EntryPath("corrupted"),
+                                 "not a graph def"));
+  GraphDef output;
+  EXPECT_FALSE(cache.Lookup("corrupted", &output));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/shape_optimizer.h"
 
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
@@ -65,14 +66,19 @@ Status ShapeOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
     return errors::Aborted("Nothing to do.");
   }
 
-  *optimized_graph = item.graph;
-  GraphProperties properties(item);
+  GrapplerItem optimized_item = item.WithGraph(GraphDef(item.graph));
+  GraphDef* graph_def = &optimized_item.graph;
+  GraphProperties properties(optimized_item);
+  // The Size nodes created by the first rewrite are candidates for the second
+  // one, so their shapes are inferred incrementally in between.
+  properties.set_incremental_updates(true);
   bool inferred_properties = false;
+  absl::flat_hash_set<string> updated_nodes;
   {
-    MutableGraphView graph(optimized_graph);
+    MutableGraphView graph(graph_def);
     // The product of all the dimensions in a tensor shape can be expressed more
     // simply as the size of the tensor.
-    for (auto& node : *optimized_graph->mutable_node()) {
+    for (auto& node : *graph_def->mutable_node()) {
       if (!IsShape(node)) {
         continue;
       }
@@ -134,13 +140,17 @@ Status ShapeOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
           }
 
           fanout.node->Swap(&size_node);
+          updated_nodes.insert(fanout.node->name());
         }
       }
     }
   }
   {
-    MutableGraphView graph(optimized_graph);
-    for (auto& node : *optimized_graph->mutable_node()) {
+    MutableGraphView graph(graph_def);
+    if (inferred_properties && !updated_nodes.empty()) {
+      TF_RETURN_IF_ERROR(properties.UpdateStatically(graph, updated_nodes));
+    }
+    for (auto& node : *graph_def->mutable_node()) {
       // Try to convert the ratio of 2 symbolic tensor sizes into a constant.
       // This is possible whenever the symbolic dimensions in the numerator and
       // denominator cancel each other.
@@ -189,6 +199,7 @@ Status ShapeOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       }
     }
   }
+  optimized_graph->Swap(graph_def);
   return Status::OK();
 }
 
@@ -161,6 +161,47 @@ TEST_F(ShapeOptimizerTest, OptimizeShapeRatio) {
               tensors_actual[0].scalar<int>()(), 0);
 }
 
+TEST_F(ShapeOptimizerTest, OptimizeRatioOfShapeProducts) {
+  // The ratio can only be simplified once the products of the shapes have
+  // been rewritten as sizes.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice("/cpu:0");
+  Output a = ops::Const(s.WithOpName("a"), 3.14f, {32, 32});
+  Output b = ops::Const(s.WithOpName("b"), 3.14f, {32, 16});
+  Output c = ops::Shape(s.WithOpName("c"), a);
+  Output d = ops::Shape(s.WithOpName("d"), b);
+  Output i = ops::Const(s.WithOpName("i"), 0, {1});
+  ops::ReduceProd::Attrs attrs;
+  Output e = ops::ReduceProd(s.WithOpName("e"), c, i, attrs.KeepDims(false));
+  Output f = ops::ReduceProd(s.WithOpName("f"), d, i, attrs.KeepDims(false));
+  Output g = ops::Div(s.WithOpName("g"), e, f);
+
+  GrapplerItem item;
+  item.fetch = {"g"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+
+  GraphDef output;
+  ShapeOptimizer optimizer;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "e" || node.name() == "f") {
+      found++;
+      EXPECT_EQ("Size", node.op());
+    } else if (node.name() == "g") {
+      found++;
+      EXPECT_EQ("Const", node.op());
+    }
+  }
+  EXPECT_EQ(3, found);
+
+  auto tensors_actual = EvaluateNodes(output, item.fetch);
+  EXPECT_NEAR(tensors_expected[0].scalar<int>()(),
+              tensors_actual[0].scalar<int>()(), 0);
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -70,19 +70,23 @@ class BatchResource : public serving::BatchResourceBase {
                        const std::vector<int32>& allowed_batch_sizes,
                        FunctionLibraryRuntime::Handle fhandle,
                        bool enable_large_batch_splitting,
+                       int64 target_latency_micros,
+                       bool enable_ragged_batching,
+                       const std::vector<int32>& ragged_output_indices,
                        std::unique_ptr<BatchResource>* resource) {
     BatcherT::Options batcher_options;
     batcher_options.num_batch_threads = num_batch_threads;
     std::shared_ptr<BatcherT> batcher;
     TF_RETURN_IF_ERROR(BatcherT::Create(batcher_options, &batcher));
 
+    BatcherT::QueueOptions batcher_queue_options;
+    TF_RETURN_IF_ERROR(GetBatcherQueueOptions(
+        num_batch_threads, max_batch_size, batch_timeout_micros,
+        max_enqueued_batches, allowed_batch_sizes, enable_large_batch_splitting,
+        target_latency_micros, &batcher_queue_options));
     resource->reset(new BatchResource(
-        fhandle, std::move(batcher),
-        GetBatcherQueueOptions(num_batch_threads, max_batch_size,
-                               batch_timeout_micros, max_enqueued_batches,
-                               allowed_batch_sizes,
-                               enable_large_batch_splitting),
-        allowed_batch_sizes));
+        fhandle, std::move(batcher), batcher_queue_options,
+        allowed_batch_sizes, enable_ragged_batching, ragged_output_indices));
     return Status::OK();
   }
 
@@ -92,11 +96,14 @@ class BatchResource : public serving::BatchResourceBase {
   BatchResource(FunctionLibraryRuntime::Handle fhandle,
                 std::shared_ptr<BatcherT> batcher,
                 const BatcherT::QueueOptions& batcher_queue_options,
-                std::vector<int32> allowed_batch_sizes)
+                std::vector<int32> allowed_batch_sizes,
+                bool enable_ragged_batching,
+                std::vector<int32> ragged_output_indices)
       : BatchResourceBase(
             /*has_process_batch_function=*/fhandle != kInvalidHandle,
             std::move(batcher), batcher_queue_options,
-            std::move(allowed_batch_sizes)),
+            std::move(allowed_batch_sizes), enable_ragged_batching,
+            std::move(ragged_output_indices)),
         fhandle_(fhandle) {}
 
   void ProcessFuncBatchImpl(
@@ -164,6 +171,27 @@ class BatchFunctionKernel : public AsyncOpKernel {
       has_attribute_enable_large_batch_splitting_ = false;
     }
 
+    if (c->HasAttr("target_latency_micros")) {
+      OP_REQUIRES_OK(
+          c, c->GetAttr("target_latency_micros", &target_latency_micros_));
+      OP_REQUIRES(c, target_latency_micros_ >= 0,
+                  errors::InvalidArgument(
+                      "target_latency_micros must be non-negative; was ",
+                      target_latency_micros_));
+    } else {
+      target_latency_micros_ = 0;
+    }
+
+    if (c->HasAttr("enable_ragged_batching")) {
+      OP_REQUIRES_OK(
+          c, c->GetAttr("enable_ragged_batching", &enable_ragged_batching_));
+      OP_REQUIRES_OK(
+          c, c->GetAttr("ragged_output_indices", &ragged_output_indices_));
+    } else {
+      enable_ragged_batching_ = false;
+    }
+    OP_REQUIRES_OK(c, ValidateRaggedOutputIndices(c->num_outputs()));
+
     OP_REQUIRES_OK(c, ValidateAllowedBatchSizes());
   }
 
@@ -181,7 +209,8 @@ class BatchFunctionKernel : public AsyncOpKernel {
       TF_RETURN_IF_ERROR(BatchResource::Create(
           num_batch_threads_, max_batch_size_, batch_timeout_micros_,
           max_enqueued_batches_, allowed_batch_sizes_, fhandle_,
-          enable_large_batch_splitting_, &new_resource));
+          enable_large_batch_splitting_, target_latency_micros_,
+          enable_ragged_batching_, ragged_output_indices_, &new_resource));
       *r = new_resource.release();
       return Status::OK();
     };
@@ -222,6 +251,30 @@ class BatchFunctionKernel : public AsyncOpKernel {
     return Status::OK();
   }
 
+  // Validates 'ragged_output_indices_', which may only be set with ragged
+  // batching and must refer to distinct outputs.
+  Status ValidateRaggedOutputIndices(int num_outputs) const {
+    if (!enable_ragged_batching_ && !ragged_output_indices_.empty()) {
+      return errors::InvalidArgument(
+          "ragged_output_indices requires enable_ragged_batching");
+    }
+    std::vector<bool> seen(num_outputs);
+    for (int32 index : ragged_output_indices_) {
+      if (index < 0 || index >= num_outputs) {
+        return errors::InvalidArgument("ragged_output_indices entry ", index,
+                                       " is out of range for ", num_outputs,
+                                       " outputs");
+      }
+      if (seen[index]) {
+        return errors::InvalidArgument(
+            "ragged_output_indices entries must be distinct; got ", index,
+            " twice");
+      }
+      seen[index] = true;
+    }
+    return Status::OK();
+  }
+
  private:
   string container_;
   string shared_name_;
@@ -234,6 +287,9 @@ class BatchFunctionKernel : public AsyncOpKernel {
   FunctionLibraryRuntime::Handle fhandle_;
   bool enable_large_batch_splitting_;
   bool has_attribute_enable_large_batch_splitting_;
+  int64 target_latency_micros_;
+  bool enable_ragged_batching_;
+  std::vector<int32> ragged_output_indices_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("BatchFunction").Device(DEVICE_CPU),
@@ -266,8 +322,10 @@ class BatchKernel : public AsyncOpKernel {
       std::unique_ptr<BatchResource> new_resource;
       TF_RETURN_IF_ERROR(BatchResource::Create(
           num_batch_threads_, max_batch_size_, batch_timeout_micros_,
-          max_enqueued_batches_, allowed_batch_sizes_, kInvalidHandle, false,
-          &new_resource));
+          max_enqueued_batches_, allowed_batch_sizes_, kInvalidHandle,
+          /*enable_large_batch_splitting=*/false,
+          /*target_latency_micros=*/0, /*enable_ragged_batching=*/false,
+          /*ragged_output_indices=*/{}, &new_resource));
       *r = new_resource.release();
       return Status::OK();
     };
@@ -15,9 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/batching_util/batch_resource_base.h"
 
+#include <algorithm>
+
 #include "tensorflow/core/framework/ops_util.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/kernels/batching_util/concat_split_util.h"
+#include "tensorflow/core/kernels/batching_util/latency_slo_batch_tuner.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/monitoring/percentile_sampler.h"
 #include "tensorflow/core/util/incremental_barrier.h"
@@ -79,10 +82,42 @@ const string& GetModelName(OpKernelContext* ctx) {
   return ctx->session_metadata()->name();
 }
 
+// Splits 'tensor' along its 0th dimension into pieces of 'sizes' rows. The
+// pieces alias the buffer of 'tensor', which stays alive until all of them are
+// released. Pieces that don't start at an address aligned for Eigen are
+// copied, since kernels downstream may access them through Eigen.
+Status SplitAlongDim0(const Tensor& tensor, const std::vector<int64>& sizes,
+                      std::vector<Tensor>* result) {
+  if (tensor.dims() == 0) {
+    return errors::InvalidArgument("Cannot split a zero-dimensional tensor");
+  }
+  int64 total_size = 0;
+  for (int64 size : sizes) {
+    total_size += size;
+  }
+  if (total_size != tensor.dim_size(0)) {
+    return errors::InvalidArgument(
+        "The values in 'sizes' do not sum to the zeroth-dimension size of "
+        "'tensor'");
+  }
+
+  result->reserve(sizes.size());
+  int64 start = 0;
+  for (int64 size : sizes) {
+    Tensor slice = tensor.Slice(start, start + size);
+    if (slice.IsAligned()) {
+      result->push_back(std::move(slice));
+    } else {
+      result->push_back(tensor::DeepCopy(slice));
+    }
+    start += size;
+  }
+  return Status::OK();
+}
+
 }  // namespace
 
 using ::tensorflow::concat_split_util::Concat;
-using ::tensorflow::concat_split_util::Split;
 using TensorMatrix = std::vector<std::vector<Tensor>>;
 
 Status BatchResourceBase::RegisterInput(
@@ -131,20 +166,19 @@ Status BatchResourceBase::RegisterInput(
   return batcher_queue->Schedule(&batch_components);
 }
 
-/*static*/ BatchResourceBase::BatcherT::QueueOptions
-BatchResourceBase::GetBatcherQueueOptions(
+/*static*/ Status BatchResourceBase::GetBatcherQueueOptions(
     int32 num_batch_threads, int32 max_batch_size, int32 batch_timeout_micros,
     int32 max_enqueued_batches, const std::vector<int32>& allowed_batch_sizes,
-    bool enable_large_batch_splitting) {
-  BatcherT::QueueOptions batcher_queue_options;
-  batcher_queue_options.input_batch_size_limit = max_batch_size;
-  batcher_queue_options.max_enqueued_batches = max_enqueued_batches;
-  batcher_queue_options.batch_timeout_micros = batch_timeout_micros;
+    bool enable_large_batch_splitting, int64 target_latency_micros,
+    BatcherT::QueueOptions* batcher_queue_options) {
+  batcher_queue_options->input_batch_size_limit = max_batch_size;
+  batcher_queue_options->max_enqueued_batches = max_enqueued_batches;
+  batcher_queue_options->batch_timeout_micros = batch_timeout_micros;
   // Support for splitting large batch is still in progress.
-  batcher_queue_options.enable_large_batch_splitting =
+  batcher_queue_options->enable_large_batch_splitting =
       enable_large_batch_splitting;
   if (enable_large_batch_splitting) {
-    batcher_queue_options.split_input_task_func =
+    batcher_queue_options->split_input_task_func =
         [](std::unique_ptr<BatchTask>* input_task,
            int open_batch_remaining_slot, int max_batch_size,
            std::vector<std::unique_ptr<BatchTask>>* output_tasks) -> Status {
@@ -153,14 +187,31 @@ BatchResourceBase::GetBatcherQueueOptions(
     };
 
     if (allowed_batch_sizes.empty()) {
-      batcher_queue_options.max_execution_batch_size = max_batch_size;
+      batcher_queue_options->max_execution_batch_size = max_batch_size;
     } else {
-      batcher_queue_options.max_execution_batch_size =
+      batcher_queue_options->max_execution_batch_size =
           *allowed_batch_sizes.rbegin();
     }
   }
 
-  return batcher_queue_options;
+  if (target_latency_micros > 0) {
+    // The tuner picks among the sizes batches are padded to, and never waits
+    // longer for a batch than the static timeout.
+    LatencySloBatchTuner::Options tuner_options;
+    tuner_options.target_latency_micros = target_latency_micros;
+    tuner_options.max_batch_size =
+        enable_large_batch_splitting
+            ? batcher_queue_options->max_execution_batch_size
+            : max_batch_size;
+    tuner_options.batch_sizes = allowed_batch_sizes;
+    tuner_options.has_max_batch_timeout = true;
+    tuner_options.max_batch_timeout_micros = batch_timeout_micros;
+    std::unique_ptr<LatencySloBatchTuner> tuner;
+    TF_RETURN_IF_ERROR(LatencySloBatchTuner::Create(tuner_options, &tuner));
+    batcher_queue_options->latency_slo_tuner = std::move(tuner);
+  }
+
+  return Status::OK();
 }
 
 /*static*/ Status BatchResourceBase::ValidateBatch(const BatchT& batch) {
@@ -248,6 +299,81 @@ Status BatchResourceBase::ConcatInputTensors(
   return Status::OK();
 }
 
+Status BatchResourceBase::ConcatRaggedInputTensors(
+    const BatchT& batch, OpKernelContext* context,
+    std::vector<Tensor>* concatenated_tensors) const {
+  if (batch.num_tasks() == 0) {
+    return errors::InvalidArgument("Empty batch.");
+  }
+  RecordProcessedBatchSize(batch.size(), GetModelName(context));
+
+  // All tasks should have the same number of input edges.
+  const int num_inputs = batch.task(0).inputs.size();
+  concatenated_tensors->reserve(2 * num_inputs);
+
+  for (int i = 0; i < num_inputs; ++i) {
+    const TensorShape& first_shape = batch.task(0).inputs.at(i).shape();
+    int64 num_rows = 0;
+    for (int task_idx = 0; task_idx < batch.num_tasks(); ++task_idx) {
+      const TensorShape& shape = batch.task(task_idx).inputs.at(i).shape();
+      bool compatible = shape.dims() >= 2 && shape.dims() == first_shape.dims();
+      for (int d = 2; compatible && d < shape.dims(); ++d) {
+        compatible = shape.dim_size(d) == first_shape.dim_size(d);
+      }
+      if (!compatible) {
+        return errors::InvalidArgument(
+            "Ragged batching requires inputs of rank 2 or more that agree on "
+            "all but their first two dimensions; input ",
+            i, " got shapes ", first_shape.DebugString(), " and ",
+            shape.DebugString());
+      }
+      num_rows += shape.dim_size(0);
+    }
+
+    Tensor row_splits;
+    TF_RETURN_IF_ERROR(context->allocate_temp(
+        DT_INT64, TensorShape({num_rows + 1}), &row_splits));
+    auto row_splits_flat = row_splits.vec<int64>();
+    row_splits_flat(0) = 0;
+    int64 row = 0;
+
+    std::vector<Tensor> to_concatenate;
+    to_concatenate.reserve(batch.num_tasks());
+    for (int task_idx = 0; task_idx < batch.num_tasks(); ++task_idx) {
+      const Tensor& input = batch.task(task_idx).inputs.at(i);
+      const int64 task_num_rows = input.dim_size(0);
+      const int64 row_length = input.dim_size(1);
+      for (int64 r = 0; r < task_num_rows; ++r, ++row) {
+        row_splits_flat(row + 1) = row_splits_flat(row) + row_length;
+      }
+
+      // Merge the first two dimensions, which doesn't copy the data.
+      TensorShape values_shape = input.shape();
+      values_shape.RemoveDim(0);
+      values_shape.set_dim(0, task_num_rows * row_length);
+      Tensor values;
+      if (!values.CopyFrom(input, values_shape)) {
+        return errors::Internal("Failed to reshape input ", i, " from ",
+                                input.shape().DebugString(), " to ",
+                                values_shape.DebugString());
+      }
+      to_concatenate.push_back(std::move(values));
+    }
+
+    Tensor concatenated_values;
+    TF_RETURN_IF_ERROR(Concat(context, to_concatenate, &concatenated_values));
+    concatenated_tensors->push_back(std::move(concatenated_values));
+    concatenated_tensors->push_back(std::move(row_splits));
+  }
+  return Status::OK();
+}
+
+bool BatchResourceBase::IsRaggedOutput(int output_index) const {
+  return enable_ragged_batching_ &&
+         std::find(ragged_output_indices_.begin(), ragged_output_indices_.end(),
+                   output_index) != ragged_output_indices_.end();
+}
+
 /*static*/ Status BatchResourceBase::SplitInputTask(
     std::unique_ptr<BatchTask>* input_task_ptr, int open_batch_remaining_slot,
     int max_batch_size, std::vector<std::unique_ptr<BatchTask>>* output_tasks) {
@@ -333,11 +459,10 @@ Status BatchResourceBase::ConcatInputTensors(
   for (int i = 0; i < num_input_tensors; ++i) {
     std::vector<Tensor> split_tensors;
     const Tensor& input_tensor = input_task.inputs[i];
-    // TODO(b/154140947):
-    // Figure out the optimal implementation of Split, by using
-    // 'Tensor::Slice' and eliminating unnecessary memcpy as much as possible.
-    const Status split_status = Split(input_task.context, input_tensor,
-                                      output_task_sizes, &split_tensors);
+    // The splits are concatenated into a batch later, so there is no need to
+    // copy them here.
+    const Status split_status =
+        SplitAlongDim0(input_tensor, output_task_sizes, &split_tensors);
     if (!split_status.ok()) {
       return errors::Internal(
           "When splitting input, Tensor split operation failed: ",
@@ -372,12 +497,27 @@ Status BatchResourceBase::SplitOutputTensors(
   for (int i = 0; i < batch->num_tasks(); ++i) {
     task_sizes_plus_optional_padding.push_back(batch->task(i).size());
   }
+  // Ragged batches are never padded.
   const int padding_size =
-      RoundToLowestAllowedBatchSize(batch->size()) - batch->size();
+      enable_ragged_batching_
+          ? 0
+          : RoundToLowestAllowedBatchSize(batch->size()) - batch->size();
   if (padding_size > 0) {
     task_sizes_plus_optional_padding.push_back(padding_size);
   }
 
+  // Ragged outputs have one row per value of the first input of each task.
+  std::vector<int64> task_num_values;
+  int64 num_values = 0;
+  if (enable_ragged_batching_) {
+    task_num_values.reserve(batch->num_tasks());
+    for (int i = 0; i < batch->num_tasks(); ++i) {
+      const Tensor& input = batch->task(i).inputs[0];
+      task_num_values.push_back(input.dim_size(0) * input.dim_size(1));
+      num_values += task_num_values.back();
+    }
+  }
+
   // For each output tensor name, a divided-up tensor with one entry per task.
   std::map<string, std::vector<Tensor>> split_tensors;
 
@@ -394,32 +534,53 @@ Status BatchResourceBase::SplitOutputTensors(
       return errors::FailedPrecondition(
           "Batched output tensor has 0 dimensions");
     }
-    if (output_tensor.shape().dim_size(0) !=
-        static_cast<int64>(batch->size() + padding_size)) {
+    const bool ragged_output = IsRaggedOutput(i);
+    if (ragged_output) {
+      if (output_tensor.shape().dim_size(0) != num_values) {
+        return errors::FailedPrecondition(
+            "Ragged batched output tensor's 0th dimension does not equal the "
+            "number of values of the first input tensor");
+      }
+    } else if (output_tensor.shape().dim_size(0) !=
+               static_cast<int64>(batch->size() + padding_size)) {
       return errors::FailedPrecondition(
           "Batched output tensor's 0th dimension does not equal the sum of "
           "the 0th dimension sizes of the input tensors");
     }
+    const std::vector<int64>& split_sizes =
+        ragged_output ? task_num_values : task_sizes_plus_optional_padding;
 
     std::vector<Tensor> split_tensor;
-    const Status split_status = tensor::Split(
-        output_tensor, task_sizes_plus_optional_padding, &split_tensor);
+    const Status split_status =
+        SplitAlongDim0(output_tensor, split_sizes, &split_tensor);
     DCHECK(split_status.ok()) << split_status.ToString();
     if (!split_status.ok()) {
       return errors::Internal("Tensor split operation failed: ",
                               split_status.ToString());
     }
-    DCHECK_EQ(split_tensor.size(), task_sizes_plus_optional_padding.size());
-    if (split_tensor.size() != task_sizes_plus_optional_padding.size()) {
+    DCHECK_EQ(split_tensor.size(), split_sizes.size());
+    if (split_tensor.size() != split_sizes.size()) {
       return errors::Internal(
           "Tensor split operation did not work as expected; got ",
-          split_tensor.size(), " splits; expected ",
-          task_sizes_plus_optional_padding.size());
+          split_tensor.size(), " splits; expected ", split_sizes.size());
     }
 
     // Ignore a possible final split_tensors entry containing the padding.
     for (int j = 0; j < batch->num_tasks(); ++j) {
       BatchTask& task = *(batch->mutable_task(j));
+      if (ragged_output) {
+        // Restore the [rows, length] dimensions of the task's first input.
+        const Tensor& input = task.inputs[0];
+        TensorShape task_output_shape = split_tensor[j].shape();
+        task_output_shape.set_dim(0, input.dim_size(1));
+        task_output_shape.InsertDim(0, input.dim_size(0));
+        Tensor task_output;
+        if (!task_output.CopyFrom(split_tensor[j], task_output_shape)) {
+          return errors::Internal("Failed to reshape ragged output ", i,
+                                  " to ", task_output_shape.DebugString());
+        }
+        split_tensor[j] = std::move(task_output);
+      }
       if (task.is_partial) {
         std::vector<Tensor>& tensor_vector = (*task.output)[task.split_index];
         tensor_vector[i] = std::move(split_tensor[j]);
@@ -475,7 +636,13 @@ void BatchResourceBase::ProcessFuncBatch(std::unique_ptr<BatchT> batch) const {
   }
 
   std::vector<Tensor> concatenated_tensors;
-  status = ConcatInputTensors(*batch, last_task_context, &concatenated_tensors);
+  if (enable_ragged_batching_) {
+    status = ConcatRaggedInputTensors(*batch, last_task_context,
+                                      &concatenated_tensors);
+  } else {
+    status =
+        ConcatInputTensors(*batch, last_task_context, &concatenated_tensors);
+  }
   if (!status.ok()) {
     return;
   }
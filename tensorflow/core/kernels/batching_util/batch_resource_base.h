@@ -32,6 +32,10 @@ limitations under the License.
 namespace tensorflow {
 namespace serving {
 
+namespace internal {
+class BatchResourceBaseTestAccess;
+}
+
 // Base class for resource that encapsulating the state and logic for batching
 // tensors.
 class BatchResourceBase : public ResourceBase {
@@ -99,21 +103,34 @@ class BatchResourceBase : public ResourceBase {
   using BatcherQueueT = BatchScheduler<BatchResourceBase::BatchTask>;
   using BatchT = Batch<BatchResourceBase::BatchTask>;
 
+  // If 'enable_ragged_batching' is true, the inputs of the batch function are
+  // packed without padding into values and row splits, and the outputs at
+  // 'ragged_output_indices' are split back along the rows of the first input.
   BatchResourceBase(bool has_process_batch_function,
                     std::shared_ptr<BatcherT> batcher,
                     const BatcherT::QueueOptions& batcher_queue_options,
-                    std::vector<int32> allowed_batch_sizes)
+                    std::vector<int32> allowed_batch_sizes,
+                    bool enable_ragged_batching = false,
+                    std::vector<int32> ragged_output_indices = {})
       : has_process_batch_function_(has_process_batch_function),
         batcher_(std::move(batcher)),
         batcher_queue_options_(batcher_queue_options),
-        allowed_batch_sizes_(std::move(allowed_batch_sizes)) {}
-
-  static BatcherT::QueueOptions GetBatcherQueueOptions(
+        allowed_batch_sizes_(std::move(allowed_batch_sizes)),
+        enable_ragged_batching_(enable_ragged_batching),
+        ragged_output_indices_(std::move(ragged_output_indices)) {}
+
+  // If 'target_latency_micros' is positive, the queue tunes its batch size
+  // and timeout to keep the p99 latency of its requests below the target,
+  // within the limits set by the other arguments.
+  static Status GetBatcherQueueOptions(
       int32 num_batch_threads, int32 max_batch_size, int32 batch_timeout_micros,
       int32 max_enqueued_batches, const std::vector<int32>& allowed_batch_sizes,
-      bool enable_large_batch_splitting);
+      bool enable_large_batch_splitting, int64 target_latency_micros,
+      BatcherT::QueueOptions* batcher_queue_options);
 
  private:
+  friend class internal::BatchResourceBaseTestAccess;
+
   // Implementation of calling the process batch function.
   virtual void ProcessFuncBatchImpl(
       const BatchResourceBase::BatchTask& last_task,
@@ -137,6 +154,20 @@ class BatchResourceBase : public ResourceBase {
   Status ConcatInputTensors(const BatchT& batch, OpKernelContext* context,
                             std::vector<Tensor>* concatenated_tensors) const;
 
+  // Packs the i-th inputs of the tasks in 'batch', of shape
+  // [rows, length, ...], into a tensor of values of shape
+  // [sum(rows * length), ...] followed by an int64 tensor of row splits of
+  // shape [sum(rows) + 1]. Emits the values and row splits of each input in
+  // turn. The inputs of the tasks must agree on their dimensions after the
+  // 1st one.
+  Status ConcatRaggedInputTensors(
+      const BatchT& batch, OpKernelContext* context,
+      std::vector<Tensor>* concatenated_tensors) const;
+
+  // Returns true if the batch function output at 'output_index' has one row
+  // per value of the first (ragged) input.
+  bool IsRaggedOutput(int output_index) const;
+
   // Split 'input' of 'input_task_ptr' along 0th dimension, into a list of
   // 'output_tasks'.
   // Task sizes are determined by
@@ -194,6 +225,9 @@ class BatchResourceBase : public ResourceBase {
       TF_GUARDED_BY(batcher_queues_mu_);
 
   std::vector<int32> allowed_batch_sizes_;
+
+  const bool enable_ragged_batching_;
+  const std::vector<int32> ragged_output_indices_;
 };
 
 }  // namespace serving
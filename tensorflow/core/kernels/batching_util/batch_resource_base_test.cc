@@ -0,0 +1,430 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/batch_resource_base.h"
+
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/batching_util/threadsafe_status.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace serving {
+
+namespace internal {
+
+class BatchResourceBaseTestAccess {
+ public:
+  using BatchTask = BatchResourceBase::BatchTask;
+  using BatchT = BatchResourceBase::BatchT;
+
+  static Status SplitInputTask(
+      std::unique_ptr<BatchTask>* input_task_ptr, int open_batch_remaining_slot,
+      int max_batch_size,
+      std::vector<std::unique_ptr<BatchTask>>* output_tasks) {
+    return BatchResourceBase::SplitInputTask(
+        input_task_ptr, open_batch_remaining_slot, max_batch_size,
+        output_tasks);
+  }
+
+  static Status SplitOutputTensors(const BatchResourceBase& resource,
+                                   const std::vector<Tensor>& combined_outputs,
+                                   BatchT* batch) {
+    return resource.SplitOutputTensors(combined_outputs, batch);
+  }
+
+  static Status ConcatRaggedInputTensors(
+      const BatchResourceBase& resource, const BatchT& batch,
+      OpKernelContext* context, std::vector<Tensor>* concatenated_tensors) {
+    return resource.ConcatRaggedInputTensors(batch, context,
+                                             concatenated_tensors);
+  }
+
+  static bool IsRaggedOutput(const BatchResourceBase& resource,
+                             int output_index) {
+    return resource.IsRaggedOutput(output_index);
+  }
+};
+
+}  // namespace internal
+
+namespace {
+
+using BatchTask = internal::BatchResourceBaseTestAccess::BatchTask;
+using BatchT = internal::BatchResourceBaseTestAccess::BatchT;
+using TestAccess = internal::BatchResourceBaseTestAccess;
+
+// Number of floats in a row that starts at an address aligned for Eigen.
+constexpr int kAlignedRowSize =
+    EIGEN_MAX_ALIGN_BYTES > sizeof(float)
+        ? EIGEN_MAX_ALIGN_BYTES / sizeof(float)
+        : 1;
+
+// A batch resource whose batch function is never run.
+class FakeBatchResource : public BatchResourceBase {
+ public:
+  explicit FakeBatchResource(std::vector<int32> allowed_batch_sizes,
+                             bool enable_ragged_batching = false,
+                             std::vector<int32> ragged_output_indices = {})
+      : BatchResourceBase(/*has_process_batch_function=*/true,
+                          /*batcher=*/nullptr, BatcherT::QueueOptions(),
+                          std::move(allowed_batch_sizes),
+                          enable_ragged_batching,
+                          std::move(ragged_output_indices)) {}
+
+  string DebugString() const override { return "FakeBatchResource"; }
+
+ private:
+  void ProcessFuncBatchImpl(const BatchResourceBase::BatchTask& last_task,
+                            absl::Span<const Tensor> inputs,
+                            std::vector<Tensor>* combined_outputs,
+                            std::function<void(const Status&)> done)
+      const override {
+    done(errors::Unimplemented("FakeBatchResource"));
+  }
+};
+
+class BatchResourceBaseTest : public OpsTestBase {
+ protected:
+  // Runs an op with a single output, whose context receives the outputs of
+  // the split tasks.
+  void SetUp() override {
+    TF_ASSERT_OK(NodeDefBuilder("identity", "Identity")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    AddInputFromArray<float>(TensorShape({1}), {0});
+    TF_ASSERT_OK(RunOpKernel());
+  }
+
+  std::unique_ptr<BatchTask> CreateTask(const Tensor& input, bool* done) {
+    auto task = absl::make_unique<BatchTask>();
+    task->guid = 1;
+    task->inputs.push_back(input);
+    task->context = context_.get();
+    task->done_callback = [done]() { *done = true; };
+    task->output = std::make_shared<BatchResourceBase::TensorMatrix>();
+    task->status = std::make_shared<ThreadSafeStatus>();
+    return task;
+  }
+
+  // Splits a task with `input` into pieces of 1, 2 and 2 rows.
+  std::vector<std::unique_ptr<BatchTask>> Split(const Tensor& input,
+                                                bool* done) {
+    std::unique_ptr<BatchTask> task = CreateTask(input, done);
+    std::vector<std::unique_ptr<BatchTask>> split_tasks;
+    TF_CHECK_OK(internal::BatchResourceBaseTestAccess::SplitInputTask(
+        &task, /*open_batch_remaining_slot=*/1, /*max_batch_size=*/2,
+        &split_tasks));
+    return split_tasks;
+  }
+
+  // Returns a closed batch of pieces of one split task, with `sizes` rows of
+  // `row_size` floats each. The pieces' outputs go to `output`.
+  std::unique_ptr<BatchT> CreateSplitBatch(
+      const std::vector<int64>& sizes, int64 row_size,
+      std::shared_ptr<BatchResourceBase::TensorMatrix>* output) {
+    *output = std::make_shared<BatchResourceBase::TensorMatrix>(
+        sizes.size(), std::vector<Tensor>(1));
+    auto batch = absl::make_unique<BatchT>();
+    for (int i = 0; i < sizes.size(); ++i) {
+      auto task = absl::make_unique<BatchTask>();
+      task->guid = 1;
+      task->inputs.push_back(
+          Tensor(DT_FLOAT, TensorShape({sizes[i], row_size})));
+      task->context = context_.get();
+      task->split_index = i;
+      task->is_partial = true;
+      task->output = *output;
+      task->status = std::make_shared<ThreadSafeStatus>();
+      batch->AddTask(std::move(task));
+    }
+    batch->Close();
+    return batch;
+  }
+
+  // Returns a closed batch of tasks whose inputs are `inputs[i]`.
+  std::unique_ptr<BatchT> CreateBatch(
+      const std::vector<std::vector<Tensor>>& inputs) {
+    auto batch = absl::make_unique<BatchT>();
+    for (const std::vector<Tensor>& task_inputs : inputs) {
+      auto task = absl::make_unique<BatchTask>();
+      task->inputs = task_inputs;
+      task->context = context_.get();
+      batch->AddTask(std::move(task));
+    }
+    batch->Close();
+    return batch;
+  }
+};
+
+Tensor Iota(const TensorShape& shape) {
+  Tensor tensor(DT_FLOAT, shape);
+  auto flat = tensor.flat<float>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = i;
+  }
+  return tensor;
+}
+
+TEST_F(BatchResourceBaseTest, SplitInputTaskAliasesAlignedPieces) {
+  const Tensor input = Iota(TensorShape({5, kAlignedRowSize}));
+  bool done = false;
+  std::vector<std::unique_ptr<BatchTask>> split_tasks = Split(input, &done);
+  ASSERT_EQ(split_tasks.size(), 3);
+
+  const std::vector<int64> starts = {0, 1, 3, 5};
+  for (int i = 0; i < split_tasks.size(); ++i) {
+    const BatchTask& task = *split_tasks[i];
+    EXPECT_EQ(task.split_index, i);
+    EXPECT_TRUE(task.is_partial);
+    ASSERT_EQ(task.inputs.size(), 1);
+    const Tensor expected = input.Slice(starts[i], starts[i + 1]);
+    test::ExpectTensorEqual<float>(task.inputs[0], expected);
+    // Every row is aligned, so no piece is copied.
+    EXPECT_TRUE(task.inputs[0].SharesBufferWith(input));
+    EXPECT_EQ(task.inputs[0].tensor_data().data(),
+              expected.tensor_data().data());
+  }
+}
+
+TEST_F(BatchResourceBaseTest, SplitInputTaskCopiesUnalignedPieces) {
+  const Tensor input = Iota(TensorShape({5, 1}));
+  bool done = false;
+  std::vector<std::unique_ptr<BatchTask>> split_tasks = Split(input, &done);
+  ASSERT_EQ(split_tasks.size(), 3);
+
+  const std::vector<int64> starts = {0, 1, 3, 5};
+  for (int i = 0; i < split_tasks.size(); ++i) {
+    const Tensor& piece = split_tasks[i]->inputs[0];
+    const Tensor slice = input.Slice(starts[i], starts[i + 1]);
+    test::ExpectTensorEqual<float>(piece, slice);
+    EXPECT_TRUE(piece.IsAligned());
+    // Only the pieces that start at an aligned address alias the input.
+    EXPECT_EQ(piece.SharesBufferWith(input), slice.IsAligned());
+  }
+  // The first piece starts at the beginning of the input.
+  EXPECT_TRUE(split_tasks[0]->inputs[0].SharesBufferWith(input));
+}
+
+TEST_F(BatchResourceBaseTest, SplitInputTaskMergesOutputs) {
+  const Tensor input = Iota(TensorShape({5, 1}));
+  bool done = false;
+  std::vector<std::unique_ptr<BatchTask>> split_tasks = Split(input, &done);
+  ASSERT_EQ(split_tasks.size(), 3);
+
+  // Complete the pieces out of order, each with rows holding its index.
+  for (int i = split_tasks.size() - 1; i >= 0; --i) {
+    BatchTask& task = *split_tasks[i];
+    Tensor output(DT_FLOAT, task.inputs[0].shape());
+    output.flat<float>().setConstant(task.split_index);
+    (*task.output)[task.split_index][0] = output;
+    EXPECT_FALSE(done);
+    task.done_callback();
+  }
+
+  // The outputs of the pieces are concatenated in split order.
+  EXPECT_TRUE(done);
+  TF_EXPECT_OK(context_->status());
+  test::ExpectTensorEqual<float>(
+      *GetOutput(0), test::AsTensor<float>({0, 1, 1, 2, 2}, {5, 1}));
+}
+
+TEST_F(BatchResourceBaseTest, SplitOutputTensorsAliasesAlignedSlices) {
+  FakeBatchResource resource(/*allowed_batch_sizes=*/{});
+  std::shared_ptr<BatchResourceBase::TensorMatrix> output;
+  std::unique_ptr<BatchT> batch =
+      CreateSplitBatch({1, 2, 2}, kAlignedRowSize, &output);
+  const Tensor combined = Iota(TensorShape({5, kAlignedRowSize}));
+  TF_ASSERT_OK(TestAccess::SplitOutputTensors(resource, {combined},
+                                              batch.get()));
+
+  const std::vector<int64> starts = {0, 1, 3, 5};
+  for (int i = 0; i < batch->num_tasks(); ++i) {
+    const Tensor& piece = (*output)[i][0];
+    const Tensor expected = combined.Slice(starts[i], starts[i + 1]);
+    test::ExpectTensorEqual<float>(piece, expected);
+    // Every row is aligned, so no slice is copied.
+    EXPECT_TRUE(piece.SharesBufferWith(combined));
+    EXPECT_EQ(piece.tensor_data().data(), expected.tensor_data().data());
+  }
+}
+
+TEST_F(BatchResourceBaseTest, SplitOutputTensorsCopiesUnalignedSlices) {
+  FakeBatchResource resource(/*allowed_batch_sizes=*/{});
+  std::shared_ptr<BatchResourceBase::TensorMatrix> output;
+  std::unique_ptr<BatchT> batch = CreateSplitBatch({1, 2, 2}, 1, &output);
+  const Tensor combined = Iota(TensorShape({5, 1}));
+  TF_ASSERT_OK(TestAccess::SplitOutputTensors(resource, {combined},
+                                              batch.get()));
+
+  const std::vector<int64> starts = {0, 1, 3, 5};
+  for (int i = 0; i < batch->num_tasks(); ++i) {
+    const Tensor& piece = (*output)[i][0];
+    const Tensor slice = combined.Slice(starts[i], starts[i + 1]);
+    test::ExpectTensorEqual<float>(piece, slice);
+    EXPECT_TRUE(piece.IsAligned());
+    // Only the slices that start at an aligned address alias the output.
+    EXPECT_EQ(piece.SharesBufferWith(combined), slice.IsAligned());
+  }
+  EXPECT_TRUE((*output)[0][0].SharesBufferWith(combined));
+}
+
+TEST_F(BatchResourceBaseTest, SplitOutputTensorsDropsPadding) {
+  FakeBatchResource resource(/*allowed_batch_sizes=*/{8});
+  std::shared_ptr<BatchResourceBase::TensorMatrix> output;
+  std::unique_ptr<BatchT> batch =
+      CreateSplitBatch({1, 2, 2}, kAlignedRowSize, &output);
+  const Tensor combined = Iota(TensorShape({8, kAlignedRowSize}));
+  TF_ASSERT_OK(TestAccess::SplitOutputTensors(resource, {combined},
+                                              batch.get()));
+
+  const std::vector<int64> starts = {0, 1, 3, 5};
+  for (int i = 0; i < batch->num_tasks(); ++i) {
+    const Tensor& piece = (*output)[i][0];
+    test::ExpectTensorEqual<float>(piece,
+                                   combined.Slice(starts[i], starts[i + 1]));
+    EXPECT_TRUE(piece.SharesBufferWith(combined));
+  }
+
+  // The output must have a row per row of the padded batch.
+  const Tensor unpadded = Iota(TensorShape({5, kAlignedRowSize}));
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      TestAccess::SplitOutputTensors(resource, {unpadded}, batch.get())));
+}
+
+TEST_F(BatchResourceBaseTest, ConcatRaggedInputTensors) {
+  FakeBatchResource resource(/*allowed_batch_sizes=*/{8},
+                             /*enable_ragged_batching=*/true);
+  // Two inputs per task, of rank 2 and 3. Rows and row lengths differ
+  // between the tasks.
+  std::unique_ptr<BatchT> batch = CreateBatch(
+      {{test::AsTensor<float>({0, 1, 2, 3, 4, 5}, {2, 3}),
+        test::AsTensor<float>({0, 1, 2, 3}, {2, 1, 2})},
+       {test::AsTensor<float>({10, 11}, {1, 2}),
+        test::AsTensor<float>({10, 11, 12, 13}, {1, 2, 2})}});
+  std::vector<Tensor> concatenated;
+  TF_ASSERT_OK(TestAccess::ConcatRaggedInputTensors(
+      resource, *batch, context_.get(), &concatenated));
+
+  // The values and row splits of each input in turn, without padding.
+  ASSERT_EQ(concatenated.size(), 4);
+  test::ExpectTensorEqual<float>(
+      concatenated[0], test::AsTensor<float>({0, 1, 2, 3, 4, 5, 10, 11}));
+  test::ExpectTensorEqual<int64>(concatenated[1],
+                                 test::AsTensor<int64>({0, 3, 6, 8}));
+  test::ExpectTensorEqual<float>(
+      concatenated[2],
+      test::AsTensor<float>({0, 1, 2, 3, 10, 11, 12, 13}, {4, 2}));
+  test::ExpectTensorEqual<int64>(concatenated[3],
+                                 test::AsTensor<int64>({0, 1, 2, 4}));
+}
+
+TEST_F(BatchResourceBaseTest, ConcatRaggedInputTensorsRejectsRankOne) {
+  FakeBatchResource resource(/*allowed_batch_sizes=*/{},
+                             /*enable_ragged_batching=*/true);
+  std::unique_ptr<BatchT> batch =
+      CreateBatch({{test::AsTensor<float>({0, 1})},
+                   {test::AsTensor<float>({2, 3, 4})}});
+  std::vector<Tensor> concatenated;
+  EXPECT_TRUE(errors::IsInvalidArgument(TestAccess::ConcatRaggedInputTensors(
+      resource, *batch, context_.get(), &concatenated)));
+}
+
+TEST_F(BatchResourceBaseTest, ConcatRaggedInputTensorsRejectsMismatchedRanks) {
+  FakeBatchResource resource(/*allowed_batch_sizes=*/{},
+                             /*enable_ragged_batching=*/true);
+  std::unique_ptr<BatchT> batch =
+      CreateBatch({{test::AsTensor<float>({0, 1}, {1, 2})},
+                   {test::AsTensor<float>({2, 3}, {1, 1, 2})}});
+  std::vector<Tensor> concatenated;
+  EXPECT_TRUE(errors::IsInvalidArgument(TestAccess::ConcatRaggedInputTensors(
+      resource, *batch, context_.get(), &concatenated)));
+}
+
+TEST_F(BatchResourceBaseTest,
+       ConcatRaggedInputTensorsRejectsMismatchedInnerDims) {
+  FakeBatchResource resource(/*allowed_batch_sizes=*/{},
+                             /*enable_ragged_batching=*/true);
+  std::unique_ptr<BatchT> batch =
+      CreateBatch({{test::AsTensor<float>({0, 1}, {1, 1, 2})},
+                   {test::AsTensor<float>({2, 3, 4}, {1, 1, 3})}});
+  std::vector<Tensor> concatenated;
+  EXPECT_TRUE(errors::IsInvalidArgument(TestAccess::ConcatRaggedInputTensors(
+      resource, *batch, context_.get(), &concatenated)));
+}
+
+TEST_F(BatchResourceBaseTest, IsRaggedOutput) {
+  FakeBatchResource ragged(/*allowed_batch_sizes=*/{},
+                           /*enable_ragged_batching=*/true,
+                           /*ragged_output_indices=*/{1});
+  EXPECT_FALSE(TestAccess::IsRaggedOutput(ragged, 0));
+  EXPECT_TRUE(TestAccess::IsRaggedOutput(ragged, 1));
+
+  // The indices are ignored unless ragged batching is enabled.
+  FakeBatchResource padded(/*allowed_batch_sizes=*/{},
+                           /*enable_ragged_batching=*/false,
+                           /*ragged_output_indices=*/{1});
+  EXPECT_FALSE(TestAccess::IsRaggedOutput(padded, 1));
+}
+
+TEST_F(BatchResourceBaseTest, RaggedBatchOfSplitInputTask) {
+  FakeBatchResource resource(/*allowed_batch_sizes=*/{8},
+                             /*enable_ragged_batching=*/true,
+                             /*ragged_output_indices=*/{0});
+  // A task of 5 rows of length 2, split into pieces of 1, 2 and 2 rows.
+  const Tensor input = Iota(TensorShape({5, 2}));
+  bool done = false;
+  std::vector<std::unique_ptr<BatchTask>> split_tasks = Split(input, &done);
+  ASSERT_EQ(split_tasks.size(), 3);
+  auto batch = absl::make_unique<BatchT>();
+  for (auto& task : split_tasks) {
+    batch->AddTask(std::move(task));
+  }
+  batch->Close();
+
+  std::vector<Tensor> concatenated;
+  TF_ASSERT_OK(TestAccess::ConcatRaggedInputTensors(
+      resource, *batch, context_.get(), &concatenated));
+  ASSERT_EQ(concatenated.size(), 2);
+  test::ExpectTensorEqual<float>(concatenated[0], Iota(TensorShape({10})));
+  test::ExpectTensorEqual<int64>(concatenated[1],
+                                 test::AsTensor<int64>({0, 2, 4, 6, 8, 10}));
+
+  // The batch function returns one row per value, which is split back into
+  // the [rows, length] shape of each piece, unpadded.
+  TF_ASSERT_OK(TestAccess::SplitOutputTensors(resource, {concatenated[0]},
+                                              batch.get()));
+  for (int i = 0; i < batch->num_tasks(); ++i) {
+    EXPECT_FALSE(done);
+    batch->mutable_task(i)->done_callback();
+  }
+
+  // The pieces are merged into the output of the original task.
+  EXPECT_TRUE(done);
+  TF_EXPECT_OK(context_->status());
+  test::ExpectTensorEqual<float>(*GetOutput(0), input);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,169 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/latency_slo_batch_tuner.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace serving {
+
+/*static*/ Status LatencySloBatchTuner::Create(
+    const Options& options, std::unique_ptr<LatencySloBatchTuner>* tuner) {
+  if (options.target_latency_micros <= 0) {
+    return errors::InvalidArgument(
+        "target_latency_micros must be positive; was ",
+        options.target_latency_micros);
+  }
+  if (options.max_batch_size <= 0) {
+    return errors::InvalidArgument("max_batch_size must be positive; was ",
+                                   options.max_batch_size);
+  }
+  if (options.min_batch_timeout_micros < 0 ||
+      options.max_batch_timeout_micros < 0) {
+    return errors::InvalidArgument("Batch timeouts must be non-negative");
+  }
+  if (options.has_max_batch_timeout &&
+      options.max_batch_timeout_micros < options.min_batch_timeout_micros) {
+    return errors::InvalidArgument(
+        "max_batch_timeout_micros must not be smaller than "
+        "min_batch_timeout_micros");
+  }
+  if (options.min_samples <= 0 || options.num_samples < options.min_samples) {
+    return errors::InvalidArgument(
+        "Expected 0 < min_samples <= num_samples; got min_samples ",
+        options.min_samples, " and num_samples ", options.num_samples);
+  }
+  if (options.retry_interval_micros <= 0) {
+    return errors::InvalidArgument(
+        "retry_interval_micros must be positive; was ",
+        options.retry_interval_micros);
+  }
+
+  std::vector<int32> batch_sizes = options.batch_sizes;
+  if (batch_sizes.empty()) {
+    for (int32 size = 1; size < options.max_batch_size; size *= 2) {
+      batch_sizes.push_back(size);
+    }
+    batch_sizes.push_back(options.max_batch_size);
+  }
+  const int num_batch_sizes = batch_sizes.size();
+  for (int i = 0; i < num_batch_sizes; ++i) {
+    if (batch_sizes[i] <= 0 || batch_sizes[i] > options.max_batch_size ||
+        (i > 0 && batch_sizes[i] <= batch_sizes[i - 1])) {
+      return errors::InvalidArgument(
+          "batch_sizes must be positive, increasing and at most "
+          "max_batch_size");
+    }
+  }
+  tuner->reset(new LatencySloBatchTuner(options, batch_sizes));
+  return Status::OK();
+}
+
+LatencySloBatchTuner::LatencySloBatchTuner(
+    const Options& options, const std::vector<int32>& batch_sizes)
+    : options_(options) {
+  mutex_lock l(mu_);
+  candidates_.resize(batch_sizes.size());
+  for (int i = 0; i < candidates_.size(); ++i) {
+    candidates_[i].batch_size = batch_sizes[i];
+    candidates_[i].samples.reserve(options_.num_samples);
+  }
+  Update();
+}
+
+void LatencySloBatchTuner::RecordBatch(int batch_size,
+                                       int64 processing_micros) {
+  mutex_lock l(mu_);
+  auto it = std::lower_bound(
+      candidates_.begin(), candidates_.end(), batch_size,
+      [](const Candidate& c, int size) { return c.batch_size < size; });
+  Candidate& candidate = it == candidates_.end() ? candidates_.back() : *it;
+
+  if (static_cast<int>(candidate.samples.size()) < options_.num_samples) {
+    candidate.samples.push_back(processing_micros);
+  } else {
+    candidate.samples[candidate.next_sample] = processing_micros;
+    candidate.next_sample = (candidate.next_sample + 1) % options_.num_samples;
+  }
+  candidate.last_sample_micros = options_.env->NowMicros();
+  const int num_samples = candidate.samples.size();
+  if (num_samples < options_.min_samples) return;
+
+  std::vector<int64> sorted(candidate.samples);
+  const int p99_index = (num_samples * 99 + 99) / 100 - 1;
+  std::nth_element(sorted.begin(), sorted.begin() + p99_index, sorted.end());
+  candidate.p99_micros = sorted[p99_index];
+  Update();
+}
+
+void LatencySloBatchTuner::Update() {
+  // The processing time budget that leaves room for the minimum timeout.
+  const int64 budget_micros =
+      options_.target_latency_micros - options_.min_batch_timeout_micros;
+  const uint64 now_micros = options_.env->NowMicros();
+
+  int chosen = 0;
+  int64 chosen_p99_micros = std::max<int64>(candidates_[0].p99_micros, 0);
+  for (int i = 0; i < candidates_.size(); ++i) {
+    Candidate& candidate = candidates_[i];
+    if (candidate.p99_micros > budget_micros &&
+        now_micros - candidate.last_sample_micros >=
+            options_.retry_interval_micros) {
+      // The batch size hasn't been used since it was too slow; forget its
+      // samples so that it is explored again.
+      candidate.samples.clear();
+      candidate.next_sample = 0;
+      candidate.p99_micros = -1;
+    }
+    int64 p99_micros = candidate.p99_micros;
+    const bool measured = p99_micros >= 0;
+    if (!measured) {
+      if (i == 0) break;
+      // Explore the next batch size, assuming that the processing time grows
+      // at most linearly with the batch size.
+      p99_micros = chosen_p99_micros * candidate.batch_size /
+                   candidates_[chosen].batch_size;
+    }
+    if (p99_micros > budget_micros) break;
+    chosen = i;
+    chosen_p99_micros = p99_micros;
+    if (!measured) break;
+  }
+
+  int64 timeout_micros = std::max(
+      options_.target_latency_micros - chosen_p99_micros,
+      options_.min_batch_timeout_micros);
+  if (options_.has_max_batch_timeout) {
+    timeout_micros =
+        std::min(timeout_micros, options_.max_batch_timeout_micros);
+  }
+  if (candidates_[chosen].batch_size != max_batch_size() ||
+      timeout_micros != batch_timeout_micros()) {
+    VLOG(2) << "Batch size " << candidates_[chosen].batch_size
+            << " has an estimated p99 processing time of "
+            << chosen_p99_micros << " us; using a batch timeout of "
+            << timeout_micros << " us";
+  }
+  max_batch_size_.store(candidates_[chosen].batch_size,
+                        std::memory_order_relaxed);
+  batch_timeout_micros_.store(timeout_micros, std::memory_order_relaxed);
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,135 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LATENCY_SLO_BATCH_TUNER_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LATENCY_SLO_BATCH_TUNER_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Chooses the maximum batch size and the batch timeout of a batching queue so
+// that the 99th percentile latency of its requests stays below a target.
+//
+// A request waits at most the batch timeout for its batch to be closed, and
+// then for the batch to be processed. The tuner keeps a window of recent
+// processing times for each candidate batch size, and picks the largest batch
+// size whose p99 processing time fits in the target together with the minimum
+// batch timeout. The rest of the target becomes the batch timeout.
+//
+// Candidate batch sizes that haven't been measured are explored one at a time:
+// the next larger candidate is allowed as soon as the largest measured one
+// fits, with its processing time extrapolated linearly until it is measured.
+// Initially only the smallest candidate is allowed. A candidate whose p99 did
+// not fit receives no more batches, so its samples are discarded
+// 'retry_interval_micros' after the last one and it is explored again, in case
+// processing has become faster.
+//
+// This class is thread-safe.
+class LatencySloBatchTuner {
+ public:
+  struct Options {
+    // The target 99th percentile latency of a request, from the time it is
+    // enqueued until its batch has been processed. Must be positive.
+    int64 target_latency_micros = 0;
+
+    // The largest batch size the tuner may choose.
+    int max_batch_size = 1000;
+
+    // The candidate batch sizes, in increasing order. Batches are attributed
+    // to the smallest candidate that is at least as large as the batch, e.g.
+    // the size they are padded to. If empty, the candidates are the powers of
+    // two below 'max_batch_size', and 'max_batch_size' itself.
+    std::vector<int32> batch_sizes;
+
+    // Bounds of the batch timeout. 'max_batch_timeout_micros' only applies if
+    // 'has_max_batch_timeout' is set, and may then be zero; otherwise the
+    // timeout is only bounded by the target latency.
+    int64 min_batch_timeout_micros = 0;
+    bool has_max_batch_timeout = false;
+    int64 max_batch_timeout_micros = 0;
+
+    // The number of most recent processing times kept for each candidate
+    // batch size, and the number needed before their p99 is trusted.
+    int num_samples = 100;
+    int min_samples = 10;
+
+    // How long a candidate batch size whose p99 processing time doesn't fit
+    // stays excluded after its last sample. Must be positive.
+    int64 retry_interval_micros = 60 * 1000 * 1000;
+
+    // The environment to use for time.
+    Env* env = Env::Default();
+  };
+
+  static Status Create(const Options& options,
+                       std::unique_ptr<LatencySloBatchTuner>* tuner);
+
+  // Records that a batch of 'batch_size' took 'processing_micros' to process,
+  // and updates the maximum batch size and the batch timeout.
+  void RecordBatch(int batch_size, int64 processing_micros)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // The current maximum batch size and batch timeout.
+  int max_batch_size() const {
+    return max_batch_size_.load(std::memory_order_relaxed);
+  }
+  int64 batch_timeout_micros() const {
+    return batch_timeout_micros_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Candidate {
+    int32 batch_size;
+    // Ring buffer of the most recent processing times.
+    std::vector<int64> samples;
+    int next_sample = 0;
+    // The p99 of 'samples', or -1 if there are fewer than 'min_samples'.
+    int64 p99_micros = -1;
+    // When the last sample was recorded.
+    uint64 last_sample_micros = 0;
+  };
+
+  LatencySloBatchTuner(const Options& options,
+                       const std::vector<int32>& batch_sizes);
+
+  // Chooses the maximum batch size and timeout from the current estimates.
+  void Update() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  mutex mu_;
+  std::vector<Candidate> candidates_ TF_GUARDED_BY(mu_);
+
+  std::atomic<int> max_batch_size_;
+  std::atomic<int64> batch_timeout_micros_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(LatencySloBatchTuner);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LATENCY_SLO_BATCH_TUNER_H_
@@ -0,0 +1,219 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/latency_slo_batch_tuner.h"
+
+#include "tensorflow/core/kernels/batching_util/fake_clock_env.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+TEST(LatencySloBatchTunerTest, InvalidOptions) {
+  std::unique_ptr<LatencySloBatchTuner> tuner;
+  LatencySloBatchTuner::Options options;
+  EXPECT_FALSE(LatencySloBatchTuner::Create(options, &tuner).ok());
+
+  options.target_latency_micros = 1000;
+  TF_EXPECT_OK(LatencySloBatchTuner::Create(options, &tuner));
+
+  LatencySloBatchTuner::Options bad_options = options;
+  bad_options.max_batch_size = 0;
+  EXPECT_FALSE(LatencySloBatchTuner::Create(bad_options, &tuner).ok());
+
+  bad_options = options;
+  bad_options.batch_sizes = {4, 2};
+  EXPECT_FALSE(LatencySloBatchTuner::Create(bad_options, &tuner).ok());
+
+  bad_options = options;
+  bad_options.batch_sizes = {2, 2000};
+  EXPECT_FALSE(LatencySloBatchTuner::Create(bad_options, &tuner).ok());
+
+  bad_options = options;
+  bad_options.min_batch_timeout_micros = 200;
+  bad_options.has_max_batch_timeout = true;
+  bad_options.max_batch_timeout_micros = 100;
+  EXPECT_FALSE(LatencySloBatchTuner::Create(bad_options, &tuner).ok());
+
+  bad_options = options;
+  bad_options.min_samples = 20;
+  bad_options.num_samples = 10;
+  EXPECT_FALSE(LatencySloBatchTuner::Create(bad_options, &tuner).ok());
+
+  bad_options = options;
+  bad_options.retry_interval_micros = 0;
+  EXPECT_FALSE(LatencySloBatchTuner::Create(bad_options, &tuner).ok());
+}
+
+TEST(LatencySloBatchTunerTest, GrowsAndShrinksBatchSize) {
+  LatencySloBatchTuner::Options options;
+  options.target_latency_micros = 1000;
+  options.max_batch_size = 8;
+  options.num_samples = 1;
+  options.min_samples = 1;
+  std::unique_ptr<LatencySloBatchTuner> tuner;
+  TF_ASSERT_OK(LatencySloBatchTuner::Create(options, &tuner));
+
+  // Nothing has been measured yet, so only the smallest batch size is allowed.
+  EXPECT_EQ(1, tuner->max_batch_size());
+  EXPECT_EQ(1000, tuner->batch_timeout_micros());
+
+  // The processing time grows linearly with the batch size, so each
+  // measurement lets the tuner explore the next batch size.
+  tuner->RecordBatch(1, 100);
+  EXPECT_EQ(2, tuner->max_batch_size());
+  EXPECT_EQ(800, tuner->batch_timeout_micros());
+  tuner->RecordBatch(2, 200);
+  EXPECT_EQ(4, tuner->max_batch_size());
+  EXPECT_EQ(600, tuner->batch_timeout_micros());
+  tuner->RecordBatch(3, 400);
+  EXPECT_EQ(8, tuner->max_batch_size());
+  EXPECT_EQ(200, tuner->batch_timeout_micros());
+
+  // A batch of 8 exceeds the target on its own.
+  tuner->RecordBatch(8, 1200);
+  EXPECT_EQ(4, tuner->max_batch_size());
+  EXPECT_EQ(600, tuner->batch_timeout_micros());
+
+  // Batches that became slower shrink the batch size further.
+  tuner->RecordBatch(4, 1100);
+  EXPECT_EQ(2, tuner->max_batch_size());
+  EXPECT_EQ(800, tuner->batch_timeout_micros());
+}
+
+TEST(LatencySloBatchTunerTest, RetriesBatchSizeAfterLatencyRecovers) {
+  test_util::FakeClockEnv env(Env::Default());
+  LatencySloBatchTuner::Options options;
+  options.target_latency_micros = 1000;
+  options.max_batch_size = 4;
+  options.num_samples = 1;
+  options.min_samples = 1;
+  options.retry_interval_micros = 1000;
+  options.env = &env;
+  std::unique_ptr<LatencySloBatchTuner> tuner;
+  TF_ASSERT_OK(LatencySloBatchTuner::Create(options, &tuner));
+
+  tuner->RecordBatch(1, 100);
+  EXPECT_EQ(2, tuner->max_batch_size());
+  // A batch of 2 is too slow, e.g. because the device is busy.
+  tuner->RecordBatch(2, 1200);
+  EXPECT_EQ(1, tuner->max_batch_size());
+  EXPECT_EQ(900, tuner->batch_timeout_micros());
+
+  env.AdvanceByMicroseconds(999);
+  tuner->RecordBatch(1, 100);
+  EXPECT_EQ(1, tuner->max_batch_size());
+
+  // Once the retry interval has passed, a batch of 2 is explored again.
+  env.AdvanceByMicroseconds(1);
+  tuner->RecordBatch(1, 100);
+  EXPECT_EQ(2, tuner->max_batch_size());
+  EXPECT_EQ(800, tuner->batch_timeout_micros());
+
+  // It is still too slow, so it is excluded for another interval.
+  tuner->RecordBatch(2, 1200);
+  EXPECT_EQ(1, tuner->max_batch_size());
+  env.AdvanceByMicroseconds(999);
+  tuner->RecordBatch(1, 100);
+  EXPECT_EQ(1, tuner->max_batch_size());
+
+  // The latency has recovered by the next retry, and the tuner grows the
+  // batch size again.
+  env.AdvanceByMicroseconds(1);
+  tuner->RecordBatch(1, 100);
+  EXPECT_EQ(2, tuner->max_batch_size());
+  tuner->RecordBatch(2, 200);
+  EXPECT_EQ(4, tuner->max_batch_size());
+  EXPECT_EQ(600, tuner->batch_timeout_micros());
+}
+
+TEST(LatencySloBatchTunerTest, UsesP99) {
+  LatencySloBatchTuner::Options options;
+  options.target_latency_micros = 1000;
+  options.batch_sizes = {1, 2};
+  options.max_batch_size = 2;
+  std::unique_ptr<LatencySloBatchTuner> tuner;
+  TF_ASSERT_OK(LatencySloBatchTuner::Create(options, &tuner));
+
+  // Too few samples to estimate the p99.
+  for (int i = 0; i < options.min_samples - 1; ++i) {
+    tuner->RecordBatch(1, 100);
+  }
+  EXPECT_EQ(1, tuner->max_batch_size());
+
+  // A single slow batch out of 100 doesn't affect the p99.
+  tuner->RecordBatch(1, 900);
+  for (int i = options.min_samples; i < options.num_samples; ++i) {
+    tuner->RecordBatch(1, 100);
+  }
+  EXPECT_EQ(2, tuner->max_batch_size());
+  EXPECT_EQ(800, tuner->batch_timeout_micros());
+
+  // Two slow batches out of the last 100 do.
+  tuner->RecordBatch(1, 900);
+  EXPECT_EQ(1, tuner->max_batch_size());
+  EXPECT_EQ(100, tuner->batch_timeout_micros());
+}
+
+TEST(LatencySloBatchTunerTest, ClampsBatchTimeout) {
+  LatencySloBatchTuner::Options options;
+  options.target_latency_micros = 1000;
+  options.max_batch_size = 2;
+  options.min_batch_timeout_micros = 100;
+  options.has_max_batch_timeout = true;
+  options.max_batch_timeout_micros = 300;
+  options.num_samples = 1;
+  options.min_samples = 1;
+  std::unique_ptr<LatencySloBatchTuner> tuner;
+  TF_ASSERT_OK(LatencySloBatchTuner::Create(options, &tuner));
+  EXPECT_EQ(300, tuner->batch_timeout_micros());
+
+  // The batch of 2 fits in the budget left by the minimum timeout.
+  tuner->RecordBatch(2, 880);
+  tuner->RecordBatch(1, 440);
+  EXPECT_EQ(2, tuner->max_batch_size());
+  EXPECT_EQ(120, tuner->batch_timeout_micros());
+
+  // Only the smallest batch size remains, with the minimum timeout.
+  tuner->RecordBatch(1, 950);
+  tuner->RecordBatch(2, 1900);
+  EXPECT_EQ(1, tuner->max_batch_size());
+  EXPECT_EQ(100, tuner->batch_timeout_micros());
+}
+
+TEST(LatencySloBatchTunerTest, ZeroMaxBatchTimeout) {
+  LatencySloBatchTuner::Options options;
+  options.target_latency_micros = 1000;
+  options.max_batch_size = 2;
+  options.has_max_batch_timeout = true;
+  options.max_batch_timeout_micros = 0;
+  options.num_samples = 1;
+  options.min_samples = 1;
+  std::unique_ptr<LatencySloBatchTuner> tuner;
+  TF_ASSERT_OK(LatencySloBatchTuner::Create(options, &tuner));
+  EXPECT_EQ(0, tuner->batch_timeout_micros());
+
+  // The batch size is still tuned, but batches never wait.
+  tuner->RecordBatch(1, 200);
+  tuner->RecordBatch(2, 400);
+  EXPECT_EQ(2, tuner->max_batch_size());
+  EXPECT_EQ(0, tuner->batch_timeout_micros());
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
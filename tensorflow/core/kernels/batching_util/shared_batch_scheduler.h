@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <deque>
 #include <functional>
 #include <list>
@@ -27,6 +28,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/latency_slo_batch_tuner.h"
 #include "tensorflow/core/kernels/batching_util/periodic_function.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -193,6 +195,12 @@ class SharedBatchScheduler
     // submit batches whose size is in a small set of allowed sizes, that can be
     // done by adding padding in the process-batch callback.
     size_t max_execution_batch_size = 1000;
+
+    // If set, the queue closes batches at the maximum batch size and after
+    // the batch timeout chosen by the tuner, instead of using the static
+    // limits above (which still bound the batch size). The queue reports the
+    // processing time of every batch to the tuner.
+    std::shared_ptr<LatencySloBatchTuner> latency_slo_tuner;
   };
   Status AddQueue(const QueueOptions& options,
                   std::function<void(std::unique_ptr<Batch<TaskType>>)>
@@ -300,12 +308,25 @@ class Queue {
   // Returns the maximum allowed size of tasks to be enqueued.
   // Returned value would be less than or equal to the maximum allowed input
   // size that's provided by caller of batch scheduler.
+  // If the queue has a latency SLO tuner, this is the tuner's current maximum
+  // batch size, capped by the static limit.
   size_t max_execution_batch_size() const {
-    if (options_.enable_large_batch_splitting) {
-      return options_.max_execution_batch_size;
-    } else {
-      return options_.input_batch_size_limit;
+    const size_t static_limit = options_.enable_large_batch_splitting
+                                    ? options_.max_execution_batch_size
+                                    : options_.input_batch_size_limit;
+    if (options_.latency_slo_tuner == nullptr) {
+      return static_limit;
+    }
+    return std::min<size_t>(static_limit,
+                            options_.latency_slo_tuner->max_batch_size());
+  }
+
+  // Returns the time an open batch may wait for more tasks.
+  int64 batch_timeout_micros() const {
+    if (options_.latency_slo_tuner == nullptr) {
+      return options_.batch_timeout_micros;
     }
+    return options_.latency_slo_tuner->batch_timeout_micros();
   }
 
   // Called by a thread that is ready to process a batch, to request one from
@@ -334,9 +355,10 @@ class Queue {
   // fresh open batch behind it.
   void StartNewBatch() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
-  // Split `input task` into `output_tasks` according to 'task_sizes'.
+  // Split `input task` into `output_tasks` that fill the open batch and then
+  // batches of up to `max_execution_batch_size`.
   Status SplitInputBatchIntoSubtasks(
-      std::unique_ptr<TaskType>* input_task,
+      std::unique_ptr<TaskType>* input_task, int max_execution_batch_size,
       std::vector<std::unique_ptr<TaskType>>* output_tasks)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
@@ -628,8 +650,9 @@ Status Queue<TaskType>::ScheduleWithoutSplit(std::unique_ptr<TaskType>* task) {
 
     DCHECK(!closed_);
 
-    if (batches_.back()->size() + (*task)->size() >
-        options_.input_batch_size_limit) {
+    if (!batches_.back()->empty() &&
+        batches_.back()->size() + (*task)->size() >
+            max_execution_batch_size()) {
       if (batches_.size() >= options_.max_enqueued_batches) {
         return errors::Unavailable(
             "The batch scheduling queue to which this task was submitted is "
@@ -676,19 +699,22 @@ Status Queue<TaskType>::ScheduleWithSplit(std::unique_ptr<TaskType>* task) {
                                    options_.input_batch_size_limit);
   }
 
-  // The max size to be enqueued.
-  const int max_execution_batch_size = options_.max_execution_batch_size;
-
   bool notify_of_schedulable_batch = false;
   {
     mutex_lock l(mu_);
 
     DCHECK(!closed_);
 
+    // The max size to be enqueued.
+    const int max_execution_batch_size = this->max_execution_batch_size();
+
     const int num_new_batches_schedulable =
         options_.max_enqueued_batches - batches_.size();
-    const int open_batch_capacity =
-        max_execution_batch_size - batches_.back()->size();
+    // The open batch may exceed the current maximum batch size if the latency
+    // SLO tuner lowered it.
+    const int open_batch_capacity = std::max(
+        0, max_execution_batch_size -
+               static_cast<int>(batches_.back()->size()));
     const int scheduling_capacity =
         (num_new_batches_schedulable * max_execution_batch_size) +
         open_batch_capacity;
@@ -704,8 +730,7 @@ Status Queue<TaskType>::ScheduleWithSplit(std::unique_ptr<TaskType>* task) {
           "full");
     }
 
-    const int64 open_batch_remaining_slot =
-        max_execution_batch_size - batches_.back()->size();
+    const int64 open_batch_remaining_slot = open_batch_capacity;
 
     const int64 input_task_size = (*task)->size();
 
@@ -715,12 +740,13 @@ Status Queue<TaskType>::ScheduleWithSplit(std::unique_ptr<TaskType>* task) {
       // This is the fast path when input doesn't need to be split.
       output_tasks.push_back(std::move(*task));
     } else {
-      TF_RETURN_IF_ERROR(SplitInputBatchIntoSubtasks(task, &output_tasks));
+      TF_RETURN_IF_ERROR(SplitInputBatchIntoSubtasks(
+          task, max_execution_batch_size, &output_tasks));
     }
 
     for (int i = 0; i < output_tasks.size(); ++i) {
       if (batches_.back()->size() + output_tasks[i]->size() >
-          options_.max_execution_batch_size) {
+          max_execution_batch_size) {
         StartNewBatch();
       }
       if (batches_.back()->empty()) {
@@ -760,7 +786,8 @@ size_t Queue<TaskType>::SchedulingCapacity() const {
   const int num_new_batches_schedulable =
       options_.max_enqueued_batches - batches_.size();
   const int open_batch_capacity =
-      max_execution_batch_size() - batches_.back()->size();
+      std::max(0, static_cast<int>(max_execution_batch_size()) -
+                      static_cast<int>(batches_.back()->size()));
   return (num_new_batches_schedulable * max_execution_batch_size()) +
          open_batch_capacity;
 }
@@ -798,7 +825,13 @@ void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
       [&batch] { return strings::StrCat("ProcessBatch:", batch->size()); },
       profiler::ContextType::kSharedBatchScheduler,
       batch->traceme_context_id());
+  const int batch_size = batch->size();
+  const uint64 start_time_micros = env_->NowMicros();
   process_batch_callback_(std::move(batch));
+  if (options_.latency_slo_tuner != nullptr) {
+    options_.latency_slo_tuner->RecordBatch(
+        batch_size, env_->NowMicros() - start_time_micros);
+  }
 
   {
     mutex_lock l(mu_);
@@ -845,13 +878,13 @@ void Queue<TaskType>::StartNewBatch() {
 
 template <typename TaskType>
 Status Queue<TaskType>::SplitInputBatchIntoSubtasks(
-    std::unique_ptr<TaskType>* input_task,
+    std::unique_ptr<TaskType>* input_task, int max_execution_batch_size,
     std::vector<std::unique_ptr<TaskType>>* output_tasks) {
-  const int open_batch_remaining_slot =
-      max_execution_batch_size() - batches_.back()->size();
+  const int open_batch_remaining_slot = std::max(
+      0, max_execution_batch_size - static_cast<int>(batches_.back()->size()));
   return options_.split_input_task_func(
       std::move(input_task), open_batch_remaining_slot,
-      max_execution_batch_size(), std::move(output_tasks));
+      max_execution_batch_size, std::move(output_tasks));
 }
 
 template <typename TaskType>
@@ -862,7 +895,7 @@ bool Queue<TaskType>::IsOpenBatchSchedulable() const {
   }
   return closed_ || open_batch->size() >= max_execution_batch_size() ||
          env_->NowMicros() >=
-             open_batch_start_time_micros_ + options_.batch_timeout_micros;
+             open_batch_start_time_micros_ + batch_timeout_micros();
 }
 
 template <typename TaskType>
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
 
 #include "tensorflow/core/kernels/batching_util/fake_clock_env.h"
+#include "tensorflow/core/kernels/batching_util/latency_slo_batch_tuner.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/macros.h"
@@ -254,6 +255,85 @@ TEST(SharedBatchSchedulerTest, ObeysTimeout) {
   stop_teardown.Notify();
 }
 
+TEST(SharedBatchSchedulerTest, ObeysLatencySloTuner) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    LatencySloBatchTuner::Options tuner_options;
+    tuner_options.target_latency_micros = 1000;
+    tuner_options.max_batch_size = 4;
+    tuner_options.num_samples = 1;
+    tuner_options.min_samples = 1;
+    std::unique_ptr<LatencySloBatchTuner> tuner;
+    TF_ASSERT_OK(LatencySloBatchTuner::Create(tuner_options, &tuner));
+    std::shared_ptr<LatencySloBatchTuner> shared_tuner = std::move(tuner);
+
+    mutex mu;
+    std::vector<int> batch_sizes;
+    Notification batch_processed[3];
+    auto callback = [&env, &mu, &batch_sizes, &batch_processed](
+                        std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      // A batch of n tasks of size 1 takes n * 100 microseconds to process.
+      env.AdvanceByMicroseconds(100 * batch->size());
+      mutex_lock l(mu);
+      batch_sizes.push_back(batch->size());
+      batch_processed[batch_sizes.size() - 1].Notify();
+    };
+    // The tuner is updated after the callback returns.
+    auto wait_for_max_batch_size = [&shared_tuner](int max_batch_size) {
+      while (shared_tuner->max_batch_size() != max_batch_size) {
+        Env::Default()->SleepForMicroseconds(1000);
+      }
+    };
+
+    SharedBatchScheduler<FakeTask>::Options options;
+    options.num_batch_threads = 1;
+    options.env = &env;
+    std::shared_ptr<SharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(SharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    SharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.input_batch_size_limit = 4;
+    queue_options.batch_timeout_micros = 10;
+    queue_options.max_enqueued_batches = 4;
+    queue_options.latency_slo_tuner = shared_tuner;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, callback, &queue));
+
+    // Nothing has been measured yet, so batches are closed at size 1.
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    batch_processed[0].WaitForNotification();
+    wait_for_max_batch_size(2);
+
+    // The tuner allows batches of 2, with a timeout of 800 microseconds.
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_FALSE(batch_processed[1].HasBeenNotified());
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    batch_processed[1].WaitForNotification();
+    wait_for_max_batch_size(4);
+
+    // The tuner allows batches of 4, with a timeout of 600 microseconds.
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    env.AdvanceByMicroseconds(599);
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_FALSE(batch_processed[2].HasBeenNotified());
+    env.AdvanceByMicroseconds(1);
+    batch_processed[2].WaitForNotification();
+
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ(std::vector<int>({1, 2, 1}), batch_sizes);
+    }
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
 TEST(SharedBatchSchedulerTest, ObeysTimeoutWithRealClock) {
   Notification first_batch_processed, second_batch_processed;
   auto callback = [&first_batch_processed, &second_batch_processed](
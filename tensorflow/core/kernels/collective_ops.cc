@@ -47,6 +47,19 @@ static std::unique_ptr<OpKernel> BuildOpKernel(OpKernelConstruction* c,
   return k;
 }
 
+// Reads the attrs that configure compression of the values exchanged by a
+// reduction.  Compression is left unset if the attr is "none".
+static Status GetCompressionAttrs(OpKernelConstruction* c,
+                                  CollectiveParams* col_params) {
+  string compression;
+  TF_RETURN_IF_ERROR(c->GetAttr("compression", &compression));
+  if (compression != "none") {
+    col_params->instance.impl_details.compression = compression;
+  }
+  return c->GetAttr("topk_ratio",
+                    &col_params->instance.impl_details.topk_ratio);
+}
+
 class CollectiveOpKernel : public AsyncOpKernel {
  public:
   explicit CollectiveOpKernel(OpKernelConstruction* c) : AsyncOpKernel(c) {}
@@ -207,6 +220,7 @@ class CollectiveReduceOpKernel : public CollectiveOpKernel {
     OP_REQUIRES_OK(
         c, c->GetAttr("timeout_seconds",
                       &col_params_.instance.impl_details.timeout_seconds));
+    OP_REQUIRES_OK(c, GetCompressionAttrs(c, &col_params_));
     VLOG(2) << "CollectiveReduce instance " << col_params_.instance.instance_key
             << " merge_op " << merge_op_name << " final_op " << final_op_name
             << " communication_hint "
@@ -455,6 +469,7 @@ class CollectiveReduceV2OpKernel : public AsyncOpKernel {
     OP_REQUIRES_OK(
         c, c->GetAttr("communication_hint",
                       &col_params_->instance.impl_details.communication_hint));
+    OP_REQUIRES_OK(c, GetCompressionAttrs(c, col_params_.get()));
     // Prepare OpKernels for reduction and final operations.
     // The merge_op takes two inputs
     NodeDef sub_node;
@@ -510,6 +525,10 @@ class CollectiveReduceV2OpKernel : public AsyncOpKernel {
     col_params->instance.impl_details.communication_hint =
         col_params_->instance.impl_details.communication_hint;
     col_params->instance.impl_details.timeout_seconds = 0;
+    col_params->instance.impl_details.compression =
+        col_params_->instance.impl_details.compression;
+    col_params->instance.impl_details.topk_ratio =
+        col_params_->instance.impl_details.topk_ratio;
     col_params->instance.impl_details.subdiv_offsets =
         col_params_->instance.impl_details.subdiv_offsets;
     col_params->merge_op = std::move(col_params_->merge_op);
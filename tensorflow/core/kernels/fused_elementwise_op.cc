@@ -0,0 +1,302 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements the _FusedElementwise op, created by the Grappler elementwise
+// fusion pass (see grappler/optimizers/elementwise_fusion.h). The op evaluates
+// an expression tree of element-wise ops block by block, keeping intermediate
+// results for a block in a small scratch buffer, so that the inputs and the
+// output are read and written from memory exactly once.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Number of elements processed at once. Intermediate results for a block must
+// fit into the L1/L2 cache.
+constexpr int64 kBlockSize = 1024;
+// Rough cost of evaluating a single fused op for one element.
+constexpr int64 kCostPerElement = 5;
+
+enum class FusedOp {
+  kAbs,
+  kExp,
+  kLog,
+  kNeg,
+  kReciprocal,
+  kRelu,
+  kRsqrt,
+  kSigmoid,
+  kSqrt,
+  kSquare,
+  kTanh,
+  kAdd,
+  kDiv,
+  kMaximum,
+  kMinimum,
+  kMul,
+  kSquaredDifference,
+  kSub,
+};
+
+struct FusedOpSpec {
+  const char* name;
+  FusedOp op;
+  int arity;
+};
+
+// NOTE: Keep in sync with the list of supported ops in
+// grappler/optimizers/elementwise_fusion.cc.
+constexpr FusedOpSpec kFusedOpSpecs[] = {
+    {"Abs", FusedOp::kAbs, 1},
+    {"Exp", FusedOp::kExp, 1},
+    {"Inv", FusedOp::kReciprocal, 1},
+    {"Log", FusedOp::kLog, 1},
+    {"Neg", FusedOp::kNeg, 1},
+    {"Reciprocal", FusedOp::kReciprocal, 1},
+    {"Relu", FusedOp::kRelu, 1},
+    {"Rsqrt", FusedOp::kRsqrt, 1},
+    {"Sigmoid", FusedOp::kSigmoid, 1},
+    {"Sqrt", FusedOp::kSqrt, 1},
+    {"Square", FusedOp::kSquare, 1},
+    {"Tanh", FusedOp::kTanh, 1},
+    {"Add", FusedOp::kAdd, 2},
+    {"AddV2", FusedOp::kAdd, 2},
+    {"Div", FusedOp::kDiv, 2},
+    {"Maximum", FusedOp::kMaximum, 2},
+    {"Minimum", FusedOp::kMinimum, 2},
+    {"Mul", FusedOp::kMul, 2},
+    {"RealDiv", FusedOp::kDiv, 2},
+    {"SquaredDifference", FusedOp::kSquaredDifference, 2},
+    {"Sub", FusedOp::kSub, 2},
+};
+
+const FusedOpSpec* FindFusedOpSpec(const string& name) {
+  for (const FusedOpSpec& spec : kFusedOpSpecs) {
+    if (name == spec.name) return &spec;
+  }
+  return nullptr;
+}
+
+// A single step of the fused expression. Operands index into the op inputs
+// (index < num_args) or into the results of the previous steps.
+struct Instruction {
+  FusedOp op;
+  int operands[2];
+};
+
+}  // namespace
+
+template <typename T>
+class FusedElementwiseOp : public OpKernel {
+ public:
+  explicit FusedElementwiseOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("num_args", &num_args_));
+
+    std::vector<string> fused_ops;
+    std::vector<int32> fused_op_inputs;
+    OP_REQUIRES_OK(context, context->GetAttr("fused_ops", &fused_ops));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("fused_op_inputs", &fused_op_inputs));
+
+    int next_operand = 0;
+    for (int i = 0; i < fused_ops.size(); ++i) {
+      const FusedOpSpec* spec = FindFusedOpSpec(fused_ops[i]);
+      OP_REQUIRES(
+          context, spec != nullptr,
+          errors::Unimplemented("Unsupported fused op: ", fused_ops[i]));
+
+      Instruction instruction;
+      instruction.op = spec->op;
+      for (int j = 0; j < 2; ++j) {
+        if (j >= spec->arity) {
+          // Unused operand of a unary op.
+          instruction.operands[j] = instruction.operands[0];
+          continue;
+        }
+        OP_REQUIRES(context, next_operand < fused_op_inputs.size(),
+                    errors::InvalidArgument(
+                        "Not enough fused_op_inputs for fused op ", i, ": ",
+                        fused_ops[i]));
+        const int operand = fused_op_inputs[next_operand++];
+        OP_REQUIRES(
+            context, operand >= 0 && operand < num_args_ + i,
+            errors::InvalidArgument("Fused op ", i, " (", fused_ops[i],
+                                    ") has invalid operand index ", operand));
+        instruction.operands[j] = operand;
+      }
+      program_.push_back(instruction);
+    }
+    OP_REQUIRES(context, next_operand == fused_op_inputs.size(),
+                errors::InvalidArgument("Unused fused_op_inputs: expected ",
+                                        next_operand, " but got ",
+                                        fused_op_inputs.size()));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    for (int i = 1; i < num_args_; ++i) {
+      OP_REQUIRES(context, context->input(i).shape() == input.shape(),
+                  errors::InvalidArgument(
+                      "All inputs must have the same shape, but input 0 has "
+                      "shape ",
+                      input.shape().DebugString(), " and input ", i,
+                      " has shape ", context->input(i).shape().DebugString()));
+    }
+
+    // Output can reuse any of the input buffers, because each output block is
+    // written only after all reads of the same block.
+    std::vector<int> candidate_inputs(num_args_);
+    std::iota(candidate_inputs.begin(), candidate_inputs.end(), 0);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
+                                candidate_inputs, 0, input.shape(), &output));
+
+    const int64 num_elements = input.NumElements();
+    if (num_elements == 0) return;
+
+    std::vector<const T*> args(num_args_);
+    for (int i = 0; i < num_args_; ++i) {
+      args[i] = context->input(i).flat<T>().data();
+    }
+    T* out = output->flat<T>().data();
+
+    const int64 num_blocks = Eigen::divup(num_elements, kBlockSize);
+    auto evaluate_blocks = [&](int64 start, int64 limit) {
+      std::vector<T> scratch(program_.size() * kBlockSize);
+      for (int64 block = start; block < limit; ++block) {
+        const int64 offset = block * kBlockSize;
+        const int64 size = std::min(kBlockSize, num_elements - offset);
+        EvaluateBlock(args, offset, size, scratch.data(), out + offset);
+      }
+    };
+
+    auto* worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    const int64 cost_per_block = kBlockSize * program_.size() * kCostPerElement;
+    Shard(worker_threads->num_threads, worker_threads->workers, num_blocks,
+          cost_per_block, evaluate_blocks);
+  }
+
+ private:
+  using Vec = typename TTypes<T>::UnalignedFlat;
+  using ConstVec = typename TTypes<T>::UnalignedConstFlat;
+
+  void EvaluateBlock(const std::vector<const T*>& args, int64 offset,
+                     int64 size, T* scratch, T* out) const {
+    const auto operand = [&](int index) -> ConstVec {
+      if (index < num_args_) return ConstVec(args[index] + offset, size);
+      return ConstVec(scratch + (index - num_args_) * kBlockSize, size);
+    };
+
+    const int num_instructions = program_.size();
+    for (int i = 0; i < num_instructions; ++i) {
+      const Instruction& instruction = program_[i];
+      Vec result(i + 1 == num_instructions ? out : scratch + i * kBlockSize,
+                 size);
+      ConstVec x = operand(instruction.operands[0]);
+      ConstVec y = operand(instruction.operands[1]);
+
+      switch (instruction.op) {
+        case FusedOp::kAbs:
+          result = x.abs();
+          break;
+        case FusedOp::kExp:
+          result = x.exp();
+          break;
+        case FusedOp::kLog:
+          result = x.log();
+          break;
+        case FusedOp::kNeg:
+          result = -x;
+          break;
+        case FusedOp::kReciprocal:
+          result = x.inverse();
+          break;
+        case FusedOp::kRelu:
+          result = x.cwiseMax(static_cast<T>(0));
+          break;
+        case FusedOp::kRsqrt:
+          result = x.rsqrt();
+          break;
+        case FusedOp::kSigmoid:
+          result = x.sigmoid();
+          break;
+        case FusedOp::kSqrt:
+          result = x.sqrt();
+          break;
+        case FusedOp::kSquare:
+          result = x.square();
+          break;
+        case FusedOp::kTanh:
+          result = x.tanh();
+          break;
+        case FusedOp::kAdd:
+          result = x + y;
+          break;
+        case FusedOp::kDiv:
+          result = x / y;
+          break;
+        case FusedOp::kMaximum:
+          result = x.cwiseMax(y);
+          break;
+        case FusedOp::kMinimum:
+          result = x.cwiseMin(y);
+          break;
+        case FusedOp::kMul:
+          result = x * y;
+          break;
+        case FusedOp::kSquaredDifference:
+          result = (x - y).square();
+          break;
+        case FusedOp::kSub:
+          result = x - y;
+          break;
+      }
+    }
+  }
+
+  int num_args_;
+  std::vector<Instruction> program_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedElementwiseOp);
+};
+
+#define REGISTER_CPU(T)                                        \
+  REGISTER_KERNEL_BUILDER(Name("_FusedElementwise")            \
+                              .Device(DEVICE_CPU)              \
+                              .TypeConstraint<T>("T"),         \
+                          FusedElementwiseOp<T>);
+
+TF_CALL_float(REGISTER_CPU);
+TF_CALL_double(REGISTER_CPU);
+
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
@@ -0,0 +1,109 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+class FusedElementwiseOpTest : public OpsTestBase {
+ protected:
+  Status MakeOp(int num_args, const std::vector<string>& fused_ops,
+                const std::vector<int>& fused_op_inputs) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("fused_elementwise", "_FusedElementwise")
+                           .Input(FakeInput(num_args, DT_FLOAT))
+                           .Attr("num_args", num_args)
+                           .Attr("fused_ops", fused_ops)
+                           .Attr("fused_op_inputs", fused_op_inputs)
+                           .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(FusedElementwiseOpTest, UnaryChain) {
+  // y = Tanh(Neg(x))
+  TF_ASSERT_OK(MakeOp(1, {"Neg", "Tanh"}, {0, 1}));
+  AddInputFromArray<float>(TensorShape({4}), {-1.0f, 0.0f, 0.5f, 2.0f});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({4}));
+  test::FillValues<float>(&expected, {std::tanh(1.0f), 0.0f, std::tanh(-0.5f),
+                                      std::tanh(-2.0f)});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedElementwiseOpTest, ExpressionTree) {
+  // y = Sigmoid(a * b) + Relu(a - c)
+  TF_ASSERT_OK(MakeOp(3, {"Mul", "Sigmoid", "Sub", "Relu", "AddV2"},
+                      {0, 1, 3, 0, 2, 5, 4, 6}));
+  AddInputFromArray<float>(TensorShape({2, 2}), {1.0f, -2.0f, 3.0f, 0.5f});
+  AddInputFromArray<float>(TensorShape({2, 2}), {0.5f, 1.0f, -1.0f, 2.0f});
+  AddInputFromArray<float>(TensorShape({2, 2}), {0.0f, 1.0f, 1.0f, 1.0f});
+  TF_ASSERT_OK(RunOpKernel());
+
+  const auto sigmoid = [](float x) { return 1.0f / (1.0f + std::exp(-x)); };
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({2, 2}));
+  test::FillValues<float>(
+      &expected, {sigmoid(0.5f) + 1.0f, sigmoid(-2.0f) + 0.0f,
+                  sigmoid(-3.0f) + 2.0f, sigmoid(1.0f) + 0.0f});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedElementwiseOpTest, MultipleBlocks) {
+  // y = SquaredDifference(x, Square(x)), with more elements than a block.
+  TF_ASSERT_OK(MakeOp(1, {"Square", "SquaredDifference"}, {0, 0, 1}));
+  constexpr int kSize = 5000;
+  std::vector<float> input(kSize);
+  std::vector<float> expected_values(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    input[i] = static_cast<float>(i % 17) / 4.0f;
+    const float diff = input[i] - input[i] * input[i];
+    expected_values[i] = diff * diff;
+  }
+  AddInputFromArray<float>(TensorShape({kSize}), input);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({kSize}));
+  test::FillValues<float>(&expected, expected_values);
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+}
+
+TEST_F(FusedElementwiseOpTest, InvalidOperandIndex) {
+  // Second op refers to its own result.
+  EXPECT_FALSE(MakeOp(1, {"Neg", "Tanh"}, {0, 2}).ok());
+}
+
+TEST_F(FusedElementwiseOpTest, UnsupportedOp) {
+  EXPECT_FALSE(MakeOp(1, {"Cumsum"}, {0}).ok());
+}
+
+TEST_F(FusedElementwiseOpTest, MismatchedShapes) {
+  TF_ASSERT_OK(MakeOp(2, {"Mul"}, {0, 1}));
+  AddInputFromArray<float>(TensorShape({2}), {1.0f, 2.0f});
+  AddInputFromArray<float>(TensorShape({3}), {1.0f, 2.0f, 3.0f});
+  EXPECT_FALSE(RunOpKernel().ok());
+}
+
+}  // namespace tensorflow
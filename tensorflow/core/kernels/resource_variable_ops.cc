@@ -69,6 +69,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/gather_functor.h"
 #include "tensorflow/core/kernels/gather_nd_op.h"
 #include "tensorflow/core/kernels/scatter_functor.h"
+#include "tensorflow/core/kernels/sparse_update_aggregator.h"
 #include "tensorflow/core/kernels/training_op_helpers.h"
 #include "tensorflow/core/kernels/variable_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -77,6 +78,7 @@ limitations under the License.
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/util.h"
 
 namespace tensorflow {
@@ -345,6 +347,9 @@ DestroyResourceOp::DestroyResourceOp(OpKernelConstruction* ctx)
 void DestroyResourceOp::Compute(OpKernelContext* ctx) {
   const ResourceHandle& p = HandleFromInput(ctx, 0);
   Status status = DeleteResource(ctx, p);
+  if (status.ok() && p.hash_code() == TypeIndex::Make<Var>().hash_code()) {
+    DeleteSparseUpdateAggregator(ctx, p);
+  }
   if (ignore_lookup_error_ && errors::IsNotFound(status)) {
     return;
   }
@@ -853,6 +858,11 @@ class ResourceScatterUpdateOp : public OpKernel {
     if (!s.ok()) {
       use_exclusive_lock_ = false;
     }
+    if (std::is_same<Device, CPUDevice>::value &&
+        (op == scatter_op::UpdateOp::ADD || op == scatter_op::UpdateOp::SUB)) {
+      OP_REQUIRES_OK(c, ReadBoolFromEnvVar(kAggregateSparseUpdatesEnvVar,
+                                           false, &aggregate_));
+    }
   }
 
   void Compute(OpKernelContext* c) override {
@@ -864,18 +874,28 @@ class ResourceScatterUpdateOp : public OpKernel {
                                   c->input_dtype(0) == DT_VARIANT;
     if (is_non_pod_dtype || use_exclusive_lock_) {
       mutex_lock ml(*v->mu());
-      DoCompute(c);
+      DoCompute(c, nullptr);
+    } else if (aggregate_) {
+      // Updates are serialized per row by the aggregator.
+      core::RefCountPtr<SparseUpdateAggregator> aggregator;
+      OP_REQUIRES_OK(c, LookupOrCreateSparseUpdateAggregator(
+                            c, HandleFromInput(c, 0), &aggregator));
+      tf_shared_lock ml(*v->mu());
+      DoCompute(c, aggregator.get());
     } else {
       // For POD dtypes, we can safely run the update without the mutex.
       tf_shared_lock ml(*v->mu());
-      DoCompute(c);
+      DoCompute(c, nullptr);
     }
   }
 
  private:
   bool use_exclusive_lock_;
+  // Whether to apply additions through a SparseUpdateAggregator, see
+  // kAggregateSparseUpdatesEnvVar.
+  bool aggregate_ = false;
 
-  void DoCompute(OpKernelContext* c) {
+  void DoCompute(OpKernelContext* c, SparseUpdateAggregator* aggregator) {
     core::RefCountPtr<Var> v;
     OP_REQUIRES_OK(c, LookupResource(c, HandleFromInput(c, 0), &v));
     Tensor* params = v->tensor();
@@ -909,7 +929,22 @@ class ResourceScatterUpdateOp : public OpKernel {
                                 " indexing: ", params->dim_size(0), " > ",
                                 std::numeric_limits<Index>::max()));
 
-    if (N > 0) {
+    if (N > 0 && aggregator != nullptr) {
+      OP_REQUIRES(c,
+                  TensorShapeUtils::IsScalar(updates.shape()) ||
+                      updates.NumElements() % N == 0,
+                  errors::InvalidArgument(
+                      "shape of indices (", indices.shape().DebugString(),
+                      ") is not compatible with the shape of updates (",
+                      updates.shape().DebugString(), ")"));
+      const Index bad_i = aggregator->ScatterAdd<T, Index>(
+          indices, updates, op == scatter_op::UpdateOp::SUB, params);
+      OP_REQUIRES(c, bad_i < 0,
+                  errors::InvalidArgument(
+                      "indices", SliceDebugString(indices.shape(), bad_i),
+                      " = ", indices.flat<Index>()(bad_i), " is not in [0, ",
+                      params->dim_size(0), ")"));
+    } else if (N > 0) {
       auto indices_flat = indices.flat<Index>();
       auto params_flat = params->flat_outer_dims<T>();
       if (TensorShapeUtils::IsScalar(updates.shape())) {
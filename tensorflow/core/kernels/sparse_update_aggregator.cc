@@ -0,0 +1,58 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/sparse_update_aggregator.h"
+
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+
+const char* const kAggregateSparseUpdatesEnvVar =
+    "TF_AGGREGATE_SPARSE_VARIABLE_UPDATES";
+
+constexpr int SparseUpdateAggregator::kNumStripes;
+
+namespace {
+
+string AggregatorName(const ResourceHandle& handle) {
+  return strings::StrCat(handle.name(), "/SparseUpdateAggregator");
+}
+
+}  // namespace
+
+Status LookupOrCreateSparseUpdateAggregator(
+    OpKernelContext* ctx, const ResourceHandle& handle,
+    core::RefCountPtr<SparseUpdateAggregator>* aggregator) {
+  SparseUpdateAggregator* raw = nullptr;
+  TF_RETURN_IF_ERROR(
+      ctx->resource_manager()->LookupOrCreate<SparseUpdateAggregator>(
+          handle.container(), AggregatorName(handle), &raw,
+          [](SparseUpdateAggregator** ret) {
+            *ret = new SparseUpdateAggregator;
+            return Status::OK();
+          }));
+  aggregator->reset(raw);
+  return Status::OK();
+}
+
+void DeleteSparseUpdateAggregator(OpKernelContext* ctx,
+                                  const ResourceHandle& handle) {
+  // Most variables never had an aggregator.
+  ctx->resource_manager()
+      ->Delete<SparseUpdateAggregator>(handle.container(),
+                                       AggregatorName(handle))
+      .IgnoreError();
+}
+
+}  // namespace tensorflow
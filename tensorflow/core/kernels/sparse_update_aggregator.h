@@ -0,0 +1,225 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_SPARSE_UPDATE_AGGREGATOR_H_
+#define TENSORFLOW_CORE_KERNELS_SPARSE_UPDATE_AGGREGATOR_H_
+
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_handle.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Name of the environment variable that makes ResourceScatterAdd and
+// ResourceScatterSub on CPU go through a SparseUpdateAggregator.
+extern const char* const kAggregateSparseUpdatesEnvVar;
+
+// Applies concurrent sparse additions to one resource variable, typically the
+// embedding updates sent to a parameter server by many workers.
+//
+// The rows of the variable are split into kNumStripes stripes by row index.
+// Each call is split by stripe and handed to the stripes in turn.  A stripe is
+// updated by one thread at a time; calls arriving while it is busy are queued,
+// and the next thread to take the stripe merges every queued call, summing the
+// updates of duplicate rows, and writes each row once.  Calls touching
+// different stripes run concurrently, and hot rows are written once per batch
+// rather than once per call.
+//
+// Callers must hold the variable's mutex in shared mode, which keeps its shape
+// fixed and excludes dense writes, and must always pass the same variable.
+class SparseUpdateAggregator : public ResourceBase {
+ public:
+  static constexpr int kNumStripes = 64;
+
+  SparseUpdateAggregator() = default;
+
+  string DebugString() const override { return "SparseUpdateAggregator"; }
+
+  // Adds `updates` (subtracts them if `negate`) to the rows of `params` given
+  // by `indices`.  `updates` is either a scalar added to every element of the
+  // rows, or has one row per index.  Returns the position of the first index
+  // out of range, in which case nothing is applied, or -1 on success.
+  template <typename T, typename Index>
+  Index ScatterAdd(const Tensor& indices, const Tensor& updates, bool negate,
+                   Tensor* params);
+
+ private:
+  // The part of a ScatterAdd call that falls in one stripe.
+  struct Pending {
+    std::vector<int64> rows;
+    // Row of `updates` for each entry of `rows`.
+    std::vector<int64> positions;
+    const void* updates = nullptr;
+    bool scalar = false;
+    bool negate = false;
+    bool done = false;
+  };
+
+  struct Stripe {
+    mutex mu;
+    condition_variable cv;
+    bool busy TF_GUARDED_BY(mu) = false;
+    std::vector<Pending*> queue TF_GUARDED_BY(mu);
+  };
+
+  // Queues `pending` on its stripe and returns once it has been applied,
+  // possibly by another thread.
+  template <typename T>
+  void Submit(Stripe* stripe, Pending* pending, Tensor* params);
+
+  // Writes the updates of `batch` to `params`.
+  template <typename T>
+  static void Apply(const std::vector<Pending*>& batch, Tensor* params);
+
+  Stripe stripes_[kNumStripes];
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SparseUpdateAggregator);
+};
+
+// Returns the aggregator of the resource variable `handle`, creating it on
+// first use.  The aggregator is stored next to the variable in the resource
+// manager of `ctx`.
+Status LookupOrCreateSparseUpdateAggregator(
+    OpKernelContext* ctx, const ResourceHandle& handle,
+    core::RefCountPtr<SparseUpdateAggregator>* aggregator);
+
+// Deletes the aggregator of the resource variable `handle`, if any.
+void DeleteSparseUpdateAggregator(OpKernelContext* ctx,
+                                  const ResourceHandle& handle);
+
+// Implementation details follow.
+
+template <typename T, typename Index>
+Index SparseUpdateAggregator::ScatterAdd(const Tensor& indices,
+                                         const Tensor& updates, bool negate,
+                                         Tensor* params) {
+  const auto indices_flat = indices.flat<Index>();
+  const Index n = static_cast<Index>(indices_flat.size());
+  const Index limit = static_cast<Index>(params->dim_size(0));
+  std::vector<Pending> parts(kNumStripes);
+  for (Index i = 0; i < n; ++i) {
+    const Index index = internal::SubtleMustCopy(indices_flat(i));
+    if (!FastBoundsCheck(index, limit)) return i;
+    Pending& part = parts[index % kNumStripes];
+    part.rows.push_back(index);
+    part.positions.push_back(i);
+  }
+  for (int s = 0; s < kNumStripes; ++s) {
+    Pending& part = parts[s];
+    if (part.rows.empty()) continue;
+    part.updates = updates.tensor_data().data();
+    part.scalar = TensorShapeUtils::IsScalar(updates.shape());
+    part.negate = negate;
+    Submit<T>(&stripes_[s], &part, params);
+  }
+  return -1;
+}
+
+template <typename T>
+void SparseUpdateAggregator::Submit(Stripe* stripe, Pending* pending,
+                                    Tensor* params) {
+  {
+    mutex_lock l(stripe->mu);
+    stripe->queue.push_back(pending);
+  }
+  while (true) {
+    std::vector<Pending*> batch;
+    {
+      mutex_lock l(stripe->mu);
+      while (!pending->done && stripe->busy) {
+        stripe->cv.wait(l);
+      }
+      if (pending->done) return;
+      // `pending` is still queued, so it is part of this batch.
+      stripe->busy = true;
+      batch.swap(stripe->queue);
+    }
+    Apply<T>(batch, params);
+    {
+      mutex_lock l(stripe->mu);
+      for (Pending* p : batch) p->done = true;
+      stripe->busy = false;
+    }
+    stripe->cv.notify_all();
+  }
+}
+
+template <typename T>
+void SparseUpdateAggregator::Apply(const std::vector<Pending*>& batch,
+                                   Tensor* params) {
+  auto params_flat = params->flat_outer_dims<T>();
+  const int64 row_size = params_flat.dimension(1);
+  // Adds row `j` of the updates of `p` to `dst`.
+  auto add_update = [row_size](const Pending& p, size_t j, auto dst) {
+    if (p.scalar) {
+      const T u = *static_cast<const T*>(p.updates);
+      dst = dst + (p.negate ? static_cast<T>(-u) : u);
+      return;
+    }
+    typename TTypes<T>::ConstVec u(
+        static_cast<const T*>(p.updates) + p.positions[j] * row_size,
+        row_size);
+    if (p.negate) {
+      dst -= u;
+    } else {
+      dst += u;
+    }
+  };
+
+  if (batch.size() == 1) {
+    const Pending& p = *batch[0];
+    for (size_t j = 0; j < p.rows.size(); ++j) {
+      add_update(p, j, params_flat.template chip<0>(p.rows[j]));
+    }
+    return;
+  }
+
+  // Sum the updates of each distinct row, then write every row once.
+  absl::flat_hash_map<int64, int64> slots;
+  std::vector<int64> slot_rows;
+  for (const Pending* p : batch) {
+    for (int64 row : p->rows) {
+      if (slots.emplace(row, slot_rows.size()).second) {
+        slot_rows.push_back(row);
+      }
+    }
+  }
+  Tensor sums(DataTypeToEnum<T>::value,
+              TensorShape({static_cast<int64>(slot_rows.size()), row_size}));
+  auto sums_flat = sums.matrix<T>();
+  sums_flat.setZero();
+  for (const Pending* p : batch) {
+    for (size_t j = 0; j < p->rows.size(); ++j) {
+      add_update(*p, j, sums_flat.template chip<0>(slots[p->rows[j]]));
+    }
+  }
+  for (size_t slot = 0; slot < slot_rows.size(); ++slot) {
+    params_flat.template chip<0>(slot_rows[slot]) +=
+        sums_flat.template chip<0>(slot);
+  }
+}
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_SPARSE_UPDATE_AGGREGATOR_H_
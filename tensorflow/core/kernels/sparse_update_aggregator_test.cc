@@ -0,0 +1,146 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/sparse_update_aggregator.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+Tensor Zeros(int64 rows, int64 cols) {
+  Tensor t(DT_FLOAT, TensorShape({rows, cols}));
+  t.flat<float>().setZero();
+  return t;
+}
+
+TEST(SparseUpdateAggregatorTest, AddsAndSubtractsRows) {
+  core::RefCountPtr<SparseUpdateAggregator> aggregator(
+      new SparseUpdateAggregator);
+  Tensor params = Zeros(3, 2);
+  EXPECT_EQ(-1, (aggregator->ScatterAdd<float, int32>(
+                    test::AsTensor<int32>({2, 0, 2}),
+                    test::AsTensor<float>({1, 2, 3, 4, 5, 6}, {3, 2}),
+                    /*negate=*/false, &params)));
+  EXPECT_EQ(-1, (aggregator->ScatterAdd<float, int64>(
+                    test::AsTensor<int64>({1}), test::AsScalar<float>(10),
+                    /*negate=*/true, &params)));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({3, 4, -10, -10, 6, 8}, {3, 2}), params);
+}
+
+TEST(SparseUpdateAggregatorTest, OutOfRangeIndexAppliesNothing) {
+  core::RefCountPtr<SparseUpdateAggregator> aggregator(
+      new SparseUpdateAggregator);
+  Tensor params = Zeros(2, 1);
+  EXPECT_EQ(2, (aggregator->ScatterAdd<float, int32>(
+                   test::AsTensor<int32>({0, 1, 2}),
+                   test::AsTensor<float>({1, 1, 1}, {3, 1}),
+                   /*negate=*/false, &params)));
+  test::ExpectTensorEqual<float>(Zeros(2, 1), params);
+}
+
+TEST(SparseUpdateAggregatorTest, ConcurrentUpdatesOfHotRows) {
+  const int kNumThreads = 16;
+  const int kNumCalls = 200;
+  const int kNumIndices = 32;
+  const int64 kNumRows = 100;
+  const int64 kRowSize = 8;
+  core::RefCountPtr<SparseUpdateAggregator> aggregator(
+      new SparseUpdateAggregator);
+  Tensor params = Zeros(kNumRows, kRowSize);
+  std::vector<Tensor> expected(kNumThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&, t]() {
+        random::PhiloxRandom philox(t + 1);
+        random::SimplePhilox rnd(&philox);
+        expected[t] = Zeros(kNumRows, kRowSize);
+        auto sum = expected[t].matrix<float>();
+        for (int call = 0; call < kNumCalls; ++call) {
+          Tensor indices(DT_INT32, TensorShape({kNumIndices}));
+          Tensor updates(DT_FLOAT, TensorShape({kNumIndices, kRowSize}));
+          for (int i = 0; i < kNumIndices; ++i) {
+            // Half of the indices go to a few hot rows.
+            const int32 row = (i % 2 == 0) ? rnd.Uniform(4)
+                                           : rnd.Uniform(kNumRows);
+            indices.vec<int32>()(i) = row;
+            for (int64 j = 0; j < kRowSize; ++j) {
+              // Small integers keep the float sums exact in any order.
+              const float value = static_cast<float>(rnd.Uniform(5));
+              updates.matrix<float>()(i, j) = value;
+              sum(row, j) += value;
+            }
+          }
+          EXPECT_EQ(-1, (aggregator->ScatterAdd<float, int32>(
+                            indices, updates, /*negate=*/false, &params)));
+        }
+      });
+    }
+  }
+  Tensor total = Zeros(kNumRows, kRowSize);
+  for (const Tensor& t : expected) {
+    total.flat<float>() += t.flat<float>();
+  }
+  test::ExpectTensorEqual<float>(total, params);
+}
+
+void BM_ConcurrentScatterAdd(int iters, int num_threads, int num_rows) {
+  testing::StopTiming();
+  const int kNumIndices = 256;
+  const int64 kRowSize = 64;
+  core::RefCountPtr<SparseUpdateAggregator> aggregator(
+      new SparseUpdateAggregator);
+  Tensor params = Zeros(num_rows, kRowSize);
+  Tensor indices(DT_INT32, TensorShape({kNumIndices}));
+  random::PhiloxRandom philox(1);
+  random::SimplePhilox rnd(&philox);
+  for (int i = 0; i < kNumIndices; ++i) {
+    indices.vec<int32>()(i) = rnd.Uniform(num_rows);
+  }
+  Tensor updates(DT_FLOAT, TensorShape({kNumIndices, kRowSize}));
+  updates.flat<float>().setConstant(1);
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_threads *
+                          kNumIndices);
+  testing::StartTiming();
+  {
+    thread::ThreadPool pool(Env::Default(), "bench", num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&]() {
+        for (int i = 0; i < iters; ++i) {
+          aggregator->ScatterAdd<float, int32>(indices, updates,
+                                               /*negate=*/false, &params);
+        }
+      });
+    }
+  }
+  testing::StopTiming();
+}
+BENCHMARK(BM_ConcurrentScatterAdd)
+    ->ArgPair(1, 1000)
+    ->ArgPair(8, 1000)
+    ->ArgPair(8, 16)
+    ->ArgPair(32, 16);
+
+}  // namespace
+}  // namespace tensorflow
@@ -54,6 +54,16 @@ REGISTER_OP("BatchFunction")
     // NOTE: Support for `enable_large_batch_splitting == true` is still
     // developed in progress.
     .Attr("enable_large_batch_splitting: bool = false")
+    // If positive, the batch size and the batch timeout are tuned at runtime
+    // so that the 99th percentile latency of the op stays below this target.
+    .Attr("target_latency_micros: int = 0")
+    // If 'enable_ragged_batching' is true, inputs of different tasks may
+    // differ in their 1st dimension, e.g. the sequence length. Instead of
+    // being padded, each input is passed to 'f' as a pair of flat values and
+    // int64 row splits, and the outputs listed in 'ragged_output_indices' are
+    // split back along the row lengths of the first input.
+    .Attr("enable_ragged_batching: bool = false")
+    .Attr("ragged_output_indices: list(int) = []")
     // TODO(apassos): Fix this shape inference function. It requires shape
     // inference of function calls.
     .SetShapeFn(shape_inference::UnknownShape);
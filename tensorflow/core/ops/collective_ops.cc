@@ -32,6 +32,8 @@ REGISTER_OP("CollectiveReduce")
     .Attr("wait_for: list(int) = []")
     .Attr("communication_hint: string = 'auto'")
     .Attr("timeout_seconds: float = 0")
+    .Attr("compression: {'none', 'bf16', 'fp16', 'topk'} = 'none'")
+    .Attr("topk_ratio: float = 0.01")
     .SetIsStateful()
     .SetShapeFn(shape_inference::UnchangedShape);
 
@@ -114,6 +116,8 @@ REGISTER_OP("CollectiveReduceV2")
     .Attr("merge_op: {'Min', 'Max', 'Mul', 'Add'}")
     .Attr("final_op: {'Id', 'Div'}")
     .Attr("communication_hint: string = 'auto'")
+    .Attr("compression: {'none', 'bf16', 'fp16', 'topk'} = 'none'")
+    .Attr("topk_ratio: float = 0.01")
     .SetIsStateful()
     .SetShapeFn(shape_inference::UnchangedShape);
 
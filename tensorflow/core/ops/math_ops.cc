@@ -1121,6 +1121,41 @@ _FusedConv2D output.
 expected to create these operators.
 )doc");
 
+REGISTER_OP("_FusedElementwise")
+    .Input("args: num_args * T")
+    .Output("y: T")
+    .Attr("T: {float, double}")
+    .Attr("num_args: int >= 1")
+    .Attr("fused_ops: list(string) >= 1")
+    .Attr("fused_op_inputs: list(int)")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle out = c->input(0);
+      for (int i = 1; i < c->num_inputs(); ++i) {
+        TF_RETURN_IF_ERROR(c->Merge(out, c->input(i), &out));
+      }
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Evaluates an expression tree of element-wise operations in a single pass.
+
+All `args` must have the same shape, broadcasting is not supported. The
+expression is specified by the `fused_ops` attribute, which is a list of TF op
+names specified as strings (e.g. "Tanh"), evaluated in order. The operands of
+each op are taken from `fused_op_inputs` in order (one index per op input): an
+index `i < num_args` refers to `args[i]`, and an index `num_args + j` refers to
+the result of the `j`-th fused op. The result of the last fused op is the
+output.
+
+Currently supported fused ops are: unary {"Abs","Exp","Inv","Log","Neg",
+"Reciprocal","Relu","Rsqrt","Sigmoid","Sqrt","Square","Tanh"} and binary
+{"Add","AddV2","Div","Maximum","Minimum","Mul","RealDiv","SquaredDifference",
+"Sub"}.
+
+*NOTE*: Do not invoke this operator directly in Python. Grappler is
+expected to create these operators.
+)doc");
+
 // --------------------------------------------------------------------------
 
 // For operations where the output is a reduction function along some
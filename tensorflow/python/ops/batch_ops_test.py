@@ -404,6 +404,43 @@ class BatchOpsTest(test.TestCase):
           np.all(
               np.equal(main_results[0], np.array([5, 6, 7], dtype=np.int32))))
 
+  def testBatchFunctionOpWithRaggedBatching(self):
+    """Tests that the batch_function op batches inputs without padding."""
+    if context.executing_eagerly():
+      return
+
+    with self.cached_session() as sess:
+
+      @function.Defun(dtypes.int32, dtypes.int64)
+      def computation(values, row_splits):
+        # One output per value, and one per row.
+        return values + 1, row_splits[1:] - row_splits[:-1]
+
+      inp = array_ops.placeholder(dtype=dtypes.int32, shape=[1, None])
+      result = gen_batch_ops.batch_function(
+          [inp],
+          num_batch_threads=1,
+          max_batch_size=10,
+          batch_timeout_micros=100000,  # 100ms
+          Tout=[dtypes.int32, dtypes.int64],
+          enable_ragged_batching=True,
+          ragged_output_indices=[0],
+          f=computation,
+          captured_tensors=computation.captured_inputs)
+      thread_results = []
+
+      def worker():
+        thread_results.extend(sess.run(result, feed_dict={inp: [[1, 2, 3]]}))
+
+      worker_thread = threading.Thread(target=worker)
+      worker_thread.start()
+      main_results = sess.run(result, feed_dict={inp: [[4, 5]]})
+      worker_thread.join()
+      self.assertAllEqual(thread_results[0], [[2, 3, 4]])
+      self.assertAllEqual(thread_results[1], [3])
+      self.assertAllEqual(main_results[0], [[5, 6]])
+      self.assertAllEqual(main_results[1], [2])
+
   def testBasicUnbatchDecoratedWithReshape(self):
     """Tests that the batch_function decorator works."""
     if context.executing_eagerly():
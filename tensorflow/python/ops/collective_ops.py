@@ -28,7 +28,9 @@ def all_reduce(t,
                final_op,
                subdiv_offsets=(0,),
                communication_hint='auto',
-               timeout=0):
+               timeout=0,
+               compression='none',
+               topk_ratio=0.01):
   """Reduces tensors collectively, across devices.
 
   Args:
@@ -45,11 +47,21 @@ def all_reduce(t,
       independent subdivision should begin.  Use [0] if no subdivision should
       be done.
     communication_hint: preferred collective communication.  The implementation
-      may fall back to another mechanism.  Options include `auto`, `ring`, and
-      `nccl`.
+      may fall back to another mechanism.  Options include `auto`, `ring`,
+      `nccl`, and `hierarchical`.  `hierarchical` reduces within each task
+      before reducing across tasks, and only applies to CPU devices.
     timeout: If set to a non zero, set a completion timeout to detect staleness.
       If the timer goes off, a DeadlineExceededError is raised.
       The timeout value in seconds. This feature is experimental.
+    compression: lossy compression of the values exchanged between devices,
+      one of `none`, `bf16`, `fp16` or `topk`.  Values are still reduced in
+      float32.  `topk` only sends the `topk_ratio` fraction of largest
+      magnitude values of each chunk and adds the rest to the next reduction
+      with the same `instance_key` (error feedback), so it requires
+      `merge_op` 'Add'.
+      Compression uses the ring implementation and only applies to float32
+      tensors on CPU devices.  This feature is experimental.
+    topk_ratio: fraction of values sent by `topk` compression.
 
   Returns:
     An Op implementing the distributed reduction.
@@ -68,7 +80,9 @@ def all_reduce(t,
       final_op=final_op,
       subdiv_offsets=subdiv_offsets,
       communication_hint=communication_hint.lower(),
-      timeout_seconds=timeout)
+      timeout_seconds=timeout,
+      compression=compression.lower(),
+      topk_ratio=topk_ratio)
 
 
 def all_gather(t,
@@ -21,6 +21,8 @@ from __future__ import print_function
 import threading
 import time
 
+import numpy as np
+
 from tensorflow.core.protobuf import config_pb2
 from tensorflow.core.protobuf import rewriter_config_pb2
 from tensorflow.python.eager import context
@@ -57,7 +59,9 @@ class CollectiveOpTest(test.TestCase):
                             merge_op='Add',
                             final_op='Div',
                             timeout=0,
-                            reported_group_size=None):
+                            reported_group_size=None,
+                            compression='none',
+                            tolerance=None):
     group_key = 1
     group_size = len(inputs)
     if reported_group_size is None:
@@ -81,12 +85,14 @@ class CollectiveOpTest(test.TestCase):
                   merge_op,
                   final_op,
                   communication_hint=communication_hint,
-                  timeout=timeout))
+                  timeout=timeout,
+                  compression=compression))
       run_options = config_pb2.RunOptions()
       if set_graph_key:
         run_options.experimental.collective_graph_key = 1
       results = sess.run(colred, options=run_options)
-    tolerance = 1e-3 if fp16 else 1e-5
+    if tolerance is None:
+      tolerance = 1e-3 if fp16 else 1e-5
     for i in range(group_size):
       logging.info('i {} result {} expected {}'.format(i, results[i], expected))
       self.assertAllClose(results[i], expected, rtol=tolerance, atol=tolerance)
@@ -137,6 +143,76 @@ class CollectiveOpTest(test.TestCase):
           set_graph_key=True,
           fp16=True)
 
+  def testBf16CompressedReduce(self):
+    with ops.Graph().as_default():
+      self._testCollectiveReduce(
+          inputs=[[0.1, 1.1, 2.1, 3.1, 4.1, 5.1, 6.1, 7.1],
+                  [0.3, 1.3, 2.3, 3.3, 4.3, 5.3, 6.3, 7.3]],
+          expected=[0.2, 1.2, 2.2, 3.2, 4.2, 5.2, 6.2, 7.2],
+          set_graph_key=True,
+          compression='bf16',
+          tolerance=2e-2)
+
+  def testFp16CompressedReduce(self):
+    with ops.Graph().as_default():
+      self._testCollectiveReduce(
+          inputs=[[0.1, 1.1, 2.1, 3.1, 4.1, 5.1, 6.1, 7.1],
+                  [0.3, 1.3, 2.3, 3.3, 4.3, 5.3, 6.3, 7.3]],
+          expected=[0.2, 1.2, 2.2, 3.2, 4.2, 5.2, 6.2, 7.2],
+          set_graph_key=True,
+          compression='fp16',
+          tolerance=1e-2)
+
+  def testTopKCompressionRequiresAdd(self):
+    with ops.Graph().as_default():
+      with self.assertRaisesRegex(errors.InvalidArgumentError,
+                                  'requires merge_op Add'):
+        self._testCollectiveReduce(
+            inputs=[[1., 2.], [3., 4.]],
+            expected=[3., 4.],
+            set_graph_key=True,
+            merge_op='Max',
+            final_op='Id',
+            compression='topk')
+
+  def testTopKCompressedSgdConverges(self):
+    # Fits a linear model with data parallel SGD on 2 replicas whose gradients
+    # are all-reduced with top-k compression.  Error feedback makes up for the
+    # dropped gradient values, so the model still converges.
+    group_size = 2
+    num_features = 16
+    rng = np.random.RandomState(0)
+    true_weights = rng.randn(num_features, 1).astype(np.float32)
+    features = [
+        rng.randn(32, num_features).astype(np.float32)
+        for _ in range(group_size)
+    ]
+    labels = [np.dot(x, true_weights) for x in features]
+    config = config_pb2.ConfigProto(device_count={'CPU': group_size})
+    with ops.Graph().as_default(), self.session(config=config) as sess:
+      weights = []
+      train_ops = []
+      for i in range(group_size):
+        with ops.device('/CPU:%d' % i):
+          w = variables.Variable(
+              array_ops.zeros([num_features, 1]), name='w%d' % i)
+          x = constant_op.constant(features[i])
+          y = constant_op.constant(labels[i])
+          grad = math_ops.matmul(
+              x, math_ops.matmul(x, w) - y, transpose_a=True) / 32.
+          grad = collective_ops.all_reduce(
+              grad, group_size, group_key=7, instance_key=7, merge_op='Add',
+              final_op='Div', compression='topk', topk_ratio=0.25)
+          weights.append(w)
+          train_ops.append(w.assign_sub(0.1 * grad))
+      sess.run(variables.global_variables_initializer())
+      for _ in range(300):
+        sess.run(train_ops)
+      results = sess.run(weights)
+    # Every replica applies the same reduced gradient.
+    self.assertAllEqual(results[0], results[1])
+    self.assertAllClose(results[0], true_weights, rtol=1e-2, atol=1e-2)
+
   def testCollectiveMultipleConcurrentReduce(self):
     # Tests that execute collectives need to be enclosed in graph or tf.function
     with ops.Graph().as_default():